@@ -32,14 +32,57 @@ struct Accessor
 		MAT4
 	};
 
+	/// Substitutions of some elements, stored apart from the buffer view which holds
+	/// the others. Without a buffer view, the other elements are zeros
+	struct Sparse
+	{
+		/// Number of substituted elements
+		size_t count = 0;
+
+		/// Indices of the substituted elements, strictly increasing
+		struct Indices
+		{
+			Handle<BufferView> buffer_view = {};
+
+			/// Offset relative to the start of the bufferView in bytes
+			size_t byte_offset = 0;
+
+			/// UNSIGNED_BYTE, UNSIGNED_SHORT or UNSIGNED_INT
+			ComponentType component_type = ComponentType::UNSIGNED_INT;
+		} indices;
+
+		/// Packed values of the substituted elements
+		struct Values
+		{
+			Handle<BufferView> buffer_view = {};
+
+			/// Offset relative to the start of the bufferView in bytes
+			size_t byte_offset = 0;
+		} values;
+
+		/// Elements with the substitutions applied, made when first needed
+		std::vector<uint8_t> dense;
+
+		std::once_flag materialized;
+	};
+
 	/// @return The size of the data pointed by this accessor
 	size_t get_size() const;
 
-	/// @return The address of the data pointed by this accessor
+	/// @return The size of an element in bytes, including the padding of matrix columns
+	size_t get_element_size() const;
+
+	/// @return The address of the data pointed by this accessor. For a sparse accessor,
+	/// these are its dense elements, applying the substitutions the first time
 	const uint8_t* get_data() const;
 
-	/// @return The stride of the buffer view pointed by this accessor
+	/// @return The stride of the buffer view pointed by this accessor, zero when packed
 	size_t get_stride() const;
+
+	/// Applies the substitutions of a sparse accessor into its dense elements,
+	/// unless already done. It is safe to call it concurrently from multiple threads
+	/// @throw std::runtime_error If indices or values are out of their buffer views
+	void materialize() const;
 	
 	/// The model of the accessor
 	Handle<Accessor> handle = {};
@@ -53,6 +96,10 @@ struct Accessor
 	/// Datatype of components in the attribute
 	ComponentType component_type;
 
+	/// Whether integer components are mapped to [0, 1] for unsigned
+	/// or [-1, 1] for signed types when read as floats
+	bool normalized = false;
+
 	/// Number of attributes referenced by this accessor
 	size_t count;
 
@@ -64,7 +111,18 @@ struct Accessor
 
 	/// Minimum value of each component in this attribute
 	std::vector<float> min;
+
+	/// Null unless the accessor is sparse. Copies of an accessor
+	/// share its substitutions, and their dense elements
+	std::shared_ptr<Sparse> sparse;
 };
 
 
+/// @return The size of a component in bytes
+size_t size_of( Accessor::ComponentType ct );
+
+/// @return The number of components of a type
+size_t size_of( Accessor::Type tp );
+
+
 } // namespace spot::gfx
@@ -0,0 +1,316 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+#include <spot/math/math.h>
+
+#include "spot/gltf/accessor.h"
+#include "spot/gltf/color.h"
+
+namespace spot::gfx
+{
+
+
+/// Layout of accessor elements read as T, specialized for the supported types
+template <typename T>
+struct AccessorLayout;
+
+template <Accessor::ComponentType Component>
+struct ScalarLayout
+{
+	static constexpr auto component_type = Component;
+	static constexpr auto type = Accessor::Type::SCALAR;
+};
+
+template <> struct AccessorLayout<int8_t> : ScalarLayout<Accessor::ComponentType::BYTE> {};
+template <> struct AccessorLayout<uint8_t> : ScalarLayout<Accessor::ComponentType::UNSIGNED_BYTE> {};
+template <> struct AccessorLayout<int16_t> : ScalarLayout<Accessor::ComponentType::SHORT> {};
+template <> struct AccessorLayout<uint16_t> : ScalarLayout<Accessor::ComponentType::UNSIGNED_SHORT> {};
+template <> struct AccessorLayout<uint32_t> : ScalarLayout<Accessor::ComponentType::UNSIGNED_INT> {};
+template <> struct AccessorLayout<float> : ScalarLayout<Accessor::ComponentType::FLOAT> {};
+
+/// Vectors and matrices of N components
+template <typename C, size_t N>
+struct AccessorLayout<std::array<C, N>>
+{
+	static constexpr auto component_type = AccessorLayout<C>::component_type;
+	static constexpr auto type = N == 2 ? Accessor::Type::VEC2
+		: N == 3 ? Accessor::Type::VEC3
+		: N == 4 ? Accessor::Type::VEC4
+		: N == 9 ? Accessor::Type::MAT3
+		: N == 16 ? Accessor::Type::MAT4 : Accessor::Type::NONE;
+	static_assert( type != Accessor::Type::NONE, "Number of components not supported" );
+};
+
+template <> struct AccessorLayout<math::Vec2> : AccessorLayout<std::array<float, 2>> {};
+template <> struct AccessorLayout<math::Vec3> : AccessorLayout<std::array<float, 3>> {};
+/// Read as stored, like Animation::get_rotations always did
+template <> struct AccessorLayout<math::Quat> : AccessorLayout<std::array<float, 4>> {};
+template <> struct AccessorLayout<Color> : AccessorLayout<std::array<float, 4>> {};
+template <> struct AccessorLayout<math::Mat4> : AccessorLayout<std::array<float, 16>> {};
+
+
+/// Checks that the elements of an accessor with a buffer view are within it, whatever their layout
+/// @param accessor Accessor to look into
+/// @param element_size Size of an element in bytes, with the padding of matrix columns
+/// @param stride Set to the distance between elements in bytes
+/// @return The address of the first element, loading its buffer if needed
+/// @throw std::runtime_error If elements are out of the buffer view
+const char* get_accessor_bytes( const Accessor& accessor, size_t element_size, size_t& stride );
+
+
+/// Checks that an accessor holds elements of a layout, within its buffer view
+/// @param accessor Accessor to look into
+/// @param component_type Expected component type
+/// @param type Expected type
+/// @param element_size Size of an element in bytes
+/// @param stride Set to the distance between elements in bytes
+/// @return The address of the first element, loading its buffer if needed
+/// @throw std::runtime_error If the layout does not match or elements are out of the buffer view
+const char* check_accessor_view( const Accessor& accessor, Accessor::ComponentType component_type, Accessor::Type type,
+	size_t element_size, size_t& stride );
+
+
+/// Checks that an accessor holds elements of a layout, and gathers its substitutions when sparse
+/// @param indices Set to the indices of the substituted elements
+/// @param values Set to the address of the packed values of the substituted elements
+/// @return The address of the first element of the buffer view, null when the other elements are zeros
+/// @throw std::runtime_error If the layout does not match, elements are out of their buffer views
+/// or sparse indices are not strictly increasing
+const char* check_sparse_view( const Accessor& accessor, Accessor::ComponentType component_type, Accessor::Type type,
+	size_t element_size, size_t& stride, std::vector<uint32_t>& indices, const char*& values );
+
+
+/// Elements of an accessor read in place as T, without copying them.
+/// The layout is checked once when the view is made, then elements are
+/// plain loads at a fixed stride, whether the buffer view is interleaved or not
+template <typename T>
+class AccessorView
+{
+	static_assert( std::is_trivially_copyable_v<T>, "Elements are read as bytes" );
+
+  public:
+	/// Reads elements by value, as they might not be aligned in the buffer
+	class Iterator
+	{
+	  public:
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const T*;
+		using reference = T;
+
+		Iterator() = default;
+		Iterator( const char* d, size_t s ) : data { d }, stride { s } {}
+
+		T operator*() const { return load( data ); }
+		T operator[]( difference_type n ) const { return load( data + n * difference_type( stride ) ); }
+
+		Iterator& operator++() { data += stride; return *this; }
+		Iterator operator++( int ) { auto ret = *this; data += stride; return ret; }
+		Iterator& operator--() { data -= stride; return *this; }
+		Iterator operator--( int ) { auto ret = *this; data -= stride; return ret; }
+		Iterator& operator+=( difference_type n ) { data += n * difference_type( stride ); return *this; }
+		Iterator& operator-=( difference_type n ) { data -= n * difference_type( stride ); return *this; }
+		Iterator operator+( difference_type n ) const { return Iterator( *this ) += n; }
+		Iterator operator-( difference_type n ) const { return Iterator( *this ) -= n; }
+		friend Iterator operator+( difference_type n, const Iterator& it ) { return it + n; }
+		difference_type operator-( const Iterator& other ) const { return ( data - other.data ) / difference_type( stride ); }
+
+		bool operator==( const Iterator& other ) const { return data == other.data; }
+		bool operator!=( const Iterator& other ) const { return data != other.data; }
+		bool operator<( const Iterator& other ) const { return data < other.data; }
+		bool operator>( const Iterator& other ) const { return data > other.data; }
+		bool operator<=( const Iterator& other ) const { return data <= other.data; }
+		bool operator>=( const Iterator& other ) const { return data >= other.data; }
+
+	  private:
+		const char* data = nullptr;
+		size_t stride = sizeof( T );
+	};
+
+	using value_type = T;
+	using iterator = Iterator;
+	using const_iterator = Iterator;
+
+	AccessorView() = default;
+
+	/// @param accessor Accessor holding elements of type T
+	/// @throw std::runtime_error If the accessor does not hold elements of type T
+	explicit AccessorView( const Accessor& accessor )
+	: bytes { check_accessor_view( accessor, AccessorLayout<T>::component_type, AccessorLayout<T>::type, sizeof( T ), byte_stride ) }
+	, count { accessor.count }
+	{}
+
+	/// @return The number of elements
+	size_t size() const { return count; }
+
+	bool empty() const { return count == 0; }
+
+	/// @return The distance between elements in bytes
+	size_t stride() const { return byte_stride; }
+
+	/// @return The address of the first element
+	const char* data() const { return bytes; }
+
+	/// @return Whether elements are packed, so the view can be copied as a whole
+	bool is_packed() const { return byte_stride == sizeof( T ); }
+
+	T operator[]( size_t i ) const { return load( bytes + i * byte_stride ); }
+
+	T front() const { return ( *this )[0]; }
+
+	T back() const { return ( *this )[count - 1]; }
+
+	Iterator begin() const { return Iterator( bytes, byte_stride ); }
+
+	Iterator end() const { return Iterator( bytes + count * byte_stride, byte_stride ); }
+
+  private:
+	static T load( const char* data )
+	{
+		T ret;
+		std::memcpy( &ret, data, sizeof( T ) );
+		return ret;
+	}
+
+	/// Set while checking the accessor, before bytes
+	size_t byte_stride = sizeof( T );
+
+	const char* bytes = nullptr;
+
+	size_t count = 0;
+};
+
+
+/// Elements of a sparse accessor read as T, overlaying its substitutions on the buffer
+/// view without making them dense. Only the indices are decoded when the view is made,
+/// so large mostly unchanged accessors such as morph targets stay compact.
+/// Substitutions can also be visited on their own, to apply them as deltas
+template <typename T>
+class SparseAccessorView
+{
+	static_assert( std::is_trivially_copyable_v<T>, "Elements are read as bytes" );
+
+  public:
+	/// Walks elements in order, following the next substitution
+	class Iterator
+	{
+	  public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const T*;
+		using reference = T;
+
+		Iterator() = default;
+		Iterator( const SparseAccessorView& v, size_t i, size_t s ) : view { &v }, index { i }, substitution { s } {}
+
+		T operator*() const
+		{
+			return is_substituted() ? view->get_substitution( substitution ) : view->get_base( index );
+		}
+
+		Iterator& operator++()
+		{
+			substitution += is_substituted();
+			++index;
+			return *this;
+		}
+
+		Iterator operator++( int ) { auto ret = *this; ++*this; return ret; }
+
+		bool operator==( const Iterator& other ) const { return index == other.index; }
+		bool operator!=( const Iterator& other ) const { return index != other.index; }
+
+	  private:
+		bool is_substituted() const
+		{
+			return substitution < view->indices.size() && view->indices[substitution] == index;
+		}
+
+		const SparseAccessorView* view = nullptr;
+		size_t index = 0;
+
+		/// Next substitution to meet
+		size_t substitution = 0;
+	};
+
+	using value_type = T;
+	using iterator = Iterator;
+	using const_iterator = Iterator;
+
+	SparseAccessorView() = default;
+
+	/// @param accessor Accessor holding elements of type T, sparse or not
+	/// @throw std::runtime_error If the accessor does not hold elements of type T
+	explicit SparseAccessorView( const Accessor& accessor )
+	: base { check_sparse_view( accessor, AccessorLayout<T>::component_type, AccessorLayout<T>::type, sizeof( T ),
+		  base_stride, indices, values ) }
+	, count { accessor.count }
+	{}
+
+	/// @return The number of elements
+	size_t size() const { return count; }
+
+	bool empty() const { return count == 0; }
+
+	/// @return The element at index i, looking for its substitution first
+	T operator[]( size_t i ) const
+	{
+		auto it = std::lower_bound( indices.begin(), indices.end(), uint32_t( i ) );
+		return it != indices.end() && *it == i ? get_substitution( it - indices.begin() ) : get_base( i );
+	}
+
+	Iterator begin() const { return Iterator( *this, 0, 0 ); }
+
+	Iterator end() const { return Iterator( *this, count, indices.size() ); }
+
+	/// @return The number of substituted elements
+	size_t get_substitution_count() const { return indices.size(); }
+
+	/// @return The index of the element replaced by the k-th substitution
+	uint32_t get_substitution_index( size_t k ) const { return indices[k]; }
+
+	/// @return The value of the k-th substitution
+	T get_substitution( size_t k ) const { return load( values + k * sizeof( T ) ); }
+
+	/// @return The element at index i of the buffer view, ignoring substitutions
+	T get_base( size_t i ) const { return base ? load( base + i * base_stride ) : zero(); }
+
+  private:
+	static T load( const char* data )
+	{
+		T ret;
+		std::memcpy( &ret, data, sizeof( T ) );
+		return ret;
+	}
+
+	/// @return An element of zeros, whatever the default of T
+	static T zero()
+	{
+		T ret;
+		std::memset( &ret, 0, sizeof( T ) );
+		return ret;
+	}
+
+	/// These are set while checking the accessor, before base
+	size_t base_stride = sizeof( T );
+
+	std::vector<uint32_t> indices;
+
+	const char* values = nullptr;
+
+	/// Null when elements which are not substituted are zeros
+	const char* base = nullptr;
+
+	size_t count = 0;
+};
+
+
+} // namespace spot::gfx
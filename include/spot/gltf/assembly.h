@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "spot/gltf/mesh.h"
+
+namespace spot::gfx
+{
+
+
+/// Where an attribute of assembled vertices goes, as floats in memory chosen by the caller.
+/// Streams into the same buffer at different offsets make an interleaved layout,
+/// streams into different buffers make a structure of arrays
+struct VertexStream
+{
+	/// Attribute to write. COLOR_0 is written as four floats, the others as the
+	/// components of their accessor: three for POSITION and NORMAL, two for TEXCOORD_0
+	Primitive::Semantic semantic = Primitive::Semantic::NONE;
+
+	/// Where the attribute of the first vertex goes
+	float* data = nullptr;
+
+	/// Distance between vertices in bytes, zero when packed
+	size_t stride = 0;
+};
+
+
+/// @return Every primitive of a model, by mesh and then by primitive
+std::vector<Primitive*> get_primitives( Gltf& model );
+
+
+/// @return The number of vertices of a primitive, which is the count of its POSITION accessor,
+/// or the number of its vertices for a primitive made at runtime
+size_t get_vertex_count( const Primitive& primitive );
+
+
+/// Positions of the vertices of a primitive, as three floats each
+struct PrimitivePositions
+{
+	PrimitivePositions() = default;
+	PrimitivePositions( PrimitivePositions&& ) = default;
+	PrimitivePositions& operator=( PrimitivePositions&& ) = default;
+
+	/// Position of the first vertex, null for a primitive without positions
+	const float* data = nullptr;
+
+	/// Distance between positions in bytes
+	size_t stride = 3 * sizeof( float );
+
+	/// Number of vertices
+	size_t count = 0;
+
+	/// Positions decoded from the POSITION accessor, which data points into
+	std::vector<float> decoded;
+};
+
+
+/// @return The positions of a primitive, pointing into its runtime vertices while it has some,
+/// which must not change while they are used, or decoded from its POSITION accessor
+/// @throw std::runtime_error If the POSITION accessor is not a VEC3 or can not be read
+PrimitivePositions get_positions( const Primitive& primitive );
+
+
+/// @return Whether every runtime vertex of a primitive has a normal of unit length,
+/// rather than the placeholder a Vertex starts with
+bool has_unit_normals( const Primitive& primitive );
+
+
+/// @return The position of a vertex among positions stride bytes apart
+inline const float* get_position( const float* positions, const size_t stride, const size_t vertex )
+{
+	return reinterpret_cast<const float*>( reinterpret_cast<const uint8_t*>( positions ) + vertex * stride );
+}
+
+
+/// @throw std::runtime_error If the indices are not triangles or an index is out of the vertices
+void check_triangles( const Indices& indices, size_t vertex_count );
+
+
+/// Gathers the attributes of a primitive into streams, whatever the layout of their
+/// accessors. Integer attributes are converted, dequantizing normalized ones, and
+/// colors without alpha get an alpha of one. Uses the SIMD kernels of decode_components.
+/// Streams of attributes the primitive lacks are left as they are
+/// @param primitive Primitive to read
+/// @param streams Where to write get_vertex_count() vertices
+/// @throw std::runtime_error If an attribute does not have the expected type, has fewer
+/// elements than POSITION, or is out of its buffer view
+void assemble_vertices( const Primitive& primitive, const std::vector<VertexStream>& streams );
+
+
+/// Fills the vertices of a primitive from its POSITION, NORMAL, COLOR_0 and TEXCOORD_0 accessors,
+/// leaving the defaults of Vertex for the missing ones. Primitives without POSITION are left as they are
+/// @throw std::runtime_error If an attribute can not be read
+void assemble_vertices( Primitive& primitive );
+
+
+/// Fills the indices of a primitive from its indices accessor, keeping its component type.
+/// Primitives without an indices accessor are left as they are
+/// @throw std::runtime_error If the accessor is not a scalar of unsigned integers or can not be read
+void assemble_indices( Primitive& primitive );
+
+
+/// Stores the indices of a primitive in a new accessor of the model, which becomes its
+/// indices accessor, so indices changed in memory are written along with the model
+/// @param model Model owning the primitive
+/// @param primitive Primitive with indices
+void store_indices( Gltf& model, Primitive& primitive );
+
+
+/// Fills the vertices and indices of every primitive of a model
+/// @param model Model with meshes to assemble
+/// @param threads Maximum number of workers, with 0 primitives are assembled on this thread
+/// @throw std::runtime_error If an attribute can not be read
+void assemble_vertices( Gltf& model, uint32_t threads = 0 );
+
+
+/// Stores the indices of a primitive with the narrowest width its vertices allow,
+/// 8 bits up to 255 vertices and 16 bits up to 65535, which need a renderer supporting them
+/// @throw std::runtime_error If an index is out of the vertices
+void narrow_indices( Primitive& primitive );
+
+/// Narrows the indices of every primitive of a model
+void narrow_indices( Gltf& model );
+
+
+} // namespace spot::gfx
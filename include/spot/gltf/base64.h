@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+namespace spot::gfx
+{
+
+
+/// Decodes base64 text, stopping at the first padding or non-base64 character.
+/// Uses SSSE3 or AVX2 when the CPU supports them
+/// @param encoded Base64 text, such as the payload of a data uri
+/// @return The decoded bytes
+std::vector<char> base64_decode( std::string_view encoded );
+
+
+/// Scalar version of base64_decode, used for the tail and where SIMD is not available
+std::vector<char> base64_decode_scalar( std::string_view encoded );
+
+
+} // namespace spot::gfx
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "spot/gltf/buffer.h"
+#include "spot/gltf/options.h"
+
+namespace spot::gfx
+{
+
+
+/// Identity of the source a blob was made from, the blob is only used
+/// while its source has the same identity
+struct BlobSource
+{
+	/// Size of the source in bytes
+	uint64_t size = 0;
+
+	/// Modification time of the source file, zero for memory
+	int64_t modified = 0;
+
+	/// Hash of the source bytes, zero for files
+	uint64_t hash = 0;
+
+	/// @return The size and modification time of a file, without reading it
+	static BlobSource from_file( const std::string& path );
+
+	/// @return The size and hash of bytes in memory
+	static BlobSource from_bytes( const ByteSpan& bytes );
+
+	bool operator==( const BlobSource& other ) const
+	{
+		return size == other.size && modified == other.modified && hash == other.hash;
+	}
+
+	bool operator!=( const BlobSource& other ) const { return !( *this == other ); }
+};
+
+
+/// @return A fingerprint of the options which change what a loaded model holds: sections,
+/// scenes and topology conversion. Parsers, storage and workers lead to the same model
+uint64_t get_blob_options( const LoadOptions& options );
+
+
+/// @param blob Bytes of a blob written by Gltf::save_blob
+/// @param source Identity of the source the blob should have been made from
+/// @param options Options of the load the blob would stand for
+/// @return Whether the blob is valid, of this version, made from that source with options
+/// shaping the model the same way, and whether the external buffer and image files it was
+/// made from have not changed since
+bool is_blob_current( const ByteSpan& blob, const BlobSource& source, const LoadOptions& options = {} );
+
+
+} // namespace spot::gfx
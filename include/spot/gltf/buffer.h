@@ -1,5 +1,8 @@
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -10,12 +13,77 @@ namespace spot::gfx
 {
 
 
+class BufferCache;
+
+/// Contiguous bytes living in memory owned by someone else
+struct ByteSpan
+{
+	/// Address of the first byte
+	const char* data = nullptr;
+
+	/// Number of bytes
+	size_t size = 0;
+
+	/// Keeps alive the memory pointed by data
+	std::shared_ptr<const void> owner;
+};
+
+
+/// Whether files can be mapped in memory on this platform
+#if defined( ANDROID )
+constexpr bool can_map_files = false;
+#else
+constexpr bool can_map_files = true;
+#endif
+
+
+/// Maps a file in memory for reading
+/// @param path Path of the file
+/// @return The bytes of the file, unmapped when the owner is released
+ByteSpan map_file( const std::string& path );
+
+
 /// Buffer pointing to binary geometry, animation, or skins
 struct ByteBuffer
 {
+	/// How the bytes of an external file are brought into memory
+	enum class Storage
+	{
+		/// Read into data
+		Read,
+		/// Map into span, pages are loaded when touched.
+		/// Falls back to Read where files can not be mapped
+		Map
+	};
+
 	ByteBuffer() = default;
 
-	ByteBuffer( std::string uri, size_t byte_length );
+	/// @param uri Path of a file or data uri
+	/// @param byte_length Length of the buffer in bytes
+	/// @param storage How the file should be brought into memory
+	/// @param lazy Whether to defer loading until the bytes are first needed
+	/// @param cache Cache sharing the bytes of files with other buffers, null to read them here
+	ByteBuffer( std::string uri, size_t byte_length, Storage storage = Storage::Read, bool lazy = false,
+		std::shared_ptr<BufferCache> cache = {} );
+
+	/// Constructs a buffer looking into bytes owned elsewhere, without copying them
+	/// @param span Bytes of the buffer, for example the BIN chunk of a GLB
+	/// @param byte_length Length of the buffer in bytes
+	ByteBuffer( ByteSpan span, size_t byte_length );
+
+	ByteBuffer( ByteBuffer&& other );
+	ByteBuffer& operator=( ByteBuffer&& other );
+	~ByteBuffer();
+
+	/// Brings the bytes of this buffer into memory, if not already there.
+	/// It is safe to call it concurrently from multiple threads
+	void load();
+
+	/// @return Whether the bytes of this buffer are in memory
+	bool is_loaded() const;
+
+	/// @return The address of the bytes of this buffer, loading them if needed
+	const char* get_data();
 
 	Handle<ByteBuffer> handle = {};
 
@@ -25,8 +93,24 @@ struct ByteBuffer
 	/// Length of the buffer in bytes
 	size_t byte_length = 0;
 
-	/// Bytes lazily loaded
+	/// Bytes owned by this buffer, empty until loaded
 	std::vector<char> data;
+
+	/// Bytes owned elsewhere, used instead of data when not empty
+	ByteSpan span;
+
+  private:
+	/// State of a deferred load
+	struct Loader
+	{
+		Storage storage = Storage::Read;
+		std::shared_ptr<BufferCache> cache;
+		std::once_flag once;
+		std::atomic<bool> done = false;
+	};
+
+	/// Null when there is nothing left to load
+	std::unique_ptr<Loader> loader;
 };
 
 
@@ -41,6 +125,9 @@ struct BufferView
 		ElementArrayBuffer = 34963
 	};
 
+	/// @return The address of the first byte of this view, loading its buffer if needed
+	const char* get_data() const;
+
 	Handle<BufferView> handle = {};
 
 	/// Index of the buffer
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "spot/gltf/buffer.h"
+
+namespace spot::gfx
+{
+
+
+/// Cache of external buffer files, so models referring to the same file share
+/// one immutable copy of its bytes instead of reading their own.
+/// Entries are keyed by path and checked against the identity of the file,
+/// so a file changed on disk is read again. Once the cached bytes exceed the
+/// capacity, the least recently used entries are evicted. Bytes still used by
+/// a model stay alive through their owner, and are found again while they are
+class BufferCache
+{
+  public:
+	/// Identity of a file, zero when it can not be queried
+	struct Identity
+	{
+		uint64_t device = 0;
+		uint64_t inode = 0;
+		uint64_t size = 0;
+		int64_t modified = 0;
+
+		bool operator==( const Identity& other ) const
+		{
+			return device == other.device && inode == other.inode && size == other.size && modified == other.modified;
+		}
+	};
+
+	/// Counters of the cache
+	struct Stats
+	{
+		/// Loads served by bytes already in memory
+		uint64_t hits = 0;
+
+		/// Loads which had to read a file
+		uint64_t misses = 0;
+
+		/// Entries dropped to stay within the capacity
+		uint64_t evictions = 0;
+
+		/// Bytes held by the cache
+		size_t bytes = 0;
+
+		/// Files held by the cache
+		size_t entries = 0;
+	};
+
+	/// @param capacity Maximum number of bytes held by the cache
+	explicit BufferCache( size_t capacity = 256 << 20 );
+
+	/// @return The cache shared by the whole process
+	static const std::shared_ptr<BufferCache>& shared();
+
+	/// Brings the bytes of a file into memory, unless they are already cached.
+	/// It is safe to call it concurrently, a file is read once by the first caller
+	/// @param path Path of the file
+	/// @param byte_length Number of bytes needed from the start of the file
+	/// @param storage How the file should be brought into memory
+	/// @return The first byte_length bytes of the file, kept alive by their owner
+	ByteSpan load( const std::string& path, size_t byte_length, ByteBuffer::Storage storage = ByteBuffer::Storage::Read );
+
+	/// @param capacity Maximum number of bytes held by the cache, evicting entries if needed
+	void set_capacity( size_t capacity );
+
+	/// @return The maximum number of bytes held by the cache
+	size_t get_capacity() const;
+
+	/// @return The counters of the cache
+	Stats get_stats() const;
+
+	/// Drops every entry and resets the counters
+	void clear();
+
+  private:
+	struct Entry
+	{
+		Identity identity;
+
+		/// Whole file, null while it is being read
+		ByteSpan span;
+
+		/// Finds the bytes while a model uses them, even once evicted
+		std::weak_ptr<const void> weak;
+
+		/// Ready once the file has been read
+		std::shared_future<void> ready;
+
+		/// Position in the recently used list, end when evicted
+		std::list<std::string>::iterator used;
+	};
+
+	/// @return The bytes of a cached entry, or a null span when it has to be read
+	ByteSpan find( Entry& entry, const std::string& path, const Identity& identity, size_t byte_length );
+
+	/// Marks an entry as the most recently used, holding its bytes
+	void touch( Entry& entry, const std::string& path );
+
+	/// Evicts the least recently used entries until the bytes are within the capacity
+	void trim();
+
+	mutable std::mutex mutex;
+
+	size_t capacity;
+
+	Stats stats;
+
+	std::unordered_map<std::string, Entry> entries;
+
+	/// Paths of the entries holding their bytes, the most recently used first
+	std::list<std::string> recent;
+};
+
+
+/// @return The identity of the file at that path, zero when it can not be queried
+BufferCache::Identity get_identity( const std::string& path );
+
+
+} // namespace spot::gfx
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "spot/gltf/accessor.h"
+
+namespace spot::gfx
+{
+
+
+/// Decodes elements of an accessor into floats, one per component, dequantizing
+/// integer components as KHR_mesh_quantization describes: normalized ones are
+/// mapped to [0, 1] or [-1, 1], others are converted as they are.
+/// Matrix columns padded to four bytes are unpadded. Sparse accessors are decoded
+/// from their dense elements, other accessors without a buffer view decode to zeros.
+/// Uses SSE2 when the CPU supports it
+/// @param accessor Accessor to decode
+/// @param out Room for count times the number of components floats
+/// @throw std::runtime_error If elements are out of the buffer view
+void decode_floats( const Accessor& accessor, float* out );
+
+/// @return The elements of an accessor decoded into floats
+std::vector<float> decode_floats( const Accessor& accessor );
+
+/// Scalar version of decode_floats, used for the tails and where SIMD is not available
+void decode_floats_scalar( const Accessor& accessor, float* out );
+
+
+/// Decodes elements of an accessor into half floats, ready for a 16 bit float vertex format.
+/// Uses F16C when the CPU supports it
+/// @param accessor Accessor to decode
+/// @param out Room for count times the number of components halfs
+/// @throw std::runtime_error If elements are out of the buffer view
+void decode_halfs( const Accessor& accessor, uint16_t* out );
+
+
+/// Decodes strided elements of components of the same type into floats
+/// @param data Address of the first element
+/// @param stride Distance between elements in bytes
+/// @param count Number of elements
+/// @param component_type Datatype of the components
+/// @param components Number of components of an element
+/// @param normalized Whether integer components are normalized
+/// @param out Where the first element goes
+/// @param out_stride Distance between decoded elements in bytes, zero when packed
+/// @throw std::runtime_error If out_stride is not a multiple of a float
+void decode_components( const uint8_t* data, size_t stride, size_t count, Accessor::ComponentType component_type,
+	size_t components, bool normalized, float* out, size_t out_stride = 0 );
+
+
+/// Converts floats into half floats, rounding to the nearest even
+/// @param in Floats to convert
+/// @param count Number of floats
+/// @param out Room for count halfs
+void encode_halfs( const float* in, size_t count, uint16_t* out );
+
+/// @return The half float nearest to a float, infinity when out of range
+uint16_t float_to_half( float value );
+
+/// @return The float value of a half float
+float half_to_float( uint16_t half );
+
+
+} // namespace spot::gfx
@@ -1,9 +1,12 @@
 #pragma once
 
+#include <future>
 #include <spot/math/math.h>
 #include <spot/math/shape.h>
 #include <nlohmann/json.hpp>
 
+#include "spot/gltf/accessor_view.h"
+#include "spot/gltf/blob.h"
 #include "spot/gltf/buffer.h"
 #include "spot/gltf/camera.h"
 #include "spot/gltf/image.h"
@@ -17,11 +20,14 @@
 #include "spot/gltf/bounds.h"
 #include "spot/gltf/animation.h"
 #include "spot/gltf/handle.h"
+#include "spot/gltf/options.h"
 
 namespace spot::gfx
 {
 
 class Gltf;
+struct SaveLayout;
+
 /// GL Transmission Format
 class Gltf
 {
@@ -53,7 +59,9 @@ class Gltf
 	/// Constructs a Gltf object
 	/// @param j Json object describing the model
 	/// @param path Gltf file path
-	Gltf( const nlohmann::json& j, const std::string& path = "." );
+	/// @param options Options controlling how the model is loaded
+	/// @param bin Binary chunk of a GLB, used by the first buffer without uri
+	Gltf( const nlohmann::json& j, const std::string& path = ".", const LoadOptions& options = {}, ByteSpan bin = {} );
 
 	/// Delete copy constructor
 	Gltf( const Gltf& ) = delete;
@@ -62,9 +70,127 @@ class Gltf
 	Gltf& operator=( const Gltf& ) = delete;
 
 	/// Loads a GLtf model from path
+	/// @param path Gltf or GLB file path
+	/// @param options Options controlling how the model is loaded
+	/// @return A Gltf model
+	static Gltf load( const std::string& path, const LoadOptions& options = {} );
+
+	/// Loads a GLB binary container, where the first buffer
+	/// looks directly into the BIN chunk without copying it
+	/// @param glb Bytes of the whole GLB file
+	/// @param path GLB file path
+	/// @param options Options controlling how the model is loaded
+	/// @return A Gltf model
+	static Gltf load_glb( ByteSpan glb, const std::string& path = ".", const LoadOptions& options = {} );
+
+	/// Loads a model on another thread. Destroying the future waits for the load,
+	/// which can be cancelled through the progress of the options
+	/// @param path Gltf or GLB file path
+	/// @param options Options controlling how the model is loaded
+	/// @return A future for the Gltf model, rethrowing errors and LoadCancelled
+	static std::future<Gltf> load_async( const std::string& path, const LoadOptions& options = {} );
+
+	/// Loads a model held in memory on another thread, see load_from_memory
+	/// @param bytes Bytes of the glTF json or of the GLB container
+	/// @param options Options controlling how the model is loaded
+	/// @return A future for the Gltf model, rethrowing errors and LoadCancelled
+	static std::future<Gltf> load_from_memory_async( ByteSpan bytes, const LoadOptions& options = {} );
+
+	/// Loads a glTF or GLB model held in memory, without copying it.
+	/// External resources are looked up through the resolver of the options
+	/// @param bytes Bytes of the glTF json or of the GLB container
+	/// @param options Options controlling how the model is loaded
+	/// @return A Gltf model
+	static Gltf load_from_memory( ByteSpan bytes, const LoadOptions& options = {} );
+
+	/// Parses a glTF json text with the front end chosen by the options
+	/// @param text Bytes of the json text
+	/// @param path Gltf file path
+	/// @param options Options controlling how the model is loaded
+	/// @param bin Binary chunk of a GLB, used by the first buffer without uri
+	/// @return A Gltf model
+	static Gltf parse( const ByteSpan& text, const std::string& path = ".", const LoadOptions& options = {}, ByteSpan bin = {} );
+
+	/// Reads a glTF json text with the in-tree tokenizer
+	/// @param text Bytes of the json text
+	/// @param path Gltf file path
+	/// @param options Options controlling how the model is loaded
+	/// @param bin Binary chunk of a GLB, used by the first buffer without uri
+	/// @return A Gltf model
+	static Gltf load_tokenized( const ByteSpan& text, const std::string& path = ".", const LoadOptions& options = {}, ByteSpan bin = {} );
+
+	/// Streams a glTF json through a SAX parser, reading it twice
+	/// to size the lists first and then to fill them element by element
+	/// @param in Seekable stream of the json text
 	/// @param path Gltf file path
+	/// @param options Options controlling how the model is loaded
+	/// @param bin Binary chunk of a GLB, used by the first buffer without uri
 	/// @return A Gltf model
-	static Gltf load( const std::string& path );
+	static Gltf load_streaming( std::istream& in, const std::string& path = ".", const LoadOptions& options = {}, ByteSpan bin = {} );
+
+	/// Streams a glTF json text through a SAX parser
+	/// @param text Bytes of the json text
+	/// @param path Gltf file path
+	/// @param options Options controlling how the model is loaded
+	/// @param bin Binary chunk of a GLB, used by the first buffer without uri
+	/// @return A Gltf model
+	static Gltf load_streaming( const ByteSpan& text, const std::string& path = ".", const LoadOptions& options = {}, ByteSpan bin = {} );
+
+	/// Loads a model through a flat binary blob cached next to it. The blob is written by the first load,
+	/// and read by the next ones until the model file or its buffer and image files change, or
+	/// the options ask for other sections, scenes or topology. See is_blob_current.
+	/// A blob which can not be written is skipped, leaving any previous one as it was
+	/// @param path Gltf or GLB file path
+	/// @param options Options controlling how the model is loaded when there is no valid blob
+	/// @param blob_path Path of the blob, the model path followed by ".blob" when empty
+	/// @return A Gltf model
+	static Gltf load_cached( const std::string& path, const LoadOptions& options = {}, std::string blob_path = {} );
+
+	/// Reads a model from a blob written by save_blob, with buffers pointing into it
+	/// @param blob Bytes of the blob, kept alive by the buffers through its owner
+	/// @param path Gltf file path the blob was made from
+	/// @param options Options stored in the model, sections and scenes are not applied
+	/// @return A Gltf model
+	/// @throw std::runtime_error If the blob is not valid or of another version
+	static Gltf load_blob( ByteSpan blob, const std::string& path = ".", const LoadOptions& options = {} );
+
+	/// Writes this model as a flat binary blob: records with indices instead of handles,
+	/// a string table, and the bytes of every buffer, which are loaded if needed.
+	/// Images provided by a resolver and runtime state like vertices are not written. The identities
+	/// of external buffer and image files, and the options of the load, are written to tell when it is stale
+	/// @param out Binary stream to write to
+	/// @param source Identity of the source the model was loaded from
+	void save_blob( std::ostream& out, const BlobSource& source = {} );
+
+	/// Writes this model to a file, as a GLB when the path ends with ".glb", otherwise as
+	/// a glTF json with the bytes of its buffer views coalesced into a ".bin" file next to it.
+	/// Accessors and buffer views nothing saved refers to, as those replaced by mesh passes, are left out
+	/// Levels of detail are saved as MSFT_lod nodes and meshes following those of the model, with the nodes
+	/// outside every scene and hierarchy, so viewers ignoring the extension draw only the full level
+	/// Primitives with only vertices in memory get POSITION, COLOR_0 and TEXCOORD_0 accessors,
+	/// and NORMAL when every vertex has a unit normal, as the default one is only a placeholder
+	/// @param path Path of the file to write
+	/// @throw std::runtime_error If the file can not be written
+	void save( const std::string& path );
+
+	/// Writes this model as a GLB, streaming the json chunk and then the bytes of the buffer views
+	/// saved, coalesced into the BIN chunk at aligned offsets. Buffers are loaded if needed
+	/// @param out Binary stream to write to
+	/// @throw std::runtime_error If the model does not fit the 32 bit lengths of a GLB
+	void save_glb( std::ostream& out );
+
+	/// Writes this model as a glTF json, along with the bytes of the buffer views saved
+	/// coalesced into a single buffer at aligned offsets. Buffers are loaded if needed
+	/// @param json Stream to write the json to
+	/// @param bin Binary stream to write the buffer to, untouched when no bytes are saved
+	/// @param bin_uri Uri of the buffer written in the json
+	void save_gltf( std::ostream& json, std::ostream& bin, const std::string& bin_uri );
+
+	/// Streams the json of this model, without building a document first
+	/// @param out Stream to write to
+	/// @param layout Where buffer views and runtime primitives go in the saved buffer
+	/// @param bin_uri Uri of the saved buffer, empty for the BIN chunk of a GLB
+	void write_json( std::ostream& out, const SaveLayout& layout, const std::string& bin_uri ) const;
 
 	/// @return A newly created Node
 	Handle<Node> create_node();
@@ -87,6 +213,17 @@ class Gltf
 	/// @return The handle of a new mesh
 	Handle<Mesh> create_mesh( Mesh&& m = {} );
 
+	/// Adds packed elements as a new buffer, with a view and an accessor looking at them.
+	/// Useful to store data made at runtime, which is then written along the rest of the model
+	/// @param bytes Elements of the accessor, moved into the new buffer
+	/// @param component_type Datatype of the components
+	/// @param type Number of components of an element
+	/// @param count Number of elements
+	/// @param target Target of the new buffer view
+	/// @return The handle of the new accessor
+	Handle<Accessor> create_accessor( std::vector<char> bytes, Accessor::ComponentType component_type,
+		Accessor::Type type, size_t count, BufferView::Target target = BufferView::Target::None );
+
 	/// @param bounds Index of the bounds
 	/// @return The bounds found at that index, nullptr otherwise
 	Bounds* get_bounds( int32_t bounds );
@@ -98,6 +235,43 @@ class Gltf
 	/// @return The animation at that index, nullptr otherwise
 	Accessor* get_accessor( size_t accessor );
 
+	/// Brings the bytes of all buffers into memory
+	void prefetch();
+
+	/// Brings the bytes of those buffers into memory, useful with lazy buffers
+	/// @param handles Buffers to load
+	void prefetch( const std::vector<Handle<ByteBuffer>>& handles );
+
+	/// Moves the progress of the load, if any, to another stage
+	/// @param stage Stage entered
+	/// @throw LoadCancelled If the load has been cancelled
+	void enter( LoadProgress::Stage stage ) const;
+
+	/// Loads a buffer accounting its bytes in the progress of the load
+	/// @param buffer Buffer to load
+	void load_buffer( ByteBuffer& buffer );
+
+	/// Starts loading the buffers while the rest of the model is parsed,
+	/// or loads them straight away without workers
+	/// @return A future to wait on, not valid when there is nothing to wait
+	std::future<void> start_loading_buffers();
+
+	/// Keeps the scenes selected by the options, making the default one current
+	/// when kept, otherwise the first one kept
+	/// @param scene_index Index of the default scene
+	/// @throw std::runtime_error If a scene does not exist
+	void select_scenes( size_t scene_index );
+
+	/// @return The buffers used by the meshes of the selected scenes, or by all meshes
+	/// without a selection, by animations and by images stored in buffer views
+	std::vector<Handle<ByteBuffer>> get_used_buffers();
+
+	/// Loads the buffers used by a partial load, see LoadOptions::is_partial
+	void load_used_buffers();
+
+	/// Converts strips, fans and loops to lists when the options ask for it, see LoadOptions::list_topology
+	void convert_topology();
+
 	/// Load the nodes pointer using node indices
 	void load_nodes();
 
@@ -113,73 +287,170 @@ class Gltf
 
 	/// Initializes buffers
 	/// @param j Json object describing the buffers
-	void init_buffers( const nlohmann::json& j );
+	/// @param bin Binary chunk of a GLB, if any
+	void init_buffers( const nlohmann::json& j, const ByteSpan& bin = {} );
+
+	/// Initializes a buffer, the first one may refer to the GLB binary chunk
+	/// @param j Json object describing the buffer
+	/// @param buffer Buffer to initialize
+	/// @param bin Binary chunk of a GLB, if any
+	void init_buffer( const nlohmann::json& j, ByteBuffer& buffer, const ByteSpan& bin = {} );
+
+	/// Initializes a buffer from its fields, whatever parsed them
+	/// @param buffer Buffer to initialize
+	/// @param byte_length Length of the buffer in bytes
+	/// @param uri Uri of the buffer, null when it has none
+	/// @param bin Binary chunk of a GLB, if any
+	void init_buffer( ByteBuffer& buffer, size_t byte_length, const std::string* uri, const ByteSpan& bin = {} );
 
 	/// Initializes bufferViews
 	/// @param j Json object describing the bufferViews
 	void init_buffer_views( const nlohmann::json& j );
 
+	/// Initializes a bufferView
+	/// @param j Json object describing the bufferView
+	/// @param view BufferView to initialize
+	void init_buffer_view( const nlohmann::json& j, BufferView& view );
+
 	/// Initializes cameras
 	/// @param j Json object describing the cameras
 	void init_cameras( const nlohmann::json& j );
 
+	/// Initializes a camera
+	/// @param j Json object describing the camera
+	/// @param camera Camera to initialize
+	void init_camera( const nlohmann::json& j, GltfCamera& camera );
+
 	/// Initializes samplers
 	/// @param j Json object describing the samplers
 	void init_samplers( const nlohmann::json& j );
 
+	/// Initializes a sampler
+	/// @param j Json object describing the sampler
+	/// @param sampler Sampler to initialize
+	void init_sampler( const nlohmann::json& j, GltfSampler& sampler );
+
 	/// Initializes images
 	/// @param j Json object describing the images
 	void init_images( const nlohmann::json& j );
 
+	/// Initializes an image
+	/// @param j Json object describing the image
+	/// @param image Image to initialize
+	void init_image( const nlohmann::json& j, GltfImage& image );
+
+	/// Sets the uri of an image, and its bytes when the resolver provides them
+	/// @param image Image to initialize
+	/// @param uri Uri of the image, relative to the model
+	void init_image_uri( GltfImage& image, const std::string& uri );
+
+	/// @param uri Uri of a resource, relative to the model
+	/// @return The bytes provided by the resolver, empty without one or for data uris
+	ByteSpan resolve( const std::string& uri ) const;
+
 	/// Initializes textures
 	/// @param j Json object describing the textures
 	void init_textures( const nlohmann::json& j );
 
+	/// Initializes a texture
+	/// @param j Json object describing the texture
+	/// @param texture Texture to initialize
+	void init_texture( const nlohmann::json& j, GltfTexture& texture );
+
 	/// Initializes accessors
 	/// @param j Json object describing the accessors
 	void init_accessors( const nlohmann::json& j );
 
+	/// Initializes an accessor
+	/// @param j Json object describing the accessor
+	/// @param accessor Accessor to initialize
+	void init_accessor( const nlohmann::json& j, Accessor& accessor );
+
 	/// Initializes materials
 	/// @param j Json object describing the materials
 	void init_materials( const nlohmann::json& j );
 
+	/// Initializes a material
+	/// @param j Json object describing the material
+	/// @param material Material to initialize
+	void init_material( const nlohmann::json& j, Material& material );
+
 	/// Initializes meshes
 	/// @param j Json object describing the meshes
 	void init_meshes( const nlohmann::json& j );
 
+	/// Initializes a mesh
+	/// @param j Json object describing the mesh
+	/// @param mesh Mesh to initialize
+	void init_mesh( const nlohmann::json& j, Mesh& mesh );
+
 	/// Initializes lights
 	/// @param j Json object describing the lights
 	void init_lights( const nlohmann::json& j );
 
+	/// Initializes a light
+	/// @param j Json object describing the light
+	/// @param light Light to initialize
+	void init_light( const nlohmann::json& j, Light& light );
+
 	/// Initializes nodes
 	/// @param j Json object describing the nodes
 	void init_nodes( const nlohmann::json& j );
 
+	/// Initializes a node, except for its children
+	/// @param j Json object describing the node
+	/// @param node Node to initialize
+	void init_node( const nlohmann::json& j, Node& node );
+
+	/// Initializes the children of a node, which should be already available
+	/// @param j Json object describing the node
+	/// @param node Node to initialize
+	void init_node_children( const nlohmann::json& j, Node& node );
+
 	/// Initializes animations
 	/// @param j Json object describing the animations
 	void init_animations( const nlohmann::json& j );
 
+	/// Initializes an animation
+	/// @param j Json object describing the animation
+	/// @param animation Animation to initialize
+	void init_animation( const nlohmann::json& j, Animation& animation );
+
 	/// Initializes shapes
 	/// @param j Json object describing the shapes
 	void init_shapes( const nlohmann::json& j );
 
+	/// Initializes a shape
+	/// @param j Json object describing the shape
+	void init_shape( const nlohmann::json& j );
+
 	/// Initializes scripts
 	/// @param j Json object describing scripts
 	void init_scripts( const nlohmann::json& j );
 
+	/// Initializes a script
+	/// @param j Json object describing the script
+	/// @param script Script to initialize
+	void init_script( const nlohmann::json& j, Script& script );
+
 	/// Initializes scenes
 	/// @param j Json object describing the scenes
 	void init_scenes( const nlohmann::json& j );
 
+	/// Initializes a scene
+	/// @param j Json object describing the scene
+	/// @param scene Scene to initialize
+	void init_scene( const nlohmann::json& j, Scene& scene );
+
 	/// Directory path of the gltf file
 	std::string path;
 
+	/// Options used to load this model
+	LoadOptions options;
+
 	/// List of buffers
 	Uvec<ByteBuffer> buffers;
 
-	/// Cache of buffers
-	std::map<const size_t, std::vector<char>> buffers_cache;
-
 	/// List of buffer views
 	Uvec<BufferView> buffer_views;
 
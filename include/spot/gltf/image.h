@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include "spot/gltf/buffer.h"
 #include "spot/gltf/handle.h"
 
 namespace spot::gfx
@@ -21,6 +22,9 @@ struct GltfImage
 	/// Buffer view index
 	uint32_t buffer_view = 0;
 
+	/// Bytes of the image when provided by a resolver, empty otherwise
+	ByteSpan data;
+
 	/// Name
 	std::string name = "Unknown";
 };
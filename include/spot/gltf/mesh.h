@@ -1,12 +1,14 @@
 #ifndef GST_MESH_H_
 #define GST_MESH_H_
 
+#include <initializer_list>
 #include <unordered_map>
 #include <string>
 #include <vector>
 #include <spot/math/math.h>
 #include <spot/math/shape.h>
 
+#include "spot/gltf/accessor.h"
 #include "spot/gltf/handle.h"
 #include "spot/gltf/color.h"
 
@@ -14,7 +16,6 @@
 namespace spot::gfx
 {
 class Gltf;
-struct Accessor;
 struct Material;
 class Mesh;
 
@@ -29,8 +30,84 @@ struct alignas(16) Vertex
 };
 
 
-/// @todo Change this, as indices can be of different sizes
-using Index = uint16_t;
+/// Value of an index, whatever the width it is stored with
+using Index = uint32_t;
+
+
+/// @brief Indices of a primitive, stored with 8, 16 or 32 bits each
+/// as the accessor they come from, or narrowed to what the vertices need
+class Indices
+{
+  public:
+	Indices() = default;
+
+	/// Indices stored with 16 bits, or 32 bits if a value does not fit below the restart value 65535
+	Indices( std::initializer_list<Index> values );
+
+	/// @param component_type UNSIGNED_BYTE, UNSIGNED_SHORT or UNSIGNED_INT
+	/// @param count Number of indices, initialized to zero
+	/// @throw std::runtime_error If the component type is not valid for indices
+	explicit Indices( Accessor::ComponentType component_type, size_t count = 0 );
+
+	/// @return The narrowest component type for indices of that many vertices,
+	/// keeping the maximum value of the type free for primitive restart
+	static Accessor::ComponentType get_component_type( size_t vertex_count );
+
+	Accessor::ComponentType get_component_type() const { return component_type; }
+
+	/// @return The size of an index in bytes
+	size_t get_index_size() const { return index_size; }
+
+	size_t size() const { return bytes.size() / index_size; }
+
+	bool empty() const { return bytes.empty(); }
+
+	Index operator[]( size_t i ) const;
+
+	/// Sets an index, which must fit the current width
+	void set( size_t i, Index value );
+
+	/// Appends an index, widening the storage if it does not fit below the restart value of its width
+	void push_back( Index value );
+
+	void resize( size_t count ) { bytes.resize( count * index_size ); }
+
+	void clear() { bytes.clear(); }
+
+	/// @return The largest index, zero when empty
+	Index get_max() const;
+
+	/// Changes the width of the indices
+	/// @throw std::runtime_error If the component type is not valid or an index does not fit
+	/// below the restart value of the new width
+	void convert( Accessor::ComponentType component_type );
+
+	/// Stores the indices with the narrowest width for that many vertices
+	/// @throw std::runtime_error If an index is not less than the vertex count
+	void narrow( size_t vertex_count );
+
+	/// @return The indices as they are stored, to be uploaded as they are
+	const std::vector<uint8_t>& get_bytes() const { return bytes; }
+
+	uint8_t* data() { return bytes.data(); }
+	const uint8_t* data() const { return bytes.data(); }
+
+	/// Calls a function with the indices as an array of their own type, so
+	/// algorithms over indices are written once and run on any width
+	/// @param func Callable with a pointer to indices and their count, returning the same type for any width
+	template <typename Func>
+	decltype( auto ) visit( Func&& func );
+
+	template <typename Func>
+	decltype( auto ) visit( Func&& func ) const;
+
+  private:
+	Accessor::ComponentType component_type = Accessor::ComponentType::UNSIGNED_SHORT;
+
+	size_t index_size = sizeof( uint16_t );
+
+	std::vector<uint8_t> bytes;
+};
 
 
 /// @brief Geometry to be rendered with the given material
@@ -66,7 +143,7 @@ struct Primitive
 
 	Primitive(
 		std::vector<Vertex> vertices,
-		std::vector<Index> indices,
+		Indices indices,
 		const Handle<Material>& material
 	);
 
@@ -92,7 +169,20 @@ struct Primitive
 	void* extras;
 
 	std::vector<Vertex> vertices;
-	std::vector<Index> indices;
+	Indices indices;
+};
+
+
+/// @brief Simplified primitives of a mesh, for drawing it far away.
+/// They keep the vertices of the mesh, indexing fewer of them
+struct MeshLod
+{
+	/// Primitives simplified, in the same order as the ones of the mesh. They share
+	/// the attributes of those, while primitives of runtime vertices only have indices
+	std::vector<Primitive> primitives;
+
+	/// Largest distance from the surface of the mesh, in model units
+	float error = 0.0f;
 };
 
 
@@ -138,6 +228,9 @@ struct Mesh
 	/// Array of weights to be applied to the Morph Targets
 	std::vector<float> weights;
 
+	/// Levels of detail, from the finest to the coarsest, written with MSFT_lod
+	std::vector<MeshLod> lods;
+
 	/// User-defined name of this object
 	std::string name = "Unknown";
 
@@ -147,6 +240,30 @@ struct Mesh
 };
 
 
+template <typename Func>
+decltype( auto ) Indices::visit( Func&& func )
+{
+	switch ( index_size )
+	{
+	case sizeof( uint8_t ): return func( bytes.data(), size() );
+	case sizeof( uint16_t ): return func( reinterpret_cast<uint16_t*>( bytes.data() ), size() );
+	default: return func( reinterpret_cast<uint32_t*>( bytes.data() ), size() );
+	}
+}
+
+
+template <typename Func>
+decltype( auto ) Indices::visit( Func&& func ) const
+{
+	switch ( index_size )
+	{
+	case sizeof( uint8_t ): return func( bytes.data(), size() );
+	case sizeof( uint16_t ): return func( reinterpret_cast<const uint16_t*>( bytes.data() ), size() );
+	default: return func( reinterpret_cast<const uint32_t*>( bytes.data() ), size() );
+	}
+}
+
+
 }  // namespace spot::gfx
 
 
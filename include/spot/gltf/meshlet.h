@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "spot/gltf/mesh.h"
+
+namespace spot::gfx
+{
+
+
+/// Most vertices of a meshlet, the limit of common mesh shader outputs
+constexpr size_t meshlet_max_vertices = 64;
+
+/// Most triangles of a meshlet, leaving room for four bytes of padding in
+/// a table of 128 triangles of three local indices each
+constexpr size_t meshlet_max_triangles = 124;
+
+
+/// Cluster of triangles drawn, and culled, together
+struct Meshlet
+{
+	/// First entry in the vertex table of the meshlets
+	uint32_t vertex_offset = 0;
+
+	/// First entry in the triangle table of the meshlets, in local indices
+	uint32_t triangle_offset = 0;
+
+	uint32_t vertex_count = 0;
+	uint32_t triangle_count = 0;
+};
+
+
+/// Volumes enclosing a meshlet, for culling it before drawing it
+struct MeshletBounds
+{
+	/// Sphere containing every vertex
+	math::Vec3 center = {};
+	float radius = 0.0f;
+
+	/// Cone containing the normals of every triangle. The meshlet faces away from a
+	/// camera at c when dot( center - c, cone_axis ) >= cone_cutoff * length( center - c ) + radius,
+	/// or more tightly when dot( normalize( cone_apex - c ), cone_axis ) >= cone_cutoff
+	math::Vec3 cone_apex = {};
+	math::Vec3 cone_axis = {};
+
+	/// Sine of the angle of the cone, 1 for meshlets which can not be culled as they face every way
+	float cone_cutoff = 1.0f;
+};
+
+
+/// Meshlets of a primitive, which refer to its vertices through a table. Tables
+/// of every meshlet are packed one after the other, so they are uploaded as they are
+struct Meshlets
+{
+	std::vector<Meshlet> meshlets;
+
+	/// Bounds of every meshlet
+	std::vector<MeshletBounds> bounds;
+
+	/// Vertices of the primitive, as indexed by the local indices of the meshlets
+	std::vector<uint32_t> vertices;
+
+	/// Three local indices for every triangle
+	std::vector<uint8_t> triangles;
+};
+
+
+/// Splits a triangle list into meshlets. Each meshlet grows from a triangle, adding
+/// the neighbouring triangles which bring in fewer new vertices, then those whose vertices
+/// have fewer triangles left, so meshlets come out compact and without holes.
+/// Best run on indices optimized for the vertex cache, as the order leads to seeds
+/// @param indices Indices of the triangles
+/// @param positions Address of the position of the first vertex
+/// @param vertex_count Number of vertices
+/// @param stride Distance between positions in bytes, zero when packed
+/// @param max_vertices Most vertices of a meshlet, up to 256
+/// @param max_triangles Most triangles of a meshlet, up to 512
+/// @param threads Maximum number of workers, each of them splitting a range of triangles,
+/// with 0 meshlets are made on this thread
+/// @throw std::runtime_error If the indices are not triangles, an index is out of the vertices, or limits are not valid
+Meshlets build_meshlets( const Indices& indices, const float* positions, size_t vertex_count, size_t stride = 0,
+	size_t max_vertices = meshlet_max_vertices, size_t max_triangles = meshlet_max_triangles, uint32_t threads = 0 );
+
+
+/// @return The bounds of triangles given by local indices into a vertex table
+/// @param vertices Vertex table of the meshlet
+/// @param triangles Three local indices for every triangle
+/// @param triangle_count Number of triangles
+/// @param positions Address of the position of the first vertex
+/// @param stride Distance between positions in bytes, zero when packed
+/// @throw std::runtime_error If there are more than 512 triangles
+MeshletBounds compute_meshlet_bounds( const uint32_t* vertices, const uint8_t* triangles, size_t triangle_count,
+	const float* positions, size_t stride = 0 );
+
+
+/// Splits a triangle list primitive into meshlets, loading its indices from its accessor
+/// when it has none in memory. Positions are read from its runtime vertices, or decoded
+/// from its POSITION accessor. Primitives without indices draw their vertices in order
+/// @return The meshlets, empty for primitives which are not triangle lists
+/// @throw std::runtime_error If indices or positions can not be read or are not valid
+Meshlets build_meshlets( Primitive& primitive, size_t max_vertices = meshlet_max_vertices,
+	size_t max_triangles = meshlet_max_triangles, uint32_t threads = 0 );
+
+
+/// Splits every triangle list primitive of a model into meshlets
+/// @param model Model with meshes to split
+/// @param threads Maximum number of workers, with 0 meshlets are made on this thread
+/// @return The meshlets of every primitive, by mesh and then by primitive
+/// @throw std::runtime_error If indices or positions can not be read or are not valid
+std::vector<Meshlets> build_meshlets( Gltf& model, uint32_t threads = 0, size_t max_vertices = meshlet_max_vertices,
+	size_t max_triangles = meshlet_max_triangles );
+
+
+} // namespace spot::gfx
@@ -87,6 +87,7 @@ class Node : public Handled<Node>
 	std::vector<Script*> scripts;
 
 	friend class Gltf;
+	friend class GltfTokenizer;
 };
 
 
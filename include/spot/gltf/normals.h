@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "spot/gltf/mesh.h"
+
+namespace spot::gfx
+{
+
+
+/// How the triangles around a vertex weigh on its normal
+enum class NormalWeight
+{
+	/// By their angle at the vertex, so a face counts the same however it is split in triangles
+	Angle,
+
+	/// By their area, so large triangles weigh more than the small ones around them
+	Area,
+};
+
+
+/// Computes smooth normals of a triangle list, each vertex summing the normals of its triangles
+/// @param indices Indices of the triangles
+/// @param positions Three floats for every vertex
+/// @param vertex_count Number of vertices
+/// @param normals Room for three floats for every vertex. Vertices without triangles get +z
+/// @param weight How triangles weigh on the normals of their vertices
+/// @throw std::runtime_error If the indices are not triangles or an index is out of the vertices
+void generate_normals( const Indices& indices, const float* positions, size_t vertex_count, float* normals,
+	NormalWeight weight = NormalWeight::Angle );
+
+
+/// Computes tangents of a triangle list as MikkTSpace does for every vertex. The tangents of the triangles
+/// around a vertex are projected on its normal and summed, weighted by their angle at the vertex.
+/// Vertices are not split where their triangles disagree on the handedness, as the majority wins.
+/// The handedness follows glTF, whose texture coordinates start at the top left, so the bitangent
+/// is cross( normal, tangent.xyz ) * tangent.w
+/// @param indices Indices of the triangles
+/// @param positions Three floats for every vertex
+/// @param normals Three floats for every vertex, of unit length
+/// @param texcoords Two floats for every vertex
+/// @param vertex_count Number of vertices
+/// @param tangents Room for four floats for every vertex. Vertices without texture space get a tangent
+/// perpendicular to their normal
+/// @throw std::runtime_error If the indices are not triangles or an index is out of the vertices
+void generate_tangents( const Indices& indices, const float* positions, const float* normals, const float* texcoords,
+	size_t vertex_count, float* tangents );
+
+
+/// Computes the normals of a triangle list primitive, from its runtime vertices or from its POSITION
+/// accessor, loading its indices when it has none in memory. Vertices in memory get their normal
+/// @return Three floats for every vertex, empty for primitives which are not triangle lists or have no positions
+/// @throw std::runtime_error If the positions or indices can not be read or are not valid
+std::vector<float> generate_normals( Primitive& primitive, NormalWeight weight = NormalWeight::Angle );
+
+
+/// Computes the tangents of a triangle list primitive with NORMAL and TEXCOORD_0 accessors
+/// @param primitive Primitive to read
+/// @param normals Normals to use instead of the NORMAL accessor, when not empty
+/// @return Four floats for every vertex, empty for primitives which are not triangle lists
+/// or have no positions, normals or texture coordinates
+/// @throw std::runtime_error If attributes or indices can not be read or are not valid
+std::vector<float> generate_tangents( Primitive& primitive, const std::vector<float>& normals = {} );
+
+
+/// Numbers of attributes added to a model
+struct GeneratedAttributes
+{
+	size_t normals = 0;
+	size_t tangents = 0;
+};
+
+
+/// Adds a NORMAL accessor to every triangle list primitive without it, then a TANGENT accessor
+/// to those with TEXCOORD_0 and without it, so consumers find them as any other attribute.
+/// Primitives with only runtime vertices get their normals in those vertices instead, when some
+/// of them still has no unit normal, and are saved with them. They get no tangents, as a Vertex
+/// has no room for them
+/// @param model Model with meshes to complete
+/// @param threads Maximum number of workers, with 0 attributes are generated on this thread
+/// @param tangents Whether tangents are generated as well
+/// @param weight How triangles weigh on the normals of their vertices
+/// @return The numbers of attributes added, counting runtime primitives given normals
+/// @throw std::runtime_error If attributes or indices can not be read or are not valid
+GeneratedAttributes generate_normals( Gltf& model, uint32_t threads = 0, bool tangents = true,
+	NormalWeight weight = NormalWeight::Angle );
+
+
+} // namespace spot::gfx
@@ -0,0 +1,234 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "spot/gltf/mesh.h"
+
+namespace spot::gfx
+{
+
+
+/// How well an order of triangles uses a FIFO post-transform vertex cache
+struct VertexCacheStats
+{
+	size_t triangles = 0;
+
+	/// Vertices referenced by the triangles
+	size_t vertices = 0;
+
+	/// Vertices shaded, one for every cache miss
+	size_t transformed = 0;
+
+	/// Average cache miss ratio, vertices shaded per triangle, from 3 down to about 0.5
+	float acmr = 0.0f;
+
+	/// Average transform to vertex ratio, vertices shaded per vertex, 1 being the best
+	float atvr = 0.0f;
+};
+
+
+/// Vertex cache statistics of a primitive before and after its optimization
+struct VertexCacheReport
+{
+	VertexCacheStats before;
+	VertexCacheStats after;
+};
+
+
+/// Simulates a FIFO vertex cache over a triangle list
+/// @param indices Indices of the triangles
+/// @param vertex_count Number of vertices indexed
+/// @param cache_size Entries of the simulated cache
+/// @throw std::runtime_error If an index is out of the vertices
+VertexCacheStats analyze_vertex_cache( const Indices& indices, size_t vertex_count, size_t cache_size = 32 );
+
+
+/// Reorders the triangles of a list for the post-transform vertex cache with Tipsify,
+/// which fans around vertices still in a cache of the given size and restarts from
+/// recent vertices with triangles left. It runs in linear time, and the triangles
+/// keep their winding. Lists with fewer than two triangles are left as they are
+/// @param indices Indices of the triangles
+/// @param vertex_count Number of vertices indexed
+/// @param cache_size Entries of the cache to optimize for
+/// @throw std::runtime_error If the indices are not triangles or an index is out of the vertices
+void optimize_vertex_cache( Indices& indices, size_t vertex_count, size_t cache_size = 16 );
+
+
+/// Reorders the indices of a triangle list primitive, loading them from its indices
+/// accessor when it has none in memory. Other primitives are left as they are
+/// @return The statistics of a cache of cache_size entries, zero for primitives left as they are
+/// @throw std::runtime_error If the indices can not be read or are not valid
+VertexCacheReport optimize_vertex_cache( Primitive& primitive, size_t cache_size = 16 );
+
+
+/// Reorders the indices of every triangle list primitive of a model, storing the
+/// indices of primitives loaded from accessors in new accessors, so they are saved
+/// @param model Model with meshes to optimize
+/// @param threads Maximum number of workers, with 0 primitives are optimized on this thread
+/// @param cache_size Entries of the cache to optimize for
+/// @return The statistics of every primitive, by mesh and then by primitive
+/// @throw std::runtime_error If indices can not be read or are not valid
+std::vector<VertexCacheReport> optimize_vertex_cache( Gltf& model, uint32_t threads = 0, size_t cache_size = 16 );
+
+
+/// Elements of an attribute, for passes looking at their bytes
+struct AttributeStream
+{
+	/// Address of the first element, null for elements which are all zeros
+	const uint8_t* data = nullptr;
+
+	/// Size of an element in bytes
+	size_t size = 0;
+
+	/// Distance between elements in bytes
+	size_t stride = 0;
+};
+
+
+/// Vertices of a primitive before and after a remap
+struct VertexRemapStats
+{
+	size_t vertices_before = 0;
+	size_t vertices_after = 0;
+
+	/// Bytes of the vertex attributes, the runtime vertices, and the indices
+	size_t bytes_before = 0;
+	size_t bytes_after = 0;
+
+	/// @return The bytes saved, negative when bytes were added, like indices for a primitive without them
+	int64_t get_bytes_saved() const { return int64_t( bytes_before ) - int64_t( bytes_after ); }
+};
+
+
+/// Unset entry of a remap table
+constexpr uint32_t remap_unused = ~uint32_t( 0 );
+
+
+/// Makes a table moving vertices in the order they are first used, where vertices with
+/// the same bytes in every stream share a position when welding. Vertices are hashed
+/// across all their streams, so finding duplicates takes linear time
+/// @param streams Attributes of the vertices
+/// @param vertex_count Number of vertices
+/// @param indices Indices of the vertices, null when drawn in order
+/// @param weld Whether duplicate vertices are merged, otherwise vertices are only reordered
+/// @param remap Set to the new position of every vertex, remap_unused for vertices not indexed
+/// @return The number of vertices after the remap
+/// @throw std::runtime_error If an index is out of the vertices
+size_t generate_vertex_remap( const std::vector<AttributeStream>& streams, size_t vertex_count, const Indices* indices,
+	bool weld, std::vector<uint32_t>& remap );
+
+
+/// Rewrites indices through a remap table, keeping their width
+void remap_indices( Indices& indices, const std::vector<uint32_t>& remap );
+
+
+/// Moves packed elements through a remap table
+/// @param stream Elements to move
+/// @param remap Table of generate_vertex_remap
+/// @param count Number of elements after the remap
+/// @return The moved elements, packed
+std::vector<char> remap_elements( const AttributeStream& stream, const std::vector<uint32_t>& remap, size_t count );
+
+
+/// Welds duplicate vertices of a primitive and orders the others as the indices first use
+/// them, so the vertex fetch goes through memory forward. Best run after optimize_vertex_cache.
+/// Attributes are stored in new accessors, and so are indices when the primitive has any attribute.
+/// Primitives without indices get them. Primitives sharing accessors stop sharing them
+/// @param model Model owning the primitive
+/// @param primitive Primitive with accessors or runtime vertices
+/// @param weld Whether duplicate vertices are merged, otherwise vertices are only reordered
+/// @return Vertices and bytes before and after, zero for primitives without vertices
+/// @throw std::runtime_error If attributes or indices can not be read
+VertexRemapStats optimize_vertex_fetch( Gltf& model, Primitive& primitive, bool weld = true );
+
+
+/// Welds and reorders the vertices of every primitive of a model
+/// @param model Model with meshes to optimize
+/// @param threads Maximum number of workers, with 0 primitives are optimized on this thread
+/// @param weld Whether duplicate vertices are merged, otherwise vertices are only reordered
+/// @return The statistics of every primitive, by mesh and then by primitive
+/// @throw std::runtime_error If attributes or indices can not be read
+std::vector<VertexRemapStats> optimize_vertex_fetch( Gltf& model, uint32_t threads = 0, bool weld = true );
+
+
+/// Fragments of a mesh rasterized with depth testing from six directions, along
+/// and against each axis, with back faces culled as a renderer would
+struct OverdrawStats
+{
+	/// Pixels covered by the mesh
+	size_t covered = 0;
+
+	/// Fragments passing the depth test when drawn, thus shaded
+	size_t shaded = 0;
+
+	/// Fragments shaded per pixel covered, 1 being the best
+	float overdraw = 0.0f;
+};
+
+
+/// Overdraw and vertex cache statistics of a primitive before and after its optimization
+struct OverdrawReport
+{
+	OverdrawStats before;
+	OverdrawStats after;
+
+	VertexCacheStats cache_before;
+	VertexCacheStats cache_after;
+};
+
+
+/// Estimates the overdraw of a triangle list on the CPU, drawing it in order on
+/// square grids of resolution pixels fitted to its bounds, from six directions
+/// @param indices Indices of the triangles
+/// @param positions Address of the position of the first vertex
+/// @param vertex_count Number of vertices
+/// @param stride Distance between positions in bytes, zero when packed
+/// @param resolution Pixels of the side of a grid
+/// @throw std::runtime_error If the indices are not triangles or an index is out of the vertices
+OverdrawStats analyze_overdraw( const Indices& indices, const float* positions, size_t vertex_count,
+	size_t stride = 0, size_t resolution = 256 );
+
+
+/// Reorders a triangle list so triangles likely to occlude others are drawn first, with the
+/// second pass of Tipsify. The list, best ordered by optimize_vertex_cache before, is split
+/// into clusters where the cache restarts, and then wherever the miss ratio of a cluster is
+/// within threshold of the one of the whole restart. Clusters are sorted by how much they
+/// face away from the center of the mesh, so the order does not depend on the view
+/// @param indices Indices of the triangles
+/// @param positions Address of the position of the first vertex
+/// @param vertex_count Number of vertices
+/// @param stride Distance between positions in bytes, zero when packed
+/// @param threshold How much the vertex cache miss ratio may grow, at least 1, where
+/// higher values make smaller clusters, which are sorted better
+/// @param cache_size Entries of the cache the clusters are made for
+/// @throw std::runtime_error If the indices are not triangles or an index is out of the vertices
+void optimize_overdraw( Indices& indices, const float* positions, size_t vertex_count, size_t stride = 0,
+	float threshold = 1.05f, size_t cache_size = 16 );
+
+
+/// Reorders the indices of a triangle list primitive for the vertex cache with Tipsify and then
+/// to reduce overdraw, loading them from its indices accessor when it has none in memory.
+/// Positions are read from its runtime vertices, or decoded from its POSITION accessor.
+/// Other primitives are left as they are
+/// @param primitive Primitive to optimize
+/// @param threshold How much the vertex cache miss ratio may grow
+/// @param cache_size Entries of the cache to optimize for
+/// @return The statistics before and after both passes, zero for primitives left as they are
+/// @throw std::runtime_error If indices or positions can not be read or are not valid
+OverdrawReport optimize_overdraw( Primitive& primitive, float threshold = 1.05f, size_t cache_size = 16 );
+
+
+/// Reorders the indices of every triangle list primitive of a model for the vertex cache and then
+/// to reduce overdraw, storing the indices of primitives loaded from accessors in new accessors, so they are saved
+/// @param model Model with meshes to optimize
+/// @param threads Maximum number of workers, with 0 primitives are optimized on this thread
+/// @param threshold How much the vertex cache miss ratio may grow
+/// @param cache_size Entries of the cache to optimize for
+/// @return The statistics of every primitive, by mesh and then by primitive
+/// @throw std::runtime_error If indices or positions can not be read or are not valid
+std::vector<OverdrawReport> optimize_overdraw( Gltf& model, uint32_t threads = 0, float threshold = 1.05f,
+	size_t cache_size = 16 );
+
+
+} // namespace spot::gfx
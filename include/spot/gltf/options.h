@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "spot/gltf/buffer.h"
+#include "spot/gltf/cache.h"
+#include "spot/gltf/progress.h"
+#include "spot/gltf/resolver.h"
+
+namespace spot::gfx
+{
+
+
+/// Options controlling how a Gltf model is loaded
+struct LoadOptions
+{
+	/// How the json text is turned into a model
+	enum class Parser
+	{
+		/// Parses the whole json document, then builds the model from it
+		Dom,
+
+		/// Streams the json through a SAX handler, building the model element
+		/// by element without ever holding the whole document in memory
+		Sax,
+
+		/// Reads the json text with the in-tree glTF tokenizer, which knows
+		/// the schema and writes values straight into the model
+		Tokenizer,
+	};
+
+	/// Parts of a model which can be skipped. Accessors, buffer views and buffers
+	/// are always read, as they are small, but only referenced buffers are loaded
+	struct Sections
+	{
+		bool cameras = true;
+
+		/// Samplers, images, textures and materials
+		bool materials = true;
+
+		bool meshes = true;
+
+		/// Nodes, needed by animations and scenes
+		bool nodes = true;
+
+		bool animations = true;
+
+		/// KHR_lights_punctual lights
+		bool lights = true;
+
+		/// Scripts and shapes in the extras
+		bool scripts = true;
+		bool shapes = true;
+
+		bool scenes = true;
+
+		/// @return Whether every section is read
+		bool all() const
+		{
+			return cameras && materials && meshes && nodes && animations && lights && scripts && shapes && scenes;
+		}
+
+		/// @return These sections, skipping those which depend on skipped ones
+		Sections resolved() const
+		{
+			auto ret = *this;
+			ret.animations &= nodes;
+			ret.scenes &= nodes;
+			return ret;
+		}
+	};
+
+	/// @return Whether only a part of the model is wanted
+	bool is_partial() const { return !sections.all() || !scenes.empty(); }
+
+	/// Json front end
+	Parser parser = Parser::Dom;
+
+	/// Sections to read
+	Sections sections;
+
+	/// Indices of the scenes to keep, all of them when empty. With a selection
+	/// only buffers used by the meshes of those scenes and animations are loaded
+	std::vector<size_t> scenes;
+
+	/// How external buffers are brought into memory
+	ByteBuffer::Storage storage = ByteBuffer::Storage::Read;
+
+	/// Whether buffers are loaded the first time their bytes are needed,
+	/// instead of during construction. Set it to not load buffers at all. See Gltf::prefetch
+	bool lazy_buffers = false;
+
+	/// Number of workers loading buffers and decoding data uris in the background,
+	/// while the rest of the model is parsed. With 0 they are loaded on the calling thread
+	uint32_t load_threads = 0;
+
+	/// Whether primitives drawn with strips, fans and loops are converted to lists once the model
+	/// is loaded, so they are drawn as LINES and TRIANGLES. Their buffers are loaded even when
+	/// lazy, and the load threads convert them. See convert_to_lists
+	bool list_topology = false;
+
+	/// Provides the bytes of external buffers and images, which then refer to
+	/// memory owned by the resolver. Files are used when null
+	std::shared_ptr<Resolver> resolver;
+
+	/// Shares the bytes of external buffer files with other models loaded through it,
+	/// BufferCache::shared() being the one of the whole process. Each model reads its own when null
+	std::shared_ptr<BufferCache> cache;
+
+	/// Receives the stage and bytes of the load as it goes,
+	/// and lets another thread cancel it
+	std::shared_ptr<LoadProgress> progress;
+};
+
+
+} // namespace spot::gfx
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace spot::gfx
+{
+
+
+/// Calls f( i ) for every i in [0, count), spreading the calls over a pool of workers.
+/// The first exception thrown by f stops the remaining calls and is rethrown here
+/// @param count Number of calls
+/// @param threads Maximum number of workers, with 0 calls are made on this thread
+/// @param f Function to call with the index
+template <typename F>
+void parallel_for( const size_t count, const uint32_t threads, F&& f )
+{
+	auto workers = std::min<size_t>( threads, count );
+	if ( workers <= 1 )
+	{
+		for ( size_t i = 0; i < count; ++i )
+		{
+			f( i );
+		}
+		return;
+	}
+
+	std::atomic<size_t> next = 0;
+	std::exception_ptr error;
+	std::mutex error_mutex;
+
+	auto work = [&]() {
+		for ( auto i = next++; i < count; i = next++ )
+		{
+			try
+			{
+				f( i );
+			}
+			catch ( ... )
+			{
+				std::lock_guard<std::mutex> lock( error_mutex );
+				if ( !error )
+				{
+					error = std::current_exception();
+				}
+				next = count;
+			}
+		}
+	};
+
+	// This thread works as well
+	std::vector<std::thread> pool;
+	pool.reserve( workers - 1 );
+	for ( size_t w = 1; w < workers; ++w )
+	{
+		pool.emplace_back( work );
+	}
+	work();
+
+	for ( auto& thread : pool )
+	{
+		thread.join();
+	}
+
+	if ( error )
+	{
+		std::rethrow_exception( error );
+	}
+}
+
+
+/// Starts a parallel_for in the background
+/// @return A future to wait on, which rethrows the first exception
+template <typename F>
+std::future<void> parallel_for_async( const size_t count, const uint32_t threads, F f )
+{
+	return std::async( std::launch::async, [count, threads, f = std::move( f )]() mutable {
+		parallel_for( count, threads, f );
+	} );
+}
+
+
+} // namespace spot::gfx
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+
+namespace spot::gfx
+{
+
+
+/// Thrown by a load which has been cancelled through its progress
+struct LoadCancelled : public std::runtime_error
+{
+	LoadCancelled() : std::runtime_error{ "Load cancelled" } {}
+};
+
+
+/// Progress of a load, written by the loader and readable from any thread
+struct LoadProgress
+{
+	/// Parts of a load, in the order they are entered
+	enum class Stage
+	{
+		Queued,
+		Json,
+		Buffers,
+		Accessors,
+		Meshes,
+		Nodes,
+		Done
+	};
+
+	/// Asks the load to stop, it throws LoadCancelled at the next check
+	void cancel() { cancelled = true; }
+
+	/// Throws LoadCancelled if the load has been cancelled
+	void check() const
+	{
+		if ( cancelled )
+		{
+			throw LoadCancelled();
+		}
+	}
+
+	/// Moves to another stage, unless the load has been cancelled
+	void enter( const Stage s )
+	{
+		check();
+		stage = s;
+	}
+
+	/// Stage the load is in
+	std::atomic<Stage> stage = Stage::Queued;
+
+	/// Bytes of external and data uri buffers read so far
+	std::atomic<uint64_t> bytes_loaded = 0;
+
+	/// Bytes of external and data uri buffers to read
+	std::atomic<uint64_t> bytes_total = 0;
+
+	/// Whether the load has been asked to stop
+	std::atomic<bool> cancelled = false;
+};
+
+
+} // namespace spot::gfx
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+#include "spot/gltf/buffer.h"
+
+namespace spot::gfx
+{
+
+
+/// Provides the bytes of the resources a model refers to by uri,
+/// so they can come from archives or memory instead of files
+class Resolver
+{
+  public:
+	virtual ~Resolver() = default;
+
+	/// @param uri Uri of the resource, as written in the glTF
+	/// @return The bytes of the resource, whose owner keeps them alive.
+	/// An empty span when unknown, so it is read from the directory of the model
+	virtual ByteSpan resolve( const std::string& uri ) = 0;
+};
+
+
+/// Resolves uris to bytes registered up front, without copying them
+class SpanResolver : public Resolver
+{
+  public:
+	/// @param uri Uri of the resource
+	/// @param bytes Bytes of the resource, they must outlive the model unless owned by the span
+	void add( const std::string& uri, ByteSpan bytes ) { spans[uri] = std::move( bytes ); }
+
+	ByteSpan resolve( const std::string& uri ) override
+	{
+		auto it = spans.find( uri );
+		return it != spans.end() ? it->second : ByteSpan{};
+	}
+
+  private:
+	std::unordered_map<std::string, ByteSpan> spans;
+};
+
+
+} // namespace spot::gfx
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "spot/gltf/mesh.h"
+
+namespace spot::gfx
+{
+
+
+/// Per vertex floats weighing in the cost of simplification, like normals or texture coordinates
+struct SimplifyAttribute
+{
+	/// Address of the attribute of the first vertex
+	const float* data = nullptr;
+
+	/// Number of floats of an attribute
+	size_t components = 0;
+
+	/// Distance between attributes in bytes, zero when packed
+	size_t stride = 0;
+
+	/// How much a squared difference of the attribute costs, compared to a squared distance
+	/// relative to the size of the mesh
+	float weight = 1.0f;
+};
+
+
+/// Simplifies a triangle list by collapsing edges onto their vertices, ordered by quadric error
+/// metrics: the squared distance from the planes of the faces merged, plus the difference of
+/// the attributes given. Borders are kept in place, and vertices splitting attributes on the
+/// same position, like texture seams, are not moved. The vertices are kept as they are,
+/// and fewer of them are indexed
+/// @param indices Indices of the triangles, replaced by the simplified ones
+/// @param positions Address of the position of the first vertex
+/// @param vertex_count Number of vertices
+/// @param stride Distance between positions in bytes, zero when packed
+/// @param target_count Number of indices to reach, which may not be reached
+/// @param target_error Largest error allowed, relative to the largest extent of the positions
+/// @param attributes Attributes weighing in the cost of collapses
+/// @return The error of the simplified triangles, relative to the largest extent of the positions
+/// @throw std::runtime_error If the indices are not triangles or an index is out of the vertices
+float simplify( Indices& indices, const float* positions, size_t vertex_count, size_t stride, size_t target_count,
+	float target_error, const std::vector<SimplifyAttribute>& attributes = {} );
+
+
+/// How the levels of detail of a mesh are made
+struct LodOptions
+{
+	/// Triangles of a level compared to the previous one
+	float ratio = 0.5f;
+
+	/// Maximum number of levels
+	size_t max_levels = 4;
+
+	/// Largest error of a level, relative to the size of every primitive
+	float max_error = 0.05f;
+
+	/// Weight of normals in the cost of collapses
+	float normal_weight = 0.5f;
+
+	/// Weight of the first texture coordinates in the cost of collapses
+	float texcoord_weight = 1.0f;
+};
+
+
+/// Makes the levels of detail of a mesh, replacing any it had. Every level simplifies the
+/// triangle list primitives of the mesh from their full resolution, with their runtime
+/// vertices, or with the POSITION, NORMAL and TEXCOORD_0 accessors they are decoded from.
+/// Other primitives are kept as they are. Levels stop when the error grows over the
+/// maximum or triangles stop going down. Indices of primitives loaded from accessors are
+/// stored in new accessors of the model, so they are saved
+/// @param model Model owning the mesh
+/// @param mesh Mesh to make levels for
+/// @param options How levels are made
+/// @throw std::runtime_error If attributes or indices can not be read
+void generate_lods( Gltf& model, Mesh& mesh, const LodOptions& options = {} );
+
+
+/// Makes the levels of detail of every mesh of a model
+/// @param model Model with meshes to simplify
+/// @param threads Maximum number of workers, with 0 meshes are simplified on this thread
+/// @param options How levels are made
+/// @throw std::runtime_error If attributes or indices can not be read
+void generate_lods( Gltf& model, uint32_t threads = 0, const LodOptions& options = {} );
+
+
+} // namespace spot::gfx
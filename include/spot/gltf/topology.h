@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+
+#include "spot/gltf/mesh.h"
+
+namespace spot::gfx
+{
+
+
+/// @return The list mode drawing the same primitives as a mode, LINES for line strips and loops,
+/// TRIANGLES for triangle strips and fans, the mode itself for lists and points
+Primitive::Mode get_list_mode( Primitive::Mode mode );
+
+
+/// Converts indices of strips, fans or loops to indices of a list drawing the same lines or
+/// triangles. Triangles keep their winding, and degenerate ones stitching strips together are
+/// dropped. The width of the indices is kept, as they refer to the same vertices
+/// @param indices Indices drawn with the mode
+/// @param mode Mode of the indices
+/// @return Indices to draw with get_list_mode( mode ), a copy of the indices for lists and points
+Indices convert_to_list( const Indices& indices, Primitive::Mode mode );
+
+
+/// Converts a primitive drawn with strips, fans or loops to a list, loading its indices from its
+/// accessor when it has none in memory. Primitives without indices get indices of their vertices
+/// in order, 16 bits wide, or 32 bits when the vertices do not fit
+/// @return Whether the primitive has been converted
+/// @throw std::runtime_error If the indices can not be read
+bool convert_to_list( Primitive& primitive );
+
+
+/// Converts every primitive of a model drawn with strips, fans or loops to a list, storing
+/// the new indices of loaded primitives in accessors, so consumers only meet lists and points
+/// @param model Model with meshes to convert
+/// @param threads Maximum number of workers, with 0 primitives are converted on this thread
+/// @return The number of primitives converted
+/// @throw std::runtime_error If indices can not be read
+size_t convert_to_lists( Gltf& model, uint32_t threads = 0 );
+
+
+} // namespace spot::gfx
@@ -10,15 +10,8 @@ namespace spot::gfx
 
 std::vector<math::Quat> Animation::get_rotations( const Handle<Sampler>& sampler ) const
 {
-	std::vector<math::Quat> quats;
-
-	auto len = sampler->output->count * sizeof( math::Quat );
-	assert( sampler->output->get_size() == len && "Size mismatch" );
-
-	quats.resize( sampler->output->count );
-	std::memcpy( quats.data(), sampler->output->get_data(), len );
-
-	return quats;
+	auto quats = AccessorView<math::Quat>( *sampler->output );
+	return { quats.begin(), quats.end() };
 }
 
 
@@ -29,8 +22,8 @@ math::Quat Animation::find_last_rotation() const
 		auto& channel = (*channels)[i];
 		if ( channel.target.path == Target::Path::Rotation )
 		{
-			auto quats = get_rotations( channel.sampler );
-			if ( quats.size() )
+			auto quats = AccessorView<math::Quat>( *channel.sampler->output );
+			if ( !quats.empty() )
 			{
 				return quats.back();
 			}
@@ -43,15 +36,13 @@ math::Quat Animation::find_last_rotation() const
 
 std::vector<float> Animation::get_times( const Handle<Sampler>& sampler ) const
 {
-	std::vector<float> times;
-
-	if ( sampler->input )
+	if ( !sampler->input )
 	{
-		times.resize( sampler->input->count );
-		std::memcpy( times.data(), sampler->input->get_data(), sampler->input->count * sizeof( float ) );
+		return {};
 	}
 
-	return times;
+	auto times = AccessorView<float>( *sampler->input );
+	return { times.begin(), times.end() };
 }
 
 
@@ -59,12 +50,12 @@ float Animation::find_max_time()
 {
 	for ( auto& channel : *channels )
 	{
-		std::vector<float> times = get_times( channel.sampler );
-
-		auto it = std::max_element( std::begin( times ), std::end( times ) );
-		if ( it != std::end( times ) )
+		if ( channel.sampler->input )
 		{
-			time.max = std::max<float>( time.max, *it );
+			for ( auto t : AccessorView<float>( *channel.sampler->input ) )
+			{
+				time.max = std::max<float>( time.max, t );
+			}
 		}
 	}
 
@@ -104,6 +95,7 @@ void Animation::add_rotation(
 		auto buffer = model->buffers.push();
 		buffer_view->buffer = buffer;
 		buffer->byte_length = times.size() * sizeof( float );
+		buffer_view->byte_length = buffer->byte_length;
 		buffer->data.resize( buffer->byte_length );
 		std::memcpy( buffer->data.data(), times.data(), buffer->byte_length );
 	}
@@ -122,6 +114,7 @@ void Animation::add_rotation(
 		auto buffer = model->buffers.push();
 		buffer_view->buffer = buffer;
 		buffer->byte_length = quats.size() * sizeof( math::Quat );
+		buffer_view->byte_length = buffer->byte_length;
 		buffer->data.resize( buffer->byte_length );
 		std::memcpy( buffer->data.data(), quats.data(), buffer->byte_length );
 	}
@@ -164,6 +157,7 @@ void Animation::add_rotation( const Handle<Node>& node, const float time, const
 		auto buffer = model->buffers.push();
 		buffer_view->buffer = buffer;
 		buffer->byte_length = times.size() * sizeof( float );
+		buffer_view->byte_length = buffer->byte_length;
 		buffer->data.resize( buffer->byte_length );
 		std::memcpy( buffer->data.data(), times.data(), buffer->byte_length );
 	}
@@ -182,6 +176,7 @@ void Animation::add_rotation( const Handle<Node>& node, const float time, const
 		auto buffer = model->buffers.push();
 		buffer_view->buffer = buffer;
 		buffer->byte_length = quats.size() * sizeof( math::Quat );
+		buffer_view->byte_length = buffer->byte_length;
 		buffer->data.resize( buffer->byte_length );
 		std::memcpy( buffer->data.data(), quats.data(), buffer->byte_length );
 	}
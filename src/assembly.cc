@@ -0,0 +1,335 @@
+#include "spot/gltf/assembly.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "spot/gltf/decode.h"
+#include "spot/gltf/gltf.h"
+#include "spot/gltf/parallel.h"
+
+namespace spot::gfx
+{
+
+
+/// @return The number of floats written for an attribute of an accessor
+/// @throw std::runtime_error If the accessor does not have the type the attribute needs
+size_t get_stream_components( const Primitive::Semantic semantic, const Accessor& accessor )
+{
+	auto components = size_of( accessor.type );
+	auto expected = Accessor::Type::NONE;
+	switch ( semantic )
+	{
+	case Primitive::Semantic::POSITION:
+	case Primitive::Semantic::NORMAL: expected = Accessor::Type::VEC3; break;
+	case Primitive::Semantic::TANGENT:
+	case Primitive::Semantic::JOINTS_0:
+	case Primitive::Semantic::WEIGHTS_0: expected = Accessor::Type::VEC4; break;
+	case Primitive::Semantic::TEXCOORD_0:
+	case Primitive::Semantic::TEXCOORD_1: expected = Accessor::Type::VEC2; break;
+	case Primitive::Semantic::COLOR_0:
+		if ( accessor.type == Accessor::Type::VEC3 || accessor.type == Accessor::Type::VEC4 )
+		{
+			return 4;
+		}
+		break;
+	default: break;
+	}
+
+	if ( accessor.type != expected )
+	{
+		throw std::runtime_error{ "Attribute " + to_string( semantic ) + " not valid: " + to_string( accessor.type ) };
+	}
+	return components;
+}
+
+
+std::vector<Primitive*> get_primitives( Gltf& model )
+{
+	std::vector<Primitive*> ret;
+	for ( auto& mesh : *model.meshes )
+	{
+		for ( auto& primitive : mesh.primitives )
+		{
+			ret.emplace_back( &primitive );
+		}
+	}
+	return ret;
+}
+
+
+size_t get_vertex_count( const Primitive& primitive )
+{
+	auto it = primitive.attributes.find( Primitive::Semantic::POSITION );
+	return it != primitive.attributes.end() && it->second ? it->second->count : primitive.vertices.size();
+}
+
+
+PrimitivePositions get_positions( const Primitive& primitive )
+{
+	PrimitivePositions ret;
+	if ( !primitive.vertices.empty() )
+	{
+		ret.data = &primitive.vertices[0].p.x;
+		ret.stride = sizeof( Vertex );
+		ret.count = primitive.vertices.size();
+		return ret;
+	}
+
+	auto it = primitive.attributes.find( Primitive::Semantic::POSITION );
+	if ( it == primitive.attributes.end() || !it->second )
+	{
+		return ret;
+	}
+	if ( it->second->type != Accessor::Type::VEC3 )
+	{
+		throw std::runtime_error{ "Attribute POSITION not valid: " + to_string( it->second->type ) };
+	}
+	ret.decoded = decode_floats( *it->second );
+	ret.data = ret.decoded.data();
+	ret.count = it->second->count;
+	return ret;
+}
+
+
+bool has_unit_normals( const Primitive& primitive )
+{
+	return std::all_of( primitive.vertices.begin(), primitive.vertices.end(), []( const Vertex& vertex ) {
+		auto& n = vertex.n;
+		return std::abs( n.x * n.x + n.y * n.y + n.z * n.z - 1.0f ) < 1e-3f;
+	} );
+}
+
+
+void check_triangles( const Indices& indices, const size_t vertex_count )
+{
+	if ( indices.size() % 3 != 0 )
+	{
+		throw std::runtime_error{ "Indices not triangles: " + std::to_string( indices.size() ) };
+	}
+	if ( !indices.empty() && indices.get_max() >= vertex_count )
+	{
+		throw std::runtime_error{ "Index out of " + std::to_string( vertex_count ) + " vertices" };
+	}
+}
+
+
+/// An attribute of a primitive going into a stream
+struct StreamGather
+{
+	/// Null for an accessor without data, which reads as zeros
+	const uint8_t* data = nullptr;
+	size_t stride = 0;
+	Accessor::ComponentType component_type = Accessor::ComponentType::FLOAT;
+	bool normalized = false;
+
+	/// Components of the accessor
+	size_t components = 0;
+
+	/// Components written, more for colors which get an alpha
+	size_t out_components = 0;
+
+	float* out = nullptr;
+
+	/// Distance between vertices in floats
+	size_t out_stride = 0;
+};
+
+
+/// Vertices gathered by every stream before moving to the next ones,
+/// so interleaved vertices are still in the L1 cache when the next stream writes them
+constexpr size_t assembly_chunk = 16;
+
+
+void assemble_vertices( const Primitive& primitive, const std::vector<VertexStream>& streams )
+{
+	auto count = get_vertex_count( primitive );
+	if ( count == 0 )
+	{
+		return;
+	}
+
+	std::vector<StreamGather> gathers;
+	for ( auto& stream : streams )
+	{
+		auto it = primitive.attributes.find( stream.semantic );
+		if ( it == primitive.attributes.end() || !it->second )
+		{
+			continue;
+		}
+
+		auto& accessor = *it->second;
+		auto& gather = gathers.emplace_back();
+		gather.out_components = get_stream_components( stream.semantic, accessor );
+		if ( accessor.count < count )
+		{
+			throw std::runtime_error{ "Attribute " + to_string( stream.semantic ) + " shorter than POSITION" };
+		}
+		auto out_stride = stream.stride ? stream.stride : gather.out_components * sizeof( float );
+		if ( out_stride % sizeof( float ) != 0 )
+		{
+			throw std::runtime_error{ "Vertex stream not aligned to floats" };
+		}
+		gather.out = stream.data;
+		gather.out_stride = out_stride / sizeof( float );
+
+		gather.component_type = accessor.component_type;
+		gather.normalized = accessor.normalized;
+		gather.components = size_of( accessor.type );
+		if ( accessor.buffer_view || accessor.sparse )
+		{
+			auto element_size = size_of( accessor.component_type ) * gather.components;
+			gather.data = reinterpret_cast<const uint8_t*>(
+				check_accessor_view( accessor, accessor.component_type, accessor.type, element_size, gather.stride ) );
+		}
+	}
+
+	for ( size_t first = 0; first < count; first += assembly_chunk )
+	{
+		auto chunk = std::min( assembly_chunk, count - first );
+		for ( auto& gather : gathers )
+		{
+			auto out = gather.out + first * gather.out_stride;
+			if ( gather.data )
+			{
+				decode_components( gather.data + first * gather.stride, gather.stride, chunk, gather.component_type,
+					gather.components, gather.normalized, out, gather.out_stride * sizeof( float ) );
+			}
+			else
+			{
+				// Zeros, as glTF describes accessors without data
+				for ( size_t i = 0; i < chunk; ++i )
+				{
+					std::fill( out + i * gather.out_stride, out + i * gather.out_stride + gather.components, 0.0f );
+				}
+			}
+
+			// Opaque colors
+			for ( size_t c = gather.components; c < gather.out_components; ++c )
+			{
+				for ( size_t i = 0; i < chunk; ++i )
+				{
+					out[i * gather.out_stride + c] = 1.0f;
+				}
+			}
+		}
+	}
+}
+
+
+void assemble_vertices( Primitive& primitive )
+{
+	// Primitives made at runtime come with their vertices
+	auto& attributes = primitive.attributes;
+	if ( !attributes.count( Primitive::Semantic::POSITION ) )
+	{
+		return;
+	}
+
+	auto& vertices = primitive.vertices;
+	vertices.resize( get_vertex_count( primitive ) );
+	if ( vertices.empty() )
+	{
+		return;
+	}
+
+	// Defaults are written only where an attribute is missing, to go through vertices once
+	const Vertex defaults;
+	auto normal = attributes.count( Primitive::Semantic::NORMAL );
+	auto color = attributes.count( Primitive::Semantic::COLOR_0 );
+	auto texcoord = attributes.count( Primitive::Semantic::TEXCOORD_0 );
+	if ( !normal || !color || !texcoord )
+	{
+		for ( auto& vertex : vertices )
+		{
+			vertex.n = normal ? vertex.n : defaults.n;
+			vertex.c = color ? vertex.c : defaults.c;
+			vertex.t = texcoord ? vertex.t : defaults.t;
+		}
+	}
+
+	auto& first = vertices[0];
+	assemble_vertices( primitive,
+		{
+			{ Primitive::Semantic::POSITION, &first.p.x, sizeof( Vertex ) },
+			{ Primitive::Semantic::NORMAL, &first.n.x, sizeof( Vertex ) },
+			{ Primitive::Semantic::COLOR_0, &first.c.r, sizeof( Vertex ) },
+			{ Primitive::Semantic::TEXCOORD_0, &first.t.x, sizeof( Vertex ) },
+		} );
+}
+
+
+void assemble_indices( Primitive& primitive )
+{
+	if ( !primitive.indices_handle )
+	{
+		return;
+	}
+
+	auto& accessor = *primitive.indices_handle;
+	if ( accessor.type != Accessor::Type::SCALAR )
+	{
+		throw std::runtime_error{ "Indices not valid: " + to_string( accessor.type ) };
+	}
+
+	auto& indices = primitive.indices;
+	indices = Indices( accessor.component_type, accessor.count );
+	if ( !accessor.buffer_view && !accessor.sparse )
+	{
+		return;
+	}
+
+	size_t stride = 0;
+	auto data = reinterpret_cast<const uint8_t*>( check_accessor_view(
+		accessor, accessor.component_type, accessor.type, indices.get_index_size(), stride ) );
+	if ( stride == indices.get_index_size() )
+	{
+		std::memcpy( indices.data(), data, indices.get_bytes().size() );
+	}
+	else
+	{
+		for ( size_t i = 0; i < accessor.count; ++i )
+		{
+			std::memcpy( indices.data() + i * indices.get_index_size(), data + i * stride, indices.get_index_size() );
+		}
+	}
+}
+
+
+void store_indices( Gltf& model, Primitive& primitive )
+{
+	auto& indices = primitive.indices;
+	auto& bytes = indices.get_bytes();
+	primitive.indices_handle = model.create_accessor( std::vector<char>( bytes.begin(), bytes.end() ),
+		indices.get_component_type(), Accessor::Type::SCALAR, indices.size(), BufferView::Target::ElementArrayBuffer );
+}
+
+
+void assemble_vertices( Gltf& model, const uint32_t threads )
+{
+	auto primitives = get_primitives( model );
+	parallel_for( primitives.size(), threads, [&primitives]( size_t i ) {
+		assemble_vertices( *primitives[i] );
+		assemble_indices( *primitives[i] );
+	} );
+}
+
+
+void narrow_indices( Primitive& primitive )
+{
+	primitive.indices.narrow( get_vertex_count( primitive ) );
+}
+
+
+void narrow_indices( Gltf& model )
+{
+	for ( auto primitive : get_primitives( model ) )
+	{
+		narrow_indices( *primitive );
+	}
+}
+
+
+} // namespace spot::gfx
@@ -0,0 +1,286 @@
+#include "spot/gltf/base64.h"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#if defined( __x86_64__ ) || defined( __i386__ ) || defined( _M_X64 ) || defined( _M_IX86 )
+#define GST_BASE64_X86
+#include <immintrin.h>
+#if defined( _MSC_VER )
+#include <intrin.h>
+#endif
+#endif
+
+#if defined( GST_BASE64_X86 ) && ( defined( __GNUC__ ) || defined( __clang__ ) )
+#define GST_TARGET( t ) __attribute__( ( target( t ) ) )
+#else
+#define GST_TARGET( t )
+#endif
+
+namespace spot::gfx
+{
+
+
+/// Value of each base64 character, or -1 for everything else
+constexpr std::array<int8_t, 256> make_base64_table()
+{
+	std::array<int8_t, 256> table = {};
+	for ( auto& value : table )
+	{
+		value = -1;
+	}
+
+	constexpr char chars[] =
+	    "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+	    "abcdefghijklmnopqrstuvwxyz"
+	    "0123456789+/";
+	for ( int8_t i = 0; i < 64; ++i )
+	{
+		table[uint8_t( chars[i] )] = i;
+	}
+
+	return table;
+}
+
+
+constexpr auto base64_table = make_base64_table();
+
+
+/// Decodes from in to out until the first non-base64 character
+/// @return The number of bytes written to out
+size_t decode_scalar( const char* in, const size_t size, char* out )
+{
+	auto begin = out;
+	auto value = [in]( size_t i ) { return base64_table[uint8_t( in[i] )]; };
+
+	size_t i = 0;
+
+	// Whole quads
+	for ( ; i + 4 <= size; i += 4 )
+	{
+		auto a = value( i );
+		auto b = value( i + 1 );
+		auto c = value( i + 2 );
+		auto d = value( i + 3 );
+		if ( ( a | b | c | d ) < 0 )
+		{
+			break;
+		}
+
+		uint32_t bits = ( a << 18 ) | ( b << 12 ) | ( c << 6 ) | d;
+		*out++ = char( bits >> 16 );
+		*out++ = char( bits >> 8 );
+		*out++ = char( bits );
+	}
+
+	// Last incomplete quad, which may end with padding
+	int32_t bits = 0;
+	size_t count = 0;
+	for ( ; i < size && count < 4; ++i, ++count )
+	{
+		auto v = value( i );
+		if ( v < 0 )
+		{
+			break;
+		}
+		bits = ( bits << 6 ) | v;
+	}
+
+	if ( count == 2 )
+	{
+		*out++ = char( bits >> 4 );
+	}
+	else if ( count == 3 )
+	{
+		*out++ = char( bits >> 10 );
+		*out++ = char( bits >> 2 );
+	}
+
+	return out - begin;
+}
+
+
+#if defined( GST_BASE64_X86 )
+
+/// SSSE3 decoding of 16 characters into 12 bytes at a time, after Wojciech Mula
+/// @return The number of characters consumed, stopping before the first invalid block
+GST_TARGET( "ssse3" )
+size_t decode_ssse3( const char* in, const size_t size, char*& out )
+{
+	const auto lut_lo = _mm_setr_epi8(
+		0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A );
+	const auto lut_hi = _mm_setr_epi8(
+		0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10 );
+	const auto lut_roll = _mm_setr_epi8( 0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0 );
+	const auto mask_2f = _mm_set1_epi8( 0x2F );
+	const auto mask_0f = _mm_set1_epi8( 0x0F );
+	const auto merge_a = _mm_set1_epi32( 0x01400140 );
+	const auto merge_b = _mm_set1_epi32( 0x00011000 );
+	const auto pack = _mm_setr_epi8( 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1 );
+
+	size_t i = 0;
+	for ( ; i + 16 <= size; i += 16 )
+	{
+		auto chars = _mm_loadu_si128( reinterpret_cast<const __m128i*>( in + i ) );
+
+		auto hi_nibbles = _mm_and_si128( _mm_srli_epi32( chars, 4 ), mask_0f );
+		auto lo_nibbles = _mm_and_si128( chars, mask_0f );
+		auto lo = _mm_shuffle_epi8( lut_lo, lo_nibbles );
+		auto hi = _mm_shuffle_epi8( lut_hi, hi_nibbles );
+		auto valid = _mm_cmpeq_epi8( _mm_and_si128( lo, hi ), _mm_setzero_si128() );
+		if ( _mm_movemask_epi8( valid ) != 0xFFFF )
+		{
+			break;
+		}
+
+		auto eq_2f = _mm_cmpeq_epi8( chars, mask_2f );
+		auto roll = _mm_shuffle_epi8( lut_roll, _mm_add_epi8( eq_2f, hi_nibbles ) );
+		auto values = _mm_add_epi8( chars, roll );
+
+		auto merged = _mm_madd_epi16( _mm_maddubs_epi16( values, merge_a ), merge_b );
+		auto bytes = _mm_shuffle_epi8( merged, pack );
+
+		// Writes 16 bytes, 12 of which are valid
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( out ), bytes );
+		out += 12;
+	}
+
+	return i;
+}
+
+
+/// AVX2 decoding of 32 characters into 24 bytes at a time
+/// @return The number of characters consumed, stopping before the first invalid block
+GST_TARGET( "avx2" )
+size_t decode_avx2( const char* in, const size_t size, char*& out )
+{
+	const auto lut_lo = _mm256_setr_epi8(
+		0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+		0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A );
+	const auto lut_hi = _mm256_setr_epi8(
+		0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+		0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10 );
+	const auto lut_roll = _mm256_setr_epi8(
+		0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0 );
+	const auto mask_2f = _mm256_set1_epi8( 0x2F );
+	const auto mask_0f = _mm256_set1_epi8( 0x0F );
+	const auto merge_a = _mm256_set1_epi32( 0x01400140 );
+	const auto merge_b = _mm256_set1_epi32( 0x00011000 );
+	const auto pack = _mm256_setr_epi8(
+		2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+		2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1 );
+	const auto lanes = _mm256_setr_epi32( 0, 1, 2, 4, 5, 6, 7, 7 );
+
+	size_t i = 0;
+	for ( ; i + 32 <= size; i += 32 )
+	{
+		auto chars = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( in + i ) );
+
+		auto hi_nibbles = _mm256_and_si256( _mm256_srli_epi32( chars, 4 ), mask_0f );
+		auto lo_nibbles = _mm256_and_si256( chars, mask_0f );
+		auto lo = _mm256_shuffle_epi8( lut_lo, lo_nibbles );
+		auto hi = _mm256_shuffle_epi8( lut_hi, hi_nibbles );
+		if ( !_mm256_testz_si256( lo, hi ) )
+		{
+			break;
+		}
+
+		auto eq_2f = _mm256_cmpeq_epi8( chars, mask_2f );
+		auto roll = _mm256_shuffle_epi8( lut_roll, _mm256_add_epi8( eq_2f, hi_nibbles ) );
+		auto values = _mm256_add_epi8( chars, roll );
+
+		auto merged = _mm256_madd_epi16( _mm256_maddubs_epi16( values, merge_a ), merge_b );
+		auto bytes = _mm256_permutevar8x32_epi32( _mm256_shuffle_epi8( merged, pack ), lanes );
+
+		// Writes 32 bytes, 24 of which are valid
+		_mm256_storeu_si256( reinterpret_cast<__m256i*>( out ), bytes );
+		out += 24;
+	}
+
+	return i;
+}
+
+
+/// Vectorized decoders available on this CPU
+struct Simd
+{
+	bool ssse3 = false;
+	bool avx2 = false;
+};
+
+
+Simd detect_simd()
+{
+	Simd simd;
+#if defined( _MSC_VER )
+	int info[4] = {};
+	__cpuid( info, 0 );
+	auto max_leaf = info[0];
+	if ( max_leaf >= 1 )
+	{
+		__cpuid( info, 1 );
+		simd.ssse3 = info[2] & ( 1 << 9 );
+		// AVX2 also needs the OS to save ymm registers
+		bool osxsave = info[2] & ( 1 << 27 );
+		if ( osxsave && max_leaf >= 7 && ( _xgetbv( 0 ) & 0x6 ) == 0x6 )
+		{
+			__cpuidex( info, 7, 0 );
+			simd.avx2 = info[1] & ( 1 << 5 );
+		}
+	}
+#else
+	__builtin_cpu_init();
+	simd.ssse3 = __builtin_cpu_supports( "ssse3" );
+	simd.avx2 = __builtin_cpu_supports( "avx2" );
+#endif
+	return simd;
+}
+
+
+const Simd simd = detect_simd();
+
+#endif // GST_BASE64_X86
+
+
+/// Room for the widest SIMD store past the last valid byte
+constexpr size_t store_slack = 32;
+
+
+std::vector<char> base64_decode( const std::string_view encoded )
+{
+	auto in = encoded.data();
+	auto size = encoded.size();
+
+	std::vector<char> ret( size / 4 * 3 + 3 + store_slack );
+	auto out = ret.data();
+
+	size_t consumed = 0;
+#if defined( GST_BASE64_X86 )
+	if ( simd.avx2 )
+	{
+		consumed = decode_avx2( in, size, out );
+	}
+	if ( simd.ssse3 )
+	{
+		consumed += decode_ssse3( in + consumed, size - consumed, out );
+	}
+#endif
+
+	out += decode_scalar( in + consumed, size - consumed, out );
+
+	ret.resize( out - ret.data() );
+	return ret;
+}
+
+
+std::vector<char> base64_decode_scalar( const std::string_view encoded )
+{
+	std::vector<char> ret( encoded.size() / 4 * 3 + 3 );
+	ret.resize( decode_scalar( encoded.data(), encoded.size(), ret.data() ) );
+	return ret;
+}
+
+
+} // namespace spot::gfx
@@ -0,0 +1,1201 @@
+#include "spot/gltf/blob.h"
+
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <spot/file/ifstream.h>
+
+#include "spot/gltf/cache.h"
+#include "spot/gltf/gltf.h"
+
+namespace spot::gfx
+{
+
+
+/// "GSPB", also telling the byte order the blob was written with
+constexpr uint32_t blob_magic = 0x42505347;
+
+/// Bump when the records change
+constexpr uint32_t blob_version = 4;
+
+/// Index of a missing element
+constexpr uint32_t blob_none = ~0u;
+
+/// Tables are aligned so their records can be used in place
+constexpr size_t blob_alignment = 16;
+
+
+/// Strings and lists are ranges of the shared tables
+struct BlobRange
+{
+	uint32_t offset = 0;
+	uint32_t count = 0;
+};
+
+
+enum class BlobTable : uint32_t
+{
+	Strings,
+	Indices,
+	Floats,
+	Payload,
+	Buffers,
+	BufferViews,
+	Cameras,
+	Samplers,
+	Images,
+	Textures,
+	Accessors,
+	Materials,
+	Meshes,
+	Primitives,
+	Attributes,
+	Lights,
+	Nodes,
+	Animations,
+	AnimationSamplers,
+	Channels,
+	Rects,
+	Boxes,
+	Spheres,
+	Bounds,
+	Scripts,
+	Scenes,
+	Files,
+	Count
+};
+
+
+struct BlobBuffer
+{
+	BlobRange uri;
+	uint64_t offset = 0;
+	uint64_t byte_length = 0;
+};
+
+
+struct BlobBufferView
+{
+	uint32_t buffer = blob_none;
+	uint32_t target = 0;
+	uint64_t byte_offset = 0;
+	uint64_t byte_length = 0;
+	uint64_t byte_stride = 0;
+};
+
+
+struct BlobCamera
+{
+	BlobRange name;
+	uint32_t type = 0;
+	GltfCamera::Ortographic orthographic;
+	GltfCamera::Perspective perspective;
+};
+
+
+struct BlobSampler
+{
+	BlobRange name;
+	uint32_t mag_filter = 0;
+	uint32_t min_filter = 0;
+	uint32_t wrap_s = 0;
+	uint32_t wrap_t = 0;
+};
+
+
+struct BlobImage
+{
+	BlobRange name;
+	BlobRange uri;
+	BlobRange mime_type;
+	uint32_t buffer_view = 0;
+};
+
+
+struct BlobTexture
+{
+	BlobRange name;
+	uint32_t sampler = blob_none;
+	uint32_t source = blob_none;
+};
+
+
+struct BlobAccessor
+{
+	uint32_t buffer_view = blob_none;
+	uint32_t component_type = 0;
+	uint32_t type = 0;
+	uint32_t normalized = 0;
+	uint64_t byte_offset = 0;
+	uint64_t count = 0;
+	BlobRange min;
+	BlobRange max;
+
+	/// Zero unless the accessor is sparse
+	uint64_t sparse_count = 0;
+	uint32_t sparse_indices_view = blob_none;
+	uint32_t sparse_indices_component_type = 0;
+	uint64_t sparse_indices_offset = 0;
+	uint32_t sparse_values_view = blob_none;
+	uint32_t padding = 0;
+	uint64_t sparse_values_offset = 0;
+};
+
+
+struct BlobMaterial
+{
+	BlobRange name;
+	uint32_t texture = blob_none;
+	Material::PbrMetallicRoughness pbr;
+};
+
+
+struct BlobAttribute
+{
+	uint32_t semantic = 0;
+	uint32_t accessor = 0;
+};
+
+
+struct BlobPrimitive
+{
+	BlobRange attributes;
+	uint32_t indices = blob_none;
+	uint32_t material = blob_none;
+	uint32_t mode = 0;
+	float line_width = 1.0f;
+};
+
+
+struct BlobMesh
+{
+	BlobRange name;
+	BlobRange primitives;
+	BlobRange weights;
+};
+
+
+struct BlobLight
+{
+	BlobRange name;
+	math::Vec3 color;
+	float intensity = 1.0f;
+	uint32_t type = 0;
+	float range = 0.0f;
+	Light::Spot spot;
+};
+
+
+struct BlobNode
+{
+	BlobRange name;
+	BlobRange children;
+	BlobRange scripts;
+	uint32_t mesh = blob_none;
+	uint32_t camera = blob_none;
+	int32_t light = -1;
+	int32_t bounds = -1;
+	math::Quat rotation;
+	math::Vec3 scale;
+	math::Vec3 translation;
+	math::Mat4 matrix;
+};
+
+
+struct BlobAnimation
+{
+	BlobRange name;
+	BlobRange samplers;
+	BlobRange channels;
+};
+
+
+struct BlobAnimationSampler
+{
+	uint32_t input = 0;
+	uint32_t output = 0;
+	uint32_t interpolation = 0;
+};
+
+
+struct BlobChannel
+{
+	uint32_t sampler = 0;
+	uint32_t node = blob_none;
+	uint32_t path = 0;
+};
+
+
+struct BlobScript
+{
+	BlobRange uri;
+	BlobRange name;
+};
+
+
+struct BlobScene
+{
+	BlobRange name;
+	BlobRange nodes;
+};
+
+
+/// An external file the model was read from
+struct BlobFile
+{
+	BlobRange path;
+	BlobSource source;
+};
+
+
+struct BlobHeader
+{
+	uint32_t magic = blob_magic;
+	uint32_t version = blob_version;
+
+	/// Sizes of the records, so a blob written by another build is not used
+	uint32_t layout = 0;
+
+	/// Current scene
+	uint32_t scene = blob_none;
+
+	BlobSource source;
+
+	/// Fingerprint of the options the model was loaded with
+	uint64_t options = 0;
+
+	BlobRange version_string;
+	BlobRange generator;
+	BlobRange copyright;
+
+	struct Table
+	{
+		uint64_t offset = 0;
+		uint64_t size = 0;
+	};
+
+	std::array<Table, size_t( BlobTable::Count )> tables;
+};
+
+
+/// @return A fingerprint of the sizes of the records
+constexpr uint32_t get_blob_layout()
+{
+	constexpr size_t sizes[] = {
+		sizeof( BlobHeader ), sizeof( BlobBuffer ), sizeof( BlobBufferView ), sizeof( BlobCamera ),
+		sizeof( BlobSampler ), sizeof( BlobImage ), sizeof( BlobTexture ), sizeof( BlobAccessor ),
+		sizeof( BlobMaterial ), sizeof( BlobAttribute ), sizeof( BlobPrimitive ), sizeof( BlobMesh ),
+		sizeof( BlobLight ), sizeof( BlobNode ), sizeof( BlobAnimation ), sizeof( BlobAnimationSampler ),
+		sizeof( BlobChannel ), sizeof( BlobScript ), sizeof( BlobScene ), sizeof( math::Rect ),
+		sizeof( math::Box ), sizeof( math::Sphere ), sizeof( Bounds ), sizeof( BlobFile ),
+	};
+
+	uint32_t hash = 2166136261u;
+	for ( auto size : sizes )
+	{
+		hash = ( hash ^ uint32_t( size ) ) * 16777619u;
+	}
+	return hash;
+}
+
+
+static_assert( std::is_trivially_copyable_v<BlobNode> && std::is_trivially_copyable_v<BlobMaterial> &&
+	std::is_trivially_copyable_v<BlobLight> && std::is_trivially_copyable_v<math::Rect> &&
+	std::is_trivially_copyable_v<math::Box> && std::is_trivially_copyable_v<math::Sphere>,
+	"Blob records are copied as bytes" );
+
+
+/// @return The index of a handle, or none when it is not valid
+template <typename T>
+uint32_t to_index( const Handle<T>& handle )
+{
+	return handle ? uint32_t( handle.get_index() ) : blob_none;
+}
+
+
+/// Collects the tables of a blob
+class BlobWriter
+{
+  public:
+	/// @return The range of a string, written once however many times it is used
+	BlobRange string( const std::string& s )
+	{
+		auto [it, added] = strings.emplace( s, BlobRange{} );
+		if ( added )
+		{
+			auto& table = get( BlobTable::Strings );
+			it->second = { uint32_t( table.size() ), uint32_t( s.size() ) };
+			table.insert( table.end(), s.begin(), s.end() );
+		}
+		return it->second;
+	}
+
+	/// @return The range of a list of values in a shared table
+	template <typename T>
+	BlobRange list( const BlobTable t, const T* values, const size_t count )
+	{
+		auto& table = get( t );
+		auto ret = BlobRange{ uint32_t( table.size() / sizeof( T ) ), uint32_t( count ) };
+		auto bytes = reinterpret_cast<const char*>( values );
+		table.insert( table.end(), bytes, bytes + count * sizeof( T ) );
+		return ret;
+	}
+
+	BlobRange floats( const std::vector<float>& values )
+	{
+		return list( BlobTable::Floats, values.data(), values.size() );
+	}
+
+	BlobRange indices( const std::vector<uint32_t>& values )
+	{
+		return list( BlobTable::Indices, values.data(), values.size() );
+	}
+
+	/// Appends a record to its table
+	template <typename R>
+	void record( const BlobTable t, const R& r )
+	{
+		list( t, &r, 1 );
+	}
+
+	/// @return The number of records of a table
+	template <typename R>
+	uint32_t count( const BlobTable t )
+	{
+		return uint32_t( get( t ).size() / sizeof( R ) );
+	}
+
+	/// @return The offset of bytes appended to the payload, aligned for any use
+	uint64_t payload( const char* data, const size_t size )
+	{
+		auto& table = get( BlobTable::Payload );
+		table.resize( ( table.size() + blob_alignment - 1 ) / blob_alignment * blob_alignment );
+		auto ret = table.size();
+		table.insert( table.end(), data, data + size );
+		return ret;
+	}
+
+	/// Writes the header followed by the tables
+	void write( std::ostream& out, BlobHeader& header )
+	{
+		uint64_t offset = align( sizeof( BlobHeader ) );
+		for ( size_t i = 0; i < tables.size(); ++i )
+		{
+			header.tables[i] = { offset, tables[i].size() };
+			offset = align( offset + tables[i].size() );
+		}
+
+		out.write( reinterpret_cast<const char*>( &header ), sizeof( header ) );
+		uint64_t written = sizeof( header );
+		for ( size_t i = 0; i < tables.size(); ++i )
+		{
+			static const char padding[blob_alignment] = {};
+			out.write( padding, header.tables[i].offset - written );
+			out.write( tables[i].data(), tables[i].size() );
+			written = header.tables[i].offset + tables[i].size();
+		}
+	}
+
+  private:
+	static uint64_t align( const uint64_t offset )
+	{
+		return ( offset + blob_alignment - 1 ) / blob_alignment * blob_alignment;
+	}
+
+	std::vector<char>& get( const BlobTable t ) { return tables[size_t( t )]; }
+
+	std::array<std::vector<char>, size_t( BlobTable::Count )> tables;
+
+	std::unordered_map<std::string, BlobRange> strings;
+};
+
+
+/// Reads the tables of a blob, checking every range against them
+class BlobReader
+{
+  public:
+	BlobReader( const ByteSpan& b )
+	: blob { b }
+	{
+		if ( !is_valid( blob ) )
+		{
+			throw std::runtime_error{ "Blob not valid" };
+		}
+		std::memcpy( &header, blob.data, sizeof( header ) );
+	}
+
+	/// @return Whether the blob has a header of this version and tables within its bytes
+	static bool is_valid( const ByteSpan& blob )
+	{
+		BlobHeader header;
+		if ( !blob.data || blob.size < sizeof( header ) )
+		{
+			return false;
+		}
+		std::memcpy( &header, blob.data, sizeof( header ) );
+		if ( header.magic != blob_magic || header.version != blob_version || header.layout != get_blob_layout() )
+		{
+			return false;
+		}
+		for ( auto& table : header.tables )
+		{
+			if ( table.offset > blob.size || table.size > blob.size - table.offset )
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/// @return The number of records of a table
+	template <typename R>
+	size_t count( const BlobTable t ) const
+	{
+		return header.tables[size_t( t )].size / sizeof( R );
+	}
+
+	/// @return A record of a table
+	template <typename R>
+	R record( const BlobTable t, const size_t i ) const
+	{
+		R ret;
+		std::memcpy( &ret, at( t, i * sizeof( R ), sizeof( R ) ), sizeof( R ) );
+		return ret;
+	}
+
+	std::string string( const BlobRange& r ) const
+	{
+		return std::string( at( BlobTable::Strings, r.offset, r.count ), r.count );
+	}
+
+	template <typename T>
+	std::vector<T> list( const BlobTable t, const BlobRange& r ) const
+	{
+		std::vector<T> ret( r.count );
+		std::memcpy( ret.data(), at( t, uint64_t( r.offset ) * sizeof( T ), uint64_t( r.count ) * sizeof( T ) ),
+			r.count * sizeof( T ) );
+		return ret;
+	}
+
+	std::vector<float> floats( const BlobRange& r ) const { return list<float>( BlobTable::Floats, r ); }
+
+	std::vector<uint32_t> indices( const BlobRange& r ) const { return list<uint32_t>( BlobTable::Indices, r ); }
+
+	/// @return Bytes of the payload, sharing the owner of the blob
+	ByteSpan payload( const uint64_t offset, const uint64_t size ) const
+	{
+		return { at( BlobTable::Payload, offset, size ), size_t( size ), blob.owner };
+	}
+
+	/// @return A handle to an element of a list
+	/// @throw std::runtime_error If the index is out of the list
+	template <typename T>
+	static Handle<T> handle( const Uvec<T>& list, const uint32_t index )
+	{
+		if ( index == blob_none )
+		{
+			return {};
+		}
+		check( index, list->size() );
+		return Handle<T>( list, index );
+	}
+
+	static void check( const size_t index, const size_t size )
+	{
+		if ( index >= size )
+		{
+			throw std::runtime_error{ "Blob not valid: index out of range" };
+		}
+	}
+
+	BlobHeader header;
+
+  private:
+	/// @return The bytes at an offset of a table
+	const char* at( const BlobTable t, const uint64_t offset, const uint64_t size ) const
+	{
+		auto& table = header.tables[size_t( t )];
+		if ( offset > table.size || size > table.size - offset )
+		{
+			throw std::runtime_error{ "Blob not valid: range out of its table" };
+		}
+		return blob.data + table.offset + offset;
+	}
+
+	ByteSpan blob;
+};
+
+
+BlobSource BlobSource::from_file( const std::string& path )
+{
+	auto identity = get_identity( path );
+
+	BlobSource ret;
+	ret.size = identity.size;
+	ret.modified = identity.modified;
+	return ret;
+}
+
+
+BlobSource BlobSource::from_bytes( const ByteSpan& bytes )
+{
+	// FNV-1a
+	uint64_t hash = 14695981039346656037ull;
+	for ( size_t i = 0; i < bytes.size; ++i )
+	{
+		hash = ( hash ^ uint8_t( bytes.data[i] ) ) * 1099511628211ull;
+	}
+
+	BlobSource ret;
+	ret.size = bytes.size;
+	ret.hash = hash;
+	return ret;
+}
+
+
+uint64_t get_blob_options( const LoadOptions& options )
+{
+	auto sections = options.sections.resolved();
+	const bool flags[] = { sections.cameras, sections.materials, sections.meshes, sections.nodes,
+		sections.animations, sections.lights, sections.scripts, sections.shapes, sections.scenes,
+		options.list_topology };
+
+	// FNV-1a
+	uint64_t hash = 14695981039346656037ull;
+	auto add = [&hash]( const uint64_t value ) { hash = ( hash ^ value ) * 1099511628211ull; };
+	for ( auto flag : flags )
+	{
+		add( flag );
+	}
+	for ( auto scene : options.scenes )
+	{
+		add( scene );
+	}
+	return hash;
+}
+
+
+bool is_blob_current( const ByteSpan& blob, const BlobSource& source, const LoadOptions& options )
+{
+	if ( !BlobReader::is_valid( blob ) )
+	{
+		return false;
+	}
+
+	auto r = BlobReader( blob );
+	if ( r.header.source != source || r.header.options != get_blob_options( options ) )
+	{
+		return false;
+	}
+
+	// Buffers are copied in the blob, so an edited buffer file makes it stale as much as the model
+	try
+	{
+		for ( size_t i = 0; i < r.count<BlobFile>( BlobTable::Files ); ++i )
+		{
+			auto file = r.record<BlobFile>( BlobTable::Files, i );
+			if ( BlobSource::from_file( r.string( file.path ) ) != file.source )
+			{
+				return false;
+			}
+		}
+	}
+	catch ( const std::runtime_error& )
+	{
+		return false;
+	}
+	return true;
+}
+
+
+/// Records the identity of an external file, once however many elements use it.
+/// Data uris and missing files, as bytes provided by a resolver, are left out
+void add_blob_file( BlobWriter& w, std::unordered_set<std::string>& paths, const std::string& path )
+{
+	if ( path.empty() || path.back() == '/' || path.find( "data:" ) != std::string::npos ||
+		!paths.emplace( path ).second )
+	{
+		return;
+	}
+	auto source = BlobSource::from_file( path );
+	if ( source != BlobSource() )
+	{
+		w.record( BlobTable::Files, BlobFile{ w.string( path ), source } );
+	}
+}
+
+
+void Gltf::save_blob( std::ostream& out, const BlobSource& source )
+{
+	BlobWriter w;
+
+	BlobHeader header;
+	header.layout = get_blob_layout();
+	header.source = source;
+	header.options = get_blob_options( options );
+	header.version_string = w.string( asset.version );
+	header.generator = w.string( asset.generator );
+	header.copyright = w.string( asset.copyright );
+	if ( scene )
+	{
+		header.scene = uint32_t( scene - scenes.data() );
+	}
+
+	std::unordered_set<std::string> files;
+	for ( auto& buffer : *buffers )
+	{
+		BlobBuffer b;
+		b.uri = w.string( buffer.uri );
+		b.byte_length = buffer.byte_length;
+		b.offset = w.payload( buffer.get_data(), buffer.byte_length );
+		w.record( BlobTable::Buffers, b );
+		add_blob_file( w, files, buffer.uri );
+	}
+
+	for ( auto& view : *buffer_views )
+	{
+		BlobBufferView v;
+		v.buffer = to_index( view.buffer );
+		v.target = uint32_t( view.target );
+		v.byte_offset = view.byte_offset;
+		v.byte_length = view.byte_length;
+		v.byte_stride = view.byte_stride;
+		w.record( BlobTable::BufferViews, v );
+	}
+
+	for ( auto& camera : cameras )
+	{
+		BlobCamera c;
+		c.name = w.string( camera.name );
+		c.type = uint32_t( camera.type );
+		c.orthographic = camera.orthographic;
+		c.perspective = camera.perspective;
+		w.record( BlobTable::Cameras, c );
+	}
+
+	for ( auto& sampler : *samplers )
+	{
+		BlobSampler s;
+		s.name = w.string( sampler.name );
+		s.mag_filter = uint32_t( sampler.magFilter );
+		s.min_filter = uint32_t( sampler.minFilter );
+		s.wrap_s = uint32_t( sampler.wrapS );
+		s.wrap_t = uint32_t( sampler.wrapT );
+		w.record( BlobTable::Samplers, s );
+	}
+
+	for ( auto& image : *images )
+	{
+		BlobImage i;
+		i.name = w.string( image.name );
+		i.uri = w.string( image.uri );
+		i.mime_type = w.string( image.mime_type );
+		i.buffer_view = image.buffer_view;
+		w.record( BlobTable::Images, i );
+		add_blob_file( w, files, image.uri );
+	}
+
+	for ( auto& texture : *textures )
+	{
+		BlobTexture t;
+		t.name = w.string( texture.name );
+		t.sampler = to_index( texture.sampler );
+		t.source = to_index( texture.source );
+		w.record( BlobTable::Textures, t );
+	}
+
+	for ( auto& accessor : *accessors )
+	{
+		BlobAccessor a;
+		a.buffer_view = to_index( accessor.buffer_view );
+		a.component_type = uint32_t( accessor.component_type );
+		a.type = uint32_t( accessor.type );
+		a.normalized = accessor.normalized;
+		a.byte_offset = accessor.byte_offset;
+		a.count = accessor.count;
+		a.min = w.floats( accessor.min );
+		a.max = w.floats( accessor.max );
+		if ( accessor.sparse )
+		{
+			auto& sparse = *accessor.sparse;
+			a.sparse_count = sparse.count;
+			a.sparse_indices_view = to_index( sparse.indices.buffer_view );
+			a.sparse_indices_component_type = uint32_t( sparse.indices.component_type );
+			a.sparse_indices_offset = sparse.indices.byte_offset;
+			a.sparse_values_view = to_index( sparse.values.buffer_view );
+			a.sparse_values_offset = sparse.values.byte_offset;
+		}
+		w.record( BlobTable::Accessors, a );
+	}
+
+	for ( auto& material : *materials )
+	{
+		BlobMaterial m;
+		m.name = w.string( material.name );
+		m.texture = to_index( material.texture_handle );
+		m.pbr = material.pbr;
+		w.record( BlobTable::Materials, m );
+	}
+
+	for ( auto& mesh : *meshes )
+	{
+		BlobMesh m;
+		m.name = w.string( mesh.name );
+		m.weights = w.floats( mesh.weights );
+		m.primitives = { w.count<BlobPrimitive>( BlobTable::Primitives ), uint32_t( mesh.primitives.size() ) };
+		for ( auto& primitive : mesh.primitives )
+		{
+			BlobPrimitive p;
+			p.attributes = { w.count<BlobAttribute>( BlobTable::Attributes ), uint32_t( primitive.attributes.size() ) };
+			for ( auto& [semantic, accessor] : primitive.attributes )
+			{
+				w.record( BlobTable::Attributes, BlobAttribute{ uint32_t( semantic ), to_index( accessor ) } );
+			}
+			p.indices = to_index( primitive.indices_handle );
+			p.material = to_index( primitive.material );
+			p.mode = uint32_t( primitive.mode );
+			p.line_width = primitive.line_width;
+			w.record( BlobTable::Primitives, p );
+		}
+		w.record( BlobTable::Meshes, m );
+	}
+
+	for ( auto& light : lights )
+	{
+		BlobLight l;
+		l.name = w.string( light.name );
+		l.color = light.color;
+		l.intensity = light.intensity;
+		l.type = uint32_t( light.type );
+		l.range = light.range;
+		l.spot = light.spot;
+		w.record( BlobTable::Lights, l );
+	}
+
+	for ( auto& node : *nodes )
+	{
+		BlobNode n;
+		n.name = w.string( node.name );
+
+		std::vector<uint32_t> children;
+		for ( auto& child : node.children )
+		{
+			children.push_back( to_index( child ) );
+		}
+		n.children = w.indices( children );
+
+		auto scripts = std::vector<uint32_t>( node.scripts_indices.begin(), node.scripts_indices.end() );
+		n.scripts = w.indices( scripts );
+
+		n.mesh = to_index( node.mesh );
+		n.camera = node.camera ? uint32_t( node.camera - cameras.data() ) : blob_none;
+		n.light = node.light_index;
+		n.bounds = node.bounds;
+		n.rotation = node.rotation;
+		n.scale = node.scale;
+		n.translation = node.translation;
+		n.matrix = node.matrix;
+		w.record( BlobTable::Nodes, n );
+	}
+
+	for ( auto& animation : animations )
+	{
+		BlobAnimation a;
+		a.name = w.string( animation.name );
+		a.samplers = { w.count<BlobAnimationSampler>( BlobTable::AnimationSamplers ), uint32_t( animation.samplers->size() ) };
+		for ( auto& sampler : *animation.samplers )
+		{
+			BlobAnimationSampler s;
+			s.input = to_index( sampler.input );
+			s.output = to_index( sampler.output );
+			s.interpolation = uint32_t( sampler.interpolation );
+			w.record( BlobTable::AnimationSamplers, s );
+		}
+		a.channels = { w.count<BlobChannel>( BlobTable::Channels ), uint32_t( animation.channels->size() ) };
+		for ( auto& channel : *animation.channels )
+		{
+			BlobChannel c;
+			c.sampler = to_index( channel.sampler );
+			c.node = to_index( channel.target.node );
+			c.path = uint32_t( channel.target.path );
+			w.record( BlobTable::Channels, c );
+		}
+		w.record( BlobTable::Animations, a );
+	}
+
+	for ( auto& rect : rects )
+	{
+		w.record( BlobTable::Rects, static_cast<const math::Rect&>( rect ) );
+	}
+	for ( auto& box : boxes )
+	{
+		w.record( BlobTable::Boxes, static_cast<const math::Box&>( box ) );
+	}
+	for ( auto& sphere : spheres )
+	{
+		w.record( BlobTable::Spheres, static_cast<const math::Sphere&>( sphere ) );
+	}
+	for ( auto& b : bounds )
+	{
+		w.record( BlobTable::Bounds, b );
+	}
+
+	for ( auto& script : scripts )
+	{
+		w.record( BlobTable::Scripts, BlobScript{ w.string( script.uri ), w.string( script.name ) } );
+	}
+
+	for ( auto& s : scenes )
+	{
+		std::vector<uint32_t> roots;
+		for ( auto& node : s.nodes )
+		{
+			roots.push_back( to_index( node ) );
+		}
+		w.record( BlobTable::Scenes, BlobScene{ w.string( s.name ), w.indices( roots ) } );
+	}
+
+	w.write( out, header );
+}
+
+
+Gltf Gltf::load_blob( ByteSpan blob, const std::string& pth, const LoadOptions& options )
+{
+	auto r = BlobReader( blob );
+	auto& header = r.header;
+
+	Gltf model;
+	model.path = pth.substr( 0, pth.find_last_of( "/\\" ) );
+	model.options = options;
+	model.enter( LoadProgress::Stage::Json );
+
+	model.asset.version = r.string( header.version_string );
+	model.asset.generator = r.string( header.generator );
+	model.asset.copyright = r.string( header.copyright );
+
+	// Buffers point into the payload of the blob
+	model.enter( LoadProgress::Stage::Buffers );
+	for ( size_t i = 0; i < r.count<BlobBuffer>( BlobTable::Buffers ); ++i )
+	{
+		auto b = r.record<BlobBuffer>( BlobTable::Buffers, i );
+		auto handle = model.buffers.push( ByteBuffer( r.payload( b.offset, b.byte_length ), b.byte_length ) );
+		handle->uri = r.string( b.uri );
+	}
+
+	for ( size_t i = 0; i < r.count<BlobBufferView>( BlobTable::BufferViews ); ++i )
+	{
+		auto v = r.record<BlobBufferView>( BlobTable::BufferViews, i );
+		auto view = model.buffer_views.push();
+		view->buffer = r.handle( model.buffers, v.buffer );
+		view->target = BufferView::Target( v.target );
+		view->byte_offset = v.byte_offset;
+		view->byte_length = v.byte_length;
+		view->byte_stride = v.byte_stride;
+	}
+
+	model.cameras.resize( r.count<BlobCamera>( BlobTable::Cameras ) );
+	for ( size_t i = 0; i < model.cameras.size(); ++i )
+	{
+		auto c = r.record<BlobCamera>( BlobTable::Cameras, i );
+		auto& camera = model.cameras[i];
+		camera.name = r.string( c.name );
+		camera.type = GltfCamera::Type( c.type );
+		camera.orthographic = c.orthographic;
+		camera.perspective = c.perspective;
+	}
+
+	model.samplers->resize( r.count<BlobSampler>( BlobTable::Samplers ) );
+	for ( size_t i = 0; i < model.samplers->size(); ++i )
+	{
+		auto s = r.record<BlobSampler>( BlobTable::Samplers, i );
+		auto& sampler = ( *model.samplers )[i];
+		sampler.name = r.string( s.name );
+		sampler.magFilter = GltfSampler::Filter( s.mag_filter );
+		sampler.minFilter = GltfSampler::Filter( s.min_filter );
+		sampler.wrapS = GltfSampler::Wrapping( s.wrap_s );
+		sampler.wrapT = GltfSampler::Wrapping( s.wrap_t );
+	}
+
+	for ( size_t i = 0; i < r.count<BlobImage>( BlobTable::Images ); ++i )
+	{
+		auto m = r.record<BlobImage>( BlobTable::Images, i );
+		auto image = model.images.push();
+		image->name = r.string( m.name );
+		image->uri = r.string( m.uri );
+		image->mime_type = r.string( m.mime_type );
+		image->buffer_view = m.buffer_view;
+	}
+
+	for ( size_t i = 0; i < r.count<BlobTexture>( BlobTable::Textures ); ++i )
+	{
+		auto t = r.record<BlobTexture>( BlobTable::Textures, i );
+		auto texture = model.textures.push();
+		texture->name = r.string( t.name );
+		texture->sampler = r.handle( model.samplers, t.sampler );
+		texture->source = r.handle( model.images, t.source );
+	}
+
+	model.enter( LoadProgress::Stage::Accessors );
+	for ( size_t i = 0; i < r.count<BlobAccessor>( BlobTable::Accessors ); ++i )
+	{
+		auto a = r.record<BlobAccessor>( BlobTable::Accessors, i );
+		auto accessor = model.accessors.push();
+		accessor->buffer_view = r.handle( model.buffer_views, a.buffer_view );
+		accessor->component_type = Accessor::ComponentType( a.component_type );
+		accessor->type = Accessor::Type( a.type );
+		accessor->normalized = a.normalized != 0;
+		accessor->byte_offset = a.byte_offset;
+		accessor->count = a.count;
+		accessor->min = r.floats( a.min );
+		accessor->max = r.floats( a.max );
+		if ( a.sparse_count )
+		{
+			accessor->sparse = std::make_shared<Accessor::Sparse>();
+			auto& sparse = *accessor->sparse;
+			sparse.count = a.sparse_count;
+			sparse.indices.buffer_view = r.handle( model.buffer_views, a.sparse_indices_view );
+			sparse.indices.component_type = Accessor::ComponentType( a.sparse_indices_component_type );
+			sparse.indices.byte_offset = a.sparse_indices_offset;
+			sparse.values.buffer_view = r.handle( model.buffer_views, a.sparse_values_view );
+			sparse.values.byte_offset = a.sparse_values_offset;
+		}
+	}
+
+	model.enter( LoadProgress::Stage::Meshes );
+	for ( size_t i = 0; i < r.count<BlobMaterial>( BlobTable::Materials ); ++i )
+	{
+		auto m = r.record<BlobMaterial>( BlobTable::Materials, i );
+		auto material = model.materials.push();
+		material->name = r.string( m.name );
+		material->pbr = m.pbr;
+		material->texture_handle = r.handle( model.textures, m.texture );
+	}
+
+	for ( size_t i = 0; i < r.count<BlobMesh>( BlobTable::Meshes ); ++i )
+	{
+		auto m = r.record<BlobMesh>( BlobTable::Meshes, i );
+		auto mesh = model.meshes.push( Mesh( model ) );
+		mesh->name = r.string( m.name );
+		mesh->weights = r.floats( m.weights );
+
+		mesh->primitives.resize( m.primitives.count );
+		for ( uint32_t j = 0; j < m.primitives.count; ++j )
+		{
+			auto p = r.record<BlobPrimitive>( BlobTable::Primitives, size_t( m.primitives.offset ) + j );
+			auto& primitive = mesh->primitives[j];
+			for ( uint32_t k = 0; k < p.attributes.count; ++k )
+			{
+				auto a = r.record<BlobAttribute>( BlobTable::Attributes, size_t( p.attributes.offset ) + k );
+				primitive.attributes.emplace( Primitive::Semantic( a.semantic ), r.handle( model.accessors, a.accessor ) );
+			}
+			primitive.indices_handle = r.handle( model.accessors, p.indices );
+			primitive.material = r.handle( model.materials, p.material );
+			primitive.mode = Primitive::Mode( p.mode );
+			primitive.line_width = p.line_width;
+		}
+	}
+
+	model.lights.resize( r.count<BlobLight>( BlobTable::Lights ) );
+	for ( size_t i = 0; i < model.lights.size(); ++i )
+	{
+		auto l = r.record<BlobLight>( BlobTable::Lights, i );
+		auto& light = model.lights[i];
+		light.name = r.string( l.name );
+		light.color = l.color;
+		light.intensity = l.intensity;
+		light.type = Light::Type( l.type );
+		light.range = l.range;
+		light.spot = l.spot;
+	}
+
+	// Scripts, shapes and nodes
+	model.enter( LoadProgress::Stage::Nodes );
+	model.scripts.resize( r.count<BlobScript>( BlobTable::Scripts ) );
+	for ( size_t i = 0; i < model.scripts.size(); ++i )
+	{
+		auto s = r.record<BlobScript>( BlobTable::Scripts, i );
+		model.scripts[i].uri = r.string( s.uri );
+		model.scripts[i].name = r.string( s.name );
+	}
+
+	for ( size_t i = 0; i < r.count<math::Rect>( BlobTable::Rects ); ++i )
+	{
+		static_cast<math::Rect&>( model.rects.emplace_back() ) = r.record<math::Rect>( BlobTable::Rects, i );
+	}
+	for ( size_t i = 0; i < r.count<math::Box>( BlobTable::Boxes ); ++i )
+	{
+		static_cast<math::Box&>( model.boxes.emplace_back() ) = r.record<math::Box>( BlobTable::Boxes, i );
+	}
+	for ( size_t i = 0; i < r.count<math::Sphere>( BlobTable::Spheres ); ++i )
+	{
+		static_cast<math::Sphere&>( model.spheres.emplace_back() ) = r.record<math::Sphere>( BlobTable::Spheres, i );
+	}
+	for ( size_t i = 0; i < r.count<Bounds>( BlobTable::Bounds ); ++i )
+	{
+		model.bounds.emplace_back( r.record<Bounds>( BlobTable::Bounds, i ) );
+	}
+
+	// All nodes exist before children refer to them
+	auto node_count = r.count<BlobNode>( BlobTable::Nodes );
+	for ( size_t i = 0; i < node_count; ++i )
+	{
+		model.nodes.push();
+	}
+	for ( size_t i = 0; i < node_count; ++i )
+	{
+		auto n = r.record<BlobNode>( BlobTable::Nodes, i );
+		auto& node = ( *model.nodes )[i];
+		node.model = &model;
+		node.name = r.string( n.name );
+		for ( auto child : r.indices( n.children ) )
+		{
+			node.children.push_back( r.handle( model.nodes, child ) );
+		}
+		for ( auto script : r.indices( n.scripts ) )
+		{
+			r.check( script, model.scripts.size() );
+			node.scripts_indices.push_back( script );
+		}
+		node.mesh = r.handle( model.meshes, n.mesh );
+		if ( n.camera != blob_none )
+		{
+			r.check( n.camera, model.cameras.size() );
+			node.camera = &model.cameras[n.camera];
+		}
+		node.light_index = n.light;
+		node.bounds = n.bounds;
+		node.rotation = n.rotation;
+		node.scale = n.scale;
+		node.translation = n.translation;
+		node.matrix = n.matrix;
+	}
+
+	for ( size_t i = 0; i < r.count<BlobAnimation>( BlobTable::Animations ); ++i )
+	{
+		auto a = r.record<BlobAnimation>( BlobTable::Animations, i );
+		auto& animation = model.animations.emplace_back( model );
+		animation.name = r.string( a.name );
+		for ( uint32_t j = 0; j < a.samplers.count; ++j )
+		{
+			auto s = r.record<BlobAnimationSampler>( BlobTable::AnimationSamplers, size_t( a.samplers.offset ) + j );
+			Animation::Sampler sampler;
+			sampler.input = r.handle( model.accessors, s.input );
+			sampler.output = r.handle( model.accessors, s.output );
+			sampler.interpolation = Animation::Sampler::Interpolation( s.interpolation );
+			animation.samplers->push_back( std::move( sampler ) );
+		}
+		for ( uint32_t j = 0; j < a.channels.count; ++j )
+		{
+			auto c = r.record<BlobChannel>( BlobTable::Channels, size_t( a.channels.offset ) + j );
+			Animation::Channel channel;
+			channel.sampler = r.handle( animation.samplers, c.sampler );
+			channel.target.node = r.handle( model.nodes, c.node );
+			channel.target.path = Animation::Target::Path( c.path );
+			animation.channels->push_back( std::move( channel ) );
+		}
+	}
+
+	model.scenes.resize( r.count<BlobScene>( BlobTable::Scenes ) );
+	for ( size_t i = 0; i < model.scenes.size(); ++i )
+	{
+		auto s = r.record<BlobScene>( BlobTable::Scenes, i );
+		auto& scene = model.scenes[i];
+		scene.model = &model;
+		scene.name = r.string( s.name );
+		for ( auto node : r.indices( s.nodes ) )
+		{
+			scene.nodes.push_back( r.handle( model.nodes, node ) );
+		}
+	}
+	if ( header.scene != blob_none )
+	{
+		r.check( header.scene, model.scenes.size() );
+		model.scene = &model.scenes[header.scene];
+	}
+
+	model.load_nodes();
+	model.convert_topology();
+	model.enter( LoadProgress::Stage::Done );
+	return model;
+}
+
+
+/// @return The bytes of a file, or an empty span when it can not be read
+ByteSpan read_blob_file( const std::string& path )
+{
+	try
+	{
+		if ( can_map_files )
+		{
+			return map_file( path );
+		}
+
+		auto file = file::Ifstream( path, std::ios::binary );
+		auto size = get_identity( path ).size;
+		if ( !file.is_open() || size == 0 )
+		{
+			return {};
+		}
+		auto bytes = std::make_shared<std::vector<char>>( file.read( size ) );
+		return { bytes->data(), bytes->size(), std::move( bytes ) };
+	}
+	catch ( const std::runtime_error& )
+	{
+		return {};
+	}
+}
+
+
+Gltf Gltf::load_cached( const std::string& path, const LoadOptions& options, std::string blob_path )
+{
+	if ( blob_path.empty() )
+	{
+		blob_path = path + ".blob";
+	}
+
+	auto source = BlobSource::from_file( path );
+	if ( auto blob = read_blob_file( blob_path ); is_blob_current( blob, source, options ) )
+	{
+		return load_blob( std::move( blob ), path, options );
+	}
+
+	auto model = load( path, options );
+
+	// Written aside and renamed only once complete, so a blob is never read half written.
+	// Failing to write it only loses the cache, as the model has loaded anyway
+	auto temp_path = blob_path + ".tmp";
+	auto written = false;
+	try
+	{
+		std::ofstream out( temp_path, std::ios::binary );
+		if ( out.is_open() )
+		{
+			model.save_blob( out, source );
+			out.close();
+			written = !out.fail();
+		}
+	}
+	catch ( const std::exception& )
+	{
+		written = false;
+	}
+	if ( written )
+	{
+		std::remove( blob_path.c_str() );
+		std::rename( temp_path.c_str(), blob_path.c_str() );
+	}
+	else
+	{
+		std::remove( temp_path.c_str() );
+	}
+
+	return model;
+}
+
+
+} // namespace spot::gfx
@@ -1,115 +1,224 @@
 #include "spot/gltf/buffer.h"
 
+#include <stdexcept>
+#include <string_view>
 #include <spot/file/ifstream.h>
 
+#include "spot/gltf/base64.h"
+#include "spot/gltf/cache.h"
+
+#if defined( _WIN32 )
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif !defined( ANDROID )
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace spot::gfx
 {
 
 
-const std::string base64_chars =
-    "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-    "abcdefghijklmnopqrstuvwxyz"
-    "0123456789+/";
+std::vector<char> load_uri( const std::string& uri, const size_t byte_length )
+{
+	std::vector<char> data;
+
+	// Check if it is data
+	if ( uri.rfind( "data:", 0 ) == 0 )
+	{
+		// It is data, find the position of comma
+		auto comma_pos = uri.find_first_of( ',', 5 );
+		if ( comma_pos == std::string::npos )
+		{
+			// Error, data not good
+			throw std::runtime_error{ "Data URI not valid" };
+		}
 
+		// Assume it is base64
+		data = base64_decode( std::string_view( uri ).substr( comma_pos + 1 ) );
+	}
+	else
+	{
+		auto file = file::Ifstream( uri, std::ios::binary );
+		assert( file.is_open() && "Could not open the file" );
+		data = file.read( byte_length );
+	}
 
-inline bool is_base64( const char c )
-{
-	return ( isalnum( c ) || ( c == '+' ) || ( c == '/' ) );
+	return data;
 }
 
 
-std::vector<char> base64_decode( const std::string& encoded_string )
+#if defined( _WIN32 )
+
+ByteSpan map_file( const std::string& path )
 {
-	auto              in_len = encoded_string.size();
-	int               i      = 0;
-	int               j      = 0;
-	int               in_    = 0;
-	char              char_array_4[4], char_array_3[3];
-	std::vector<char> ret;
-
-	while ( in_len-- && ( encoded_string[in_] != '=' ) && is_base64( encoded_string[in_] ) )
+	auto file = CreateFileA( path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr );
+	if ( file == INVALID_HANDLE_VALUE )
 	{
-		char_array_4[i++] = encoded_string[in_];
-		in_++;
-		if ( i == 4 )
-		{
-			for ( i = 0; i < 4; i++ )
-			{
-				char_array_4[i] = base64_chars.find( char_array_4[i] );
-			}
-
-			char_array_3[0] = ( char_array_4[0] << 2 ) + ( ( char_array_4[1] & 0x30 ) >> 4 );
-			char_array_3[1] = ( ( char_array_4[1] & 0xf ) << 4 ) + ( ( char_array_4[2] & 0x3c ) >> 2 );
-			char_array_3[2] = ( ( char_array_4[2] & 0x3 ) << 6 ) + char_array_4[3];
+		throw std::runtime_error{ "Cannot open file: " + path };
+	}
 
-			for ( i = 0; ( i < 3 ); i++ )
-			{
-				ret.push_back( char_array_3[i] );
-			}
-			i = 0;
-		}
+	LARGE_INTEGER size = {};
+	GetFileSizeEx( file, &size );
+	if ( size.QuadPart == 0 )
+	{
+		CloseHandle( file );
+		return {};
 	}
 
-	if ( i )
+	auto mapping = CreateFileMappingA( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+	CloseHandle( file );
+	if ( !mapping )
 	{
-		for ( j = i; j < 4; j++ )
-		{
-			char_array_4[j] = 0;
-		}
+		throw std::runtime_error{ "Cannot map file: " + path };
+	}
 
-		for ( j = 0; j < 4; j++ )
-		{
-			char_array_4[j] = base64_chars.find( char_array_4[j] );
-		}
+	// The view keeps the mapping alive
+	auto view = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+	CloseHandle( mapping );
+	if ( !view )
+	{
+		throw std::runtime_error{ "Cannot map file: " + path };
+	}
 
-		char_array_3[0] = ( char_array_4[0] << 2 ) + ( ( char_array_4[1] & 0x30 ) >> 4 );
-		char_array_3[1] = ( ( char_array_4[1] & 0xf ) << 4 ) + ( ( char_array_4[2] & 0x3c ) >> 2 );
-		char_array_3[2] = ( ( char_array_4[2] & 0x3 ) << 6 ) + char_array_4[3];
+	auto owner = std::shared_ptr<const void>( view, []( const void* v ) { UnmapViewOfFile( v ); } );
+	return { reinterpret_cast<const char*>( view ), size_t( size.QuadPart ), std::move( owner ) };
+}
 
-		for ( j = 0; ( j < i - 1 ); j++ )
-		{
-			ret.push_back( char_array_3[j] );
-		}
-	}
+#elif defined( ANDROID )
 
-	return ret;
+ByteSpan map_file( const std::string& path )
+{
+	// Assets live inside the package and can not be mapped
+	throw std::runtime_error{ "Cannot map file: " + path };
 }
 
+#else
 
-std::vector<char> load( const std::string& uri, const size_t byte_length )
+ByteSpan map_file( const std::string& path )
 {
-	std::vector<char> data;
+	auto fd = open( path.c_str(), O_RDONLY );
+	if ( fd < 0 )
+	{
+		throw std::runtime_error{ "Cannot open file: " + path };
+	}
 
-	// Check if it is data
-	if ( uri.rfind( "data:", 0 ) == 0 )
+	struct stat info = {};
+	if ( fstat( fd, &info ) != 0 )
 	{
-		// It is data, find the position of comma
-		auto comma_pos = uri.find_first_of( ',', 5 );
-		if ( comma_pos == std::string::npos )
-		{
-			// Error, data not good
-			throw std::runtime_error{ "Data URI not valid" };
-		}
+		close( fd );
+		throw std::runtime_error{ "Cannot stat file: " + path };
+	}
 
-		// Assume it is base64
-		data = base64_decode( uri.substr( comma_pos + 1 ) );
+	size_t size = info.st_size;
+	if ( size == 0 )
+	{
+		close( fd );
+		return {};
 	}
-	else
+
+	// The mapping stays valid after closing the descriptor
+	auto addr = mmap( nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	close( fd );
+	if ( addr == MAP_FAILED )
 	{
-		auto file = file::Ifstream( uri, std::ios::binary );
-		assert( file.is_open() && "Could not open the file" );
-		data = file.read( byte_length );
+		throw std::runtime_error{ "Cannot map file: " + path };
 	}
 
-	return data;
+	auto owner = std::shared_ptr<const void>( addr, [size]( const void* a ) { munmap( const_cast<void*>( a ), size ); } );
+	return { reinterpret_cast<const char*>( addr ), size, std::move( owner ) };
 }
 
+#endif
+
 
-ByteBuffer::ByteBuffer( std::string u, const size_t len )
+ByteBuffer::ByteBuffer( std::string u, const size_t len, const Storage storage, const bool lazy, std::shared_ptr<BufferCache> cache )
 : uri { std::move( u ) }
 , byte_length { len }
-, data { load( uri, len ) }
+, loader { std::make_unique<Loader>() }
+{
+	loader->storage = storage;
+	loader->cache = std::move( cache );
+	if ( !lazy )
+	{
+		load();
+	}
+}
+
+
+ByteBuffer::ByteBuffer( ByteSpan s, const size_t len )
+: byte_length { len }
+, span { std::move( s ) }
+{
+	if ( span.size < byte_length )
+	{
+		throw std::runtime_error{ "Buffer byteLength exceeds its binary data" };
+	}
+}
+
+
+ByteBuffer::ByteBuffer( ByteBuffer&& other ) = default;
+
+
+ByteBuffer& ByteBuffer::operator=( ByteBuffer&& other ) = default;
+
+
+ByteBuffer::~ByteBuffer() = default;
+
+
+void ByteBuffer::load()
+{
+	if ( !loader )
+	{
+		return;
+	}
+
+	std::call_once( loader->once, [this]() {
+		// Data uris are always decoded
+		auto is_file = uri.rfind( "data:", 0 ) != 0;
+		if ( loader->cache && is_file )
+		{
+			span = loader->cache->load( uri, byte_length, loader->storage );
+		}
+		else if ( loader->storage == Storage::Map && can_map_files && is_file )
+		{
+			auto mapped = map_file( uri );
+			if ( mapped.size < byte_length )
+			{
+				throw std::runtime_error{ "Buffer byteLength exceeds file size: " + uri };
+			}
+			mapped.size = byte_length;
+			span = std::move( mapped );
+		}
+		else
+		{
+			data = load_uri( uri, byte_length );
+		}
+		loader->done = true;
+	} );
+}
+
+
+bool ByteBuffer::is_loaded() const
+{
+	return !loader || loader->done;
+}
+
+
+const char* ByteBuffer::get_data()
+{
+	load();
+	return span.data ? span.data : data.data();
+}
+
+
+const char* BufferView::get_data() const
 {
+	return buffer->get_data() + byte_offset;
 }
 
 
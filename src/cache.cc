@@ -0,0 +1,264 @@
+#include "spot/gltf/cache.h"
+
+#include <stdexcept>
+#include <spot/file/ifstream.h>
+
+#include <sys/stat.h>
+
+namespace spot::gfx
+{
+
+
+/// @return The identity of the file at that path, zero when it can not be queried
+BufferCache::Identity get_identity( const std::string& path )
+{
+#if defined( _WIN32 )
+	struct _stat64 info = {};
+	if ( _stat64( path.c_str(), &info ) != 0 )
+	{
+		return {};
+	}
+#else
+	struct stat info = {};
+	if ( stat( path.c_str(), &info ) != 0 )
+	{
+		return {};
+	}
+#endif
+
+	BufferCache::Identity identity;
+	identity.device = uint64_t( info.st_dev );
+	identity.inode = uint64_t( info.st_ino );
+	identity.size = uint64_t( info.st_size );
+	identity.modified = int64_t( info.st_mtime );
+	return identity;
+}
+
+
+/// @return The bytes of a file, owned by the span
+ByteSpan read_file( const std::string& path, const size_t size, const ByteBuffer::Storage storage )
+{
+	if ( storage == ByteBuffer::Storage::Map && can_map_files )
+	{
+		return map_file( path );
+	}
+
+	auto file = file::Ifstream( path, std::ios::binary );
+	if ( !file.is_open() )
+	{
+		throw std::runtime_error{ "Cannot open file: " + path };
+	}
+
+	auto bytes = std::make_shared<std::vector<char>>( file.read( size ) );
+	return { bytes->data(), bytes->size(), std::move( bytes ) };
+}
+
+
+BufferCache::BufferCache( const size_t c )
+: capacity { c }
+{}
+
+
+const std::shared_ptr<BufferCache>& BufferCache::shared()
+{
+	static auto cache = std::make_shared<BufferCache>();
+	return cache;
+}
+
+
+ByteSpan BufferCache::load( const std::string& path, const size_t byte_length, const ByteBuffer::Storage storage )
+{
+	auto identity = get_identity( path );
+
+	std::unique_lock<std::mutex> lock( mutex );
+	for ( auto it = entries.find( path ); it != entries.end(); it = entries.find( path ) )
+	{
+		auto& entry = it->second;
+
+		// Wait for another caller reading the same file, then look again
+		if ( entry.ready.wait_for( std::chrono::seconds( 0 ) ) != std::future_status::ready )
+		{
+			auto ready = entry.ready;
+			lock.unlock();
+			ready.wait();
+			lock.lock();
+			continue;
+		}
+
+		if ( auto span = find( entry, path, identity, byte_length ); span.data )
+		{
+			++stats.hits;
+			return span;
+		}
+
+		// The file changed, or more bytes are needed
+		if ( entry.used != recent.end() )
+		{
+			stats.bytes -= entry.span.size;
+			recent.erase( entry.used );
+		}
+		entries.erase( it );
+		break;
+	}
+
+	++stats.misses;
+
+	// Forget evicted entries no model uses anymore
+	for ( auto it = entries.begin(); it != entries.end(); )
+	{
+		auto& entry = it->second;
+		auto done = entry.ready.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready;
+		if ( done && entry.used == recent.end() && entry.weak.expired() )
+		{
+			it = entries.erase( it );
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	// Others asking for this file wait for this read
+	std::promise<void> promise;
+	auto& pending = entries[path];
+	pending.identity = identity;
+	pending.ready = promise.get_future().share();
+	pending.used = recent.end();
+	lock.unlock();
+
+	ByteSpan span;
+	try
+	{
+		span = read_file( path, identity.size ? size_t( identity.size ) : byte_length, storage );
+		if ( span.size < byte_length )
+		{
+			throw std::runtime_error{ "Buffer byteLength exceeds file size: " + path };
+		}
+	}
+	catch ( ... )
+	{
+		lock.lock();
+		entries.erase( path );
+		promise.set_value();
+		throw;
+	}
+
+	lock.lock();
+	if ( auto it = entries.find( path ); it != entries.end() )
+	{
+		auto& entry = it->second;
+		entry.span = span;
+		entry.weak = span.owner;
+		touch( entry, path );
+		trim();
+	}
+	promise.set_value();
+
+	span.size = byte_length;
+	return span;
+}
+
+
+ByteSpan BufferCache::find( Entry& entry, const std::string& path, const Identity& identity, const size_t byte_length )
+{
+	if ( !( entry.identity == identity ) || entry.span.size < byte_length )
+	{
+		return {};
+	}
+
+	// Evicted bytes are found while a model still uses them,
+	// and held again only if they fit
+	if ( !entry.span.owner )
+	{
+		auto owner = entry.weak.lock();
+		if ( !owner )
+		{
+			return {};
+		}
+		if ( stats.bytes + entry.span.size <= capacity )
+		{
+			entry.span.owner = owner;
+			touch( entry, path );
+		}
+		return { entry.span.data, byte_length, std::move( owner ) };
+	}
+
+	touch( entry, path );
+	return { entry.span.data, byte_length, entry.span.owner };
+}
+
+
+void BufferCache::touch( Entry& entry, const std::string& path )
+{
+	if ( entry.used != recent.end() )
+	{
+		recent.splice( recent.begin(), recent, entry.used );
+		return;
+	}
+
+	recent.push_front( path );
+	entry.used = recent.begin();
+	stats.bytes += entry.span.size;
+}
+
+
+void BufferCache::trim()
+{
+	while ( stats.bytes > capacity && !recent.empty() )
+	{
+		auto& entry = entries.at( recent.back() );
+		stats.bytes -= entry.span.size;
+		entry.span.owner.reset();
+		entry.used = recent.end();
+		recent.pop_back();
+		++stats.evictions;
+	}
+}
+
+
+void BufferCache::set_capacity( const size_t c )
+{
+	std::lock_guard<std::mutex> lock( mutex );
+	capacity = c;
+	trim();
+}
+
+
+size_t BufferCache::get_capacity() const
+{
+	std::lock_guard<std::mutex> lock( mutex );
+	return capacity;
+}
+
+
+BufferCache::Stats BufferCache::get_stats() const
+{
+	std::lock_guard<std::mutex> lock( mutex );
+	auto ret = stats;
+	ret.entries = recent.size();
+	return ret;
+}
+
+
+void BufferCache::clear()
+{
+	std::lock_guard<std::mutex> lock( mutex );
+
+	// Entries being read are left to their readers
+	for ( auto it = entries.begin(); it != entries.end(); )
+	{
+		if ( it->second.ready.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready )
+		{
+			it = entries.erase( it );
+		}
+		else
+		{
+			++it;
+		}
+	}
+	recent.clear();
+	stats = {};
+}
+
+
+} // namespace spot::gfx
@@ -0,0 +1,542 @@
+#include "spot/gltf/decode.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#include "spot/gltf/accessor_view.h"
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define GST_DECODE_SSE2
+#include <emmintrin.h>
+#if defined( _MSC_VER )
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+#endif
+
+#if defined( GST_DECODE_SSE2 ) && ( defined( __GNUC__ ) || defined( __clang__ ) )
+#define GST_TARGET( t ) __attribute__( ( target( t ) ) )
+#include <immintrin.h>
+#else
+#define GST_TARGET( t )
+#endif
+
+namespace spot::gfx
+{
+
+
+/// C++ type of a component type, and the value normalized to one
+template <Accessor::ComponentType CT>
+struct ComponentTraits;
+
+template <>
+struct ComponentTraits<Accessor::ComponentType::BYTE>
+{
+	using type = int8_t;
+	static constexpr float max = 127.0f;
+};
+
+template <>
+struct ComponentTraits<Accessor::ComponentType::UNSIGNED_BYTE>
+{
+	using type = uint8_t;
+	static constexpr float max = 255.0f;
+};
+
+template <>
+struct ComponentTraits<Accessor::ComponentType::SHORT>
+{
+	using type = int16_t;
+	static constexpr float max = 32767.0f;
+};
+
+template <>
+struct ComponentTraits<Accessor::ComponentType::UNSIGNED_SHORT>
+{
+	using type = uint16_t;
+	static constexpr float max = 65535.0f;
+};
+
+template <>
+struct ComponentTraits<Accessor::ComponentType::UNSIGNED_INT>
+{
+	using type = uint32_t;
+	static constexpr float max = 4294967295.0f;
+};
+
+template <>
+struct ComponentTraits<Accessor::ComponentType::FLOAT>
+{
+	using type = float;
+	static constexpr float max = 1.0f;
+};
+
+
+/// @return The component at that address as a float
+template <Accessor::ComponentType CT>
+float decode_component( const uint8_t* data, const bool normalized )
+{
+	using C = typename ComponentTraits<CT>::type;
+	C c;
+	std::memcpy( &c, data, sizeof( C ) );
+	auto ret = float( c );
+	if constexpr ( CT != Accessor::ComponentType::FLOAT )
+	{
+		if ( normalized )
+		{
+			// Divided rather than scaled by the reciprocal, which is an ulp off for some values
+			ret /= ComponentTraits<CT>::max;
+			if constexpr ( std::is_signed_v<C> )
+			{
+				// The most negative value would go below -1
+				ret = std::max( ret, -1.0f );
+			}
+		}
+	}
+	return ret;
+}
+
+
+/// Decodes elements into floats, writing them out_stride floats apart
+template <Accessor::ComponentType CT>
+void decode_elements_scalar( const uint8_t* data, const size_t stride, const size_t count, const size_t components,
+	const bool normalized, float* out, const size_t out_stride )
+{
+	constexpr auto size = sizeof( typename ComponentTraits<CT>::type );
+	for ( size_t i = 0; i < count; ++i, data += stride, out += out_stride )
+	{
+		for ( size_t c = 0; c < components; ++c )
+		{
+			out[c] = decode_component<CT>( data + c * size, normalized );
+		}
+	}
+}
+
+
+#if defined( GST_DECODE_SSE2 )
+
+/// Loads four consecutive components as floats
+template <Accessor::ComponentType CT, bool Normalized>
+__m128 load_components_sse2( const uint8_t* data )
+{
+	__m128 ret;
+	if constexpr ( CT == Accessor::ComponentType::FLOAT )
+	{
+		return _mm_loadu_ps( reinterpret_cast<const float*>( data ) );
+	}
+	else if constexpr ( CT == Accessor::ComponentType::UNSIGNED_INT )
+	{
+		// No unsigned conversion before AVX-512, so halves are converted apart and added exactly
+		auto x = _mm_loadu_si128( reinterpret_cast<const __m128i*>( data ) );
+		auto high = _mm_cvtepi32_ps( _mm_srli_epi32( x, 16 ) );
+		auto low = _mm_cvtepi32_ps( _mm_and_si128( x, _mm_set1_epi32( 0xffff ) ) );
+		ret = _mm_add_ps( _mm_mul_ps( high, _mm_set1_ps( 65536.0f ) ), low );
+	}
+	else
+	{
+		__m128i x;
+		if constexpr ( sizeof( typename ComponentTraits<CT>::type ) == 1 )
+		{
+			int32_t bytes;
+			std::memcpy( &bytes, data, sizeof( bytes ) );
+			x = _mm_cvtsi32_si128( bytes );
+			// Each byte ends up in the top of its lane, to be shifted down with its sign
+			x = _mm_unpacklo_epi8( x, x );
+		}
+		else
+		{
+			x = _mm_loadl_epi64( reinterpret_cast<const __m128i*>( data ) );
+		}
+		x = _mm_unpacklo_epi16( x, x );
+		constexpr int shift = 32 - 8 * sizeof( typename ComponentTraits<CT>::type );
+		if constexpr ( std::is_signed_v<typename ComponentTraits<CT>::type> )
+		{
+			x = _mm_srai_epi32( x, shift );
+		}
+		else
+		{
+			x = _mm_srli_epi32( x, shift );
+		}
+		ret = _mm_cvtepi32_ps( x );
+	}
+
+	if constexpr ( Normalized )
+	{
+		ret = _mm_div_ps( ret, _mm_set1_ps( ComponentTraits<CT>::max ) );
+		if constexpr ( std::is_signed_v<typename ComponentTraits<CT>::type> )
+		{
+			ret = _mm_max_ps( ret, _mm_set1_ps( -1.0f ) );
+		}
+	}
+	return ret;
+}
+
+
+/// Packed components going to packed floats are decoded four at a time regardless
+/// of elements, while strided elements of two to four components are decoded one
+/// per load. Reading past the components of an element stays within the next one,
+/// so only the last element is left to the scalar loop. Stores never go past the
+/// components of an element unless the next element is written afterwards
+template <Accessor::ComponentType CT, bool Normalized>
+void decode_elements_sse2( const uint8_t* data, const size_t stride, const size_t count, const size_t components,
+	float* out, const size_t out_stride )
+{
+	constexpr auto normalized = Normalized;
+	constexpr auto size = sizeof( typename ComponentTraits<CT>::type );
+	if ( stride == components * size && out_stride == components )
+	{
+		auto total = count * components;
+		size_t i = 0;
+		for ( ; i + 4 <= total; i += 4 )
+		{
+			_mm_storeu_ps( out + i, load_components_sse2<CT, Normalized>( data + i * size ) );
+		}
+		decode_elements_scalar<CT>( data + i * size, size, total - i, 1, normalized, out + i, 1 );
+	}
+	else if ( components >= 2 && components <= 4 && count > 0 )
+	{
+		auto last = count - 1;
+		if ( components == 4 || ( components == 3 && out_stride == 3 ) )
+		{
+			for ( size_t i = 0; i < last; ++i )
+			{
+				_mm_storeu_ps( out + i * out_stride, load_components_sse2<CT, Normalized>( data + i * stride ) );
+			}
+		}
+		else if ( components == 3 )
+		{
+			for ( size_t i = 0; i < last; ++i )
+			{
+				auto v = load_components_sse2<CT, Normalized>( data + i * stride );
+				_mm_storel_pi( reinterpret_cast<__m64*>( out + i * out_stride ), v );
+				_mm_store_ss( out + i * out_stride + 2, _mm_movehl_ps( v, v ) );
+			}
+		}
+		else
+		{
+			for ( size_t i = 0; i < last; ++i )
+			{
+				auto v = load_components_sse2<CT, Normalized>( data + i * stride );
+				_mm_storel_pi( reinterpret_cast<__m64*>( out + i * out_stride ), v );
+			}
+		}
+		decode_elements_scalar<CT>(
+			data + last * stride, stride, 1, components, normalized, out + last * out_stride, out_stride );
+	}
+	else
+	{
+		decode_elements_scalar<CT>( data, stride, count, components, normalized, out, out_stride );
+	}
+}
+
+
+/// Vectorized conversions available on this CPU
+struct DecodeSimd
+{
+	bool f16c = false;
+};
+
+
+DecodeSimd detect_decode_simd()
+{
+	DecodeSimd simd;
+#if defined( _MSC_VER )
+	int info[4] = {};
+	__cpuid( info, 1 );
+	// F16C is VEX encoded, so it also needs the OS to save ymm registers
+	bool osxsave = info[2] & ( 1 << 27 );
+	bool avx = info[2] & ( 1 << 28 );
+	simd.f16c = osxsave && avx && ( info[2] & ( 1 << 29 ) ) && ( _xgetbv( 0 ) & 0x6 ) == 0x6;
+#else
+	__builtin_cpu_init();
+	simd.f16c = __builtin_cpu_supports( "avx" ) && __builtin_cpu_supports( "f16c" );
+#endif
+	return simd;
+}
+
+
+const DecodeSimd decode_simd = detect_decode_simd();
+
+
+GST_TARGET( "avx,f16c" )
+size_t encode_halfs_f16c( const float* in, const size_t count, uint16_t* out )
+{
+	size_t i = 0;
+	for ( ; i + 8 <= count; i += 8 )
+	{
+		auto halfs = _mm256_cvtps_ph( _mm256_loadu_ps( in + i ), _MM_FROUND_TO_NEAREST_INT );
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( out + i ), halfs );
+	}
+	return i;
+}
+
+#endif // GST_DECODE_SSE2
+
+
+/// Decodes with a kernel templated on the component type
+template <template <Accessor::ComponentType> class Kernel>
+void decode_with( const uint8_t* data, const size_t stride, const size_t count,
+	const Accessor::ComponentType component_type, const size_t components, const bool normalized, float* out,
+	const size_t out_stride )
+{
+	switch ( component_type )
+	{
+	case Accessor::ComponentType::BYTE:
+		return Kernel<Accessor::ComponentType::BYTE>::run( data, stride, count, components, normalized, out, out_stride );
+	case Accessor::ComponentType::UNSIGNED_BYTE:
+		return Kernel<Accessor::ComponentType::UNSIGNED_BYTE>::run( data, stride, count, components, normalized, out, out_stride );
+	case Accessor::ComponentType::SHORT:
+		return Kernel<Accessor::ComponentType::SHORT>::run( data, stride, count, components, normalized, out, out_stride );
+	case Accessor::ComponentType::UNSIGNED_SHORT:
+		return Kernel<Accessor::ComponentType::UNSIGNED_SHORT>::run( data, stride, count, components, normalized, out, out_stride );
+	case Accessor::ComponentType::UNSIGNED_INT:
+		return Kernel<Accessor::ComponentType::UNSIGNED_INT>::run( data, stride, count, components, normalized, out, out_stride );
+	case Accessor::ComponentType::FLOAT:
+		return Kernel<Accessor::ComponentType::FLOAT>::run( data, stride, count, components, normalized, out, out_stride );
+	default: throw std::runtime_error{ "Accessor component type not valid" };
+	}
+}
+
+
+template <Accessor::ComponentType CT>
+struct ScalarKernel
+{
+	static void run( const uint8_t* data, size_t stride, size_t count, size_t components, bool normalized, float* out,
+		size_t out_stride )
+	{
+		decode_elements_scalar<CT>( data, stride, count, components, normalized, out, out_stride );
+	}
+};
+
+
+template <Accessor::ComponentType CT>
+struct FastKernel
+{
+	static void run( const uint8_t* data, size_t stride, size_t count, size_t components, bool normalized, float* out,
+		size_t out_stride )
+	{
+#if defined( GST_DECODE_SSE2 )
+		// Normalization is decided once rather than for every load
+		if ( normalized )
+		{
+			decode_elements_sse2<CT, true>( data, stride, count, components, out, out_stride );
+		}
+		else
+		{
+			decode_elements_sse2<CT, false>( data, stride, count, components, out, out_stride );
+		}
+#else
+		decode_elements_scalar<CT>( data, stride, count, components, normalized, out, out_stride );
+#endif
+	}
+};
+
+
+/// Where the elements of an accessor are, and how its matrix columns are laid out
+struct DecodeSource
+{
+	const uint8_t* data = nullptr;
+	size_t stride = 0;
+
+	/// Number of columns, one for scalars and vectors
+	size_t columns = 1;
+
+	/// Components of a column
+	size_t rows = 1;
+
+	/// Distance between columns in bytes
+	size_t column_stride = 0;
+};
+
+
+/// @return Where the elements of an accessor are, null when it has no buffer view
+/// @throw std::runtime_error If elements are out of the buffer view
+DecodeSource get_decode_source( const Accessor& accessor )
+{
+	DecodeSource source;
+
+	auto components = size_of( accessor.type );
+	auto component_size = size_of( accessor.component_type );
+	if ( accessor.type == Accessor::Type::MAT2 || accessor.type == Accessor::Type::MAT3 ||
+		accessor.type == Accessor::Type::MAT4 )
+	{
+		source.rows = accessor.type == Accessor::Type::MAT2 ? 2 : accessor.type == Accessor::Type::MAT3 ? 3 : 4;
+		source.columns = source.rows;
+		// Each column starts at a multiple of four bytes
+		source.column_stride = ( source.rows * component_size + 3 ) & ~size_t( 3 );
+	}
+	else
+	{
+		source.rows = components;
+		source.column_stride = components * component_size;
+	}
+
+	auto element_size = source.columns * source.column_stride;
+	if ( accessor.sparse )
+	{
+		// Substitutions are applied once into packed elements
+		source.data = accessor.get_data();
+		source.stride = element_size;
+		return source;
+	}
+
+	if ( !accessor.buffer_view )
+	{
+		return source;
+	}
+
+	source.data = reinterpret_cast<const uint8_t*>( get_accessor_bytes( accessor, element_size, source.stride ) );
+	return source;
+}
+
+
+template <template <Accessor::ComponentType> class Kernel>
+void decode_accessor( const Accessor& accessor, const size_t first, const size_t count, float* out )
+{
+	auto source = get_decode_source( accessor );
+	auto components = source.columns * source.rows;
+	if ( !source.data )
+	{
+		std::fill( out, out + count * components, 0.0f );
+		return;
+	}
+
+	auto data = source.data + first * source.stride;
+	if ( source.column_stride == source.rows * size_of( accessor.component_type ) )
+	{
+		decode_with<Kernel>(
+			data, source.stride, count, accessor.component_type, components, accessor.normalized, out, components );
+		return;
+	}
+
+	// Padded matrix columns are decoded one at a time into their place
+	for ( size_t c = 0; c < source.columns; ++c )
+	{
+		decode_with<Kernel>( data + c * source.column_stride, source.stride, count, accessor.component_type,
+			source.rows, accessor.normalized, out + c * source.rows, components );
+	}
+}
+
+
+void decode_components( const uint8_t* data, const size_t stride, const size_t count,
+	const Accessor::ComponentType component_type, const size_t components, const bool normalized, float* out,
+	const size_t out_stride )
+{
+	if ( out_stride % sizeof( float ) != 0 )
+	{
+		throw std::runtime_error{ "Decoded elements not aligned to floats" };
+	}
+	auto out_floats = out_stride ? out_stride / sizeof( float ) : components;
+	decode_with<FastKernel>( data, stride, count, component_type, components, normalized, out, out_floats );
+}
+
+
+void decode_floats( const Accessor& accessor, float* out )
+{
+	decode_accessor<FastKernel>( accessor, 0, accessor.count, out );
+}
+
+
+std::vector<float> decode_floats( const Accessor& accessor )
+{
+	std::vector<float> ret( accessor.count * size_of( accessor.type ) );
+	decode_floats( accessor, ret.data() );
+	return ret;
+}
+
+
+void decode_floats_scalar( const Accessor& accessor, float* out )
+{
+	decode_accessor<ScalarKernel>( accessor, 0, accessor.count, out );
+}
+
+
+void decode_halfs( const Accessor& accessor, uint16_t* out )
+{
+	// Elements go through a small buffer of floats which stays in cache
+	constexpr size_t chunk = 1024;
+	float floats[chunk];
+
+	auto components = size_of( accessor.type );
+	auto elements = chunk / components;
+	for ( size_t first = 0; first < accessor.count; first += elements )
+	{
+		auto count = std::min( elements, accessor.count - first );
+		decode_accessor<FastKernel>( accessor, first, count, floats );
+		encode_halfs( floats, count * components, out + first * components );
+	}
+}
+
+
+void encode_halfs( const float* in, const size_t count, uint16_t* out )
+{
+	size_t i = 0;
+#if defined( GST_DECODE_SSE2 )
+	if ( decode_simd.f16c )
+	{
+		i = encode_halfs_f16c( in, count, out );
+	}
+#endif
+	for ( ; i < count; ++i )
+	{
+		out[i] = float_to_half( in[i] );
+	}
+}
+
+
+uint16_t float_to_half( const float value )
+{
+	uint32_t bits;
+	std::memcpy( &bits, &value, sizeof( bits ) );
+	uint32_t sign = ( bits >> 16 ) & 0x8000;
+	uint32_t abs = bits & 0x7fffffff;
+
+	if ( abs > 0x7f800000 )
+	{
+		// Quiet NaN
+		return uint16_t( sign | 0x7e00 );
+	}
+	if ( abs >= 0x477ff000 )
+	{
+		// 65520 and above round to infinity
+		return uint16_t( sign | 0x7c00 );
+	}
+	if ( abs < 0x38800000 )
+	{
+		// Subnormal halfs are multiples of 2^-24
+		float magnitude;
+		std::memcpy( &magnitude, &abs, sizeof( magnitude ) );
+		return uint16_t( sign | uint32_t( std::nearbyint( magnitude * 16777216.0f ) ) );
+	}
+
+	// Rebias the exponent from 127 to 15, then round the mantissa to the nearest even
+	auto rebiased = abs - 0x38000000;
+	rebiased += 0xfff + ( ( rebiased >> 13 ) & 1 );
+	return uint16_t( sign | ( rebiased >> 13 ) );
+}
+
+
+float half_to_float( const uint16_t half )
+{
+	uint32_t sign = uint32_t( half & 0x8000 ) << 16;
+	uint32_t exponent = ( half >> 10 ) & 0x1f;
+	uint32_t mantissa = half & 0x3ff;
+
+	if ( exponent == 0 )
+	{
+		auto ret = float( mantissa ) / 16777216.0f;
+		return sign ? -ret : ret;
+	}
+
+	uint32_t bits = exponent == 0x1f ? sign | 0x7f800000 | ( mantissa << 13 )
+	                                 : sign | ( ( exponent + 112 ) << 23 ) | ( mantissa << 13 );
+	float ret;
+	std::memcpy( &ret, &bits, sizeof( ret ) );
+	return ret;
+}
+
+
+} // namespace spot::gfx
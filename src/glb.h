@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace spot::gfx
+{
+
+
+/// GLB header and chunk identifiers, shared by the loader and the writer
+constexpr uint32_t glb_magic = 0x46546C67;      // "glTF"
+constexpr uint32_t glb_version = 2;
+constexpr uint32_t glb_chunk_json = 0x4E4F534A; // "JSON"
+constexpr uint32_t glb_chunk_bin = 0x004E4942;  // "BIN\0"
+constexpr size_t glb_header_size = 12;
+constexpr size_t glb_chunk_header_size = 8;
+
+/// GLB lengths are 32 bit
+constexpr uint64_t glb_max_length = 0xFFFFFFFFull;
+
+
+} // namespace spot::gfx
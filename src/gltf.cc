@@ -1,8 +1,15 @@
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 #include <fstream>
+#include <iterator>
 #include <stdexcept>
 #include <spot/file/ifstream.h>
 
 #include "spot/gltf/gltf.h"
+#include "spot/gltf/parallel.h"
+#include "spot/gltf/topology.h"
+#include "glb.h"
 
 
 namespace spot::gfx
@@ -12,8 +19,8 @@ namespace spot::gfx
 Gltf::Gltf( Gltf&& other )
 : asset{ std::move( other.asset ) }
 , path{ std::move( other.path ) }
+, options{ std::move( other.options ) }
 , buffers{ std::move( other.buffers ) }
-, buffers_cache{ std::move( other.buffers_cache ) }
 , buffer_views{ std::move( other.buffer_views ) }
 , cameras{ std::move( other.cameras ) }
 , samplers{ std::move( other.samplers ) }
@@ -45,8 +52,8 @@ Gltf& Gltf::operator=( Gltf&& other )
 {
 	asset         = std::move( other.asset );
 	path          = std::move( other.path );
+	options       = std::move( other.options );
 	buffers       = std::move( other.buffers );
-	buffers_cache = std::move( other.buffers_cache );
 	buffer_views  = std::move( other.buffer_views );
 	cameras       = std::move( other.cameras );
 	samplers      = std::move( other.samplers );
@@ -76,8 +83,11 @@ Gltf& Gltf::operator=( Gltf&& other )
 }
 
 
-Gltf::Gltf( const nlohmann::json& j, const std::string& pth )
+Gltf::Gltf( const nlohmann::json& j, const std::string& pth, const LoadOptions& opts, ByteSpan bin )
+: options { opts }
 {
+	auto& wanted = options.sections = opts.sections.resolved();
+
 	// Get the directory path
 	auto index = pth.find_last_of( "/\\" );
 	path = pth.substr( 0, index );
@@ -86,11 +96,15 @@ Gltf::Gltf( const nlohmann::json& j, const std::string& pth )
 	init_asset( j["asset"] );
 
 	// ByteBuffer
+	enter( LoadProgress::Stage::Buffers );
 	if ( j.count( "buffers" ) )
 	{
-		init_buffers( j["buffers"] );
+		init_buffers( j["buffers"], bin );
 	}
 
+	// Buffers are loaded by workers while the rest of the model is parsed
+	auto loading = start_loading_buffers();
+
 	// BufferViews
 	if ( j.count( "bufferViews" ) )
 	{
@@ -98,70 +112,76 @@ Gltf::Gltf( const nlohmann::json& j, const std::string& pth )
 	}
 
 	// Cameras
-	if ( j.count( "cameras" ) )
+	if ( wanted.cameras && j.count( "cameras" ) )
 	{
 		init_cameras( j["cameras"] );
 	}
 
 	// Samplers
-	if ( j.count( "samplers" ) )
+	if ( wanted.materials && j.count( "samplers" ) )
 	{
 		init_samplers( j["samplers"] );
 	}
 
 	// Images
-	if ( j.count( "images" ) )
+	if ( wanted.materials && j.count( "images" ) )
 	{
 		init_images( j["images"] );
 	}
 
 	// Textures
-	if ( j.count( "textures" ) )
+	if ( wanted.materials && j.count( "textures" ) )
 	{
 		init_textures( j["textures"] );
 	}
 
 	// Accessors
-	init_accessors( j["accessors"] );
+	enter( LoadProgress::Stage::Accessors );
+	if ( j.count( "accessors" ) )
+	{
+		init_accessors( j["accessors"] );
+	}
 
 	// Materials
-	if ( j.count( "materials" ) )
+	enter( LoadProgress::Stage::Meshes );
+	if ( wanted.materials && j.count( "materials" ) )
 	{
 		init_materials( j["materials"] );
 	}
 
 	// Meshes
-	if ( j.count( "meshes" ) )
+	if ( wanted.meshes && j.count( "meshes" ) )
 	{
 		init_meshes( j["meshes"] );
 	}
 
 	// Extras
+	enter( LoadProgress::Stage::Nodes );
 	if ( j.count( "extras" ) )
 	{
 		auto& extras = j["extras"];
 
 		// Scripts
-		if ( extras.count( "scripts" ) )
+		if ( wanted.scripts && extras.count( "scripts" ) )
 		{
 			init_scripts( extras["scripts"] );
 		}
 
 		// Shapes
-		if ( extras.count( "shapes" ) )
+		if ( wanted.shapes && extras.count( "shapes" ) )
 		{
 			init_shapes( extras["shapes"] );
 		}
 	}
 
 	// Nodes
-	if ( j.count( "nodes" ) )
+	if ( wanted.nodes && j.count( "nodes" ) )
 	{
 		init_nodes( j["nodes"] );
 	}
 
 	// Animations
-	if ( j.count( "animations" ) )
+	if ( wanted.animations && j.count( "animations" ) )
 	{
 		init_animations( j["animations"] );
 	}
@@ -172,14 +192,14 @@ Gltf::Gltf( const nlohmann::json& j, const std::string& pth )
 		auto extensions = j["extensions"];
 
 		// Lights
-		if ( extensions.count( "KHR_lights_punctual" ) )
+		if ( wanted.lights && extensions.count( "KHR_lights_punctual" ) )
 		{
 			init_lights( extensions["KHR_lights_punctual"]["lights"] );
 		}
 	}
 
 	// Scenes
-	if ( j.count( "scenes" ) )
+	if ( wanted.scenes && j.count( "scenes" ) )
 	{
 		init_scenes( j["scenes"] );
 
@@ -189,8 +209,17 @@ Gltf::Gltf( const nlohmann::json& j, const std::string& pth )
 		{
 			uIndex = j["scene"].get<uint64_t>();
 		}
-		scene = &scenes[static_cast<const unsigned>( uIndex )];
+		select_scenes( static_cast<size_t>( uIndex ) );
 	}
+
+	// Wait for the buffers, rethrowing loading errors
+	if ( loading.valid() )
+	{
+		loading.get();
+	}
+	load_used_buffers();
+	convert_topology();
+	enter( LoadProgress::Stage::Done );
 }
 
 
@@ -213,26 +242,76 @@ void Gltf::init_asset( const nlohmann::json& j )
 }
 
 
-void Gltf::init_buffers( const nlohmann::json& j )
+void Gltf::init_buffers( const nlohmann::json& j, const ByteSpan& bin )
 {
 	for ( const auto& b : j )
 	{
-		// ByteBuffer length in bytes (mandatory)
-		auto byte_length = b["byteLength"].get<size_t>();
+		init_buffer( b, *buffers.push(), bin );
+	}
+}
+
+
+void Gltf::init_buffer( const nlohmann::json& b, ByteBuffer& buffer, const ByteSpan& bin )
+{
+	// ByteBuffer length in bytes (mandatory)
+	auto byte_length = b["byteLength"].get<size_t>();
+
+	// Uri of the binary file to upload
+	if ( b.count( "uri" ) )
+	{
+		auto uri = b["uri"].get<std::string>();
+		init_buffer( buffer, byte_length, &uri, bin );
+	}
+	else
+	{
+		init_buffer( buffer, byte_length, nullptr, bin );
+	}
+}
+
+
+void Gltf::init_buffer( ByteBuffer& buffer, const size_t byte_length, const std::string* uri, const ByteSpan& bin )
+{
+	// Keep the handle of the slot
+	auto handle = buffer.handle;
+
+	// The first buffer without uri refers to the GLB binary chunk
+	if ( bin.data && handle.get_index() == 0 && !uri )
+	{
+		buffer = ByteBuffer( bin, byte_length );
+		buffer.handle = handle;
+		return;
+	}
 
-		// Uri of the binary file to upload
-		std::string uri;
-		if ( b.count( "uri" ) )
+	std::string location;
+	if ( uri )
+	{
+		location = *uri;
+		// If it is not data
+		if ( location.rfind( "data:", 0 ) != 0 )
 		{
-			uri = b["uri"].get<std::string>();
-			// If it is not data
-			if ( uri.rfind( "data:", 0 ) != 0 )
+			location = path + "/" + location;
+
+			// Bytes provided by the resolver are used in place
+			if ( auto span = resolve( *uri ); span.data )
 			{
-				uri = path + "/" + uri;
+				buffer = ByteBuffer( std::move( span ), byte_length );
+				buffer.uri = location;
+				buffer.handle = handle;
+				return;
 			}
 		}
+	}
 
-		buffers.push( ByteBuffer( uri, byte_length ) );
+	// Loading is left to workers when there are some, or to report its progress.
+	// A partial load waits to know which buffers are used
+	auto partial = options.is_partial();
+	auto lazy = options.lazy_buffers || options.load_threads > 0 || options.progress || partial;
+	buffer = ByteBuffer( location, byte_length, options.storage, lazy, options.cache );
+	buffer.handle = handle;
+
+	if ( options.progress && !options.lazy_buffers && !partial )
+	{
+		options.progress->bytes_total += byte_length;
 	}
 }
 
@@ -241,35 +320,39 @@ void Gltf::init_buffer_views( const nlohmann::json& j )
 {
 	for ( const auto& v : j )
 	{
-		auto view = buffer_views.push();
+		init_buffer_view( v, *buffer_views.push() );
+	}
+}
 
-		// ByteBuffer
-		auto buffer_index = v["buffer"].get<size_t>();
-		view->buffer = Handle<ByteBuffer>( buffers, buffer_index );
 
-		// Byte offset
-		if ( v.count( "byteOffset" ) )
-		{
-			view->byte_offset = v["byteOffset"].get<size_t>();
-		}
+void Gltf::init_buffer_view( const nlohmann::json& v, BufferView& view )
+{
+	// ByteBuffer
+	auto buffer_index = v["buffer"].get<size_t>();
+	view.buffer = Handle<ByteBuffer>( buffers, buffer_index );
 
-		// Byte length
-		if ( v.count( "byteLength" ) )
-		{
-			view->byte_length = v["byteLength"].get<size_t>();
-		}
+	// Byte offset
+	if ( v.count( "byteOffset" ) )
+	{
+		view.byte_offset = v["byteOffset"].get<size_t>();
+	}
 
-		// Byte stride
-		if ( v.count( "byteStride" ) )
-		{
-			view->byte_stride = v["byteStride"].get<size_t>();
-		}
+	// Byte length
+	if ( v.count( "byteLength" ) )
+	{
+		view.byte_length = v["byteLength"].get<size_t>();
+	}
 
-		// Target
-		if ( v.count( "target" ) )
-		{
-			view->target = static_cast<BufferView::Target>( v["target"].get<size_t>() );
-		}
+	// Byte stride
+	if ( v.count( "byteStride" ) )
+	{
+		view.byte_stride = v["byteStride"].get<size_t>();
+	}
+
+	// Target
+	if ( v.count( "target" ) )
+	{
+		view.target = static_cast<BufferView::Target>( v["target"].get<size_t>() );
 	}
 }
 
@@ -278,39 +361,41 @@ void Gltf::init_cameras( const nlohmann::json& j )
 {
 	for ( const auto& c : j )
 	{
-		GltfCamera camera;
+		init_camera( c, cameras.emplace_back() );
+	}
+}
 
-		// Type
-		auto type   = c["type"].get<std::string>();
-		camera.type = ( type == "orthographic" ) ? GltfCamera::Type::Ortographic : GltfCamera::Type::Perspective;
 
-		// Camera
-		if ( camera.type == GltfCamera::Type::Ortographic )
-		{
-			camera.orthographic.xmag  = c["orthographic"]["xmag"].get<float>();
-			camera.orthographic.ymag  = c["orthographic"]["ymag"].get<float>();
-			camera.orthographic.zfar  = c["orthographic"]["zfar"].get<float>();
-			camera.orthographic.znear = c["orthographic"]["znear"].get<float>();
-		}
-		else
-		{
-			auto& perspective = c["perspective"];
-			if ( perspective.count( "aspectRatio" ) )
-			{
-				camera.perspective.aspect_ratio = perspective["aspectRatio"].get<float>();
-			}
-			camera.perspective.yfov  = c["perspective"]["yfov"].get<float>();
-			camera.perspective.zfar  = c["perspective"]["zfar"].get<float>();
-			camera.perspective.znear = c["perspective"]["znear"].get<float>();
-		}
+void Gltf::init_camera( const nlohmann::json& c, GltfCamera& camera )
+{
+	// Type
+	auto type   = c["type"].get<std::string>();
+	camera.type = ( type == "orthographic" ) ? GltfCamera::Type::Ortographic : GltfCamera::Type::Perspective;
 
-		// Name
-		if ( c.count( "name" ) )
+	// Camera
+	if ( camera.type == GltfCamera::Type::Ortographic )
+	{
+		camera.orthographic.xmag  = c["orthographic"]["xmag"].get<float>();
+		camera.orthographic.ymag  = c["orthographic"]["ymag"].get<float>();
+		camera.orthographic.zfar  = c["orthographic"]["zfar"].get<float>();
+		camera.orthographic.znear = c["orthographic"]["znear"].get<float>();
+	}
+	else
+	{
+		auto& perspective = c["perspective"];
+		if ( perspective.count( "aspectRatio" ) )
 		{
-			camera.name = c["name"].get<std::string>();
+			camera.perspective.aspect_ratio = perspective["aspectRatio"].get<float>();
 		}
+		camera.perspective.yfov  = c["perspective"]["yfov"].get<float>();
+		camera.perspective.zfar  = c["perspective"]["zfar"].get<float>();
+		camera.perspective.znear = c["perspective"]["znear"].get<float>();
+	}
 
-		cameras.push_back( std::move( camera ) );
+	// Name
+	if ( c.count( "name" ) )
+	{
+		camera.name = c["name"].get<std::string>();
 	}
 }
 
@@ -385,39 +470,41 @@ void Gltf::init_samplers( const nlohmann::json& j )
 {
 	for ( const auto& s : j )
 	{
-		GltfSampler sampler;
+		init_sampler( s, samplers->emplace_back() );
+	}
+}
 
-		// Mag Filter
-		if ( s.count( "magFilter" ) )
-		{
-			sampler.magFilter = static_cast<GltfSampler::Filter>( s["magFilter"].get<int>() );
-		}
 
-		// Min Filter
-		if ( s.count( "minFilter" ) )
-		{
-			sampler.minFilter = static_cast<GltfSampler::Filter>( s["minFilter"].get<int>() );
-		}
+void Gltf::init_sampler( const nlohmann::json& s, GltfSampler& sampler )
+{
+	// Mag Filter
+	if ( s.count( "magFilter" ) )
+	{
+		sampler.magFilter = static_cast<GltfSampler::Filter>( s["magFilter"].get<int>() );
+	}
 
-		// WrapS
-		if ( s.count( "wrapS" ) )
-		{
-			sampler.wrapS = static_cast<GltfSampler::Wrapping>( s["wrapS"].get<int>() );
-		}
+	// Min Filter
+	if ( s.count( "minFilter" ) )
+	{
+		sampler.minFilter = static_cast<GltfSampler::Filter>( s["minFilter"].get<int>() );
+	}
 
-		// WrapT
-		if ( s.count( "wrapT" ) )
-		{
-			sampler.wrapT = static_cast<GltfSampler::Wrapping>( s["wrapT"].get<int>() );
-		}
+	// WrapS
+	if ( s.count( "wrapS" ) )
+	{
+		sampler.wrapS = static_cast<GltfSampler::Wrapping>( s["wrapS"].get<int>() );
+	}
 
-		// Name
-		if ( s.count( "name" ) )
-		{
-			sampler.name = s["name"].get<std::string>();
-		}
+	// WrapT
+	if ( s.count( "wrapT" ) )
+	{
+		sampler.wrapT = static_cast<GltfSampler::Wrapping>( s["wrapT"].get<int>() );
+	}
 
-		samplers->push_back( sampler );
+	// Name
+	if ( s.count( "name" ) )
+	{
+		sampler.name = s["name"].get<std::string>();
 	}
 }
 
@@ -426,28 +513,49 @@ void Gltf::init_images( const nlohmann::json& j )
 {
 	for ( const auto& i : j )
 	{
-		auto image = images.push();
+		init_image( i, *images.push() );
+	}
+}
 
-		if ( i.count( "uri" ) )
-		{
-			image->uri = path + "/" + i["uri"].get<std::string>();
-		}
 
-		if ( i.count( "mimeType" ) )
-		{
-			image->mime_type = i["mimeType"].get<std::string>();
-		}
+void Gltf::init_image( const nlohmann::json& i, GltfImage& image )
+{
+	if ( i.count( "uri" ) )
+	{
+		init_image_uri( image, i["uri"].get<std::string>() );
+	}
 
-		if ( i.count( "bufferView" ) )
-		{
-			image->buffer_view = i["bufferView"].get<uint32_t>();
-		}
+	if ( i.count( "mimeType" ) )
+	{
+		image.mime_type = i["mimeType"].get<std::string>();
+	}
 
-		if ( i.count( "name" ) )
-		{
-			image->name = i["name"].get<std::string>();
-		}
+	if ( i.count( "bufferView" ) )
+	{
+		image.buffer_view = i["bufferView"].get<uint32_t>();
+	}
+
+	if ( i.count( "name" ) )
+	{
+		image.name = i["name"].get<std::string>();
+	}
+}
+
+
+void Gltf::init_image_uri( GltfImage& image, const std::string& uri )
+{
+	image.uri = path + "/" + uri;
+	image.data = resolve( uri );
+}
+
+
+ByteSpan Gltf::resolve( const std::string& uri ) const
+{
+	if ( options.resolver && uri.rfind( "data:", 0 ) != 0 )
+	{
+		return options.resolver->resolve( uri );
 	}
+	return {};
 }
 
 
@@ -455,27 +563,31 @@ void Gltf::init_textures( const nlohmann::json& j )
 {
 	for ( const auto& t : j )
 	{
-		auto texture = textures.push();
+		init_texture( t, *textures.push() );
+	}
+}
 
-		// GltfSampler
-		if ( t.count( "sampler" ) )
-		{
-			auto handle = t["sampler"].get<size_t>();
-			texture->sampler = Handle<GltfSampler>( samplers, handle );
-		}
 
-		// Image
-		if ( t.count( "source" ) )
-		{
-			auto index = t["source"].get<int32_t>();
-			texture->source = Handle<GltfImage>( images, index );
-		}
+void Gltf::init_texture( const nlohmann::json& t, GltfTexture& texture )
+{
+	// GltfSampler
+	if ( t.count( "sampler" ) )
+	{
+		auto handle = t["sampler"].get<size_t>();
+		texture.sampler = Handle<GltfSampler>( samplers, handle );
+	}
 
-		// Name
-		if ( t.count( "name" ) )
-		{
-			texture->name = t["name"].get<std::string>();
-		}
+	// Image
+	if ( t.count( "source" ) )
+	{
+		auto index = t["source"].get<int32_t>();
+		texture.source = Handle<GltfImage>( images, index );
+	}
+
+	// Name
+	if ( t.count( "name" ) )
+	{
+		texture.name = t["name"].get<std::string>();
 	}
 }
 
@@ -596,172 +708,426 @@ size_t Accessor::get_size() const
 }
 
 
+size_t Accessor::get_element_size() const
+{
+	auto component_size = size_of( component_type );
+	size_t columns = type == Type::MAT2 ? 2 : type == Type::MAT3 ? 3 : type == Type::MAT4 ? 4 : 1;
+	auto rows = size_of( type ) / columns;
+	// Each matrix column starts at a multiple of four bytes
+	auto column_size = columns > 1 ? ( rows * component_size + 3 ) & ~size_t( 3 ) : rows * component_size;
+	return columns * column_size;
+}
+
+
 const uint8_t* Accessor::get_data() const
 {
-	auto& buffer = buffer_view->buffer;
-	auto data = buffer->data.data() + buffer_view->byte_offset + byte_offset;
+	if ( sparse )
+	{
+		materialize();
+		return sparse->dense.data();
+	}
+
+	auto data = buffer_view->get_data() + byte_offset;
 	return reinterpret_cast<const uint8_t*>( data );
 }
 
 
 size_t Accessor::get_stride() const
 {
-	return buffer_view->byte_stride;
+	return sparse ? 0 : buffer_view->byte_stride;
 }
 
 
-void Gltf::init_accessors( const nlohmann::json& j )
+const char* get_accessor_bytes( const Accessor& accessor, const size_t element_size, size_t& stride )
 {
-	for ( const auto& a : j )
+	auto& view = *accessor.buffer_view;
+	stride = view.byte_stride ? view.byte_stride : element_size;
+	if ( accessor.count > 0 )
 	{
-		auto accessor = accessors.push();
-
-		// ByteBuffer view
-		if ( a.count( "bufferView" ) )
+		auto end = accessor.byte_offset + ( accessor.count - 1 ) * stride + element_size;
+		if ( stride < element_size || ( view.byte_length && end > view.byte_length ) )
 		{
-			auto buffer_view_index = a["bufferView"].get<size_t>();
-			accessor->buffer_view = Handle<BufferView>( buffer_views, buffer_view_index );
+			throw std::runtime_error{ "Accessor out of its buffer view" };
 		}
+	}
 
-		// Byte offset
-		if ( a.count( "byteOffset" ) )
-		{
-			accessor->byte_offset = a["byteOffset"].get<size_t>();
-		}
+	return view.get_data() + accessor.byte_offset;
+}
 
-		// Component type
-		accessor->component_type = a["componentType"].get<Accessor::ComponentType>();
 
-		// Count
-		accessor->count = a["count"].get<size_t>();
+/// @return The address of size bytes of a buffer view used by a sparse accessor
+/// @throw std::runtime_error If they are out of the buffer view
+const char* get_sparse_bytes( const Handle<BufferView>& view, const size_t byte_offset, const size_t size )
+{
+	if ( !view )
+	{
+		throw std::runtime_error{ "Sparse accessor without buffer view" };
+	}
+	if ( view->byte_length && byte_offset + size > view->byte_length )
+	{
+		throw std::runtime_error{ "Sparse accessor out of its buffer view" };
+	}
+	return view->get_data() + byte_offset;
+}
 
-		// Type
-		accessor->type = from_string<Accessor::Type>( a["type"].get<std::string>() );
 
-		// Max
-		if ( a.count( "max" ) )
-		{
-			for ( const auto& value : a["max"] )
-			{
-				accessor->max.push_back( value.get<float>() );
-			}
-		}
+template <typename I>
+void widen_sparse_indices( const char* data, std::vector<uint32_t>& indices )
+{
+	for ( size_t i = 0; i < indices.size(); ++i )
+	{
+		I index;
+		std::memcpy( &index, data + i * sizeof( I ), sizeof( I ) );
+		indices[i] = index;
+	}
+}
 
-		// Min
-		if ( a.count( "min" ) )
-		{
-			for ( const auto& value : a["min"] )
-			{
-				accessor->min.push_back( value.get<float>() );
-			}
-		}
+
+/// @return The indices of the substituted elements of a sparse accessor, widened to 32 bits
+/// @throw std::runtime_error If they are out of their buffer view or of the accessor, or not strictly increasing
+std::vector<uint32_t> get_sparse_indices( const Accessor& accessor )
+{
+	auto& sparse = *accessor.sparse;
+	auto component_type = sparse.indices.component_type;
+	auto data = get_sparse_bytes( sparse.indices.buffer_view, sparse.indices.byte_offset,
+		sparse.count * size_of( component_type ) );
+
+	std::vector<uint32_t> ret( sparse.count );
+	switch ( component_type )
+	{
+	case Accessor::ComponentType::UNSIGNED_BYTE: widen_sparse_indices<uint8_t>( data, ret ); break;
+	case Accessor::ComponentType::UNSIGNED_SHORT: widen_sparse_indices<uint16_t>( data, ret ); break;
+	case Accessor::ComponentType::UNSIGNED_INT: widen_sparse_indices<uint32_t>( data, ret ); break;
+	default: throw std::runtime_error{ "Sparse indices component type not valid" };
+	}
+
+	// Lookups search the indices, so they must be strictly increasing; a reduction rather than a branch per index
+	bool unordered = false;
+	for ( size_t i = 1; i < ret.size(); ++i )
+	{
+		unordered |= ret[i] <= ret[i - 1];
+	}
+	if ( unordered )
+	{
+		throw std::runtime_error{ "Sparse indices not strictly increasing" };
+	}
+	if ( !ret.empty() && ret.back() >= accessor.count )
+	{
+		throw std::runtime_error{ "Sparse index out of its accessor" };
 	}
+	return ret;
 }
 
 
-void Gltf::init_materials( const nlohmann::json& j )
+/// Copies values at the indices of their elements, each one of Size bytes
+template <size_t Size>
+void scatter_sparse_values( uint8_t* dense, const std::vector<uint32_t>& indices, const char* values )
 {
-	for ( const auto& m : j )
+	for ( size_t i = 0; i < indices.size(); ++i )
 	{
-		auto material = materials.push();
+		std::memcpy( dense + size_t( indices[i] ) * Size, values + i * Size, Size );
+	}
+}
 
-		// Name
-		if ( m.count( "name" ) )
-		{
-			material->name = m["name"].get<std::string>();
-		}
 
-		// PbrMetallicRoughness
-		if ( m.count( "pbrMetallicRoughness" ) )
-		{
-			auto& mr = m["pbrMetallicRoughness"];
+void Accessor::materialize() const
+{
+	if ( !sparse )
+	{
+		return;
+	}
 
-			if ( mr.count( "baseColorFactor" ) )
-			{
-				auto color = mr["baseColorFactor"].get<std::vector<float>>();
-				material->pbr.color.r = color[0];
-				material->pbr.color.g = color[1];
-				material->pbr.color.b = color[2];
-				material->pbr.color.a = color[3];
-			}
+	std::call_once( sparse->materialized, [this] {
+		auto element_size = get_element_size();
+		auto& dense = sparse->dense;
+		dense.assign( count * element_size, 0 );
 
-			if ( mr.count( "baseColorTexture" ) )
+		if ( buffer_view )
+		{
+			size_t stride;
+			auto base = get_accessor_bytes( *this, element_size, stride );
+			if ( stride == element_size )
 			{
-				auto index = mr["baseColorTexture"]["index"].get<size_t>();
-				material->texture_handle = Handle<GltfTexture>( textures, index );
+				std::memcpy( dense.data(), base, dense.size() );
 			}
-
-			if ( mr.count( "metallicFactor" ) )
+			else
 			{
-				material->pbr.metallic = mr["metallicFactor"].get<float>();
+				for ( size_t i = 0; i < count; ++i )
+				{
+					std::memcpy( dense.data() + i * element_size, base + i * stride, element_size );
+				}
 			}
+		}
 
-			if ( mr.count( "roughnessFactor" ) )
+		auto indices = get_sparse_indices( *this );
+		auto values =
+			get_sparse_bytes( sparse->values.buffer_view, sparse->values.byte_offset, sparse->count * element_size );
+
+		// Fixed sizes let the copies become plain moves
+		switch ( element_size )
+		{
+		case 1: scatter_sparse_values<1>( dense.data(), indices, values ); break;
+		case 2: scatter_sparse_values<2>( dense.data(), indices, values ); break;
+		case 4: scatter_sparse_values<4>( dense.data(), indices, values ); break;
+		case 8: scatter_sparse_values<8>( dense.data(), indices, values ); break;
+		case 12: scatter_sparse_values<12>( dense.data(), indices, values ); break;
+		case 16: scatter_sparse_values<16>( dense.data(), indices, values ); break;
+		default:
+			for ( size_t i = 0; i < indices.size(); ++i )
 			{
-				material->pbr.roughness = mr["roughnessFactor"].get<float>();
+				std::memcpy( dense.data() + size_t( indices[i] ) * element_size, values + i * element_size,
+					element_size );
 			}
+			break;
 		}
-	}
+	} );
 }
 
 
-template <>
-Primitive::Semantic from_string<Primitive::Semantic>( const std::string& s )
+/// @throw std::runtime_error If the accessor does not hold elements of that layout
+void check_accessor_layout( const Accessor& accessor, const Accessor::ComponentType component_type,
+	const Accessor::Type type, const size_t element_size )
 {
-	if ( s == "POSITION" )
-	{
-		return Primitive::Semantic::POSITION;
-	}
-	else if ( s == "NORMAL" )
-	{
-		return Primitive::Semantic::NORMAL;
-	}
-	else if ( s == "TANGENT" )
-	{
-		return Primitive::Semantic::TANGENT;
-	}
-	else if ( s == "TEXCOORD_0" )
+	if ( accessor.component_type != component_type || accessor.type != type ||
+		size_of( component_type ) * size_of( type ) != element_size )
 	{
-		return Primitive::Semantic::TEXCOORD_0;
+		throw std::runtime_error{ "Accessor type not matching its view: " + to_string( accessor.type ) };
 	}
-	else if ( s == "TEXCOORD_1" )
+}
+
+
+const char* check_accessor_view( const Accessor& accessor, const Accessor::ComponentType component_type,
+	const Accessor::Type type, const size_t element_size, size_t& stride )
+{
+	check_accessor_layout( accessor, component_type, type, element_size );
+
+	if ( accessor.sparse )
 	{
-		return Primitive::Semantic::TEXCOORD_1;
+		stride = element_size;
+		return reinterpret_cast<const char*>( accessor.get_data() );
 	}
-	else if ( s == "COLOR_0" )
+
+	if ( !accessor.buffer_view )
 	{
-		return Primitive::Semantic::COLOR_0;
+		throw std::runtime_error{ "Accessor without buffer view" };
 	}
-	else if ( s == "JOINTS_0" )
+
+	return get_accessor_bytes( accessor, element_size, stride );
+}
+
+
+const char* check_sparse_view( const Accessor& accessor, const Accessor::ComponentType component_type,
+	const Accessor::Type type, const size_t element_size, size_t& stride, std::vector<uint32_t>& indices,
+	const char*& values )
+{
+	check_accessor_layout( accessor, component_type, type, element_size );
+
+	if ( accessor.sparse )
 	{
-		return Primitive::Semantic::JOINTS_0;
+		indices = get_sparse_indices( accessor );
+		values = get_sparse_bytes(
+			accessor.sparse->values.buffer_view, accessor.sparse->values.byte_offset, indices.size() * element_size );
 	}
-	else if ( s == "WEIGHTS_0" )
+	else if ( !accessor.buffer_view )
 	{
-		return Primitive::Semantic::WEIGHTS_0;
+		throw std::runtime_error{ "Accessor without buffer view" };
 	}
-	else
+
+	stride = element_size;
+	return accessor.buffer_view ? get_accessor_bytes( accessor, element_size, stride ) : nullptr;
+}
+
+
+void Gltf::init_accessors( const nlohmann::json& j )
+{
+	for ( const auto& a : j )
 	{
-		assert( false );
-		return Primitive::Semantic::NONE;
+		init_accessor( a, *accessors.push() );
 	}
 }
 
 
-template <>
-std::string to_string<Primitive::Semantic>( const Primitive::Semantic& s )
+void Gltf::init_accessor( const nlohmann::json& a, Accessor& accessor )
 {
-	if ( s == Primitive::Semantic::POSITION )
+	// ByteBuffer view
+	if ( a.count( "bufferView" ) )
 	{
-		return "Position";
+		auto buffer_view_index = a["bufferView"].get<size_t>();
+		accessor.buffer_view = Handle<BufferView>( buffer_views, buffer_view_index );
 	}
-	else if ( s == Primitive::Semantic::NORMAL )
+
+	// Byte offset
+	if ( a.count( "byteOffset" ) )
 	{
-		return "Normal";
+		accessor.byte_offset = a["byteOffset"].get<size_t>();
 	}
-	else if ( s == Primitive::Semantic::TANGENT )
+
+	// Component type
+	accessor.component_type = a["componentType"].get<Accessor::ComponentType>();
+
+	// Normalized
+	if ( a.count( "normalized" ) )
 	{
-		return "Tangent";
+		accessor.normalized = a["normalized"].get<bool>();
+	}
+
+	// Count
+	accessor.count = a["count"].get<size_t>();
+
+	// Type
+	accessor.type = from_string<Accessor::Type>( a["type"].get<std::string>() );
+
+	// Max
+	if ( a.count( "max" ) )
+	{
+		for ( const auto& value : a["max"] )
+		{
+			accessor.max.push_back( value.get<float>() );
+		}
+	}
+
+	// Min
+	if ( a.count( "min" ) )
+	{
+		for ( const auto& value : a["min"] )
+		{
+			accessor.min.push_back( value.get<float>() );
+		}
+	}
+
+	// Sparse
+	if ( a.count( "sparse" ) )
+	{
+		auto& s = a["sparse"];
+		accessor.sparse = std::make_shared<Accessor::Sparse>();
+		auto& sparse = *accessor.sparse;
+		sparse.count = s["count"].get<size_t>();
+
+		auto& indices = s["indices"];
+		sparse.indices.buffer_view = Handle<BufferView>( buffer_views, indices["bufferView"].get<size_t>() );
+		if ( indices.count( "byteOffset" ) )
+		{
+			sparse.indices.byte_offset = indices["byteOffset"].get<size_t>();
+		}
+		sparse.indices.component_type = indices["componentType"].get<Accessor::ComponentType>();
+
+		auto& values = s["values"];
+		sparse.values.buffer_view = Handle<BufferView>( buffer_views, values["bufferView"].get<size_t>() );
+		if ( values.count( "byteOffset" ) )
+		{
+			sparse.values.byte_offset = values["byteOffset"].get<size_t>();
+		}
+	}
+}
+
+
+void Gltf::init_materials( const nlohmann::json& j )
+{
+	for ( const auto& m : j )
+	{
+		init_material( m, *materials.push() );
+	}
+}
+
+
+void Gltf::init_material( const nlohmann::json& m, Material& material )
+{
+	// Name
+	if ( m.count( "name" ) )
+	{
+		material.name = m["name"].get<std::string>();
+	}
+
+	// PbrMetallicRoughness
+	if ( m.count( "pbrMetallicRoughness" ) )
+	{
+		auto& mr = m["pbrMetallicRoughness"];
+
+		if ( mr.count( "baseColorFactor" ) )
+		{
+			auto color = mr["baseColorFactor"].get<std::vector<float>>();
+			material.pbr.color.r = color[0];
+			material.pbr.color.g = color[1];
+			material.pbr.color.b = color[2];
+			material.pbr.color.a = color[3];
+		}
+
+		if ( mr.count( "baseColorTexture" ) )
+		{
+			auto index = mr["baseColorTexture"]["index"].get<size_t>();
+			material.texture_handle = Handle<GltfTexture>( textures, index );
+		}
+
+		if ( mr.count( "metallicFactor" ) )
+		{
+			material.pbr.metallic = mr["metallicFactor"].get<float>();
+		}
+
+		if ( mr.count( "roughnessFactor" ) )
+		{
+			material.pbr.roughness = mr["roughnessFactor"].get<float>();
+		}
+	}
+}
+
+
+template <>
+Primitive::Semantic from_string<Primitive::Semantic>( const std::string& s )
+{
+	if ( s == "POSITION" )
+	{
+		return Primitive::Semantic::POSITION;
+	}
+	else if ( s == "NORMAL" )
+	{
+		return Primitive::Semantic::NORMAL;
+	}
+	else if ( s == "TANGENT" )
+	{
+		return Primitive::Semantic::TANGENT;
+	}
+	else if ( s == "TEXCOORD_0" )
+	{
+		return Primitive::Semantic::TEXCOORD_0;
+	}
+	else if ( s == "TEXCOORD_1" )
+	{
+		return Primitive::Semantic::TEXCOORD_1;
+	}
+	else if ( s == "COLOR_0" )
+	{
+		return Primitive::Semantic::COLOR_0;
+	}
+	else if ( s == "JOINTS_0" )
+	{
+		return Primitive::Semantic::JOINTS_0;
+	}
+	else if ( s == "WEIGHTS_0" )
+	{
+		return Primitive::Semantic::WEIGHTS_0;
+	}
+	else
+	{
+		assert( false );
+		return Primitive::Semantic::NONE;
+	}
+}
+
+
+template <>
+std::string to_string<Primitive::Semantic>( const Primitive::Semantic& s )
+{
+	if ( s == Primitive::Semantic::POSITION )
+	{
+		return "Position";
+	}
+	else if ( s == Primitive::Semantic::NORMAL )
+	{
+		return "Normal";
+	}
+	else if ( s == Primitive::Semantic::TANGENT )
+	{
+		return "Tangent";
 	}
 	else if ( s == Primitive::Semantic::TEXCOORD_0 )
 	{
@@ -795,47 +1161,51 @@ void Gltf::init_meshes( const nlohmann::json& j )
 {
 	for ( const auto& m : j )
 	{
-		Mesh mesh { *this };
+		init_mesh( m, *meshes.push( Mesh( *this ) ) );
+	}
+}
 
-		// Name
-		if ( m.count( "name" ) )
-		{
-			mesh.name = m["name"].get<std::string>();
-		}
 
-		// Primitives
-		for ( const auto& p : m["primitives"] )
-		{
-			auto& primitive = mesh.primitives.emplace_back();
+void Gltf::init_mesh( const nlohmann::json& m, Mesh& mesh )
+{
+	mesh.model = this;
 
-			auto attributes = p["attributes"].get<std::map<std::string, unsigned>>();
+	// Name
+	if ( m.count( "name" ) )
+	{
+		mesh.name = m["name"].get<std::string>();
+	}
 
-			for ( const auto& a : attributes )
-			{
-				auto semantic = from_string<Primitive::Semantic>( a.first );
-				auto accessor = Handle<Accessor>( accessors, a.second );
-				primitive.attributes.emplace( semantic, accessor );
-			}
+	// Primitives
+	for ( const auto& p : m["primitives"] )
+	{
+		auto& primitive = mesh.primitives.emplace_back();
 
-			if ( p.count( "indices" ) )
-			{
-				auto indices_index = p["indices"].get<int32_t>();
-				primitive.indices_handle = Handle<Accessor>( accessors, indices_index );
-			}
+		auto attributes = p["attributes"].get<std::map<std::string, unsigned>>();
 
-			if ( p.count( "material" ) )
-			{
-				auto material_index = p["material"].get<int32_t>();
-				primitive.material = Handle<Material>( materials, material_index );
-			}
+		for ( const auto& a : attributes )
+		{
+			auto semantic = from_string<Primitive::Semantic>( a.first );
+			auto accessor = Handle<Accessor>( accessors, a.second );
+			primitive.attributes.emplace( semantic, accessor );
+		}
 
-			if ( p.count( "mode" ) )
-			{
-				primitive.mode = p["mode"].get<Primitive::Mode>();
-			}
+		if ( p.count( "indices" ) )
+		{
+			auto indices_index = p["indices"].get<int32_t>();
+			primitive.indices_handle = Handle<Accessor>( accessors, indices_index );
+		}
+
+		if ( options.sections.materials && p.count( "material" ) )
+		{
+			auto material_index = p["material"].get<int32_t>();
+			primitive.material = Handle<Material>( materials, material_index );
 		}
 
-		meshes->push_back( std::move( mesh ) );
+		if ( p.count( "mode" ) )
+		{
+			primitive.mode = p["mode"].get<Primitive::Mode>();
+		}
 	}
 }
 
@@ -853,181 +1223,184 @@ void Gltf::init_lights( const nlohmann::json& j )
 {
 	for ( const auto& l : j )
 	{
-		Light light;
+		init_light( l, lights.emplace_back() );
+	}
+}
 
-		// Name
-		if ( l.count( "name" ) )
-		{
-			light.name = l["name"].get<std::string>();
-		}
 
-		// Color
-		if ( l.count( "color" ) )
-		{
-			auto color = l["color"].get<std::vector<float>>();
-			light.color.set( color[0], color[1], color[2] );
-		}
+void Gltf::init_light( const nlohmann::json& l, Light& light )
+{
+	// Name
+	if ( l.count( "name" ) )
+	{
+		light.name = l["name"].get<std::string>();
+	}
+
+	// Color
+	if ( l.count( "color" ) )
+	{
+		auto color = l["color"].get<std::vector<float>>();
+		light.color.set( color[0], color[1], color[2] );
+	}
+
+	// Intensity
+	if ( l.count( "intensity" ) )
+	{
+		light.intensity = l["intensity"].get<float>();
+	}
+
+	// Range
+	if ( l.count( "range" ) )
+	{
+		light.range = l["range"].get<float>();
+	}
 
-		// Intensity
-		if ( l.count( "intensity" ) )
+	// Type
+	if ( l.count( "type" ) )
+	{
+		auto type = l["type"].get<std::string>();
+		if ( type == "point" )
 		{
-			light.intensity = l["intensity"].get<float>();
+			light.type = Light::Type::Point;
 		}
-
-		// Range
-		if ( l.count( "range" ) )
+		else if ( type == "directional" )
 		{
-			light.range = l["range"].get<float>();
+			light.type = Light::Type::Directional;
 		}
-
-		// Type
-		if ( l.count( "type" ) )
+		else if ( type == "spot" )
 		{
-			auto type = l["type"].get<std::string>();
-			if ( type == "point" )
-			{
-				light.type = Light::Type::Point;
-			}
-			else if ( type == "directional" )
-			{
-				light.type = Light::Type::Directional;
-			}
-			else if ( type == "spot" )
-			{
-				light.type = Light::Type::Spot;
+			light.type = Light::Type::Spot;
 
-				if ( l.count( "spot" ) )
+			if ( l.count( "spot" ) )
+			{
+				const auto& spot = l["spot"];
+				if ( spot.count( "innerConeAngle" ) )
 				{
-					const auto& spot = l["spot"];
-					if ( spot.count( "innerConeAngle" ) )
-					{
-						light.spot.inner_cone_angle = l["spot"]["innerConeAngle"].get<float>();
-					}
-					if ( spot.count( "innerConeAngle" ) )
-					{
-						light.spot.outer_cone_angle = l["spot"]["outerConeAngle"].get<float>();
-					}
+					light.spot.inner_cone_angle = l["spot"]["innerConeAngle"].get<float>();
+				}
+				if ( spot.count( "outerConeAngle" ) )
+				{
+					light.spot.outer_cone_angle = l["spot"]["outerConeAngle"].get<float>();
 				}
-			}
-			else
-			{
-				assert( false && "Invalid light type" );
 			}
 		}
-
-		lights.push_back( light );
+		else
+		{
+			assert( false && "Invalid light type" );
+		}
 	}
 }
 
 
 void Gltf::init_nodes( const nlohmann::json& j )
 {
-	size_t i = 0;
-
+	auto i = nodes->size();
 	for ( const auto& n : j )
 	{
-		auto& node = nodes->emplace_back();
-		node.model = this;
+		init_node( n, *nodes.push() );
+	}
 
-		// Index
-		node.handle = Handle<Node>( nodes, i++ );
+	// Second pass, now children are available
+	for ( auto& n : j )
+	{
+		init_node_children( n, ( *nodes )[i++] );
+	}
+}
 
-		// Name
-		if ( n.count( "name" ) )
-		{
-			node.name = n["name"].get<std::string>();
-		}
 
-		// Camera
-		if ( n.count( "camera" ) )
-		{
-			unsigned m  = n["camera"];
-			node.camera = &( cameras[m] );
-		}
+void Gltf::init_node( const nlohmann::json& n, Node& node )
+{
+	node.model = this;
 
-		// Matrix
-		if ( n.count( "matrix" ) )
-		{
-			auto marr = n["matrix"].get<std::array<float, 16>>();
-			node.matrix = math::Mat4( marr.data() );
-		}
+	// Name
+	if ( n.count( "name" ) )
+	{
+		node.name = n["name"].get<std::string>();
+	}
 
-		// Mesh
-		if ( n.count( "mesh" ) )
-		{
-			auto mesh_index = n["mesh"];
-			node.mesh = Handle<Mesh>( meshes, mesh_index );
-		}
+	// Camera
+	if ( options.sections.cameras && n.count( "camera" ) )
+	{
+		unsigned m  = n["camera"];
+		node.camera = &( cameras[m] );
+	}
 
-		// Rotation
-		if ( n.count( "rotation" ) )
-		{
-			auto qvec     = n["rotation"].get<std::vector<float>>();
-			node.rotation = math::Quat{ qvec[3], qvec[0], qvec[1], qvec[2] };
-		}
+	// Matrix
+	if ( n.count( "matrix" ) )
+	{
+		auto marr = n["matrix"].get<std::array<float, 16>>();
+		node.matrix = math::Mat4( marr.data() );
+	}
 
-		// Scale
-		if ( n.count( "scale" ) )
-		{
-			auto s     = n["scale"].get<std::vector<float>>();
-			node.scale = math::Vec3{ s[0], s[1], s[2] };
-		}
+	// Mesh
+	if ( options.sections.meshes && n.count( "mesh" ) )
+	{
+		auto mesh_index = n["mesh"];
+		node.mesh = Handle<Mesh>( meshes, mesh_index );
+	}
+
+	// Rotation
+	if ( n.count( "rotation" ) )
+	{
+		auto qvec     = n["rotation"].get<std::vector<float>>();
+		node.rotation = math::Quat{ qvec[3], qvec[0], qvec[1], qvec[2] };
+	}
+
+	// Scale
+	if ( n.count( "scale" ) )
+	{
+		auto s     = n["scale"].get<std::vector<float>>();
+		node.scale = math::Vec3{ s[0], s[1], s[2] };
+	}
+
+	// Translation
+	if ( n.count( "translation" ) )
+	{
+		auto t           = n["translation"].get<std::vector<float>>();
+		node.translation = math::Vec3{ t[0], t[1], t[2] };
+	}
 
-		// Translation
-		if ( n.count( "translation" ) )
+	// Estensions
+	if ( n.count( "extensions" ) )
+	{
+		auto& extensions = n["extensions"];
+		// Lights
+		if ( options.sections.lights && extensions.count( "KHR_lights_punctual" ) )
 		{
-			auto t           = n["translation"].get<std::vector<float>>();
-			node.translation = math::Vec3{ t[0], t[1], t[2] };
+			node.light_index = extensions["KHR_lights_punctual"]["light"].get<int32_t>();
 		}
+	}
+
+	// Extras
+	if ( n.count( "extras" ) )
+	{
+		auto& extras = n["extras"];
 
-		// Estensions
-		if ( n.count( "extensions" ) )
+		// Bounds
+		if ( options.sections.shapes && extras.count( "bounds" ) )
 		{
-			auto& extensions = n["extensions"];
-			// Lights
-			if ( extensions.count( "KHR_lights_punctual" ) )
-			{
-				node.light_index = extensions["KHR_lights_punctual"]["light"].get<int32_t>();
-			}
+			node.bounds = extras["bounds"].get<int32_t>();
 		}
 
-		// Extras
-		if ( n.count( "extras" ) )
+		// Scripts
+		if ( options.sections.scripts && extras.count( "scripts" ) )
 		{
-			auto& extras = n["extras"];
-
-			// Bounds
-			if ( extras.count( "bounds" ) )
-			{
-				node.bounds = extras["bounds"].get<int32_t>();
-			}
-
-			// Scripts
-			if ( extras.count( "scripts" ) )
-			{
-				node.scripts_indices = extras["scripts"].get<std::vector<size_t>>();
-			}
+			node.scripts_indices = extras["scripts"].get<std::vector<size_t>>();
 		}
 	}
+}
 
-	// Second pass
-	i = 0;
-	for ( auto& n : j )
-	{
-		auto& node = (*nodes)[i];
 
-		// Now children are available
-		if ( n.count( "children" ) )
+void Gltf::init_node_children( const nlohmann::json& n, Node& node )
+{
+	if ( n.count( "children" ) )
+	{
+		auto handles = n["children"].get<std::vector<size_t>>();
+		node.children.resize( handles.size() );
+		for ( size_t i = 0; i < handles.size(); ++i )
 		{
-			auto handles = n["children"].get<std::vector<size_t>>();
-			node.children.resize( handles.size() );
-			for ( size_t i = 0; i < handles.size(); ++i )
-			{
-				node.children[i] = Handle<Node>( nodes, handles[i] );
-			}
+			node.children[i] = Handle<Node>( nodes, handles[i] );
 		}
-
-		++i;
 	}
 }
 
@@ -1078,56 +1451,58 @@ Animation::Target::Path from_string<Animation::Target::Path>( const std::string&
 
 void Gltf::init_animations( const nlohmann::json& j )
 {
-	for ( auto& a : j )
+	for ( const auto& a : j )
 	{
-		auto animation = Animation( *this );
-
-		if ( a.count( "name" ) )
-		{
-			animation.name = a["name"].get<std::string>();
-		}
+		init_animation( a, animations.emplace_back( *this ) );
+	}
+}
 
-		for ( auto& s : a["samplers"] )
-		{
-			Animation::Sampler sampler;
 
-			auto input  = s["input"].get<size_t>();
-			sampler.input = Handle<Accessor>( accessors, input );
+void Gltf::init_animation( const nlohmann::json& a, Animation& animation )
+{
+	if ( a.count( "name" ) )
+	{
+		animation.name = a["name"].get<std::string>();
+	}
 
-			auto output = s["output"].get<size_t>();
-			sampler.output = Handle<Accessor>( accessors, output );
+	for ( auto& s : a["samplers"] )
+	{
+		Animation::Sampler sampler;
 
-			if ( s.count( "interpolation" ) )
-			{
-				sampler.interpolation =
-				    from_string<Animation::Sampler::Interpolation>( s["interpolation"].get<std::string>() );
-			}
+		auto input  = s["input"].get<size_t>();
+		sampler.input = Handle<Accessor>( accessors, input );
 
-			animation.samplers->push_back( std::move( sampler ) );
-		}
+		auto output = s["output"].get<size_t>();
+		sampler.output = Handle<Accessor>( accessors, output );
 
-		for ( auto& c : a["channels"] )
+		if ( s.count( "interpolation" ) )
 		{
-			Animation::Channel channel;
+			sampler.interpolation =
+			    from_string<Animation::Sampler::Interpolation>( s["interpolation"].get<std::string>() );
+		}
 
-			auto handle = c["sampler"].get<size_t>();
-			channel.sampler = Handle<Animation::Sampler>( animation.samplers, handle );
+		animation.samplers->push_back( std::move( sampler ) );
+	}
 
-			// Target
-			auto& t = c["target"];
+	for ( auto& c : a["channels"] )
+	{
+		Animation::Channel channel;
 
-			if ( t.count( "node" ) )
-			{
-				auto handle = t["node"].get<size_t>();
-				channel.target.node = Handle<Node>( nodes, handle );
-			}
+		auto handle = c["sampler"].get<size_t>();
+		channel.sampler = Handle<Animation::Sampler>( animation.samplers, handle );
 
-			channel.target.path = from_string<Animation::Target::Path>( t["path"].get<std::string>() );
+		// Target
+		auto& t = c["target"];
 
-			animation.channels->push_back( std::move( channel ) );
+		if ( t.count( "node" ) )
+		{
+			auto handle = t["node"].get<size_t>();
+			channel.target.node = Handle<Node>( nodes, handle );
 		}
 
-		animations.push_back( std::move( animation ) );
+		channel.target.path = from_string<Animation::Target::Path>( t["path"].get<std::string>() );
+
+		animation.channels->push_back( std::move( channel ) );
 	}
 }
 
@@ -1150,56 +1525,63 @@ Bounds::Type from_string<Bounds::Type>( const std::string& b )
 }
 
 
-void Gltf::init_shapes( const nlohmann::json& ss )
+void Gltf::init_shapes( const nlohmann::json& j )
 {
-	for ( auto& s : ss )
+	for ( const auto& s : j )
 	{
-		auto type = s["type"].get<std::string>();
-		if ( type == "box" )
-		{
-			auto aa = s["box"]["a"].get<std::vector<float>>();
-			auto a  = math::Vec3{ aa[0], aa[1], aa[2] };
-			auto bb = s["box"]["b"].get<std::vector<float>>();
-			auto b  = math::Vec3{ bb[0], bb[1], bb[2] };
-
-			boxes.emplace_back( Box{ a, b } );
-		}
-		else if ( type == "sphere" )
-		{
-			auto oo = s["sphere"]["o"].get<std::vector<float>>();
-			auto o  = math::Vec3{ oo[0], oo[1], oo[2] };
+		init_shape( s );
+	}
+}
 
-			auto r = s["sphere"]["r"].get<float>();
 
-			spheres.emplace_back( Sphere{ o, r } );
-		}
-		else
-		{
-			throw std::runtime_error{ "Type not supported: " + type };
-		}
+void Gltf::init_shape( const nlohmann::json& s )
+{
+	auto type = s["type"].get<std::string>();
+	if ( type == "box" )
+	{
+		auto aa = s["box"]["a"].get<std::vector<float>>();
+		auto a  = math::Vec3{ aa[0], aa[1], aa[2] };
+		auto bb = s["box"]["b"].get<std::vector<float>>();
+		auto b  = math::Vec3{ bb[0], bb[1], bb[2] };
+
+		boxes.emplace_back( Box{ a, b } );
+	}
+	else if ( type == "sphere" )
+	{
+		auto oo = s["sphere"]["o"].get<std::vector<float>>();
+		auto o  = math::Vec3{ oo[0], oo[1], oo[2] };
+
+		auto r = s["sphere"]["r"].get<float>();
+
+		spheres.emplace_back( Sphere{ o, r } );
+	}
+	else
+	{
+		throw std::runtime_error{ "Type not supported: " + type };
 	}
 }
 
 
-void Gltf::init_scripts( const nlohmann::json& ss )
+void Gltf::init_scripts( const nlohmann::json& j )
 {
-	// Init scripts
-	Script script;
-
-	for ( auto& s : ss )
+	for ( const auto& s : j )
 	{
-		script.uri = s["uri"].get<std::string>();
+		init_script( s, scripts.emplace_back() );
+	}
+}
 
-		if ( s.count( "name" ) )
-		{
-			script.name = s["name"].get<std::string>();
-		}
-		else
-		{
-			script.name = script.uri;
-		}
 
-		scripts.push_back( script );
+void Gltf::init_script( const nlohmann::json& s, Script& script )
+{
+	script.uri = s["uri"].get<std::string>();
+
+	if ( s.count( "name" ) )
+	{
+		script.name = s["name"].get<std::string>();
+	}
+	else
+	{
+		script.name = script.uri;
 	}
 }
 
@@ -1288,6 +1670,27 @@ Handle<Mesh> Gltf::create_mesh( Mesh&& m )
 }
 
 
+Handle<Accessor> Gltf::create_accessor( std::vector<char> bytes, const Accessor::ComponentType component_type,
+	const Accessor::Type type, const size_t count, const BufferView::Target target )
+{
+	auto buffer = buffers.push();
+	buffer->byte_length = bytes.size();
+	buffer->data = std::move( bytes );
+
+	auto view = buffer_views.push();
+	view->buffer = buffer;
+	view->byte_length = buffer->byte_length;
+	view->target = target;
+
+	auto accessor = accessors.push();
+	accessor->buffer_view = view;
+	accessor->component_type = component_type;
+	accessor->type = type;
+	accessor->count = count;
+	return accessor;
+}
+
+
 Bounds* Gltf::get_bounds( int32_t index )
 {
 	if ( index >= 0 && index < bounds.size() )
@@ -1317,6 +1720,248 @@ Shape* Gltf::get_shape( int32_t index )
 }
 
 
+void Gltf::prefetch()
+{
+	parallel_for( buffers->size(), options.load_threads,
+		[this]( size_t i ) { load_buffer( ( *buffers )[i] ); } );
+}
+
+
+void Gltf::prefetch( const std::vector<Handle<ByteBuffer>>& handles )
+{
+	parallel_for( handles.size(), options.load_threads,
+		[this, &handles]( size_t i ) { load_buffer( *handles[i] ); } );
+}
+
+
+void Gltf::enter( const LoadProgress::Stage stage ) const
+{
+	if ( options.progress )
+	{
+		options.progress->enter( stage );
+	}
+}
+
+
+void Gltf::load_buffer( ByteBuffer& buffer )
+{
+	if ( !options.progress )
+	{
+		buffer.load();
+		return;
+	}
+
+	options.progress->check();
+	if ( !buffer.is_loaded() )
+	{
+		buffer.load();
+		options.progress->bytes_loaded += buffer.byte_length;
+	}
+}
+
+
+std::future<void> Gltf::start_loading_buffers()
+{
+	// A partial load only loads used buffers, once the model is read
+	if ( options.lazy_buffers || options.is_partial() )
+	{
+		return {};
+	}
+
+	if ( options.load_threads > 0 )
+	{
+		return parallel_for_async( buffers->size(), options.load_threads,
+			[this]( size_t i ) { load_buffer( ( *buffers )[i] ); } );
+	}
+
+	// Buffers were made lazy only to report their progress
+	if ( options.progress )
+	{
+		prefetch();
+	}
+	return {};
+}
+
+
+void Gltf::select_scenes( const size_t scene_index )
+{
+	if ( scene_index >= scenes.size() )
+	{
+		throw std::runtime_error{ "Scene not valid: " + std::to_string( scene_index ) };
+	}
+
+	if ( options.scenes.empty() )
+	{
+		scene = &scenes[scene_index];
+		return;
+	}
+
+	// Keep the selected scenes in the order they are asked for
+	std::vector<Scene> selected;
+	selected.reserve( options.scenes.size() );
+	size_t current = 0;
+	for ( auto index : options.scenes )
+	{
+		if ( index >= scenes.size() )
+		{
+			throw std::runtime_error{ "Scene not valid: " + std::to_string( index ) };
+		}
+		if ( index == scene_index )
+		{
+			current = selected.size();
+		}
+		selected.push_back( std::move( scenes[index] ) );
+	}
+
+	scenes = std::move( selected );
+	scene  = &scenes[current];
+}
+
+
+std::vector<Handle<ByteBuffer>> Gltf::get_used_buffers()
+{
+	std::vector<bool> used_accessors( accessors->size() );
+	std::vector<bool> used_views( buffer_views->size() );
+
+	auto use_mesh = [&used_accessors]( const Mesh& mesh ) {
+		for ( auto& primitive : mesh.primitives )
+		{
+			for ( auto& [semantic, accessor] : primitive.attributes )
+			{
+				used_accessors[accessor.get_index()] = true;
+			}
+			if ( primitive.indices_handle )
+			{
+				used_accessors[primitive.indices_handle.get_index()] = true;
+			}
+		}
+	};
+
+	// Meshes of the nodes of the selected scenes, or all of them
+	if ( !options.scenes.empty() && options.sections.scenes )
+	{
+		std::vector<bool> visited( nodes->size() );
+		std::vector<Handle<Node>> stack;
+		for ( auto& s : scenes )
+		{
+			stack.insert( stack.end(), s.nodes.begin(), s.nodes.end() );
+		}
+
+		while ( !stack.empty() )
+		{
+			auto node = stack.back();
+			stack.pop_back();
+			if ( visited[node.get_index()] )
+			{
+				continue;
+			}
+			visited[node.get_index()] = true;
+
+			if ( node->mesh )
+			{
+				use_mesh( *node->mesh );
+			}
+			stack.insert( stack.end(), node->children.begin(), node->children.end() );
+		}
+	}
+	else
+	{
+		for ( auto& mesh : *meshes )
+		{
+			use_mesh( mesh );
+		}
+	}
+
+	for ( auto& animation : animations )
+	{
+		for ( auto& sampler : *animation.samplers )
+		{
+			used_accessors[sampler.input.get_index()] = true;
+			used_accessors[sampler.output.get_index()] = true;
+		}
+	}
+
+	for ( size_t i = 0; i < used_accessors.size(); ++i )
+	{
+		auto& accessor = ( *accessors )[i];
+		if ( used_accessors[i] && accessor.buffer_view )
+		{
+			used_views[accessor.buffer_view.get_index()] = true;
+		}
+		if ( used_accessors[i] && accessor.sparse )
+		{
+			for ( auto& view : { accessor.sparse->indices.buffer_view, accessor.sparse->values.buffer_view } )
+			{
+				if ( view )
+				{
+					used_views[view.get_index()] = true;
+				}
+			}
+		}
+	}
+
+	// Images stored in a buffer view
+	for ( auto& image : *images )
+	{
+		if ( image.uri.empty() && !image.data.data && image.buffer_view < used_views.size() )
+		{
+			used_views[image.buffer_view] = true;
+		}
+	}
+
+	std::vector<bool> used( buffers->size() );
+	for ( size_t i = 0; i < used_views.size(); ++i )
+	{
+		auto& view = ( *buffer_views )[i];
+		if ( used_views[i] && view.buffer )
+		{
+			used[view.buffer.get_index()] = true;
+		}
+	}
+
+	std::vector<Handle<ByteBuffer>> ret;
+	for ( size_t i = 0; i < used.size(); ++i )
+	{
+		if ( used[i] )
+		{
+			ret.emplace_back( buffers, i );
+		}
+	}
+	return ret;
+}
+
+
+void Gltf::load_used_buffers()
+{
+	if ( options.lazy_buffers || !options.is_partial() )
+	{
+		return;
+	}
+
+	auto used = get_used_buffers();
+	if ( options.progress )
+	{
+		for ( auto& buffer : used )
+		{
+			if ( !buffer->is_loaded() )
+			{
+				options.progress->bytes_total += buffer->byte_length;
+			}
+		}
+	}
+	prefetch( used );
+}
+
+
+void Gltf::convert_topology()
+{
+	if ( options.list_topology )
+	{
+		convert_to_lists( *this, options.load_threads );
+	}
+}
+
+
 Accessor* Gltf::get_accessor( const size_t accessor )
 {
 	if ( accessor < accessors->size() )
@@ -1331,40 +1976,229 @@ void Gltf::init_scenes( const nlohmann::json& j )
 {
 	for ( const auto& s : j )
 	{
-		Scene scene;
-		scene.model = this;
+		init_scene( s, scenes.emplace_back() );
+	}
+
+	load_nodes();
+}
+
 
-		// Name
-		if ( s.count( "name" ) )
+void Gltf::init_scene( const nlohmann::json& s, Scene& scene )
+{
+	scene.model = this;
+
+	// Name
+	if ( s.count( "name" ) )
+	{
+		scene.name = s["name"].get<std::string>();
+	}
+
+	// Nodes
+	if ( s.count( "nodes" ) )
+	{
+		auto indices = s["nodes"].get<std::vector<size_t>>();
+		scene.nodes.resize( indices.size() );
+		for ( size_t i = 0; i < indices.size(); ++i )
 		{
-			scene.name = s["name"].get<std::string>();
+			scene.nodes[i] = Handle<Node>( nodes, indices[i] );
 		}
+	}
+}
+
 
-		// Nodes
-		if ( s.count( "nodes" ) )
+/// @return The little endian 32 bit value at that position
+uint32_t read_u32( const char* data )
+{
+	uint32_t value;
+	std::memcpy( &value, data, sizeof( value ) );
+	return value;
+}
+
+
+/// Checks the GLB header
+/// @return The length of the whole GLB
+size_t check_glb_header( const char* header, const size_t size, const std::string& path )
+{
+	if ( size < glb_header_size || read_u32( header ) != glb_magic )
+	{
+		throw std::runtime_error{ "GLB header not valid: " + path };
+	}
+
+	if ( read_u32( header + 4 ) != glb_version )
+	{
+		throw std::runtime_error{ "GLB version not supported: " + path };
+	}
+
+	size_t length = read_u32( header + 8 );
+	if ( length < glb_header_size )
+	{
+		throw std::runtime_error{ "GLB length not valid: " + path };
+	}
+
+	return length;
+}
+
+
+/// @param chunks GLB bytes following the header
+/// @return A Gltf whose first buffer looks into the BIN chunk
+Gltf load_glb_chunks( const ByteSpan& chunks, const std::string& path, const LoadOptions& options )
+{
+	const char* json_data = nullptr;
+	size_t json_length = 0;
+	ByteSpan bin;
+
+	// Walk the chunks, skipping unknown ones
+	size_t offset = 0;
+	while ( offset + glb_chunk_header_size <= chunks.size )
+	{
+		size_t chunk_length = read_u32( chunks.data + offset );
+		auto chunk_type = read_u32( chunks.data + offset + 4 );
+		offset += glb_chunk_header_size;
+
+		if ( chunk_length > chunks.size - offset )
 		{
-			auto indices = s["nodes"].get<std::vector<size_t>>();
-			scene.nodes.resize( indices.size() );
-			for ( size_t i = 0; i < indices.size(); ++i )
-			{
-				scene.nodes[i] = Handle<Node>( nodes, indices[i] );
-			}
+			throw std::runtime_error{ "GLB chunk exceeds file length: " + path };
 		}
 
-		scenes.push_back( scene );
+		if ( chunk_type == glb_chunk_json && !json_data )
+		{
+			json_data = chunks.data + offset;
+			json_length = chunk_length;
+		}
+		else if ( chunk_type == glb_chunk_bin && !bin.data )
+		{
+			// Share ownership of the whole file with the buffer
+			bin.data = chunks.data + offset;
+			bin.size = chunk_length;
+			bin.owner = chunks.owner;
+		}
+
+		offset += chunk_length;
 	}
 
-	load_nodes();
+	if ( !json_data )
+	{
+		throw std::runtime_error{ "GLB without JSON chunk: " + path };
+	}
+
+	auto text = ByteSpan{ json_data, json_length };
+	return Gltf::parse( text, path, options, std::move( bin ) );
+}
+
+
+Gltf Gltf::parse( const ByteSpan& text, const std::string& path, const LoadOptions& options, ByteSpan bin )
+{
+	if ( options.progress )
+	{
+		options.progress->enter( LoadProgress::Stage::Json );
+	}
+
+	switch ( options.parser )
+	{
+	case LoadOptions::Parser::Sax:
+		return load_streaming( text, path, options, std::move( bin ) );
+	case LoadOptions::Parser::Tokenizer:
+		return load_tokenized( text, path, options, std::move( bin ) );
+	default:
+		auto js = nlohmann::json::parse( text.data, text.data + text.size );
+		return Gltf( js, path, options, std::move( bin ) );
+	}
+}
+
+
+Gltf Gltf::load_glb( ByteSpan glb, const std::string& path, const LoadOptions& options )
+{
+	auto length = check_glb_header( glb.data, glb.size, path );
+	if ( length > glb.size )
+	{
+		throw std::runtime_error{ "GLB truncated: " + path };
+	}
+	glb.data += glb_header_size;
+	glb.size = length - glb_header_size;
+	return load_glb_chunks( glb, path, options );
+}
+
+
+Gltf Gltf::load_from_memory( ByteSpan bytes, const LoadOptions& options )
+{
+	// GLB containers start with their magic
+	if ( bytes.size >= glb_header_size && read_u32( bytes.data ) == glb_magic )
+	{
+		return load_glb( std::move( bytes ), ".", options );
+	}
+	return parse( bytes, ".", options );
 }
 
-Gltf Gltf::load( const std::string& path )
+
+std::future<Gltf> Gltf::load_async( const std::string& path, const LoadOptions& options )
 {
+	return std::async( std::launch::async, [path, options] { return load( path, options ); } );
+}
+
+
+std::future<Gltf> Gltf::load_from_memory_async( ByteSpan bytes, const LoadOptions& options )
+{
+	return std::async( std::launch::async,
+		[bytes = std::move( bytes ), options]() mutable { return load_from_memory( std::move( bytes ), options ); } );
+}
+
+
+/// @return Whether the path ends with the extension
+bool has_extension( const std::string& path, const std::string& ext )
+{
+	return path.size() >= ext.size() &&
+		std::equal( std::rbegin( ext ), std::rend( ext ), std::rbegin( path ),
+			[]( char a, char b ) { return a == std::tolower( static_cast<unsigned char>( b ) ); } );
+}
+
+
+Gltf Gltf::load( const std::string& path, const LoadOptions& options )
+{
+	if ( has_extension( path, ".glb" ) )
+	{
+		if ( options.storage == ByteBuffer::Storage::Map && can_map_files )
+		{
+			// The BIN chunk is used straight from the mapping
+			return load_glb( map_file( path ), path, options );
+		}
+
+		auto in = file::Ifstream( path, std::ios::binary );
+		assert( in.is_open() && "Cannot open glb file" );
+
+		// The header tells the length of the whole file
+		auto header = in.read( glb_header_size );
+		auto length = check_glb_header( header.data(), header.size(), path );
+
+		// Read the chunks once, the BIN chunk is then used in place
+		auto bytes = std::make_shared<std::vector<char>>( in.read( length - glb_header_size ) );
+		if ( size_t( in.gcount() ) != bytes->size() )
+		{
+			throw std::runtime_error{ "GLB truncated: " + path };
+		}
+		auto chunks = ByteSpan{ bytes->data(), bytes->size(), bytes };
+		return load_glb_chunks( chunks, path, options );
+	}
+
 	// read a JSON file
 	auto in = file::Ifstream( path );
 	assert( in.is_open() && "Cannot open gltf file" );
+	if ( options.progress )
+	{
+		options.progress->enter( LoadProgress::Stage::Json );
+	}
+	if ( options.parser == LoadOptions::Parser::Sax )
+	{
+		return load_streaming( in, path, options );
+	}
+	else if ( options.parser == LoadOptions::Parser::Tokenizer )
+	{
+		auto text = std::string( std::istreambuf_iterator<char>( in ), std::istreambuf_iterator<char>() );
+		return load_tokenized( ByteSpan{ text.data(), text.size() }, path, options );
+	}
+
 	nlohmann::json js;
 	in >> js;
-	return Gltf( js, path );
+	return Gltf( js, path, options );
 }
 
 
@@ -1,13 +1,161 @@
 #include "spot/gltf/mesh.h"
 
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <stdexcept>
+
 #include "spot/gltf/gltf.h"
 
 namespace spot::gfx
 {
 
+/// @return The size of an index of that component type
+/// @throw std::runtime_error If the component type is not valid for indices
+size_t get_index_size( const Accessor::ComponentType component_type )
+{
+	switch ( component_type )
+	{
+	case Accessor::ComponentType::UNSIGNED_BYTE: return sizeof( uint8_t );
+	case Accessor::ComponentType::UNSIGNED_SHORT: return sizeof( uint16_t );
+	case Accessor::ComponentType::UNSIGNED_INT: return sizeof( uint32_t );
+	default: throw std::runtime_error{ "Index component type not valid: " + std::to_string( int( component_type ) ) };
+	}
+}
+
+
+Indices::Indices( const std::initializer_list<Index> values )
+{
+	// As get_component_type, the largest value of a width is the restart value glTF forbids
+	auto max = values.size() ? std::max( values ) : 0;
+	if ( max >= std::numeric_limits<uint16_t>::max() )
+	{
+		component_type = Accessor::ComponentType::UNSIGNED_INT;
+		index_size = sizeof( uint32_t );
+	}
+	resize( values.size() );
+	size_t i = 0;
+	for ( auto value : values )
+	{
+		set( i++, value );
+	}
+}
+
+
+Indices::Indices( const Accessor::ComponentType ct, const size_t count )
+: component_type { ct }
+, index_size { spot::gfx::get_index_size( ct ) }
+, bytes( count * index_size )
+{}
+
+
+Accessor::ComponentType Indices::get_component_type( const size_t vertex_count )
+{
+	// The largest index is one less than the count, and must not be the restart value
+	if ( vertex_count <= std::numeric_limits<uint8_t>::max() )
+	{
+		return Accessor::ComponentType::UNSIGNED_BYTE;
+	}
+	if ( vertex_count <= std::numeric_limits<uint16_t>::max() )
+	{
+		return Accessor::ComponentType::UNSIGNED_SHORT;
+	}
+	return Accessor::ComponentType::UNSIGNED_INT;
+}
+
+
+Index Indices::operator[]( const size_t i ) const
+{
+	return visit( [i]( auto indices, size_t ) { return Index( indices[i] ); } );
+}
+
+
+void Indices::set( const size_t i, const Index value )
+{
+	visit( [i, value]( auto indices, size_t ) {
+		using T = std::remove_pointer_t<decltype( indices )>;
+		assert( value <= std::numeric_limits<T>::max() && "Index does not fit" );
+		indices[i] = T( value );
+	} );
+}
+
+
+void Indices::push_back( const Index value )
+{
+	if ( index_size < sizeof( Index ) && value >= ( Index( 1 ) << ( index_size * 8 ) ) - 1 )
+	{
+		convert( value >= std::numeric_limits<uint16_t>::max() ? Accessor::ComponentType::UNSIGNED_INT
+		                                                        : Accessor::ComponentType::UNSIGNED_SHORT );
+	}
+	resize( size() + 1 );
+	set( size() - 1, value );
+}
+
+
+Index Indices::get_max() const
+{
+	return visit( []( auto indices, size_t count ) {
+		Index ret = 0;
+		for ( size_t i = 0; i < count; ++i )
+		{
+			ret = std::max( ret, Index( indices[i] ) );
+		}
+		return ret;
+	} );
+}
+
+
+/// Copies indices from one width to another
+template <typename From, typename To>
+void convert_indices( const From* from, const size_t count, To* to )
+{
+	for ( size_t i = 0; i < count; ++i )
+	{
+		to[i] = To( from[i] );
+	}
+}
+
+
+void Indices::convert( const Accessor::ComponentType ct )
+{
+	auto width = spot::gfx::get_index_size( ct );
+	if ( width == index_size )
+	{
+		component_type = ct;
+		return;
+	}
+
+	// As when narrowing, the largest value of the width is left for primitive restart
+	if ( width < index_size && get_max() >= ( Index( 1 ) << ( width * 8 ) ) - 1 )
+	{
+		throw std::runtime_error{ "Indices do not fit " + std::to_string( width * 8 ) + " bits" };
+	}
+
+	auto ret = Indices( ct, size() );
+	visit( [&ret]( auto from, size_t count ) {
+		ret.visit( [from, count]( auto to, size_t ) { convert_indices( from, count, to ); } );
+	} );
+	*this = std::move( ret );
+}
+
+
+void Indices::narrow( const size_t vertex_count )
+{
+	if ( !empty() && get_max() >= vertex_count )
+	{
+		throw std::runtime_error{ "Index out of " + std::to_string( vertex_count ) + " vertices" };
+	}
+	auto ct = get_component_type( vertex_count );
+	if ( spot::gfx::get_index_size( ct ) < index_size )
+	{
+		convert( ct );
+	}
+}
+
+
 Primitive::Primitive(
 	std::vector<Vertex> v,
-	std::vector<Index> i,
+	Indices i,
 	const Handle<Material>& m
 )
 : vertices { std::move( v ) }
@@ -48,7 +196,7 @@ Mesh Mesh::create_triangle( const math::Vec3& a, const math::Vec3& b, const math
 	vertices[1].p = b;
 	vertices[2].p = c;
 
-	std::vector<Index> indices;
+	Indices indices;
 	if ( material )
 	{
 		indices = { 0, 1, 2 };
@@ -88,7 +236,7 @@ Mesh Mesh::create_rect( const math::Vec3& a, const math::Vec3& b, const Handle<M
 	vertices[2].p = b;
 	vertices[3].p = math::Vec3( a.x, b.y, a.z );
 
-	std::vector<Index> indices;
+	Indices indices;
 	if ( material )
 	{
 		// .---B
@@ -173,6 +321,7 @@ Mesh::Mesh( Mesh&& other )
 : model { other.model }
 , primitives { std::move( other.primitives ) }
 , weights { std::move( other.weights ) }
+, lods { std::move( other.lods ) }
 , name { std::move( other.name ) }
 , extras { other.extras }
 {
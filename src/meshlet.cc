@@ -0,0 +1,415 @@
+#include "spot/gltf/meshlet.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+#include "spot/gltf/assembly.h"
+#include "spot/gltf/gltf.h"
+#include "spot/gltf/parallel.h"
+
+namespace spot::gfx
+{
+
+
+/// Fewest triangles a worker splits, as smaller ranges cost more in meshlets cut at their ends
+constexpr size_t meshlet_range_triangles = size_t( 1 ) << 16;
+
+/// Most triangles a meshlet may be asked for
+constexpr size_t meshlet_max_triangles_limit = 512;
+
+
+/// Splits a range of triangles into meshlets, appending them to out
+/// @param triangles Indices of every triangle
+/// @param first First triangle of the range
+/// @param count Triangles of the range
+void build_meshlet_range( const std::vector<uint32_t>& triangles, const size_t first, const size_t count,
+	const size_t vertex_count, const size_t max_vertices, const size_t max_triangles, Meshlets& out )
+{
+	auto range = &triangles[first * 3];
+
+	// Triangles of every vertex, and how many of them are left to emit
+	std::vector<uint32_t> live( vertex_count, 0 );
+	for ( size_t i = 0; i < count * 3; ++i )
+	{
+		++live[range[i]];
+	}
+	std::vector<uint32_t> offsets( vertex_count + 1, 0 );
+	std::partial_sum( live.begin(), live.end(), offsets.begin() + 1 );
+	std::vector<uint32_t> faces( count * 3 );
+	{
+		auto fill = offsets;
+		for ( size_t i = 0; i < count * 3; ++i )
+		{
+			faces[fill[range[i]]++] = uint32_t( i / 3 );
+		}
+	}
+
+	std::vector<uint8_t> emitted( count, 0 );
+	std::vector<uint8_t> queued( count, 0 );
+	std::vector<int16_t> slots( vertex_count, -1 );
+	std::vector<uint32_t> candidates;
+	size_t cursor = 0;
+
+	auto current = Meshlet{ uint32_t( out.vertices.size() ), uint32_t( out.triangles.size() ), 0, 0 };
+
+	// Triangles sharing the most vertices with the meshlet come first, then those
+	// whose vertices have fewer triangles left, as they would be left alone.
+	// Both fit in 64 bits whatever the width of size_t
+	auto get_score = [&]( const uint32_t t, size_t& added ) {
+		added = 0;
+		uint64_t left = 0;
+		for ( size_t k = 0; k < 3; ++k )
+		{
+			auto v = range[t * 3 + k];
+			added += slots[v] < 0;
+			left += live[v];
+		}
+		return ( uint64_t( added ) << 32 ) + left;
+	};
+
+	for ( size_t remaining = count; remaining > 0; --remaining )
+	{
+		auto best = ~uint32_t( 0 );
+		auto best_score = ~uint64_t( 0 );
+		for ( size_t i = 0; i < candidates.size(); )
+		{
+			auto t = candidates[i];
+			if ( emitted[t] )
+			{
+				candidates[i] = candidates.back();
+				candidates.pop_back();
+				continue;
+			}
+			size_t added;
+			auto score = get_score( t, added );
+			if ( current.vertex_count + added <= max_vertices && score < best_score )
+			{
+				best = t;
+				best_score = score;
+			}
+			++i;
+		}
+
+		// A full meshlet, or one without neighbours to grow into, is done. The next one
+		// starts from the best neighbour left, or from the next triangle in order
+		if ( current.triangle_count == max_triangles || best == ~uint32_t( 0 ) )
+		{
+			if ( current.triangle_count )
+			{
+				out.meshlets.push_back( current );
+				for ( size_t i = current.vertex_offset; i < out.vertices.size(); ++i )
+				{
+					slots[out.vertices[i]] = -1;
+				}
+				current = Meshlet{ uint32_t( out.vertices.size() ), uint32_t( out.triangles.size() ), 0, 0 };
+			}
+
+			best = ~uint32_t( 0 );
+			best_score = ~uint64_t( 0 );
+			for ( auto t : candidates )
+			{
+				size_t added;
+				auto score = get_score( t, added );
+				if ( !emitted[t] && score < best_score )
+				{
+					best = t;
+					best_score = score;
+				}
+			}
+			for ( auto t : candidates )
+			{
+				queued[t] = 0;
+			}
+			candidates.clear();
+			if ( best == ~uint32_t( 0 ) )
+			{
+				while ( emitted[cursor] )
+				{
+					++cursor;
+				}
+				best = uint32_t( cursor );
+			}
+		}
+
+		for ( size_t k = 0; k < 3; ++k )
+		{
+			auto v = range[best * 3 + k];
+			if ( slots[v] < 0 )
+			{
+				slots[v] = int16_t( current.vertex_count++ );
+				out.vertices.push_back( v );
+				for ( auto f = offsets[v]; f < offsets[v + 1]; ++f )
+				{
+					auto face = faces[f];
+					if ( !emitted[face] && !queued[face] && face != best )
+					{
+						queued[face] = 1;
+						candidates.push_back( face );
+					}
+				}
+			}
+			out.triangles.push_back( uint8_t( slots[v] ) );
+			--live[v];
+		}
+		emitted[best] = 1;
+		++current.triangle_count;
+	}
+
+	if ( current.triangle_count )
+	{
+		out.meshlets.push_back( current );
+	}
+}
+
+
+Meshlets build_meshlets( const Indices& indices, const float* positions, const size_t vertex_count, const size_t stride,
+	const size_t max_vertices, const size_t max_triangles, const uint32_t threads )
+{
+	check_triangles( indices, vertex_count );
+	if ( max_vertices < 3 || max_vertices > 256 || max_triangles < 1 || max_triangles > meshlet_max_triangles_limit )
+	{
+		throw std::runtime_error{ "Meshlet limits not valid: " + std::to_string( max_vertices ) + " vertices, " +
+			std::to_string( max_triangles ) + " triangles" };
+	}
+
+	std::vector<uint32_t> triangles( indices.size() );
+	indices.visit( [&triangles]( auto data, size_t count ) { std::copy( data, data + count, triangles.begin() ); } );
+
+	// Workers split ranges of triangles, then their meshlets are joined in order
+	auto triangle_count = triangles.size() / 3;
+	auto ranges = std::max<size_t>( 1, std::min<size_t>( threads, triangle_count / meshlet_range_triangles ) );
+	std::vector<Meshlets> parts( ranges );
+	parallel_for( ranges, ranges > 1 ? threads : 0, [&]( size_t r ) {
+		auto first = triangle_count * r / ranges;
+		auto last = triangle_count * ( r + 1 ) / ranges;
+		build_meshlet_range( triangles, first, last - first, vertex_count, max_vertices, max_triangles, parts[r] );
+	} );
+
+	Meshlets ret = std::move( parts[0] );
+	for ( size_t r = 1; r < ranges; ++r )
+	{
+		for ( auto meshlet : parts[r].meshlets )
+		{
+			meshlet.vertex_offset += uint32_t( ret.vertices.size() );
+			meshlet.triangle_offset += uint32_t( ret.triangles.size() );
+			ret.meshlets.push_back( meshlet );
+		}
+		ret.vertices.insert( ret.vertices.end(), parts[r].vertices.begin(), parts[r].vertices.end() );
+		ret.triangles.insert( ret.triangles.end(), parts[r].triangles.begin(), parts[r].triangles.end() );
+	}
+
+	ret.bounds.resize( ret.meshlets.size() );
+	parallel_for( ret.meshlets.size(), threads, [&ret, positions, stride]( size_t i ) {
+		auto& meshlet = ret.meshlets[i];
+		ret.bounds[i] = compute_meshlet_bounds( &ret.vertices[meshlet.vertex_offset],
+			&ret.triangles[meshlet.triangle_offset], meshlet.triangle_count, positions, stride );
+	} );
+	return ret;
+}
+
+
+MeshletBounds compute_meshlet_bounds( const uint32_t* vertices, const uint8_t* triangles, const size_t triangle_count,
+	const float* positions, const size_t stride )
+{
+	MeshletBounds ret;
+	if ( triangle_count == 0 )
+	{
+		return ret;
+	}
+	if ( triangle_count > meshlet_max_triangles_limit )
+	{
+		throw std::runtime_error{ "Meshlet triangles not valid: " + std::to_string( triangle_count ) };
+	}
+	auto position_stride = stride ? stride : 3 * sizeof( float );
+	auto get_point = [&]( uint8_t local ) { return get_position( positions, position_stride, vertices[local] ); };
+
+	// Local indices go from zero up, so the vertices are the first entries of the table
+	size_t vertex_count = 0;
+	for ( size_t i = 0; i < triangle_count * 3; ++i )
+	{
+		vertex_count = std::max<size_t>( vertex_count, triangles[i] + 1 );
+	}
+
+	// Sphere of Ritter, from the two points farthest apart along an axis, grown to take the others
+	const float* lowest[3] = { get_point( 0 ), get_point( 0 ), get_point( 0 ) };
+	const float* highest[3] = { lowest[0], lowest[1], lowest[2] };
+	for ( size_t i = 0; i < vertex_count; ++i )
+	{
+		auto p = get_point( uint8_t( i ) );
+		for ( size_t axis = 0; axis < 3; ++axis )
+		{
+			lowest[axis] = p[axis] < lowest[axis][axis] ? p : lowest[axis];
+			highest[axis] = p[axis] > highest[axis][axis] ? p : highest[axis];
+		}
+	}
+	auto get_distance2 = []( const float* a, const float* b ) {
+		return ( a[0] - b[0] ) * ( a[0] - b[0] ) + ( a[1] - b[1] ) * ( a[1] - b[1] ) + ( a[2] - b[2] ) * ( a[2] - b[2] );
+	};
+	size_t widest = 0;
+	for ( size_t axis = 1; axis < 3; ++axis )
+	{
+		if ( get_distance2( lowest[axis], highest[axis] ) > get_distance2( lowest[widest], highest[widest] ) )
+		{
+			widest = axis;
+		}
+	}
+	float center[3];
+	for ( size_t i = 0; i < 3; ++i )
+	{
+		center[i] = ( lowest[widest][i] + highest[widest][i] ) * 0.5f;
+	}
+	auto radius = std::sqrt( get_distance2( lowest[widest], highest[widest] ) ) * 0.5f;
+	for ( size_t i = 0; i < vertex_count; ++i )
+	{
+		auto p = get_point( uint8_t( i ) );
+		auto distance2 = get_distance2( p, center );
+		if ( distance2 > radius * radius )
+		{
+			auto distance = std::sqrt( distance2 );
+			auto grown = ( radius + distance ) * 0.5f;
+			auto k = ( grown - radius ) / distance;
+			for ( size_t j = 0; j < 3; ++j )
+			{
+				center[j] += ( p[j] - center[j] ) * k;
+			}
+			radius = grown;
+		}
+	}
+	ret.center = math::Vec3( center[0], center[1], center[2] );
+	ret.radius = radius;
+
+	// Cone around the mean of the normals, as wide as the normal farthest from it
+	float normals[meshlet_max_triangles_limit * 3];
+	float axis[3] = {};
+	for ( size_t t = 0; t < triangle_count; ++t )
+	{
+		auto a = get_point( triangles[t * 3] );
+		auto b = get_point( triangles[t * 3 + 1] );
+		auto c = get_point( triangles[t * 3 + 2] );
+		float u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		float v[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+		auto n = &normals[t * 3];
+		n[0] = u[1] * v[2] - u[2] * v[1];
+		n[1] = u[2] * v[0] - u[0] * v[2];
+		n[2] = u[0] * v[1] - u[1] * v[0];
+		auto length = std::sqrt( n[0] * n[0] + n[1] * n[1] + n[2] * n[2] );
+		for ( size_t i = 0; i < 3; ++i )
+		{
+			n[i] = length > 0.0f ? n[i] / length : 0.0f;
+			axis[i] += n[i];
+		}
+	}
+	auto axis_length = std::sqrt( axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2] );
+	if ( axis_length == 0.0f )
+	{
+		return ret;
+	}
+	for ( auto& component : axis )
+	{
+		component /= axis_length;
+	}
+
+	auto min_dot = 1.0f;
+	for ( size_t t = 0; t < triangle_count; ++t )
+	{
+		auto n = &normals[t * 3];
+		if ( n[0] != 0.0f || n[1] != 0.0f || n[2] != 0.0f )
+		{
+			min_dot = std::min( min_dot, n[0] * axis[0] + n[1] * axis[1] + n[2] * axis[2] );
+		}
+	}
+	if ( min_dot <= 0.0f )
+	{
+		return ret;
+	}
+
+	// Apex behind the planes of every triangle, along the axis
+	auto max_t = 0.0f;
+	for ( size_t t = 0; t < triangle_count; ++t )
+	{
+		auto n = &normals[t * 3];
+		auto dn = n[0] * axis[0] + n[1] * axis[1] + n[2] * axis[2];
+		if ( dn <= 0.0f )
+		{
+			continue;
+		}
+		auto p = get_point( triangles[t * 3] );
+		auto dc = ( center[0] - p[0] ) * n[0] + ( center[1] - p[1] ) * n[1] + ( center[2] - p[2] ) * n[2];
+		max_t = std::max( max_t, dc / dn );
+	}
+
+	ret.cone_axis = math::Vec3( axis[0], axis[1], axis[2] );
+	ret.cone_apex = math::Vec3( center[0] - axis[0] * max_t, center[1] - axis[1] * max_t, center[2] - axis[2] * max_t );
+	ret.cone_cutoff = std::sqrt( 1.0f - min_dot * min_dot );
+	return ret;
+}
+
+
+Meshlets build_meshlets( Primitive& primitive, const size_t max_vertices, const size_t max_triangles,
+	const uint32_t threads )
+{
+	if ( primitive.mode != Primitive::Mode::TRIANGLES )
+	{
+		return {};
+	}
+
+	auto source = get_positions( primitive );
+	if ( !source.data )
+	{
+		return {};
+	}
+	auto positions = source.data;
+	auto vertex_count = source.count;
+	auto stride = source.stride;
+
+	if ( primitive.indices.empty() )
+	{
+		assemble_indices( primitive );
+	}
+	if ( !primitive.indices.empty() )
+	{
+		return build_meshlets( primitive.indices, positions, vertex_count, stride, max_vertices, max_triangles, threads );
+	}
+
+	auto indices = Indices( Indices::get_component_type( vertex_count ), vertex_count );
+	for ( size_t i = 0; i < vertex_count; ++i )
+	{
+		indices.set( i, Index( i ) );
+	}
+	return build_meshlets( indices, positions, vertex_count, stride, max_vertices, max_triangles, threads );
+}
+
+
+std::vector<Meshlets> build_meshlets(
+	Gltf& model, const uint32_t threads, const size_t max_vertices, const size_t max_triangles )
+{
+	auto primitives = get_primitives( model );
+	std::vector<Meshlets> ret( primitives.size() );
+
+	// Small primitives are split concurrently, large ones one after the other by all the workers
+	auto is_large = [threads]( const Primitive& primitive ) {
+		auto count = primitive.indices.empty() && primitive.indices_handle ? primitive.indices_handle->count
+		                                                                    : primitive.indices.size();
+		return threads > 1 && count / 3 >= 2 * meshlet_range_triangles;
+	};
+	parallel_for( primitives.size(), threads, [&]( size_t i ) {
+		if ( !is_large( *primitives[i] ) )
+		{
+			ret[i] = build_meshlets( *primitives[i], max_vertices, max_triangles );
+		}
+	} );
+	for ( size_t i = 0; i < primitives.size(); ++i )
+	{
+		if ( is_large( *primitives[i] ) )
+		{
+			ret[i] = build_meshlets( *primitives[i], max_vertices, max_triangles, threads );
+		}
+	}
+	return ret;
+}
+
+
+} // namespace spot::gfx
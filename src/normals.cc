@@ -0,0 +1,473 @@
+#include "spot/gltf/normals.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "spot/gltf/assembly.h"
+#include "spot/gltf/decode.h"
+#include "spot/gltf/gltf.h"
+#include "spot/gltf/parallel.h"
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define GST_NORMALS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace spot::gfx
+{
+
+
+/// Weighted sum of vectors at a vertex, padded to four floats so a vector is added with a single SSE addition
+struct alignas( 16 ) VectorSum
+{
+	void add( const float* v, const float weight )
+	{
+#ifdef GST_NORMALS_SSE2
+		auto sum = _mm_load_ps( values );
+		sum = _mm_add_ps( sum, _mm_mul_ps( _mm_set_ps( 0.0f, v[2], v[1], v[0] ), _mm_set1_ps( weight ) ) );
+		_mm_store_ps( values, sum );
+#else
+		values[0] += v[0] * weight;
+		values[1] += v[1] * weight;
+		values[2] += v[2] * weight;
+#endif
+	}
+
+	float values[4] = {};
+};
+
+
+float dot3( const float* a, const float* b )
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+
+void cross3( const float* a, const float* b, float* out )
+{
+	out[0] = a[1] * b[2] - a[2] * b[1];
+	out[1] = a[2] * b[0] - a[0] * b[2];
+	out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+
+/// Scales a vector to unit length
+/// @return Whether the vector was long enough to be scaled
+bool normalize3( float* v )
+{
+	auto length = std::sqrt( dot3( v, v ) );
+	if ( length <= 1e-20f )
+	{
+		return false;
+	}
+	auto inverse = 1.0f / length;
+	v[0] *= inverse;
+	v[1] *= inverse;
+	v[2] *= inverse;
+	return true;
+}
+
+
+/// @return The arc cosine within 7e-5 radians, which weights do not need to beat,
+/// while std::acos would take most of the time of the loops
+float get_weight_angle( const float cosine )
+{
+	auto x = std::min( std::abs( cosine ), 1.0f );
+	auto ret = std::sqrt( 1.0f - x ) * ( 1.5707288f + x * ( -0.2121144f + x * ( 0.0742610f - 0.0187293f * x ) ) );
+	return cosine < 0.0f ? 3.14159265f - ret : ret;
+}
+
+
+/// Removes from a vector its part along a unit normal, leaving its length
+void flatten_on_plane( const float* normal, float* v )
+{
+	auto d = dot3( normal, v );
+	v[0] -= normal[0] * d;
+	v[1] -= normal[1] * d;
+	v[2] -= normal[2] * d;
+}
+
+
+/// Removes from a vector its part along a unit normal, then scales it to unit length
+/// @return Whether something was left to scale
+bool project_on_plane( const float* normal, float* v )
+{
+	flatten_on_plane( normal, v );
+	return normalize3( v );
+}
+
+
+void generate_normals( const Indices& indices, const float* positions, const size_t vertex_count, float* normals,
+	const NormalWeight weight )
+{
+	check_triangles( indices, vertex_count );
+
+	std::vector<VectorSum> sums( vertex_count );
+	indices.visit( [positions, weight, &sums]( auto data, const size_t count ) {
+		for ( size_t i = 0; i < count; i += 3 )
+		{
+			const float* p[3] = { positions + data[i] * 3, positions + data[i + 1] * 3, positions + data[i + 2] * 3 };
+
+			// Edges going around the triangle, the one leaving each corner
+			float edges[3][3];
+			for ( size_t k = 0; k < 3; ++k )
+			{
+				auto next = p[( k + 1 ) % 3];
+				edges[k][0] = next[0] - p[k][0];
+				edges[k][1] = next[1] - p[k][1];
+				edges[k][2] = next[2] - p[k][2];
+			}
+
+			// As long as twice the area of the triangle
+			float normal[3];
+			cross3( edges[0], edges[1], normal );
+			if ( weight == NormalWeight::Area )
+			{
+				for ( size_t k = 0; k < 3; ++k )
+				{
+					sums[data[i + k]].add( normal, 1.0f );
+				}
+				continue;
+			}
+
+			float lengths[3] = { std::sqrt( dot3( edges[0], edges[0] ) ), std::sqrt( dot3( edges[1], edges[1] ) ),
+				std::sqrt( dot3( edges[2], edges[2] ) ) };
+			if ( !normalize3( normal ) )
+			{
+				continue;
+			}
+			for ( size_t k = 0; k < 3; ++k )
+			{
+				// Between the edge leaving the corner and the one coming in, reversed
+				auto previous = ( k + 2 ) % 3;
+				auto cosine = -dot3( edges[k], edges[previous] ) / ( lengths[k] * lengths[previous] );
+				sums[data[i + k]].add( normal, get_weight_angle( cosine ) );
+			}
+		}
+	} );
+
+	for ( size_t v = 0; v < vertex_count; ++v )
+	{
+		auto n = normals + v * 3;
+		std::memcpy( n, sums[v].values, 3 * sizeof( float ) );
+		if ( !normalize3( n ) )
+		{
+			n[0] = 0.0f;
+			n[1] = 0.0f;
+			n[2] = 1.0f;
+		}
+	}
+}
+
+
+void generate_tangents( const Indices& indices, const float* positions, const float* normals, const float* texcoords,
+	const size_t vertex_count, float* tangents )
+{
+	check_triangles( indices, vertex_count );
+
+	std::vector<VectorSum> tangent_sums( vertex_count );
+	std::vector<VectorSum> bitangent_sums( vertex_count );
+	indices.visit( [&]( auto data, const size_t count ) {
+		for ( size_t i = 0; i < count; i += 3 )
+		{
+			Index v[3] = { data[i], data[i + 1], data[i + 2] };
+			const float* p[3] = { positions + v[0] * 3, positions + v[1] * 3, positions + v[2] * 3 };
+			const float* t[3] = { texcoords + v[0] * 2, texcoords + v[1] * 2, texcoords + v[2] * 2 };
+
+			float e1[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+			float e2[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+			auto du1 = t[1][0] - t[0][0];
+			auto dv1 = t[1][1] - t[0][1];
+			auto du2 = t[2][0] - t[0][0];
+			auto dv2 = t[2][1] - t[0][1];
+
+			// Directions of the texture axes on the triangle, as MikkTSpace keeps only
+			// their orientation, leaving out the magnitude of the texture mapping
+			auto area = du1 * dv2 - du2 * dv1;
+			if ( area == 0.0f )
+			{
+				continue;
+			}
+			auto sign = area > 0.0f ? 1.0f : -1.0f;
+			float os[3];
+			float ot[3];
+			for ( size_t c = 0; c < 3; ++c )
+			{
+				os[c] = ( e1[c] * dv2 - e2[c] * dv1 ) * sign;
+				ot[c] = ( e2[c] * du1 - e1[c] * du2 ) * sign;
+			}
+
+			// Only the side of the bitangent matters, which projecting it on the normals would not change
+			auto has_bitangent = normalize3( ot );
+
+			for ( size_t k = 0; k < 3; ++k )
+			{
+				auto n = normals + v[k] * 3;
+				auto next = p[( k + 1 ) % 3];
+				auto previous = p[( k + 2 ) % 3];
+				float a[3] = { next[0] - p[k][0], next[1] - p[k][1], next[2] - p[k][2] };
+				float b[3] = { previous[0] - p[k][0], previous[1] - p[k][1], previous[2] - p[k][2] };
+				flatten_on_plane( n, a );
+				flatten_on_plane( n, b );
+				auto lengths = dot3( a, a ) * dot3( b, b );
+				float tangent[3] = { os[0], os[1], os[2] };
+				if ( lengths <= 1e-30f || !project_on_plane( n, tangent ) )
+				{
+					continue;
+				}
+
+				auto angle = get_weight_angle( dot3( a, b ) / std::sqrt( lengths ) );
+				tangent_sums[v[k]].add( tangent, angle );
+				if ( has_bitangent )
+				{
+					bitangent_sums[v[k]].add( ot, angle );
+				}
+			}
+		}
+	} );
+
+	for ( size_t v = 0; v < vertex_count; ++v )
+	{
+		auto n = normals + v * 3;
+		auto tangent = tangents + v * 4;
+		std::memcpy( tangent, tangent_sums[v].values, 3 * sizeof( float ) );
+		if ( !project_on_plane( n, tangent ) )
+		{
+			// Any direction on the plane, crossing the axis least aligned with the normal
+			float axis[3] = {};
+			auto x = std::abs( n[0] );
+			auto y = std::abs( n[1] );
+			auto z = std::abs( n[2] );
+			axis[x <= y && x <= z ? 0 : y <= z ? 1 : 2] = 1.0f;
+			cross3( axis, n, tangent );
+			if ( !normalize3( tangent ) )
+			{
+				tangent[0] = 1.0f;
+				tangent[1] = 0.0f;
+				tangent[2] = 0.0f;
+			}
+		}
+
+		// MikkTSpace bitangents follow texture coordinates from the bottom left,
+		// those of glTF point the other way as they start from the top left
+		float bitangent[3];
+		cross3( n, tangent, bitangent );
+		tangent[3] = dot3( bitangent, bitangent_sums[v].values ) > 0.0f ? -1.0f : 1.0f;
+	}
+}
+
+
+/// Positions and indices of a triangle list primitive, which normals and tangents are generated from
+struct TangentSource
+{
+	/// Three floats for every vertex
+	std::vector<float> positions;
+
+	size_t vertex_count = 0;
+
+	/// Indices of the primitive, or of its vertices in order when it has none
+	const Indices* indices = nullptr;
+
+	Indices sequential;
+};
+
+
+/// Reads the positions of a primitive from its runtime vertices, or decodes them from
+/// their accessor, loading its indices when it has none in memory
+/// @return Whether the primitive is a triangle list with positions
+/// @throw std::runtime_error If the positions or indices can not be read
+bool get_tangent_source( Primitive& primitive, TangentSource& source )
+{
+	if ( primitive.mode != Primitive::Mode::TRIANGLES )
+	{
+		return false;
+	}
+
+	auto positions = get_positions( primitive );
+	if ( !positions.data )
+	{
+		return false;
+	}
+	source.vertex_count = positions.count;
+	source.positions = std::move( positions.decoded );
+
+	// Positions of runtime vertices are packed, as the kernels read them
+	if ( source.positions.empty() )
+	{
+		source.positions.resize( source.vertex_count * 3 );
+		for ( size_t v = 0; v < source.vertex_count; ++v )
+		{
+			std::memcpy( &source.positions[v * 3], get_position( positions.data, positions.stride, v ), 3 * sizeof( float ) );
+		}
+	}
+
+	if ( primitive.indices.empty() )
+	{
+		assemble_indices( primitive );
+	}
+	source.indices = &primitive.indices;
+	if ( primitive.indices.empty() && !primitive.indices_handle )
+	{
+		source.sequential = Indices( Indices::get_component_type( source.vertex_count ), source.vertex_count );
+		for ( size_t i = 0; i < source.vertex_count; ++i )
+		{
+			source.sequential.set( i, Index( i ) );
+		}
+		source.indices = &source.sequential;
+	}
+	return true;
+}
+
+
+/// @return The elements of an attribute decoded into floats, empty when the primitive does not have it
+/// @throw std::runtime_error If the attribute is not of the type or has fewer elements than the vertices
+std::vector<float> decode_tangent_attribute( const Primitive& primitive, const Primitive::Semantic semantic,
+	const Accessor::Type type, const size_t vertex_count )
+{
+	auto it = primitive.attributes.find( semantic );
+	if ( it == primitive.attributes.end() || !it->second )
+	{
+		return {};
+	}
+	auto& accessor = *it->second;
+	if ( accessor.type != type || accessor.count < vertex_count )
+	{
+		throw std::runtime_error{ "Attribute not valid: " + to_string( accessor.type ) + " of " +
+			std::to_string( accessor.count ) };
+	}
+	auto ret = decode_floats( accessor );
+	ret.resize( vertex_count * ( type == Accessor::Type::VEC2 ? 2 : 3 ) );
+	return ret;
+}
+
+
+std::vector<float> generate_normals( Primitive& primitive, const NormalWeight weight )
+{
+	TangentSource source;
+	if ( !get_tangent_source( primitive, source ) )
+	{
+		return {};
+	}
+
+	std::vector<float> ret( source.vertex_count * 3 );
+	generate_normals( *source.indices, source.positions.data(), source.vertex_count, ret.data(), weight );
+	if ( primitive.vertices.size() == source.vertex_count )
+	{
+		for ( size_t v = 0; v < source.vertex_count; ++v )
+		{
+			primitive.vertices[v].n = math::Vec3( ret[v * 3], ret[v * 3 + 1], ret[v * 3 + 2] );
+		}
+	}
+	return ret;
+}
+
+
+std::vector<float> generate_tangents( Primitive& primitive, const std::vector<float>& normals )
+{
+	TangentSource source;
+	if ( !get_tangent_source( primitive, source ) )
+	{
+		return {};
+	}
+
+	// Texture coordinates decoded from their accessor, or of runtime vertices
+	auto count = source.vertex_count;
+	auto texcoords = decode_tangent_attribute( primitive, Primitive::Semantic::TEXCOORD_0, Accessor::Type::VEC2, count );
+	if ( texcoords.empty() && primitive.attributes.empty() )
+	{
+		texcoords.resize( count * 2 );
+		for ( size_t v = 0; v < count; ++v )
+		{
+			texcoords[v * 2] = primitive.vertices[v].t.x;
+			texcoords[v * 2 + 1] = primitive.vertices[v].t.y;
+		}
+	}
+
+	// Quantized normals are not of unit length
+	auto unit_normals = normals;
+	if ( unit_normals.empty() )
+	{
+		unit_normals = decode_tangent_attribute( primitive, Primitive::Semantic::NORMAL, Accessor::Type::VEC3, count );
+	}
+	if ( texcoords.empty() || unit_normals.size() != count * 3 )
+	{
+		return {};
+	}
+	for ( size_t v = 0; v < count; ++v )
+	{
+		normalize3( &unit_normals[v * 3] );
+	}
+
+	std::vector<float> ret( count * 4 );
+	generate_tangents( *source.indices, source.positions.data(), unit_normals.data(), texcoords.data(), count, ret.data() );
+	return ret;
+}
+
+
+/// @return The bytes of floats, to be moved into a new accessor
+std::vector<char> get_float_bytes( const std::vector<float>& floats )
+{
+	std::vector<char> ret( floats.size() * sizeof( float ) );
+	std::memcpy( ret.data(), floats.data(), ret.size() );
+	return ret;
+}
+
+
+GeneratedAttributes generate_normals( Gltf& model, const uint32_t threads, const bool tangents,
+	const NormalWeight weight )
+{
+	auto primitives = get_primitives( model );
+	std::vector<std::vector<float>> normals( primitives.size() );
+	std::vector<std::vector<float>> generated_tangents( primitives.size() );
+	std::vector<char> filled( primitives.size() );
+	parallel_for( primitives.size(), threads, [&]( size_t i ) {
+		// Runtime primitives keep their normals in their vertices, without accessors
+		auto& primitive = *primitives[i];
+		auto& attributes = primitive.attributes;
+		if ( attributes.empty() )
+		{
+			if ( !has_unit_normals( primitive ) )
+			{
+				filled[i] = !generate_normals( primitive, weight ).empty();
+			}
+			return;
+		}
+		if ( !attributes.count( Primitive::Semantic::NORMAL ) )
+		{
+			normals[i] = generate_normals( primitive, weight );
+		}
+		if ( tangents && !attributes.count( Primitive::Semantic::TANGENT ) &&
+			attributes.count( Primitive::Semantic::TEXCOORD_0 ) )
+		{
+			generated_tangents[i] = generate_tangents( primitive, normals[i] );
+		}
+	} );
+
+	// Accessors are added on this thread, as handles can not be pushed concurrently
+	GeneratedAttributes ret;
+	for ( size_t i = 0; i < primitives.size(); ++i )
+	{
+		ret.normals += filled[i];
+		auto& attributes = primitives[i]->attributes;
+		if ( !normals[i].empty() )
+		{
+			attributes[Primitive::Semantic::NORMAL] = model.create_accessor( get_float_bytes( normals[i] ),
+				Accessor::ComponentType::FLOAT, Accessor::Type::VEC3, normals[i].size() / 3, BufferView::Target::ArrayBuffer );
+			++ret.normals;
+		}
+		if ( !generated_tangents[i].empty() )
+		{
+			attributes[Primitive::Semantic::TANGENT] = model.create_accessor( get_float_bytes( generated_tangents[i] ),
+				Accessor::ComponentType::FLOAT, Accessor::Type::VEC4, generated_tangents[i].size() / 4,
+				BufferView::Target::ArrayBuffer );
+			++ret.tangents;
+		}
+	}
+	return ret;
+}
+
+
+} // namespace spot::gfx
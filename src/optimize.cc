@@ -0,0 +1,978 @@
+#include "spot/gltf/optimize.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+#include "spot/gltf/assembly.h"
+#include "spot/gltf/decode.h"
+#include "spot/gltf/gltf.h"
+#include "spot/gltf/parallel.h"
+
+namespace spot::gfx
+{
+
+
+template <typename T>
+VertexCacheStats analyze_vertex_cache( const T* indices, const size_t count, const size_t vertex_count,
+	const size_t cache_size )
+{
+	VertexCacheStats ret;
+	ret.triangles = count / 3;
+
+	// Misses counted when each vertex entered the cache, zero if it never did.
+	// A vertex is still in the cache until cache_size others entered after it
+	std::vector<size_t> entered( vertex_count, 0 );
+	for ( size_t i = 0; i < count; ++i )
+	{
+		auto& vertex_entered = entered[indices[i]];
+		if ( vertex_entered == 0 )
+		{
+			++ret.vertices;
+		}
+		if ( vertex_entered == 0 || ret.transformed - vertex_entered >= cache_size )
+		{
+			vertex_entered = ++ret.transformed;
+		}
+	}
+
+	if ( ret.triangles )
+	{
+		ret.acmr = float( ret.transformed ) / ret.triangles;
+		ret.atvr = float( ret.transformed ) / ret.vertices;
+	}
+	return ret;
+}
+
+
+VertexCacheStats analyze_vertex_cache( const Indices& indices, const size_t vertex_count, const size_t cache_size )
+{
+	check_triangles( indices, vertex_count );
+	return indices.visit( [vertex_count, cache_size]( auto data, size_t count ) {
+		return analyze_vertex_cache( data, count, vertex_count, cache_size );
+	} );
+}
+
+
+/// Triangles around every vertex, in a single array
+struct TriangleAdjacency
+{
+	/// Where the triangles of each vertex start, followed by the end of the last ones
+	std::vector<uint32_t> offsets;
+
+	std::vector<uint32_t> triangles;
+};
+
+
+template <typename T>
+TriangleAdjacency get_triangle_adjacency( const T* indices, const size_t count, const size_t vertex_count )
+{
+	TriangleAdjacency ret;
+	ret.offsets.assign( vertex_count + 1, 0 );
+	for ( size_t i = 0; i < count; ++i )
+	{
+		++ret.offsets[indices[i] + 1];
+	}
+	for ( size_t v = 0; v < vertex_count; ++v )
+	{
+		ret.offsets[v + 1] += ret.offsets[v];
+	}
+
+	ret.triangles.resize( count );
+	auto next = std::vector<uint32_t>( ret.offsets.begin(), ret.offsets.end() - 1 );
+	for ( size_t i = 0; i < count; ++i )
+	{
+		ret.triangles[next[indices[i]]++] = uint32_t( i / 3 );
+	}
+	return ret;
+}
+
+
+/// Tipsify, from Fast Triangle Reordering for Vertex Locality and Reduced Overdraw
+/// by Sander, Nehab and Barczak
+template <typename T>
+void tipsify( T* indices, const size_t count, const size_t vertex_count, const size_t cache_size )
+{
+	auto adjacency = get_triangle_adjacency( indices, count, vertex_count );
+
+	// Triangles not emitted yet around every vertex
+	std::vector<uint32_t> live( vertex_count );
+	for ( size_t v = 0; v < vertex_count; ++v )
+	{
+		live[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+	}
+
+	// A vertex is in the cache while fewer than cache_size vertices entered after it
+	std::vector<size_t> entered( vertex_count, 0 );
+	size_t time = cache_size + 1;
+
+	std::vector<uint8_t> emitted( count / 3, 0 );
+	std::vector<T> ret;
+	ret.reserve( count );
+
+	// Vertices of emitted triangles, most recent last, to restart from when fanning ends
+	std::vector<T> dead_ends;
+	std::vector<T> candidates;
+
+	// Restarts from the input order when recent vertices have nothing left
+	size_t cursor = 0;
+	auto skip_dead_end = [&]() -> int64_t {
+		while ( !dead_ends.empty() )
+		{
+			auto vertex = dead_ends.back();
+			dead_ends.pop_back();
+			if ( live[vertex] )
+			{
+				return vertex;
+			}
+		}
+		for ( ; cursor < count; ++cursor )
+		{
+			if ( live[indices[cursor]] )
+			{
+				return indices[cursor];
+			}
+		}
+		return -1;
+	};
+
+	auto fan = skip_dead_end();
+	while ( fan >= 0 )
+	{
+		candidates.clear();
+		for ( auto t = adjacency.offsets[fan]; t < adjacency.offsets[fan + 1]; ++t )
+		{
+			auto triangle = adjacency.triangles[t];
+			if ( emitted[triangle] )
+			{
+				continue;
+			}
+			emitted[triangle] = 1;
+
+			for ( size_t c = 0; c < 3; ++c )
+			{
+				auto vertex = indices[triangle * 3 + c];
+				ret.push_back( vertex );
+				dead_ends.push_back( vertex );
+				candidates.push_back( vertex );
+				--live[vertex];
+				if ( time - entered[vertex] > cache_size )
+				{
+					entered[vertex] = time++;
+				}
+			}
+		}
+
+		// Fans next around the vertex which entered the cache first, among those
+		// which would still be in the cache after emitting their triangles
+		int64_t next = -1;
+		int64_t best = 0;
+		for ( auto vertex : candidates )
+		{
+			if ( !live[vertex] )
+			{
+				continue;
+			}
+			int64_t priority = 0;
+			if ( time - entered[vertex] + 2 * live[vertex] <= cache_size )
+			{
+				priority = time - entered[vertex];
+			}
+			if ( priority > best )
+			{
+				best = priority;
+				next = vertex;
+			}
+		}
+		fan = next >= 0 ? next : skip_dead_end();
+	}
+
+	std::copy( ret.begin(), ret.end(), indices );
+}
+
+
+void optimize_vertex_cache( Indices& indices, const size_t vertex_count, const size_t cache_size )
+{
+	check_triangles( indices, vertex_count );
+	if ( indices.size() < 6 )
+	{
+		return;
+	}
+	indices.visit( [vertex_count, cache_size]( auto data, size_t count ) {
+		tipsify( data, count, vertex_count, cache_size );
+	} );
+}
+
+
+VertexCacheReport optimize_vertex_cache( Primitive& primitive, const size_t cache_size )
+{
+	VertexCacheReport ret;
+	if ( primitive.mode != Primitive::Mode::TRIANGLES )
+	{
+		return ret;
+	}
+
+	auto& indices = primitive.indices;
+	if ( indices.empty() )
+	{
+		assemble_indices( primitive );
+	}
+	if ( indices.empty() )
+	{
+		return ret;
+	}
+
+	auto vertex_count = get_vertex_count( primitive );
+	ret.before = analyze_vertex_cache( indices, vertex_count, cache_size );
+	optimize_vertex_cache( indices, vertex_count, cache_size );
+	ret.after = analyze_vertex_cache( indices, vertex_count, cache_size );
+	return ret;
+}
+
+
+std::vector<VertexCacheReport> optimize_vertex_cache( Gltf& model, const uint32_t threads, const size_t cache_size )
+{
+	auto primitives = get_primitives( model );
+	std::vector<VertexCacheReport> ret( primitives.size() );
+	parallel_for( primitives.size(), threads, [&primitives, &ret, cache_size]( size_t i ) {
+		ret[i] = optimize_vertex_cache( *primitives[i], cache_size );
+	} );
+
+	// Accessors are added on this thread, as handles can not be pushed concurrently
+	for ( size_t i = 0; i < primitives.size(); ++i )
+	{
+		if ( primitives[i]->indices_handle && ret[i].after.triangles )
+		{
+			store_indices( model, *primitives[i] );
+		}
+	}
+	return ret;
+}
+
+
+/// @return A hash of bytes mixed into a seed, with FNV-1a over words and then the bytes left
+uint64_t hash_bytes( uint64_t hash, const uint8_t* data, const size_t size )
+{
+	constexpr uint64_t prime = 0x100000001b3;
+	size_t i = 0;
+	for ( ; i + sizeof( uint32_t ) <= size; i += sizeof( uint32_t ) )
+	{
+		uint32_t word;
+		std::memcpy( &word, data + i, sizeof( word ) );
+		hash = ( hash ^ word ) * prime;
+	}
+	for ( ; i < size; ++i )
+	{
+		hash = ( hash ^ data[i] ) * prime;
+	}
+	return hash;
+}
+
+
+/// Open addressing table of vertices, where vertices are equal
+/// when they have the same bytes in every stream
+class VertexTable
+{
+  public:
+	VertexTable( const std::vector<AttributeStream>& s, const size_t vertex_count ) : streams { s }
+	{
+		size_t capacity = 16;
+		while ( capacity < vertex_count * 2 )
+		{
+			capacity *= 2;
+		}
+		slots.assign( capacity, remap_unused );
+	}
+
+	/// Starts bringing the slot of a hash into the cache
+	void prefetch( const uint64_t hash ) const
+	{
+#if defined( __GNUC__ )
+		__builtin_prefetch( &slots[hash & ( slots.size() - 1 )] );
+#endif
+	}
+
+	/// @param hash Hash of the vertex
+	/// @return The first vertex inserted equal to this one, which is inserted if there is none
+	uint32_t insert( const uint32_t vertex, const uint64_t hash )
+	{
+		auto mask = slots.size() - 1;
+		for ( auto slot = hash & mask;; slot = ( slot + 1 ) & mask )
+		{
+			if ( slots[slot] == remap_unused )
+			{
+				slots[slot] = vertex;
+				return vertex;
+			}
+			if ( equal( slots[slot], vertex ) )
+			{
+				return slots[slot];
+			}
+		}
+	}
+
+	uint64_t hash( const uint32_t vertex ) const
+	{
+		uint64_t ret = 0xcbf29ce484222325;
+		for ( auto& stream : streams )
+		{
+			if ( stream.data )
+			{
+				ret = hash_bytes( ret, stream.data + vertex * stream.stride, stream.size );
+			}
+		}
+		// Low bits pick the slot, while multiplications only carry bits upwards,
+		// so every bit is mixed into them as in the splitmix64 finalizer
+		ret = ( ret ^ ( ret >> 30 ) ) * 0xbf58476d1ce4e5b9;
+		ret = ( ret ^ ( ret >> 27 ) ) * 0x94d049bb133111eb;
+		return ret ^ ( ret >> 31 );
+	}
+
+  private:
+	bool equal( const uint32_t a, const uint32_t b ) const
+	{
+		for ( auto& stream : streams )
+		{
+			if ( stream.data &&
+				std::memcmp( stream.data + a * stream.stride, stream.data + b * stream.stride, stream.size ) != 0 )
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	const std::vector<AttributeStream>& streams;
+
+	std::vector<uint32_t> slots;
+};
+
+
+size_t generate_vertex_remap( const std::vector<AttributeStream>& streams, const size_t vertex_count,
+	const Indices* indices, const bool weld, std::vector<uint32_t>& remap )
+{
+	if ( indices && !indices->empty() && indices->get_max() >= vertex_count )
+	{
+		throw std::runtime_error{ "Index out of " + std::to_string( vertex_count ) + " vertices" };
+	}
+
+	remap.assign( vertex_count, remap_unused );
+	uint32_t next = 0;
+	auto table = VertexTable( streams, weld ? vertex_count : 0 );
+	auto use = [&]( const uint32_t vertex, const uint64_t hash ) {
+		if ( remap[vertex] != remap_unused )
+		{
+			return;
+		}
+		if ( weld )
+		{
+			auto first = table.insert( vertex, hash );
+			if ( first != vertex )
+			{
+				remap[vertex] = remap[first];
+				return;
+			}
+		}
+		remap[vertex] = next++;
+	};
+
+	// Vertices hash all over the table, so the slots of a block of them are fetched ahead
+	constexpr size_t block = 16;
+	uint64_t hashes[block] = {};
+	auto use_all = [&]( const size_t count, auto get ) {
+		for ( size_t first = 0; first < count; first += block )
+		{
+			auto size = std::min( block, count - first );
+			for ( size_t i = 0; weld && i < size; ++i )
+			{
+				auto vertex = get( first + i );
+				if ( remap[vertex] == remap_unused )
+				{
+					hashes[i] = table.hash( vertex );
+					table.prefetch( hashes[i] );
+				}
+			}
+			for ( size_t i = 0; i < size; ++i )
+			{
+				use( get( first + i ), hashes[i] );
+			}
+		}
+	};
+
+	if ( indices )
+	{
+		indices->visit( [&use_all]( auto data, size_t count ) {
+			use_all( count, [data]( size_t i ) { return uint32_t( data[i] ); } );
+		} );
+	}
+	else
+	{
+		use_all( vertex_count, []( size_t i ) { return uint32_t( i ); } );
+	}
+	return next;
+}
+
+
+void remap_indices( Indices& indices, const std::vector<uint32_t>& remap )
+{
+	indices.visit( [&remap]( auto data, size_t count ) {
+		using T = std::remove_pointer_t<decltype( data )>;
+		for ( size_t i = 0; i < count; ++i )
+		{
+			data[i] = T( remap[data[i]] );
+		}
+	} );
+}
+
+
+std::vector<char> remap_elements( const AttributeStream& stream, const std::vector<uint32_t>& remap, const size_t count )
+{
+	std::vector<char> ret( count * stream.size, 0 );
+	if ( !stream.data )
+	{
+		return ret;
+	}
+
+	// Duplicates write the same bytes
+	for ( size_t v = 0; v < remap.size(); ++v )
+	{
+		if ( remap[v] != remap_unused )
+		{
+			std::memcpy( ret.data() + remap[v] * stream.size, stream.data + v * stream.stride, stream.size );
+		}
+	}
+	return ret;
+}
+
+
+/// Vertices of a primitive remapped, waiting for the accessors of their attributes
+struct RemappedVertices
+{
+	VertexRemapStats stats;
+
+	/// Elements of every attribute after the remap
+	std::vector<std::pair<Primitive::Semantic, std::vector<char>>> attributes;
+};
+
+
+/// Remaps the runtime vertices and the indices of a primitive, and
+/// the elements of its attributes, without touching the model
+RemappedVertices remap_primitive_vertices( Primitive& primitive, const bool weld )
+{
+	RemappedVertices ret;
+	auto vertex_count = get_vertex_count( primitive );
+	if ( vertex_count == 0 )
+	{
+		return ret;
+	}
+
+	auto& indices = primitive.indices;
+	if ( indices.empty() )
+	{
+		assemble_indices( primitive );
+	}
+
+	std::vector<AttributeStream> streams;
+	for ( auto& [semantic, accessor] : primitive.attributes )
+	{
+		if ( accessor->count < vertex_count )
+		{
+			throw std::runtime_error{ "Attribute " + to_string( semantic ) + " shorter than POSITION" };
+		}
+		auto& stream = streams.emplace_back();
+		stream.size = accessor->get_element_size();
+		if ( accessor->buffer_view || accessor->sparse )
+		{
+			stream.data = reinterpret_cast<const uint8_t*>(
+				check_accessor_view( *accessor, accessor->component_type, accessor->type, stream.size, stream.stride ) );
+		}
+		ret.stats.bytes_before += stream.size * vertex_count;
+	}
+
+	// Fields of runtime vertices are compared apart, leaving out their padding
+	auto& vertices = primitive.vertices;
+	if ( !vertices.empty() )
+	{
+		if ( vertices.size() != vertex_count )
+		{
+			throw std::runtime_error{ "Vertices not matching POSITION: " + std::to_string( vertices.size() ) };
+		}
+		auto& first = vertices[0];
+		streams.push_back( { reinterpret_cast<const uint8_t*>( &first.p ), sizeof( first.p ), sizeof( Vertex ) } );
+		streams.push_back( { reinterpret_cast<const uint8_t*>( &first.n ), sizeof( first.n ), sizeof( Vertex ) } );
+		streams.push_back( { reinterpret_cast<const uint8_t*>( &first.c ), sizeof( first.c ), sizeof( Vertex ) } );
+		streams.push_back( { reinterpret_cast<const uint8_t*>( &first.t ), sizeof( first.t ), sizeof( Vertex ) } );
+		ret.stats.bytes_before += vertex_count * sizeof( Vertex );
+	}
+	ret.stats.bytes_before += indices.get_bytes().size();
+
+	std::vector<uint32_t> remap;
+	auto count = generate_vertex_remap( streams, vertex_count, indices.empty() ? nullptr : &indices, weld, remap );
+
+	size_t s = 0;
+	for ( auto& [semantic, accessor] : primitive.attributes )
+	{
+		ret.attributes.emplace_back( semantic, remap_elements( streams[s++], remap, count ) );
+		ret.stats.bytes_after += ret.attributes.back().second.size();
+	}
+
+	if ( !vertices.empty() )
+	{
+		std::vector<Vertex> remapped( count );
+		for ( size_t v = 0; v < vertex_count; ++v )
+		{
+			if ( remap[v] != remap_unused )
+			{
+				remapped[remap[v]] = vertices[v];
+			}
+		}
+		vertices = std::move( remapped );
+		ret.stats.bytes_after += count * sizeof( Vertex );
+	}
+
+	if ( indices.empty() )
+	{
+		// Vertices drawn in order now go through indices
+		auto component_type = count > std::numeric_limits<uint16_t>::max() ? Accessor::ComponentType::UNSIGNED_INT
+		                                                                   : Accessor::ComponentType::UNSIGNED_SHORT;
+		indices = Indices( component_type, vertex_count );
+		for ( size_t v = 0; v < vertex_count; ++v )
+		{
+			indices.set( v, remap[v] );
+		}
+	}
+	else
+	{
+		remap_indices( indices, remap );
+	}
+	ret.stats.bytes_after += indices.get_bytes().size();
+
+	ret.stats.vertices_before = vertex_count;
+	ret.stats.vertices_after = count;
+	return ret;
+}
+
+
+/// Stores remapped attributes and indices of a primitive in new accessors
+void store_remapped_vertices( Gltf& model, Primitive& primitive, RemappedVertices& remapped )
+{
+	for ( auto& [semantic, bytes] : remapped.attributes )
+	{
+		// Copied, as making an accessor may move the others
+		auto old = *primitive.attributes.at( semantic );
+		auto components = size_of( old.type );
+		if ( old.min.size() == components && old.max.size() == components && remapped.stats.vertices_after )
+		{
+			// Vertices left out may have been the bounds, which are in the values
+			// of the component type, so quantized ones are not normalized
+			std::vector<float> values( remapped.stats.vertices_after * components );
+			decode_components( reinterpret_cast<const uint8_t*>( bytes.data() ), old.get_element_size(),
+				remapped.stats.vertices_after, old.component_type, components, false, values.data() );
+			auto floats = values.data();
+			std::copy( floats, floats + components, old.min.begin() );
+			std::copy( floats, floats + components, old.max.begin() );
+			for ( size_t i = components; i < remapped.stats.vertices_after * components; ++i )
+			{
+				old.min[i % components] = std::min( old.min[i % components], floats[i] );
+				old.max[i % components] = std::max( old.max[i % components], floats[i] );
+			}
+		}
+
+		auto accessor = model.create_accessor( std::move( bytes ), old.component_type, old.type,
+			remapped.stats.vertices_after, BufferView::Target::ArrayBuffer );
+		accessor->normalized = old.normalized;
+		accessor->min = std::move( old.min );
+		accessor->max = std::move( old.max );
+		primitive.attributes[semantic] = accessor;
+	}
+
+	if ( !primitive.attributes.empty() && remapped.stats.vertices_after )
+	{
+		store_indices( model, primitive );
+	}
+}
+
+
+VertexRemapStats optimize_vertex_fetch( Gltf& model, Primitive& primitive, const bool weld )
+{
+	auto remapped = remap_primitive_vertices( primitive, weld );
+	store_remapped_vertices( model, primitive, remapped );
+	return remapped.stats;
+}
+
+
+std::vector<VertexRemapStats> optimize_vertex_fetch( Gltf& model, const uint32_t threads, const bool weld )
+{
+	auto primitives = get_primitives( model );
+	std::vector<RemappedVertices> remapped( primitives.size() );
+	parallel_for( primitives.size(), threads, [&primitives, &remapped, weld]( size_t i ) {
+		remapped[i] = remap_primitive_vertices( *primitives[i], weld );
+	} );
+
+	std::vector<VertexRemapStats> ret;
+	for ( size_t i = 0; i < primitives.size(); ++i )
+	{
+		store_remapped_vertices( model, *primitives[i], remapped[i] );
+		ret.push_back( remapped[i].stats );
+	}
+	return ret;
+}
+
+
+/// Depth buffer counting the fragments passing its test
+struct OverdrawGrid
+{
+	OverdrawGrid( const size_t r ) : resolution { r }, depths( r * r, INFINITY ) {}
+
+	/// Draws a triangle with corners in pixels and depth in [0, 1], culled unless counter-clockwise
+	void draw( const float* a, const float* b, const float* c );
+
+	/// @return The number of pixels drawn
+	size_t get_covered() const;
+
+	size_t resolution;
+
+	std::vector<float> depths;
+
+	size_t shaded = 0;
+};
+
+
+/// @return Twice the signed area of the triangle a, b, p
+float get_edge( const float* a, const float* b, const float px, const float py )
+{
+	return ( b[0] - a[0] ) * ( py - a[1] ) - ( b[1] - a[1] ) * ( px - a[0] );
+}
+
+
+void OverdrawGrid::draw( const float* a, const float* b, const float* c )
+{
+	auto area = get_edge( a, b, c[0], c[1] );
+	if ( area <= 0.0f )
+	{
+		return;
+	}
+
+	// Pixels with their center in the bounds of the triangle
+	auto last = float( resolution - 1 );
+	auto min_x = size_t( std::clamp( std::floor( std::min( { a[0], b[0], c[0] } ) ), 0.0f, last ) );
+	auto max_x = size_t( std::clamp( std::floor( std::max( { a[0], b[0], c[0] } ) ), 0.0f, last ) );
+	auto min_y = size_t( std::clamp( std::floor( std::min( { a[1], b[1], c[1] } ) ), 0.0f, last ) );
+	auto max_y = size_t( std::clamp( std::floor( std::max( { a[1], b[1], c[1] } ) ), 0.0f, last ) );
+	for ( auto y = min_y; y <= max_y; ++y )
+	{
+		for ( auto x = min_x; x <= max_x; ++x )
+		{
+			auto px = x + 0.5f;
+			auto py = y + 0.5f;
+			auto wa = get_edge( b, c, px, py );
+			auto wb = get_edge( c, a, px, py );
+			auto wc = get_edge( a, b, px, py );
+			if ( wa < 0.0f || wb < 0.0f || wc < 0.0f )
+			{
+				continue;
+			}
+
+			auto z = ( wa * a[2] + wb * b[2] + wc * c[2] ) / area;
+			auto& depth = depths[y * resolution + x];
+			if ( z < depth )
+			{
+				depth = z;
+				++shaded;
+			}
+		}
+	}
+}
+
+
+size_t OverdrawGrid::get_covered() const
+{
+	return std::count_if( depths.begin(), depths.end(), []( float depth ) { return depth != INFINITY; } );
+}
+
+
+template <typename T>
+OverdrawStats analyze_overdraw( const T* indices, const size_t count, const float* positions, const size_t stride,
+	const size_t resolution )
+{
+	OverdrawStats ret;
+	if ( count == 0 )
+	{
+		return ret;
+	}
+
+	float min[3] = { INFINITY, INFINITY, INFINITY };
+	float max[3] = { -INFINITY, -INFINITY, -INFINITY };
+	for ( size_t i = 0; i < count; ++i )
+	{
+		auto position = get_position( positions, stride, indices[i] );
+		for ( size_t c = 0; c < 3; ++c )
+		{
+			min[c] = std::min( min[c], position[c] );
+			max[c] = std::max( max[c], position[c] );
+		}
+	}
+	auto extent = std::max( { max[0] - min[0], max[1] - min[1], max[2] - min[2] } );
+	if ( !( extent > 0.0f ) )
+	{
+		return ret;
+	}
+	auto scale = 1.0f / extent;
+
+	// Screen axes are the other two in cyclic order, so counter-clockwise faces the viewer
+	for ( size_t axis = 0; axis < 3; ++axis )
+	{
+		auto u = ( axis + 1 ) % 3;
+		auto v = ( axis + 2 ) % 3;
+		for ( auto against : { false, true } )
+		{
+			auto grid = OverdrawGrid( resolution );
+			for ( size_t i = 0; i < count; i += 3 )
+			{
+				float corners[3][3];
+				for ( size_t c = 0; c < 3; ++c )
+				{
+					auto position = get_position( positions, stride, indices[i + c] );
+					auto nu = ( position[u] - min[u] ) * scale;
+					auto depth = ( position[axis] - min[axis] ) * scale;
+					// Looking against the axis mirrors the screen
+					corners[c][0] = ( against ? 1.0f - nu : nu ) * resolution;
+					corners[c][1] = ( position[v] - min[v] ) * scale * resolution;
+					corners[c][2] = against ? depth : 1.0f - depth;
+				}
+				grid.draw( corners[0], corners[1], corners[2] );
+			}
+			ret.covered += grid.get_covered();
+			ret.shaded += grid.shaded;
+		}
+	}
+
+	if ( ret.covered )
+	{
+		ret.overdraw = float( ret.shaded ) / ret.covered;
+	}
+	return ret;
+}
+
+
+OverdrawStats analyze_overdraw( const Indices& indices, const float* positions, const size_t vertex_count,
+	const size_t stride, const size_t resolution )
+{
+	check_triangles( indices, vertex_count );
+	auto position_stride = stride ? stride : 3 * sizeof( float );
+	return indices.visit( [&]( auto data, size_t count ) {
+		return analyze_overdraw( data, count, positions, position_stride, resolution );
+	} );
+}
+
+
+template <typename T>
+void sort_overdraw_clusters( T* indices, const size_t count, const float* positions, const size_t vertex_count,
+	const size_t stride, const float threshold, const size_t cache_size )
+{
+	auto triangle_count = count / 3;
+
+	// Vertices of every triangle missing a FIFO cache
+	std::vector<uint8_t> misses( triangle_count, 0 );
+	std::vector<size_t> entered( vertex_count, 0 );
+	size_t transformed = 0;
+	for ( size_t i = 0; i < count; ++i )
+	{
+		auto& vertex_entered = entered[indices[i]];
+		if ( vertex_entered == 0 || transformed - vertex_entered >= cache_size )
+		{
+			vertex_entered = ++transformed;
+			++misses[i / 3];
+		}
+	}
+
+	// Clusters start where the cache restarts, with every vertex of a triangle missing,
+	// and then wherever their miss ratio gets within threshold of the one of the restart
+	std::vector<size_t> clusters;
+	for ( size_t begin = 0; begin < triangle_count; )
+	{
+		auto end = begin + 1;
+		size_t restart_misses = misses[begin];
+		for ( ; end < triangle_count && misses[end] < 3; ++end )
+		{
+			restart_misses += misses[end];
+		}
+
+		// Misses are counted again from an empty cache at the start of every cluster, as that
+		// is where they may end up, so clusters grow until their first misses are paid off
+		auto cluster_threshold = threshold * restart_misses / ( end - begin );
+		clusters.push_back( begin );
+		size_t cluster_misses = 0;
+		auto cluster_start = transformed;
+		for ( auto t = begin, start = begin; t + 1 < end; ++t )
+		{
+			for ( size_t c = 0; c < 3; ++c )
+			{
+				auto& vertex_entered = entered[indices[t * 3 + c]];
+				if ( vertex_entered <= cluster_start || transformed - vertex_entered >= cache_size )
+				{
+					vertex_entered = ++transformed;
+					++cluster_misses;
+				}
+			}
+			if ( float( cluster_misses ) / ( t + 1 - start ) <= cluster_threshold )
+			{
+				clusters.push_back( t + 1 );
+				start = t + 1;
+				cluster_misses = 0;
+				cluster_start = transformed;
+			}
+		}
+		begin = end;
+	}
+	clusters.push_back( triangle_count );
+
+	// Area weighted centroid and normal of every cluster, and of the mesh
+	auto cluster_count = clusters.size() - 1;
+	std::vector<std::array<float, 7>> sums( cluster_count );
+	float mesh_centroid[3] = {};
+	float mesh_area = 0.0f;
+	for ( size_t k = 0; k < cluster_count; ++k )
+	{
+		auto& sum = sums[k];
+		sum.fill( 0.0f );
+		for ( auto t = clusters[k]; t < clusters[k + 1]; ++t )
+		{
+			auto a = get_position( positions, stride, indices[t * 3] );
+			auto b = get_position( positions, stride, indices[t * 3 + 1] );
+			auto c = get_position( positions, stride, indices[t * 3 + 2] );
+			float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+			float normal[3] = { ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0] };
+			auto area = std::sqrt( normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2] );
+			for ( size_t i = 0; i < 3; ++i )
+			{
+				sum[i] += area * ( a[i] + b[i] + c[i] ) / 3.0f;
+				sum[3 + i] += normal[i];
+			}
+			sum[6] += area;
+		}
+		for ( size_t i = 0; i < 3; ++i )
+		{
+			mesh_centroid[i] += sum[i];
+		}
+		mesh_area += sum[6];
+	}
+	if ( mesh_area > 0.0f )
+	{
+		for ( auto& coordinate : mesh_centroid )
+		{
+			coordinate /= mesh_area;
+		}
+	}
+
+	// Clusters facing away from the center are more likely to occlude the others
+	std::vector<float> keys( cluster_count, 0.0f );
+	for ( size_t k = 0; k < cluster_count; ++k )
+	{
+		auto& sum = sums[k];
+		auto length = std::sqrt( sum[3] * sum[3] + sum[4] * sum[4] + sum[5] * sum[5] );
+		if ( sum[6] > 0.0f && length > 0.0f )
+		{
+			for ( size_t i = 0; i < 3; ++i )
+			{
+				keys[k] += ( sum[i] / sum[6] - mesh_centroid[i] ) * sum[3 + i] / length;
+			}
+		}
+	}
+
+	std::vector<size_t> order( cluster_count );
+	std::iota( order.begin(), order.end(), 0 );
+	std::stable_sort( order.begin(), order.end(), [&keys]( size_t a, size_t b ) { return keys[a] > keys[b]; } );
+
+	std::vector<T> ret;
+	ret.reserve( count );
+	for ( auto k : order )
+	{
+		ret.insert( ret.end(), indices + clusters[k] * 3, indices + clusters[k + 1] * 3 );
+	}
+	std::copy( ret.begin(), ret.end(), indices );
+}
+
+
+void optimize_overdraw( Indices& indices, const float* positions, const size_t vertex_count, const size_t stride,
+	const float threshold, const size_t cache_size )
+{
+	check_triangles( indices, vertex_count );
+	if ( indices.size() < 6 )
+	{
+		return;
+	}
+	auto position_stride = stride ? stride : 3 * sizeof( float );
+	indices.visit( [&]( auto data, size_t count ) {
+		sort_overdraw_clusters(
+			data, count, positions, vertex_count, position_stride, std::max( threshold, 1.0f ), cache_size );
+	} );
+}
+
+
+OverdrawReport optimize_overdraw( Primitive& primitive, const float threshold, const size_t cache_size )
+{
+	OverdrawReport ret;
+	if ( primitive.mode != Primitive::Mode::TRIANGLES )
+	{
+		return ret;
+	}
+
+	auto& indices = primitive.indices;
+	if ( indices.empty() )
+	{
+		assemble_indices( primitive );
+	}
+	if ( indices.empty() )
+	{
+		return ret;
+	}
+
+	auto source = get_positions( primitive );
+	if ( !source.data )
+	{
+		return ret;
+	}
+	auto positions = source.data;
+	auto vertex_count = source.count;
+	auto stride = source.stride;
+
+	ret.before = analyze_overdraw( indices, positions, vertex_count, stride );
+	ret.cache_before = analyze_vertex_cache( indices, vertex_count, cache_size );
+
+	// Clusters are cut where the cache restarts, which in an unordered list is almost every triangle
+	optimize_vertex_cache( indices, vertex_count, cache_size );
+	optimize_overdraw( indices, positions, vertex_count, stride, threshold, cache_size );
+	ret.after = analyze_overdraw( indices, positions, vertex_count, stride );
+	ret.cache_after = analyze_vertex_cache( indices, vertex_count, cache_size );
+	return ret;
+}
+
+
+std::vector<OverdrawReport> optimize_overdraw( Gltf& model, const uint32_t threads, const float threshold,
+	const size_t cache_size )
+{
+	auto primitives = get_primitives( model );
+	std::vector<OverdrawReport> ret( primitives.size() );
+	parallel_for( primitives.size(), threads, [&primitives, &ret, threshold, cache_size]( size_t i ) {
+		ret[i] = optimize_overdraw( *primitives[i], threshold, cache_size );
+	} );
+
+	for ( size_t i = 0; i < primitives.size(); ++i )
+	{
+		if ( primitives[i]->indices_handle && ret[i].cache_after.triangles )
+		{
+			store_indices( model, *primitives[i] );
+		}
+	}
+	return ret;
+}
+
+
+} // namespace spot::gfx
@@ -0,0 +1,465 @@
+#include <array>
+#include <istream>
+#include <stdexcept>
+
+#include "spot/gltf/gltf.h"
+
+namespace spot::gfx
+{
+
+
+/// Parts of a glTF which are streamed element by element
+enum class Section
+{
+	None,
+	Asset,
+	Buffers,
+	BufferViews,
+	Cameras,
+	Samplers,
+	Images,
+	Textures,
+	Accessors,
+	Materials,
+	Meshes,
+	Lights,
+	Nodes,
+	Animations,
+	Shapes,
+	Scripts,
+	Scenes,
+	Count
+};
+
+
+using SectionCounts = std::array<size_t, size_t( Section::Count )>;
+
+
+/// @return The section of a top level array
+Section top_section( const std::string& key )
+{
+	static const std::pair<const char*, Section> sections[] = {
+		{ "buffers", Section::Buffers },
+		{ "bufferViews", Section::BufferViews },
+		{ "cameras", Section::Cameras },
+		{ "samplers", Section::Samplers },
+		{ "images", Section::Images },
+		{ "textures", Section::Textures },
+		{ "accessors", Section::Accessors },
+		{ "materials", Section::Materials },
+		{ "meshes", Section::Meshes },
+		{ "nodes", Section::Nodes },
+		{ "animations", Section::Animations },
+		{ "scenes", Section::Scenes },
+	};
+
+	for ( auto& [name, section] : sections )
+	{
+		if ( key == name )
+		{
+			return section;
+		}
+	}
+	return Section::None;
+}
+
+
+/// @return Whether a section is read with those options
+bool is_wanted( const Section section, const LoadOptions::Sections& wanted )
+{
+	switch ( section )
+	{
+	case Section::Cameras: return wanted.cameras;
+	case Section::Samplers:
+	case Section::Images:
+	case Section::Textures:
+	case Section::Materials: return wanted.materials;
+	case Section::Meshes: return wanted.meshes;
+	case Section::Lights: return wanted.lights;
+	case Section::Nodes: return wanted.nodes;
+	case Section::Animations: return wanted.animations;
+	case Section::Shapes: return wanted.shapes;
+	case Section::Scripts: return wanted.scripts;
+	case Section::Scenes: return wanted.scenes;
+	default: return true;
+	}
+}
+
+
+/// SAX handler which builds a small json for each element of the glTF arrays,
+/// hands it to the Gltf and throws it away, so the whole DOM never exists.
+/// A first counting pass lets the second one place elements into presized lists,
+/// so handles are valid whatever the order of the sections in the file
+class SaxIngest
+{
+  public:
+	using json = nlohmann::json;
+
+	/// Counting pass
+	/// @param w Sections to read, the others are skipped
+	SaxIngest( const LoadOptions::Sections& w )
+	: wanted { w }
+	{}
+
+	/// Ingesting pass
+	SaxIngest( Gltf& m, const SectionCounts& c, const ByteSpan& b )
+	: model { &m }
+	, bin { b }
+	, wanted { m.options.sections }
+	{
+		presize( c );
+	}
+
+	bool null() { return value( nullptr ); }
+	bool boolean( bool b ) { return value( b ); }
+	bool number_integer( json::number_integer_t n ) { return value( n ); }
+	bool number_unsigned( json::number_unsigned_t n ) { return value( n ); }
+	bool number_float( json::number_float_t n, const json::string_t& ) { return value( n ); }
+	bool string( json::string_t& s ) { return value( std::move( s ) ); }
+	bool binary( json::binary_t& b ) { return value( std::move( b ) ); }
+
+	bool start_object( size_t ) { return start( false ); }
+	bool start_array( size_t ) { return start( true ); }
+	bool end_object() { return end(); }
+	bool end_array() { return end(); }
+
+	bool key( json::string_t& k )
+	{
+		if ( depth > 0 )
+		{
+			pending_key = std::move( k );
+		}
+		else
+		{
+			frames.back().key = std::move( k );
+		}
+		return true;
+	}
+
+	bool parse_error( size_t position, const std::string&, const nlohmann::detail::exception& e )
+	{
+		throw std::runtime_error{ "Json not valid at " + std::to_string( position ) + ": " + e.what() };
+	}
+
+	/// Number of elements found for each section
+	SectionCounts counts = {};
+
+	/// Index of the default scene
+	size_t scene = 0;
+
+  private:
+	/// Container opened outside of an element
+	struct Frame
+	{
+		bool array = false;
+
+		/// Current key of an object
+		std::string key;
+
+		/// Section of an array whose elements are streamed
+		Section section = Section::None;
+	};
+
+	/// @return The section of an array opening at the current position
+	Section array_section() const
+	{
+		for ( auto& frame : frames )
+		{
+			if ( frame.array )
+			{
+				return Section::None;
+			}
+		}
+
+		if ( frames.size() == 1 )
+		{
+			return top_section( frames[0].key );
+		}
+		if ( frames.size() == 2 && frames[0].key == "extras" )
+		{
+			if ( frames[1].key == "shapes" )
+			{
+				return Section::Shapes;
+			}
+			if ( frames[1].key == "scripts" )
+			{
+				return Section::Scripts;
+			}
+		}
+		if ( frames.size() == 3 && frames[0].key == "extensions" &&
+		     frames[1].key == "KHR_lights_punctual" && frames[2].key == "lights" )
+		{
+			return Section::Lights;
+		}
+		return Section::None;
+	}
+
+	/// @return The section of the array containing the current position
+	Section element_section() const
+	{
+		return frames.empty() || !frames.back().array ? Section::None : frames.back().section;
+	}
+
+	/// @return Where a new value goes within the element being built
+	json* place( json&& v )
+	{
+		auto parent = stack.back();
+		if ( parent->is_array() )
+		{
+			parent->push_back( std::move( v ) );
+			return &parent->back();
+		}
+		auto& slot = ( *parent )[pending_key];
+		slot = std::move( v );
+		return &slot;
+	}
+
+	bool value( json&& v )
+	{
+		if ( depth > 0 )
+		{
+			if ( model )
+			{
+				place( std::move( v ) );
+			}
+			return true;
+		}
+
+		if ( auto section = element_section(); section != Section::None )
+		{
+			// Element which is not a container
+			element = std::move( v );
+			finish( section );
+		}
+		else if ( frames.size() == 1 && !frames[0].array && frames[0].key == "scene" && v.is_number() )
+		{
+			scene = v.get<size_t>();
+		}
+		return true;
+	}
+
+	bool start( const bool array )
+	{
+		auto section = Section::None;
+		if ( depth == 0 )
+		{
+			section = element_section();
+			if ( section == Section::None && !array && frames.size() == 1 && frames[0].key == "asset" )
+			{
+				section = Section::Asset;
+			}
+		}
+
+		if ( depth == 0 && section == Section::None )
+		{
+			if ( frames.empty() && array )
+			{
+				throw std::runtime_error{ "Json not valid: glTF root should be an object" };
+			}
+
+			auto streamed = array ? array_section() : Section::None;
+			if ( !is_wanted( streamed, wanted ) )
+			{
+				streamed = Section::None;
+			}
+			auto& frame   = frames.emplace_back();
+			frame.array   = array;
+			frame.section = streamed;
+			return true;
+		}
+
+		// Inside an element
+		if ( depth++ == 0 )
+		{
+			current = section;
+			if ( model )
+			{
+				element = array ? json::array() : json::object();
+				stack = { &element };
+			}
+		}
+		else if ( model )
+		{
+			stack.push_back( place( array ? json::array() : json::object() ) );
+		}
+		return true;
+	}
+
+	bool end()
+	{
+		if ( depth == 0 )
+		{
+			frames.pop_back();
+			return true;
+		}
+
+		if ( model )
+		{
+			stack.pop_back();
+		}
+
+		if ( --depth == 0 )
+		{
+			finish( current );
+		}
+		return true;
+	}
+
+	/// Hands the element over to the model
+	void finish( const Section section )
+	{
+		auto index = counts[size_t( section )]++;
+		if ( model )
+		{
+			if ( model->options.progress )
+			{
+				model->options.progress->check();
+			}
+			ingest( section, index );
+			element = nullptr;
+		}
+	}
+
+	template <typename T>
+	void presize( Uvec<T>& list, const size_t count )
+	{
+		list->resize( count );
+		for ( size_t i = 0; i < count; ++i )
+		{
+			( *list )[i].handle = Handle<T>( list, i );
+		}
+	}
+
+	/// Creates all the referenced elements up front
+	void presize( const SectionCounts& c )
+	{
+		auto count = [&c]( Section s ) { return c[size_t( s )]; };
+		presize( model->buffers, count( Section::Buffers ) );
+		presize( model->buffer_views, count( Section::BufferViews ) );
+		model->cameras.resize( count( Section::Cameras ) );
+		model->samplers->resize( count( Section::Samplers ) );
+		presize( model->images, count( Section::Images ) );
+		presize( model->textures, count( Section::Textures ) );
+		presize( model->accessors, count( Section::Accessors ) );
+		presize( model->materials, count( Section::Materials ) );
+		presize( model->meshes, count( Section::Meshes ) );
+		model->lights.resize( count( Section::Lights ) );
+		presize( model->nodes, count( Section::Nodes ) );
+		model->animations.reserve( count( Section::Animations ) );
+		model->scripts.resize( count( Section::Scripts ) );
+		model->scenes.resize( count( Section::Scenes ) );
+	}
+
+	void ingest( const Section section, const size_t i )
+	{
+		auto& m = *model;
+		switch ( section )
+		{
+		case Section::Asset: m.init_asset( element ); break;
+		case Section::Buffers: m.init_buffer( element, ( *m.buffers )[i], bin ); break;
+		case Section::BufferViews: m.init_buffer_view( element, ( *m.buffer_views )[i] ); break;
+		case Section::Cameras: m.init_camera( element, m.cameras[i] ); break;
+		case Section::Samplers: m.init_sampler( element, ( *m.samplers )[i] ); break;
+		case Section::Images: m.init_image( element, ( *m.images )[i] ); break;
+		case Section::Textures: m.init_texture( element, ( *m.textures )[i] ); break;
+		case Section::Accessors: m.init_accessor( element, ( *m.accessors )[i] ); break;
+		case Section::Materials: m.init_material( element, ( *m.materials )[i] ); break;
+		case Section::Meshes: m.init_mesh( element, ( *m.meshes )[i] ); break;
+		case Section::Lights: m.init_light( element, m.lights[i] ); break;
+		case Section::Nodes:
+			m.init_node( element, ( *m.nodes )[i] );
+			m.init_node_children( element, ( *m.nodes )[i] );
+			break;
+		case Section::Animations: m.init_animation( element, m.animations.emplace_back( m ) ); break;
+		case Section::Shapes: m.init_shape( element ); break;
+		case Section::Scripts: m.init_script( element, m.scripts[i] ); break;
+		case Section::Scenes: m.init_scene( element, m.scenes[i] ); break;
+		default: break;
+		}
+	}
+
+	/// Model being filled, null while counting
+	Gltf* model = nullptr;
+
+	/// Binary chunk of a GLB
+	ByteSpan bin;
+
+	/// Sections to read
+	LoadOptions::Sections wanted;
+
+	/// Containers opened outside of elements
+	std::vector<Frame> frames;
+
+	/// Nesting level within the current element, 0 outside
+	size_t depth = 0;
+
+	/// Section of the current element
+	Section current = Section::None;
+
+	/// Current element and the containers being built within it
+	json element;
+	std::vector<json*> stack;
+	std::string pending_key;
+};
+
+
+/// Streams a glTF through the SAX handler twice
+/// @param parse Function running a SAX parser over the whole text with the handler
+template <typename Parse>
+Gltf ingest( Parse parse, const std::string& path, const LoadOptions& options, const ByteSpan& bin )
+{
+	Gltf model;
+	model.path = path.substr( 0, path.find_last_of( "/\\" ) );
+	model.options = options;
+	model.options.sections = options.sections.resolved();
+
+	model.enter( LoadProgress::Stage::Json );
+	SaxIngest counter( model.options.sections );
+	parse( counter );
+
+	SaxIngest ingest( model, counter.counts, bin );
+	parse( ingest );
+
+	model.load_nodes();
+	if ( !model.scenes.empty() )
+	{
+		model.select_scenes( ingest.scene );
+	}
+
+	if ( options.is_partial() )
+	{
+		model.load_used_buffers();
+	}
+	else if ( !options.lazy_buffers )
+	{
+		model.enter( LoadProgress::Stage::Buffers );
+		model.prefetch();
+	}
+
+	model.convert_topology();
+	model.enter( LoadProgress::Stage::Done );
+	return model;
+}
+
+
+Gltf Gltf::load_streaming( std::istream& in, const std::string& path, const LoadOptions& options, ByteSpan bin )
+{
+	auto parse = [&in]( SaxIngest& handler ) {
+		in.clear();
+		in.seekg( 0 );
+		nlohmann::json::sax_parse( in, &handler );
+	};
+	return ingest( parse, path, options, bin );
+}
+
+
+Gltf Gltf::load_streaming( const ByteSpan& text, const std::string& path, const LoadOptions& options, ByteSpan bin )
+{
+	auto parse = [&text]( SaxIngest& handler ) {
+		nlohmann::json::sax_parse( text.data, text.data + text.size, &handler );
+	};
+	return ingest( parse, path, options, bin );
+}
+
+
+} // namespace spot::gfx
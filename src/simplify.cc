@@ -0,0 +1,715 @@
+#include "spot/gltf/simplify.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+#include "spot/gltf/assembly.h"
+#include "spot/gltf/decode.h"
+#include "spot/gltf/gltf.h"
+#include "spot/gltf/parallel.h"
+
+namespace spot::gfx
+{
+
+
+/// Sum of the squared distances from planes, as a symmetric 4x4 matrix,
+/// along with the total weight of the planes
+struct Quadric
+{
+	/// Adds a plane through the point, with a normal of unit length
+	void add_plane( const double* n, const double* p, double w );
+
+	/// @return The weighted mean of the squared distances of the point from the planes
+	double get_error( const double* p ) const;
+
+	Quadric& operator+=( const Quadric& other );
+
+	double a2 = 0.0, b2 = 0.0, c2 = 0.0, d2 = 0.0;
+	double ab = 0.0, ac = 0.0, ad = 0.0;
+	double bc = 0.0, bd = 0.0, cd = 0.0;
+	double weight = 0.0;
+};
+
+
+void Quadric::add_plane( const double* n, const double* p, const double w )
+{
+	auto d = -( n[0] * p[0] + n[1] * p[1] + n[2] * p[2] );
+	a2 += w * n[0] * n[0];
+	b2 += w * n[1] * n[1];
+	c2 += w * n[2] * n[2];
+	d2 += w * d * d;
+	ab += w * n[0] * n[1];
+	ac += w * n[0] * n[2];
+	ad += w * n[0] * d;
+	bc += w * n[1] * n[2];
+	bd += w * n[1] * d;
+	cd += w * n[2] * d;
+	weight += w;
+}
+
+
+double Quadric::get_error( const double* p ) const
+{
+	if ( weight <= 0.0 )
+	{
+		return 0.0;
+	}
+	auto x = p[0], y = p[1], z = p[2];
+	auto error = a2 * x * x + b2 * y * y + c2 * z * z + d2 +
+		2.0 * ( ab * x * y + ac * x * z + bc * y * z + ad * x + bd * y + cd * z );
+	return std::max( error, 0.0 ) / weight;
+}
+
+
+Quadric& Quadric::operator+=( const Quadric& other )
+{
+	a2 += other.a2;
+	b2 += other.b2;
+	c2 += other.c2;
+	d2 += other.d2;
+	ab += other.ab;
+	ac += other.ac;
+	ad += other.ad;
+	bc += other.bc;
+	bd += other.bd;
+	cd += other.cd;
+	weight += other.weight;
+	return *this;
+}
+
+
+/// How a vertex may move while simplifying
+enum class CollapseKind : uint8_t
+{
+	/// Surrounded by triangles, moves onto any neighbour
+	Interior,
+
+	/// On an open border, moves along it
+	Border,
+
+	/// On a seam, or where the surface is not manifold, never moves
+	Locked,
+};
+
+
+/// Edge collapse of a simplification pass
+struct Collapse
+{
+	/// Position moving, and position it moves onto
+	uint32_t from = 0;
+	uint32_t to = 0;
+
+	/// Vertex taking the place of the one moving
+	uint32_t vertex = 0;
+
+	/// Squared geometric error, and the same with attributes, which collapses are sorted by
+	double error = 0.0;
+	double cost = INFINITY;
+};
+
+
+/// @return Twice the area of a triangle, as its unnormalized normal
+void get_triangle_normal( const double* a, const double* b, const double* c, double* n )
+{
+	double u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+	double v[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+	n[0] = u[1] * v[2] - u[2] * v[1];
+	n[1] = u[2] * v[0] - u[0] * v[2];
+	n[2] = u[0] * v[1] - u[1] * v[0];
+}
+
+
+float simplify( Indices& indices, const float* positions, const size_t vertex_count, const size_t stride,
+	const size_t target_count, const float target_error, const std::vector<SimplifyAttribute>& attributes )
+{
+	check_triangles( indices, vertex_count );
+	if ( indices.size() <= target_count )
+	{
+		return 0.0f;
+	}
+
+	// Positions scaled to a unit cube, so errors are relative to the size of the mesh
+	auto position_stride = stride ? stride : 3 * sizeof( float );
+	std::vector<double> points( vertex_count * 3 );
+	double min[3] = { INFINITY, INFINITY, INFINITY };
+	double max[3] = { -INFINITY, -INFINITY, -INFINITY };
+	for ( size_t v = 0; v < vertex_count; ++v )
+	{
+		auto p = get_position( positions, position_stride, v );
+		for ( size_t i = 0; i < 3; ++i )
+		{
+			points[v * 3 + i] = p[i];
+			min[i] = std::min( min[i], points[v * 3 + i] );
+			max[i] = std::max( max[i], points[v * 3 + i] );
+		}
+	}
+	auto extent = std::max( { max[0] - min[0], max[1] - min[1], max[2] - min[2] } );
+	if ( !( extent > 0.0 ) || !std::isfinite( extent ) )
+	{
+		return 0.0f;
+	}
+	for ( size_t v = 0; v < vertex_count; ++v )
+	{
+		for ( size_t i = 0; i < 3; ++i )
+		{
+			points[v * 3 + i] = ( points[v * 3 + i] - min[i] ) / extent;
+		}
+	}
+
+	std::vector<uint32_t> triangles( indices.size() );
+	indices.visit( [&triangles]( auto data, size_t count ) { std::copy( data, data + count, triangles.begin() ); } );
+
+	// Vertices on the same position share a representative, the first of them.
+	// Positions with more than a vertex split attributes, thus they are locked
+	std::vector<uint32_t> order( vertex_count );
+	std::iota( order.begin(), order.end(), 0 );
+	auto less_point = [&points]( uint32_t a, uint32_t b ) {
+		return std::lexicographical_compare( &points[a * 3], &points[a * 3 + 3], &points[b * 3], &points[b * 3 + 3] );
+	};
+	std::sort( order.begin(), order.end(), [&less_point]( uint32_t a, uint32_t b ) {
+		return less_point( a, b ) || ( !less_point( b, a ) && a < b );
+	} );
+
+	std::vector<uint8_t> used( vertex_count, 0 );
+	for ( auto index : triangles )
+	{
+		used[index] = 1;
+	}
+
+	std::vector<uint32_t> representative( vertex_count );
+	std::vector<CollapseKind> kinds( vertex_count, CollapseKind::Interior );
+	for ( size_t begin = 0; begin < order.size(); )
+	{
+		auto end = begin + 1;
+		while ( end < order.size() && !less_point( order[begin], order[end] ) )
+		{
+			++end;
+		}
+		size_t users = 0;
+		for ( auto i = begin; i < end; ++i )
+		{
+			representative[order[i]] = order[begin];
+			users += used[order[i]];
+		}
+		if ( users > 1 )
+		{
+			kinds[order[begin]] = CollapseKind::Locked;
+		}
+		begin = end;
+	}
+
+	// Attributes of a vertex, as a pointer to their floats
+	auto get_attribute = []( const SimplifyAttribute& attribute, uint32_t v ) {
+		auto attribute_stride = attribute.stride ? attribute.stride : attribute.components * sizeof( float );
+		return reinterpret_cast<const float*>( reinterpret_cast<const uint8_t*>( attribute.data ) + v * attribute_stride );
+	};
+
+	// Faces of every position, and the position of every vertex of a triangle
+	std::vector<uint32_t> corners( triangles.size() );
+	std::vector<Quadric> quadrics( vertex_count );
+	std::vector<uint32_t> face_offsets( vertex_count + 1 );
+	std::vector<uint32_t> faces( triangles.size() );
+	std::vector<uint32_t> border_edges( vertex_count );
+
+	double result = 0.0;
+	auto max_error = double( target_error ) * double( target_error );
+	auto triangle_count = triangles.size() / 3;
+	auto target_triangles = target_count / 3;
+
+	// Quadrics go through the passes, while kinds are found again at every pass
+	// as borders and manifold neighbourhoods change with the collapses
+	auto locked_seams = kinds;
+	for ( size_t t = 0; t < triangle_count; ++t )
+	{
+		auto a = &points[representative[triangles[t * 3]] * 3];
+		auto b = &points[representative[triangles[t * 3 + 1]] * 3];
+		auto c = &points[representative[triangles[t * 3 + 2]] * 3];
+		double n[3];
+		get_triangle_normal( a, b, c, n );
+		auto length = std::sqrt( n[0] * n[0] + n[1] * n[1] + n[2] * n[2] );
+		if ( length <= 0.0 )
+		{
+			continue;
+		}
+		double normal[3] = { n[0] / length, n[1] / length, n[2] / length };
+		for ( size_t k = 0; k < 3; ++k )
+		{
+			quadrics[representative[triangles[t * 3 + k]]].add_plane( normal, a, length * 0.5 );
+		}
+	}
+
+	bool border_quadrics = false;
+	std::vector<Collapse> best( vertex_count );
+	std::vector<Collapse> collapses;
+	std::vector<uint8_t> touched( vertex_count );
+	std::vector<uint32_t> moved( vertex_count );
+
+	while ( triangle_count > target_triangles )
+	{
+		for ( size_t i = 0; i < triangle_count * 3; ++i )
+		{
+			corners[i] = representative[triangles[i]];
+		}
+
+		// Faces around every position
+		std::fill( face_offsets.begin(), face_offsets.end(), 0 );
+		for ( size_t i = 0; i < triangle_count * 3; ++i )
+		{
+			++face_offsets[corners[i] + 1];
+		}
+		std::partial_sum( face_offsets.begin(), face_offsets.end(), face_offsets.begin() );
+		{
+			auto fill = face_offsets;
+			for ( size_t i = 0; i < triangle_count * 3; ++i )
+			{
+				faces[fill[corners[i]]++] = uint32_t( i / 3 );
+			}
+		}
+
+		// Faces with the directed edge between two positions, found around the first
+		auto count_edge = [&]( uint32_t a, uint32_t b ) {
+			size_t count = 0;
+			for ( auto f = face_offsets[a]; f < face_offsets[a + 1]; ++f )
+			{
+				auto c = &corners[faces[f] * 3];
+				count += ( c[0] == a && c[1] == b ) + ( c[1] == a && c[2] == b ) + ( c[2] == a && c[0] == b );
+			}
+			return count;
+		};
+
+		// Edges in more than two faces, or twice in the same direction, are not manifold
+		kinds = locked_seams;
+		std::fill( border_edges.begin(), border_edges.end(), 0 );
+		for ( size_t i = 0; i < triangle_count * 3; ++i )
+		{
+			auto a = corners[i];
+			auto b = corners[i - i % 3 + ( i % 3 + 1 ) % 3];
+			if ( a == b )
+			{
+				continue;
+			}
+			auto opposite = count_edge( b, a );
+			if ( opposite > 1 || count_edge( a, b ) > 1 )
+			{
+				kinds[a] = CollapseKind::Locked;
+				kinds[b] = CollapseKind::Locked;
+			}
+			else if ( opposite == 0 )
+			{
+				++border_edges[a];
+				++border_edges[b];
+			}
+		}
+
+		// Planes through the borders, perpendicular to their faces, keep them in place
+		for ( size_t t = 0; t < triangle_count && !border_quadrics; ++t )
+		{
+			for ( size_t k = 0; k < 3; ++k )
+			{
+				auto a = corners[t * 3 + k];
+				auto b = corners[t * 3 + ( k + 1 ) % 3];
+				if ( a == b || count_edge( b, a ) != 0 )
+				{
+					continue;
+				}
+				auto pa = &points[a * 3];
+				auto pb = &points[b * 3];
+				double n[3];
+				get_triangle_normal( pa, pb, &points[corners[t * 3 + ( k + 2 ) % 3] * 3], n );
+				double e[3] = { pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2] };
+				double p[3] = { e[1] * n[2] - e[2] * n[1], e[2] * n[0] - e[0] * n[2], e[0] * n[1] - e[1] * n[0] };
+				auto length = std::sqrt( p[0] * p[0] + p[1] * p[1] + p[2] * p[2] );
+				if ( length > 0.0 )
+				{
+					double normal[3] = { p[0] / length, p[1] / length, p[2] / length };
+					auto weight = ( e[0] * e[0] + e[1] * e[1] + e[2] * e[2] ) * 10.0;
+					quadrics[a].add_plane( normal, pa, weight );
+					quadrics[b].add_plane( normal, pa, weight );
+				}
+			}
+		}
+		border_quadrics = true;
+
+		// Positions joining more than a border are not manifold either
+		for ( size_t v = 0; v < vertex_count; ++v )
+		{
+			if ( kinds[v] == CollapseKind::Interior && border_edges[v] )
+			{
+				kinds[v] = border_edges[v] > 2 ? CollapseKind::Locked : CollapseKind::Border;
+			}
+		}
+
+		// Cheapest collapse of every position, along the edges of its faces. Positions
+		// on a border also look backward, as border edges are in a single face
+		std::fill( best.begin(), best.end(), Collapse{} );
+		auto add_collapse = [&]( uint32_t from, uint32_t to, uint32_t from_vertex, uint32_t to_vertex ) {
+			if ( kinds[from] == CollapseKind::Locked )
+			{
+				return;
+			}
+			if ( kinds[from] == CollapseKind::Border &&
+				( kinds[to] == CollapseKind::Interior || count_edge( from, to ) + count_edge( to, from ) != 1 ) )
+			{
+				return;
+			}
+			auto q = quadrics[from];
+			q += quadrics[to];
+			auto error = q.get_error( &points[to * 3] );
+			if ( error > max_error )
+			{
+				return;
+			}
+			auto cost = error;
+			for ( auto& attribute : attributes )
+			{
+				auto a = get_attribute( attribute, from_vertex );
+				auto b = get_attribute( attribute, to_vertex );
+				double difference = 0.0;
+				for ( size_t i = 0; i < attribute.components; ++i )
+				{
+					difference += double( a[i] - b[i] ) * double( a[i] - b[i] );
+				}
+				cost += attribute.weight * difference;
+			}
+			auto& collapse = best[from];
+			if ( cost < collapse.cost )
+			{
+				collapse = { from, to, to_vertex, error, cost };
+			}
+		};
+		for ( size_t t = 0; t < triangle_count; ++t )
+		{
+			for ( size_t k = 0; k < 3; ++k )
+			{
+				auto i = t * 3 + k;
+				auto j = t * 3 + ( k + 1 ) % 3;
+				if ( corners[i] == corners[j] )
+				{
+					continue;
+				}
+				add_collapse( corners[i], corners[j], triangles[i], triangles[j] );
+				if ( kinds[corners[j]] == CollapseKind::Border )
+				{
+					add_collapse( corners[j], corners[i], triangles[j], triangles[i] );
+				}
+			}
+		}
+		collapses.clear();
+		for ( auto& collapse : best )
+		{
+			if ( collapse.cost < INFINITY )
+			{
+				collapses.push_back( collapse );
+			}
+		}
+		std::sort( collapses.begin(), collapses.end(),
+			[]( const Collapse& a, const Collapse& b ) { return a.cost < b.cost; } );
+
+		// Collapses of this pass do not share positions nor faces, so they do not affect each other
+		std::fill( touched.begin(), touched.end(), 0 );
+		std::iota( moved.begin(), moved.end(), 0 );
+		size_t removed = 0;
+		size_t applied = 0;
+		for ( auto& collapse : collapses )
+		{
+			if ( triangle_count - removed <= target_triangles )
+			{
+				break;
+			}
+			if ( touched[collapse.from] || touched[collapse.to] )
+			{
+				continue;
+			}
+
+			// Faces of the position moving must not flip
+			auto to_point = &points[collapse.to * 3];
+			bool valid = true;
+			size_t merged = 0;
+			for ( auto f = face_offsets[collapse.from]; f < face_offsets[collapse.from + 1] && valid; ++f )
+			{
+				auto c = &corners[faces[f] * 3];
+				if ( c[0] == collapse.to || c[1] == collapse.to || c[2] == collapse.to )
+				{
+					++merged;
+					continue;
+				}
+				const double* p[3];
+				const double* q[3];
+				for ( size_t k = 0; k < 3; ++k )
+				{
+					valid = valid && !touched[c[k]];
+					p[k] = &points[c[k] * 3];
+					q[k] = c[k] == collapse.from ? to_point : p[k];
+				}
+				double before[3], after[3];
+				get_triangle_normal( p[0], p[1], p[2], before );
+				get_triangle_normal( q[0], q[1], q[2], after );
+				auto dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+				auto length = std::sqrt( ( before[0] * before[0] + before[1] * before[1] + before[2] * before[2] ) *
+					( after[0] * after[0] + after[1] * after[1] + after[2] * after[2] ) );
+				valid = valid && dot > 0.25 * length;
+			}
+			if ( !valid || merged == 0 )
+			{
+				continue;
+			}
+			for ( auto f = face_offsets[collapse.from]; f < face_offsets[collapse.from + 1]; ++f )
+			{
+				auto c = &corners[faces[f] * 3];
+				touched[c[0]] = touched[c[1]] = touched[c[2]] = 1;
+			}
+			moved[collapse.from] = collapse.vertex;
+			quadrics[collapse.to] += quadrics[collapse.from];
+			result = std::max( result, collapse.error );
+			removed += merged;
+			++applied;
+		}
+		if ( applied == 0 )
+		{
+			break;
+		}
+
+		// Vertices of the positions moved take their new place, and triangles left without area go away
+		size_t kept = 0;
+		for ( size_t t = 0; t < triangle_count; ++t )
+		{
+			uint32_t v[3];
+			for ( size_t k = 0; k < 3; ++k )
+			{
+				auto index = triangles[t * 3 + k];
+				auto corner = representative[index];
+				v[k] = moved[corner] != corner ? moved[corner] : index;
+			}
+			auto r0 = representative[v[0]], r1 = representative[v[1]], r2 = representative[v[2]];
+			if ( r0 == r1 || r1 == r2 || r0 == r2 )
+			{
+				continue;
+			}
+			std::copy( v, v + 3, &triangles[kept * 3] );
+			++kept;
+		}
+		triangle_count = kept;
+	}
+
+	// Indices keep their width
+	auto component_type = indices.get_component_type();
+	indices = Indices( component_type, triangle_count * 3 );
+	for ( size_t i = 0; i < triangle_count * 3; ++i )
+	{
+		indices.set( i, triangles[i] );
+	}
+	return float( std::sqrt( result ) );
+}
+
+
+/// Positions and attributes a primitive is simplified with
+struct SimplifySource
+{
+	/// Triangles at full resolution, every level starts from
+	Indices indices;
+
+	/// Positions of the runtime vertices, or decoded from the accessor
+	PrimitivePositions positions;
+
+	/// Largest extent of the positions, turning relative errors into model units
+	float extent = 0.0f;
+
+	std::vector<SimplifyAttribute> attributes;
+
+	/// Normals and texture coordinates decoded from the accessors of a primitive without runtime vertices
+	std::vector<float> decoded[2];
+};
+
+
+/// @return The floats of an attribute of a primitive, or nothing if it has not such an attribute
+/// @throw std::runtime_error If the attribute does not have the type expected
+std::vector<float> decode_lod_attribute(
+	const Primitive& primitive, const Primitive::Semantic semantic, const Accessor::Type type )
+{
+	auto it = primitive.attributes.find( semantic );
+	if ( it == primitive.attributes.end() || !it->second )
+	{
+		return {};
+	}
+	if ( it->second->type != type )
+	{
+		throw std::runtime_error{ "Attribute " + to_string( semantic ) + " not valid: " + to_string( it->second->type ) };
+	}
+	return decode_floats( *it->second );
+}
+
+
+/// Reads what a triangle list primitive is simplified with, leaving positions
+/// null for primitives which are kept as they are
+void get_simplify_source( Primitive& primitive, const LodOptions& options, SimplifySource& source )
+{
+	if ( primitive.mode != Primitive::Mode::TRIANGLES )
+	{
+		return;
+	}
+
+	source.positions = get_positions( primitive );
+	auto vertex_count = source.positions.count;
+	if ( !source.positions.data )
+	{
+		return;
+	}
+
+	if ( !primitive.vertices.empty() )
+	{
+		auto& vertices = primitive.vertices;
+		source.attributes.push_back( { &vertices[0].n.x, 3, sizeof( Vertex ), options.normal_weight } );
+		source.attributes.push_back( { &vertices[0].t.x, 2, sizeof( Vertex ), options.texcoord_weight } );
+	}
+	else
+	{
+		auto& normals = source.decoded[0] = decode_lod_attribute( primitive, Primitive::Semantic::NORMAL, Accessor::Type::VEC3 );
+		if ( normals.size() == vertex_count * 3 )
+		{
+			source.attributes.push_back( { normals.data(), 3, 0, options.normal_weight } );
+		}
+		auto& texcoords = source.decoded[1] =
+			decode_lod_attribute( primitive, Primitive::Semantic::TEXCOORD_0, Accessor::Type::VEC2 );
+		if ( texcoords.size() == vertex_count * 2 )
+		{
+			source.attributes.push_back( { texcoords.data(), 2, 0, options.texcoord_weight } );
+		}
+	}
+
+	// Primitives drawn without indices draw their vertices in order
+	if ( primitive.indices.empty() )
+	{
+		assemble_indices( primitive );
+	}
+	source.indices = primitive.indices;
+	if ( source.indices.empty() )
+	{
+		source.indices = Indices( Indices::get_component_type( vertex_count ), vertex_count );
+		for ( size_t i = 0; i < vertex_count; ++i )
+		{
+			source.indices.set( i, Index( i ) );
+		}
+	}
+
+	float min[3] = { INFINITY, INFINITY, INFINITY };
+	float max[3] = { -INFINITY, -INFINITY, -INFINITY };
+	for ( size_t v = 0; v < vertex_count; ++v )
+	{
+		auto p = get_position( source.positions.data, source.positions.stride, v );
+		for ( size_t i = 0; i < 3; ++i )
+		{
+			min[i] = std::min( min[i], p[i] );
+			max[i] = std::max( max[i], p[i] );
+		}
+	}
+	source.extent = std::max( { max[0] - min[0], max[1] - min[1], max[2] - min[2], 0.0f } );
+}
+
+
+/// Makes the levels of detail of a mesh without touching the model, so meshes can be simplified concurrently
+void make_mesh_lods( Mesh& mesh, const LodOptions& options )
+{
+	mesh.lods.clear();
+
+	std::vector<SimplifySource> sources( mesh.primitives.size() );
+	size_t previous = 0;
+	for ( size_t p = 0; p < mesh.primitives.size(); ++p )
+	{
+		get_simplify_source( mesh.primitives[p], options, sources[p] );
+		previous += sources[p].indices.size();
+	}
+	if ( previous == 0 )
+	{
+		return;
+	}
+
+	auto ratio = std::clamp( options.ratio, 0.0f, 1.0f );
+	auto factor = 1.0f;
+	for ( size_t level = 0; level < options.max_levels; ++level )
+	{
+		factor *= ratio;
+		MeshLod lod;
+		size_t count = 0;
+		for ( size_t p = 0; p < mesh.primitives.size(); ++p )
+		{
+			auto& primitive = mesh.primitives[p];
+			auto& lod_primitive = lod.primitives.emplace_back();
+			lod_primitive.attributes = primitive.attributes;
+			lod_primitive.material = primitive.material;
+			lod_primitive.mode = primitive.mode;
+			lod_primitive.line_width = primitive.line_width;
+			lod_primitive.extras = primitive.extras;
+
+			auto& source = sources[p];
+			auto& positions = source.positions;
+			if ( !positions.data )
+			{
+				lod_primitive.indices_handle = primitive.indices_handle;
+				lod_primitive.indices = primitive.indices;
+				continue;
+			}
+
+			auto indices = source.indices;
+			auto target = size_t( float( indices.size() ) * factor ) / 3 * 3;
+			auto error = simplify( indices, positions.data, positions.count, positions.stride, target,
+				options.max_error, source.attributes );
+			lod.error = std::max( lod.error, error * source.extent );
+			count += indices.size();
+			lod_primitive.indices = std::move( indices );
+		}
+
+		// Levels stop where the error does not let triangles go down by at least half of the ratio
+		if ( count == 0 || float( count ) > float( previous ) * ( 1.0f + ratio ) * 0.5f )
+		{
+			break;
+		}
+		previous = count;
+		mesh.lods.emplace_back( std::move( lod ) );
+	}
+}
+
+
+/// Stores the simplified indices of primitives loaded from accessors in new accessors
+void store_mesh_lod_indices( Gltf& model, Mesh& mesh )
+{
+	for ( auto& lod : mesh.lods )
+	{
+		for ( auto& primitive : lod.primitives )
+		{
+			if ( !primitive.attributes.empty() && !primitive.indices_handle && !primitive.indices.empty() )
+			{
+				store_indices( model, primitive );
+			}
+		}
+	}
+}
+
+
+void generate_lods( Gltf& model, Mesh& mesh, const LodOptions& options )
+{
+	make_mesh_lods( mesh, options );
+	store_mesh_lod_indices( model, mesh );
+}
+
+
+void generate_lods( Gltf& model, const uint32_t threads, const LodOptions& options )
+{
+	std::vector<Mesh*> meshes;
+	for ( auto& mesh : *model.meshes )
+	{
+		meshes.emplace_back( &mesh );
+	}
+	parallel_for( meshes.size(), threads, [&meshes, &options]( size_t i ) { make_mesh_lods( *meshes[i], options ); } );
+
+	// Accessors are added on this thread, as handles can not be pushed concurrently
+	for ( auto mesh : meshes )
+	{
+		store_mesh_lod_indices( model, *mesh );
+	}
+}
+
+
+} // namespace spot::gfx
@@ -0,0 +1,1391 @@
+#include <array>
+#include <cassert>
+#include <initializer_list>
+#include <locale>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+
+#include "spot/gltf/gltf.h"
+
+namespace spot::gfx
+{
+
+
+/// Keys of the glTF schema known by the tokenizer
+enum class Key : uint8_t
+{
+	Unknown,
+	// Top level
+	Asset, Scene, Scenes, Nodes, Meshes, Accessors, BufferViews, Buffers, Cameras,
+	Samplers, Images, Textures, Materials, Animations, Extensions, Extras,
+	// Asset
+	Version, Generator, Copyright,
+	// Buffers and views
+	ByteLength, Uri, Buffer, ByteOffset, ByteStride, Target,
+	// Cameras
+	Type, Orthographic, Perspective, Xmag, Ymag, Zfar, Znear, AspectRatio, Yfov, Name,
+	// Samplers, images and textures
+	MagFilter, MinFilter, WrapS, WrapT, MimeType, BufferView, Sampler, Source,
+	// Accessors
+	ComponentType, Count, Max, Min, Normalized, Sparse, Values,
+	// Materials
+	PbrMetallicRoughness, BaseColorFactor, BaseColorTexture, Index, MetallicFactor, RoughnessFactor,
+	// Meshes
+	Primitives, Attributes, Indices, Material, Mode,
+	Position, Normal, Tangent, Texcoord0, Texcoord1, Color0, Joints0, Weights0,
+	// Lights
+	KhrLightsPunctual, Lights, Color, Intensity, Range, Spot, InnerConeAngle, OuterConeAngle,
+	// Nodes
+	Camera, Matrix, Mesh, Rotation, Scale, Translation, Bounds, Scripts, Children, Light,
+	// Animations
+	Channels, Input, Output, Interpolation, Node, Path,
+	// Shapes
+	Shapes, Box, Sphere, A, B, O, R,
+};
+
+
+/// Spelling of every key
+constexpr std::pair<std::string_view, Key> key_names[] = {
+	{ "asset", Key::Asset }, { "scene", Key::Scene }, { "scenes", Key::Scenes }, { "nodes", Key::Nodes },
+	{ "meshes", Key::Meshes }, { "accessors", Key::Accessors }, { "bufferViews", Key::BufferViews },
+	{ "buffers", Key::Buffers }, { "cameras", Key::Cameras }, { "samplers", Key::Samplers },
+	{ "images", Key::Images }, { "textures", Key::Textures }, { "materials", Key::Materials },
+	{ "animations", Key::Animations }, { "extensions", Key::Extensions }, { "extras", Key::Extras },
+	{ "version", Key::Version }, { "generator", Key::Generator }, { "copyright", Key::Copyright },
+	{ "byteLength", Key::ByteLength }, { "uri", Key::Uri }, { "buffer", Key::Buffer },
+	{ "byteOffset", Key::ByteOffset }, { "byteStride", Key::ByteStride }, { "target", Key::Target },
+	{ "type", Key::Type }, { "orthographic", Key::Orthographic }, { "perspective", Key::Perspective },
+	{ "xmag", Key::Xmag }, { "ymag", Key::Ymag }, { "zfar", Key::Zfar }, { "znear", Key::Znear },
+	{ "aspectRatio", Key::AspectRatio }, { "yfov", Key::Yfov }, { "name", Key::Name },
+	{ "magFilter", Key::MagFilter }, { "minFilter", Key::MinFilter }, { "wrapS", Key::WrapS },
+	{ "wrapT", Key::WrapT }, { "mimeType", Key::MimeType }, { "bufferView", Key::BufferView },
+	{ "sampler", Key::Sampler }, { "source", Key::Source }, { "componentType", Key::ComponentType },
+	{ "count", Key::Count }, { "max", Key::Max }, { "min", Key::Min }, { "normalized", Key::Normalized },
+	{ "sparse", Key::Sparse }, { "values", Key::Values },
+	{ "pbrMetallicRoughness", Key::PbrMetallicRoughness }, { "baseColorFactor", Key::BaseColorFactor },
+	{ "baseColorTexture", Key::BaseColorTexture }, { "index", Key::Index },
+	{ "metallicFactor", Key::MetallicFactor }, { "roughnessFactor", Key::RoughnessFactor },
+	{ "primitives", Key::Primitives }, { "attributes", Key::Attributes }, { "indices", Key::Indices },
+	{ "material", Key::Material }, { "mode", Key::Mode },
+	{ "POSITION", Key::Position }, { "NORMAL", Key::Normal }, { "TANGENT", Key::Tangent },
+	{ "TEXCOORD_0", Key::Texcoord0 }, { "TEXCOORD_1", Key::Texcoord1 }, { "COLOR_0", Key::Color0 },
+	{ "JOINTS_0", Key::Joints0 }, { "WEIGHTS_0", Key::Weights0 },
+	{ "KHR_lights_punctual", Key::KhrLightsPunctual }, { "lights", Key::Lights }, { "color", Key::Color },
+	{ "intensity", Key::Intensity }, { "range", Key::Range }, { "spot", Key::Spot },
+	{ "innerConeAngle", Key::InnerConeAngle }, { "outerConeAngle", Key::OuterConeAngle },
+	{ "camera", Key::Camera }, { "matrix", Key::Matrix }, { "mesh", Key::Mesh }, { "rotation", Key::Rotation },
+	{ "scale", Key::Scale }, { "translation", Key::Translation }, { "bounds", Key::Bounds },
+	{ "scripts", Key::Scripts }, { "children", Key::Children }, { "light", Key::Light },
+	{ "channels", Key::Channels }, { "input", Key::Input }, { "output", Key::Output },
+	{ "interpolation", Key::Interpolation }, { "node", Key::Node }, { "path", Key::Path },
+	{ "shapes", Key::Shapes }, { "box", Key::Box }, { "sphere", Key::Sphere },
+	{ "a", Key::A }, { "b", Key::B }, { "o", Key::O }, { "r", Key::R },
+};
+
+
+/// Slots of the perfect hash table of keys
+constexpr size_t key_slots = 512;
+
+
+/// Hash which happens to be perfect for the known keys, adding a key
+/// may need another multiplier, the table would not compile otherwise
+constexpr size_t key_hash( const std::string_view name )
+{
+	uint32_t h = 0;
+	for ( auto c : name )
+	{
+		h = h * 30395u + uint8_t( c );
+	}
+	return ( h ^ ( h >> 15 ) ) & ( key_slots - 1 );
+}
+
+
+constexpr std::array<uint8_t, key_slots> make_key_table()
+{
+	// Slots refer to the entries of key_names, 0 means empty
+	std::array<uint8_t, key_slots> table = {};
+	for ( size_t i = 0; i < std::size( key_names ); ++i )
+	{
+		auto& slot = table[key_hash( key_names[i].first )];
+		if ( slot != 0 )
+		{
+			throw std::logic_error( "Key hash collision" );
+		}
+		slot = uint8_t( i + 1 );
+	}
+	return table;
+}
+
+
+constexpr auto key_table = make_key_table();
+
+
+/// @return The key with that name, Key::Unknown if it is not part of the schema
+Key find_key( const std::string_view name )
+{
+	auto slot = key_table[key_hash( name )];
+	if ( slot == 0 )
+	{
+		return Key::Unknown;
+	}
+	auto& entry = key_names[slot - 1];
+	return entry.first == name ? entry.second : Key::Unknown;
+}
+
+
+/// Single pass json reader, it never builds a document and lets the caller
+/// pull values of the expected type straight into their destination
+class JsonTokenizer
+{
+  public:
+	JsonTokenizer( const char* b, const char* e, const char* p = nullptr )
+	: begin { b }
+	, end { e }
+	, cur { p ? p : b }
+	{}
+
+	/// @return The next significant character, 0 at the end of the text
+	char peek()
+	{
+		while ( cur < end && ( *cur == ' ' || *cur == '\n' || *cur == '\r' || *cur == '\t' ) )
+		{
+			++cur;
+		}
+		return cur < end ? *cur : 0;
+	}
+
+	/// @return The current position within the text
+	const char* position() { peek(); return cur; }
+
+	void expect( const char c )
+	{
+		if ( peek() != c )
+		{
+			error( std::string( "expected '" ) + c + "'" );
+		}
+		++cur;
+	}
+
+	/// Calls the function with the key of each member of an object,
+	/// which must consume the value, skipping it when not interested
+	template <typename F>
+	void object( F f )
+	{
+		expect( '{' );
+		if ( peek() == '}' )
+		{
+			++cur;
+			return;
+		}
+		do
+		{
+			auto name = string();
+			expect( ':' );
+			f( find_key( name ) );
+		} while ( next( '}' ) );
+	}
+
+	/// Calls the function for each element of an array, which must consume it
+	template <typename F>
+	void array( F f )
+	{
+		expect( '[' );
+		if ( peek() == ']' )
+		{
+			++cur;
+			return;
+		}
+		do
+		{
+			f();
+		} while ( next( ']' ) );
+	}
+
+	/// @return The string at the current position. The view refers to the text
+	/// if the string has no escapes, otherwise it is valid until the next string
+	std::string_view string()
+	{
+		expect( '"' );
+		auto start = cur;
+		while ( cur < end && *cur != '"' && *cur != '\\' )
+		{
+			if ( uint8_t( *cur ) < 0x20 )
+			{
+				error( "control character in string" );
+			}
+			++cur;
+		}
+		if ( cur < end && *cur == '"' )
+		{
+			return std::string_view( start, cur++ - start );
+		}
+
+		scratch.assign( start, cur );
+		while ( cur < end && *cur != '"' )
+		{
+			if ( *cur == '\\' )
+			{
+				escape();
+			}
+			else if ( uint8_t( *cur ) < 0x20 )
+			{
+				error( "control character in string" );
+			}
+			else
+			{
+				scratch.push_back( *cur++ );
+			}
+		}
+		if ( cur >= end )
+		{
+			error( "unterminated string" );
+		}
+		++cur;
+		return scratch;
+	}
+
+	/// @return The number at the current position
+	double number()
+	{
+		auto n = scan_number();
+		if ( n.truncated || n.exponent < -22 || n.exponent > 22 || n.mantissa > ( uint64_t( 1 ) << 53 ) )
+		{
+			// Long mantissas and large exponents are left to the standard library
+			std::istringstream in( std::string( n.start, cur ) );
+			in.imbue( std::locale::classic() );
+			double d = 0.0;
+			in >> d;
+			return d;
+		}
+
+		// Both the mantissa and the power of ten are exact doubles,
+		// so a single operation rounds correctly
+		static constexpr double powers[] = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+		                                     1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+		                                     1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+		auto d = double( n.mantissa );
+		d = n.exponent < 0 ? d / powers[-n.exponent] : d * powers[n.exponent];
+		return n.negative ? -d : d;
+	}
+
+	/// @return The number at the current position as an integer
+	template <typename T>
+	T integer()
+	{
+		auto start = position();
+		auto n = scan_number();
+		if ( n.truncated || n.exponent != 0 )
+		{
+			cur = start;
+			return T( number() );
+		}
+		return n.negative ? T( -int64_t( n.mantissa ) ) : T( n.mantissa );
+	}
+
+	float real() { return float( number() ); }
+
+	/// @return The boolean at the current position
+	bool boolean()
+	{
+		if ( peek() == 't' )
+		{
+			literal( "true" );
+			return true;
+		}
+		literal( "false" );
+		return false;
+	}
+
+	/// Reads an array of exactly N numbers
+	template <size_t N>
+	std::array<float, N> reals()
+	{
+		std::array<float, N> values;
+		size_t i = 0;
+		array( [&] {
+			if ( i == N )
+			{
+				error( "too many values" );
+			}
+			values[i++] = real();
+		} );
+		if ( i != N )
+		{
+			error( "too few values" );
+		}
+		return values;
+	}
+
+	/// Reads an array of numbers of any length
+	template <typename T>
+	void integers( std::vector<T>& values )
+	{
+		array( [&] { values.push_back( integer<T>() ); } );
+	}
+
+	/// Skips whatever value is at the current position
+	void skip()
+	{
+		switch ( peek() )
+		{
+		case '{': object( [this]( Key ) { skip(); } ); break;
+		case '[': array( [this] { skip(); } ); break;
+		case '"': skip_string(); break;
+		case 't': literal( "true" ); break;
+		case 'f': literal( "false" ); break;
+		case 'n': literal( "null" ); break;
+		default: scan_number(); break;
+		}
+	}
+
+	[[noreturn]] void error( const std::string& what ) const
+	{
+		throw std::runtime_error{ "Json not valid at " + std::to_string( cur - begin ) + ": " + what };
+	}
+
+  private:
+	/// Decimal number split into its parts
+	struct Number
+	{
+		const char* start;
+		uint64_t mantissa = 0;
+		int32_t exponent = 0;
+		bool negative = false;
+
+		/// Whether some digits did not fit into the mantissa
+		bool truncated = false;
+	};
+
+	Number scan_number()
+	{
+		Number n;
+		n.start = position();
+
+		auto digit = [this] { return cur < end && *cur >= '0' && *cur <= '9'; };
+
+		// Significant digits go into the mantissa while they fit
+		auto digits = 0;
+		auto push = [&]( int32_t scale ) {
+			if ( digits < 19 )
+			{
+				n.mantissa = n.mantissa * 10 + uint64_t( *cur - '0' );
+				digits += n.mantissa > 0;
+				n.exponent -= scale;
+			}
+			else
+			{
+				n.truncated = true;
+				n.exponent += 1 - scale;
+			}
+		};
+
+		if ( cur < end && *cur == '-' )
+		{
+			n.negative = true;
+			++cur;
+		}
+		if ( !digit() )
+		{
+			error( "expected a value" );
+		}
+		if ( *cur == '0' )
+		{
+			++cur;
+		}
+		else
+		{
+			for ( ; digit(); ++cur )
+			{
+				push( 0 );
+			}
+		}
+		if ( cur < end && *cur == '.' )
+		{
+			++cur;
+			if ( !digit() )
+			{
+				error( "expected a digit" );
+			}
+			for ( ; digit(); ++cur )
+			{
+				push( 1 );
+			}
+		}
+		if ( cur < end && ( *cur == 'e' || *cur == 'E' ) )
+		{
+			++cur;
+			auto negative = false;
+			if ( cur < end && ( *cur == '+' || *cur == '-' ) )
+			{
+				negative = *cur++ == '-';
+			}
+			if ( !digit() )
+			{
+				error( "expected a digit" );
+			}
+			int32_t e = 0;
+			for ( ; digit(); ++cur )
+			{
+				e = std::min( e * 10 + ( *cur - '0' ), 100000 );
+			}
+			n.exponent += negative ? -e : e;
+		}
+		return n;
+	}
+
+	/// @return Whether another element follows, after consuming the separator or the closing character
+	bool next( const char close )
+	{
+		auto c = peek();
+		if ( c == ',' )
+		{
+			++cur;
+			return true;
+		}
+		if ( c == close )
+		{
+			++cur;
+			return false;
+		}
+		error( std::string( "expected ',' or '" ) + close + "'" );
+	}
+
+	void literal( const std::string_view word )
+	{
+		if ( size_t( end - cur ) < word.size() || std::string_view( cur, word.size() ) != word )
+		{
+			error( "expected a value" );
+		}
+		cur += word.size();
+	}
+
+	void skip_string()
+	{
+		expect( '"' );
+		for ( ; cur < end && *cur != '"'; ++cur )
+		{
+			if ( *cur == '\\' )
+			{
+				++cur;
+			}
+		}
+		if ( cur >= end )
+		{
+			error( "unterminated string" );
+		}
+		++cur;
+	}
+
+	uint32_t hex4()
+	{
+		if ( end - cur < 4 )
+		{
+			error( "truncated escape" );
+		}
+		uint32_t value = 0;
+		for ( auto i = 0; i < 4; ++i, ++cur )
+		{
+			auto c = *cur;
+			value <<= 4;
+			if ( c >= '0' && c <= '9' ) value |= c - '0';
+			else if ( c >= 'a' && c <= 'f' ) value |= c - 'a' + 10;
+			else if ( c >= 'A' && c <= 'F' ) value |= c - 'A' + 10;
+			else error( "invalid escape" );
+		}
+		return value;
+	}
+
+	/// Decodes the escape sequence at the current position
+	void escape()
+	{
+		if ( ++cur >= end )
+		{
+			error( "truncated escape" );
+		}
+		switch ( *cur++ )
+		{
+		case '"': scratch.push_back( '"' ); return;
+		case '\\': scratch.push_back( '\\' ); return;
+		case '/': scratch.push_back( '/' ); return;
+		case 'b': scratch.push_back( '\b' ); return;
+		case 'f': scratch.push_back( '\f' ); return;
+		case 'n': scratch.push_back( '\n' ); return;
+		case 'r': scratch.push_back( '\r' ); return;
+		case 't': scratch.push_back( '\t' ); return;
+		case 'u': break;
+		default: error( "invalid escape" );
+		}
+
+		auto code = hex4();
+		if ( code >= 0xD800 && code <= 0xDBFF )
+		{
+			if ( end - cur < 2 || cur[0] != '\\' || cur[1] != 'u' )
+			{
+				error( "missing low surrogate" );
+			}
+			cur += 2;
+			auto low = hex4();
+			if ( low < 0xDC00 || low > 0xDFFF )
+			{
+				error( "invalid low surrogate" );
+			}
+			code = 0x10000 + ( ( code - 0xD800 ) << 10 ) + ( low - 0xDC00 );
+		}
+		else if ( code >= 0xDC00 && code <= 0xDFFF )
+		{
+			error( "unexpected low surrogate" );
+		}
+
+		// UTF-8
+		if ( code < 0x80 )
+		{
+			scratch.push_back( char( code ) );
+		}
+		else if ( code < 0x800 )
+		{
+			scratch.push_back( char( 0xC0 | ( code >> 6 ) ) );
+			scratch.push_back( char( 0x80 | ( code & 0x3F ) ) );
+		}
+		else if ( code < 0x10000 )
+		{
+			scratch.push_back( char( 0xE0 | ( code >> 12 ) ) );
+			scratch.push_back( char( 0x80 | ( ( code >> 6 ) & 0x3F ) ) );
+			scratch.push_back( char( 0x80 | ( code & 0x3F ) ) );
+		}
+		else
+		{
+			scratch.push_back( char( 0xF0 | ( code >> 18 ) ) );
+			scratch.push_back( char( 0x80 | ( ( code >> 12 ) & 0x3F ) ) );
+			scratch.push_back( char( 0x80 | ( ( code >> 6 ) & 0x3F ) ) );
+			scratch.push_back( char( 0x80 | ( code & 0x3F ) ) );
+		}
+	}
+
+	const char* begin;
+	const char* end;
+	const char* cur;
+
+	/// Storage for strings with escapes
+	std::string scratch;
+};
+
+
+/// @return The primitive attribute named by the key
+Primitive::Semantic to_semantic( const Key key )
+{
+	switch ( key )
+	{
+	case Key::Position: return Primitive::Semantic::POSITION;
+	case Key::Normal: return Primitive::Semantic::NORMAL;
+	case Key::Tangent: return Primitive::Semantic::TANGENT;
+	case Key::Texcoord0: return Primitive::Semantic::TEXCOORD_0;
+	case Key::Texcoord1: return Primitive::Semantic::TEXCOORD_1;
+	case Key::Color0: return Primitive::Semantic::COLOR_0;
+	case Key::Joints0: return Primitive::Semantic::JOINTS_0;
+	case Key::Weights0: return Primitive::Semantic::WEIGHTS_0;
+	default: assert( false ); return Primitive::Semantic::NONE;
+	}
+}
+
+
+/// Fills a Gltf from a json text. A first scan over the top level object only
+/// records where each section starts, then sections are read in dependency order
+/// so that every reference can be resolved as soon as it is found
+class GltfTokenizer
+{
+  public:
+	GltfTokenizer( Gltf& m, const ByteSpan& text, const ByteSpan& b )
+	: model { m }
+	, begin { text.data }
+	, end { text.data + text.size }
+	, bin { b }
+	{}
+
+	void read()
+	{
+		model.enter( LoadProgress::Stage::Json );
+		scan();
+		forget_unwanted();
+
+		read_section( Key::Asset, [this]( JsonTokenizer& t ) { read_asset( t ); } );
+
+		model.enter( LoadProgress::Stage::Buffers );
+		read_list( Key::Buffers, [this]( JsonTokenizer& t ) { read_buffer( t, *model.buffers.push() ); } );
+
+		// Buffers are loaded by workers while the rest of the model is read
+		auto loading = model.start_loading_buffers();
+
+		read_list( Key::BufferViews, [this]( JsonTokenizer& t ) { read_buffer_view( t, *model.buffer_views.push() ); } );
+		read_list( Key::Cameras, [this]( JsonTokenizer& t ) { read_camera( t, model.cameras.emplace_back() ); } );
+		read_list( Key::Samplers, [this]( JsonTokenizer& t ) { read_sampler( t, model.samplers->emplace_back() ); } );
+		read_list( Key::Images, [this]( JsonTokenizer& t ) { read_image( t, *model.images.push() ); } );
+		read_list( Key::Textures, [this]( JsonTokenizer& t ) { read_texture( t, *model.textures.push() ); } );
+		model.enter( LoadProgress::Stage::Accessors );
+		read_list( Key::Accessors, [this]( JsonTokenizer& t ) { read_accessor( t, *model.accessors.push() ); } );
+		model.enter( LoadProgress::Stage::Meshes );
+		read_list( Key::Materials, [this]( JsonTokenizer& t ) { read_material( t, *model.materials.push() ); } );
+		read_list( Key::Meshes, [this]( JsonTokenizer& t ) { read_mesh( t, *model.meshes.push( Mesh( model ) ) ); } );
+		model.enter( LoadProgress::Stage::Nodes );
+		read_list( Key::Scripts, [this]( JsonTokenizer& t ) { read_script( t, model.scripts.emplace_back() ); } );
+		read_list( Key::Shapes, [this]( JsonTokenizer& t ) { read_shape( t ); } );
+		read_nodes();
+		read_list( Key::Animations, [this]( JsonTokenizer& t ) { read_animation( t, model.animations.emplace_back( model ) ); } );
+		read_list( Key::Lights, [this]( JsonTokenizer& t ) { read_light( t, model.lights.emplace_back() ); } );
+
+		if ( sections[size_t( Key::Scenes )] )
+		{
+			read_list( Key::Scenes, [this]( JsonTokenizer& t ) { read_scene( t, model.scenes.emplace_back() ); } );
+			model.load_nodes();
+			model.select_scenes( scene );
+		}
+
+		// Wait for the buffers, rethrowing loading errors
+		if ( loading.valid() )
+		{
+			loading.get();
+		}
+		model.load_used_buffers();
+		model.convert_topology();
+		model.enter( LoadProgress::Stage::Done );
+	}
+
+  private:
+	/// Records where the sections are, as lights, scripts and shapes
+	/// are nested they are recorded under their own key
+	void scan()
+	{
+		auto t = JsonTokenizer( begin, end );
+		t.object( [&]( Key key ) {
+			switch ( key )
+			{
+			case Key::Scene: scene = t.integer<size_t>(); break;
+			case Key::Extras:
+				t.object( [&]( Key key ) {
+					if ( key == Key::Scripts || key == Key::Shapes )
+					{
+						sections[size_t( key )] = t.position();
+					}
+					t.skip();
+				} );
+				break;
+			case Key::Extensions:
+				t.object( [&]( Key key ) {
+					if ( key != Key::KhrLightsPunctual )
+					{
+						return t.skip();
+					}
+					t.object( [&]( Key key ) {
+						if ( key == Key::Lights )
+						{
+							sections[size_t( key )] = t.position();
+						}
+						t.skip();
+					} );
+				} );
+				break;
+			case Key::Unknown: t.skip(); break;
+			default:
+				sections[size_t( key )] = t.position();
+				t.skip();
+				break;
+			}
+		} );
+
+		if ( t.peek() != 0 )
+		{
+			t.error( "unexpected content after the root" );
+		}
+	}
+
+	/// Forgets where the sections which are not wanted start, so they are never read
+	void forget_unwanted()
+	{
+		auto& wanted = model.options.sections;
+		auto forget = [this]( const bool keep, std::initializer_list<Key> keys ) {
+			for ( auto key : keys )
+			{
+				if ( !keep )
+				{
+					sections[size_t( key )] = nullptr;
+				}
+			}
+		};
+
+		forget( wanted.cameras, { Key::Cameras } );
+		forget( wanted.materials, { Key::Samplers, Key::Images, Key::Textures, Key::Materials } );
+		forget( wanted.meshes, { Key::Meshes } );
+		forget( wanted.nodes, { Key::Nodes } );
+		forget( wanted.animations, { Key::Animations } );
+		forget( wanted.lights, { Key::Lights } );
+		forget( wanted.scripts, { Key::Scripts } );
+		forget( wanted.shapes, { Key::Shapes } );
+		forget( wanted.scenes, { Key::Scenes } );
+	}
+
+	template <typename F>
+	void read_section( const Key key, F f )
+	{
+		if ( auto start = sections[size_t( key )] )
+		{
+			auto t = JsonTokenizer( begin, end, start );
+			f( t );
+		}
+	}
+
+	/// Calls the function for each element of an array section
+	template <typename F>
+	void read_list( const Key key, F f )
+	{
+		read_section( key, [&f]( JsonTokenizer& t ) { t.array( [&] { f( t ); } ); } );
+	}
+
+	/// @return The string at the current position
+	static std::string text( JsonTokenizer& t )
+	{
+		return std::string( t.string() );
+	}
+
+	void read_asset( JsonTokenizer& t )
+	{
+		t.object( [&]( Key key ) {
+			switch ( key )
+			{
+			case Key::Version: model.asset.version = text( t ); break;
+			case Key::Generator: model.asset.generator = text( t ); break;
+			case Key::Copyright: model.asset.copyright = text( t ); break;
+			default: t.skip(); break;
+			}
+		} );
+	}
+
+	void read_buffer( JsonTokenizer& t, ByteBuffer& buffer )
+	{
+		size_t byte_length = 0;
+		auto has_uri = false;
+		std::string uri;
+
+		t.object( [&]( Key key ) {
+			switch ( key )
+			{
+			case Key::ByteLength: byte_length = t.integer<size_t>(); break;
+			case Key::Uri: uri = text( t ); has_uri = true; break;
+			default: t.skip(); break;
+			}
+		} );
+
+		model.init_buffer( buffer, byte_length, has_uri ? &uri : nullptr, bin );
+	}
+
+	void read_buffer_view( JsonTokenizer& t, BufferView& view )
+	{
+		t.object( [&]( Key key ) {
+			switch ( key )
+			{
+			case Key::Buffer: view.buffer = Handle<ByteBuffer>( model.buffers, t.integer<size_t>() ); break;
+			case Key::ByteOffset: view.byte_offset = t.integer<size_t>(); break;
+			case Key::ByteLength: view.byte_length = t.integer<size_t>(); break;
+			case Key::ByteStride: view.byte_stride = t.integer<size_t>(); break;
+			case Key::Target: view.target = static_cast<BufferView::Target>( t.integer<size_t>() ); break;
+			default: t.skip(); break;
+			}
+		} );
+	}
+
+	void read_camera( JsonTokenizer& t, GltfCamera& camera )
+	{
+		GltfCamera::Ortographic orthographic;
+		GltfCamera::Perspective perspective;
+		auto type = GltfCamera::Type::Perspective;
+
+		t.object( [&]( Key key ) {
+			switch ( key )
+			{
+			case Key::Type:
+				type = t.string() == "orthographic" ? GltfCamera::Type::Ortographic : GltfCamera::Type::Perspective;
+				break;
+			case Key::Orthographic:
+				t.object( [&]( Key key ) {
+					switch ( key )
+					{
+					case Key::Xmag: orthographic.xmag = t.real(); break;
+					case Key::Ymag: orthographic.ymag = t.real(); break;
+					case Key::Zfar: orthographic.zfar = t.real(); break;
+					case Key::Znear: orthographic.znear = t.real(); break;
+					default: t.skip(); break;
+					}
+				} );
+				break;
+			case Key::Perspective:
+				t.object( [&]( Key key ) {
+					switch ( key )
+					{
+					case Key::AspectRatio: perspective.aspect_ratio = t.real(); break;
+					case Key::Yfov: perspective.yfov = t.real(); break;
+					case Key::Zfar: perspective.zfar = t.real(); break;
+					case Key::Znear: perspective.znear = t.real(); break;
+					default: t.skip(); break;
+					}
+				} );
+				break;
+			case Key::Name: camera.name = text( t ); break;
+			default: t.skip(); break;
+			}
+		} );
+
+		// Only the projection of that type is taken
+		camera.type = type;
+		if ( type == GltfCamera::Type::Ortographic )
+		{
+			camera.orthographic = orthographic;
+		}
+		else
+		{
+			camera.perspective = perspective;
+		}
+	}
+
+	void read_sampler( JsonTokenizer& t, GltfSampler& sampler )
+	{
+		t.object( [&]( Key key ) {
+			switch ( key )
+			{
+			case Key::MagFilter: sampler.magFilter = static_cast<GltfSampler::Filter>( t.integer<int>() ); break;
+			case Key::MinFilter: sampler.minFilter = static_cast<GltfSampler::Filter>( t.integer<int>() ); break;
+			case Key::WrapS: sampler.wrapS = static_cast<GltfSampler::Wrapping>( t.integer<int>() ); break;
+			case Key::WrapT: sampler.wrapT = static_cast<GltfSampler::Wrapping>( t.integer<int>() ); break;
+			case Key::Name: sampler.name = text( t ); break;
+			default: t.skip(); break;
+			}
+		} );
+	}
+
+	void read_image( JsonTokenizer& t, GltfImage& image )
+	{
+		t.object( [&]( Key key ) {
+			switch ( key )
+			{
+			case Key::Uri: model.init_image_uri( image, text( t ) ); break;
+			case Key::MimeType: image.mime_type = text( t ); break;
+			case Key::BufferView: image.buffer_view = t.integer<uint32_t>(); break;
+			case Key::Name: image.name = text( t ); break;
+			default: t.skip(); break;
+			}
+		} );
+	}
+
+	void read_texture( JsonTokenizer& t, GltfTexture& texture )
+	{
+		t.object( [&]( Key key ) {
+			switch ( key )
+			{
+			case Key::Sampler: texture.sampler = Handle<GltfSampler>( model.samplers, t.integer<size_t>() ); break;
+			case Key::Source: texture.source = Handle<GltfImage>( model.images, t.integer<int32_t>() ); break;
+			case Key::Name: texture.name = text( t ); break;
+			default: t.skip(); break;
+			}
+		} );
+	}
+
+	void read_accessor( JsonTokenizer& t, Accessor& accessor )
+	{
+		t.object( [&]( Key key ) {
+			switch ( key )
+			{
+			case Key::BufferView:
+				accessor.buffer_view = Handle<BufferView>( model.buffer_views, t.integer<size_t>() );
+				break;
+			case Key::ByteOffset: accessor.byte_offset = t.integer<size_t>(); break;
+			case Key::ComponentType:
+				accessor.component_type = static_cast<Accessor::ComponentType>( t.integer<int>() );
+				break;
+			case Key::Count: accessor.count = t.integer<size_t>(); break;
+			case Key::Normalized: accessor.normalized = t.boolean(); break;
+			case Key::Type: accessor.type = from_string<Accessor::Type>( text( t ) ); break;
+			case Key::Max: t.array( [&] { accessor.max.push_back( t.real() ); } ); break;
+			case Key::Min: t.array( [&] { accessor.min.push_back( t.real() ); } ); break;
+			case Key::Sparse:
+				accessor.sparse = std::make_shared<Accessor::Sparse>();
+				read_sparse( t, *accessor.sparse );
+				break;
+			default: t.skip(); break;
+			}
+		} );
+	}
+
+	void read_sparse( JsonTokenizer& t, Accessor::Sparse& sparse )
+	{
+		t.object( [&]( Key key ) {
+			switch ( key )
+			{
+			case Key::Count: sparse.count = t.integer<size_t>(); break;
+			case Key::Indices:
+				t.object( [&]( Key key ) {
+					switch ( key )
+					{
+					case Key::BufferView:
+						sparse.indices.buffer_view = Handle<BufferView>( model.buffer_views, t.integer<size_t>() );
+						break;
+					case Key::ByteOffset: sparse.indices.byte_offset = t.integer<size_t>(); break;
+					case Key::ComponentType:
+						sparse.indices.component_type = static_cast<Accessor::ComponentType>( t.integer<int>() );
+						break;
+					default: t.skip(); break;
+					}
+				} );
+				break;
+			case Key::Values:
+				t.object( [&]( Key key ) {
+					switch ( key )
+					{
+					case Key::BufferView:
+						sparse.values.buffer_view = Handle<BufferView>( model.buffer_views, t.integer<size_t>() );
+						break;
+					case Key::ByteOffset: sparse.values.byte_offset = t.integer<size_t>(); break;
+					default: t.skip(); break;
+					}
+				} );
+				break;
+			default: t.skip(); break;
+			}
+		} );
+	}
+
+	void read_material( JsonTokenizer& t, Material& material )
+	{
+		t.object( [&]( Key key ) {
+			switch ( key )
+			{
+			case Key::Name: material.name = text( t ); break;
+			case Key::PbrMetallicRoughness:
+				t.object( [&]( Key key ) {
+					switch ( key )
+					{
+					case Key::BaseColorFactor:
+					{
+						auto color = t.reals<4>();
+						material.pbr.color.r = color[0];
+						material.pbr.color.g = color[1];
+						material.pbr.color.b = color[2];
+						material.pbr.color.a = color[3];
+						break;
+					}
+					case Key::BaseColorTexture:
+						t.object( [&]( Key key ) {
+							if ( key == Key::Index )
+							{
+								material.texture_handle = Handle<GltfTexture>( model.textures, t.integer<size_t>() );
+							}
+							else
+							{
+								t.skip();
+							}
+						} );
+						break;
+					case Key::MetallicFactor: material.pbr.metallic = t.real(); break;
+					case Key::RoughnessFactor: material.pbr.roughness = t.real(); break;
+					default: t.skip(); break;
+					}
+				} );
+				break;
+			default: t.skip(); break;
+			}
+		} );
+	}
+
+	void read_primitive( JsonTokenizer& t, Primitive& primitive )
+	{
+		t.object( [&]( Key key ) {
+			switch ( key )
+			{
+			case Key::Attributes:
+				t.object( [&]( Key key ) {
+					auto accessor = Handle<Accessor>( model.accessors, t.integer<unsigned>() );
+					primitive.attributes.emplace( to_semantic( key ), accessor );
+				} );
+				break;
+			case Key::Indices:
+				primitive.indices_handle = Handle<Accessor>( model.accessors, t.integer<int32_t>() );
+				break;
+			case Key::Material:
+			{
+				auto index = t.integer<int32_t>();
+				if ( model.options.sections.materials )
+				{
+					primitive.material = Handle<Material>( model.materials, index );
+				}
+				break;
+			}
+			case Key::Mode: primitive.mode = static_cast<Primitive::Mode>( t.integer<int>() ); break;
+			default: t.skip(); break;
+			}
+		} );
+	}
+
+	void read_mesh( JsonTokenizer& t, Mesh& mesh )
+	{
+		mesh.model = &model;
+
+		t.object( [&]( Key key ) {
+			switch ( key )
+			{
+			case Key::Name: mesh.name = text( t ); break;
+			case Key::Primitives: t.array( [&] { read_primitive( t, mesh.primitives.emplace_back() ); } ); break;
+			default: t.skip(); break;
+			}
+		} );
+	}
+
+	void read_light( JsonTokenizer& t, Light& light )
+	{
+		auto spot = light.spot;
+		auto has_spot = false;
+		std::string type;
+
+		t.object( [&]( Key key ) {
+			switch ( key )
+			{
+			case Key::Name: light.name = text( t ); break;
+			case Key::Color:
+			{
+				auto color = t.reals<3>();
+				light.color.set( color[0], color[1], color[2] );
+				break;
+			}
+			case Key::Intensity: light.intensity = t.real(); break;
+			case Key::Range: light.range = t.real(); break;
+			case Key::Type: type = text( t ); break;
+			case Key::Spot:
+				has_spot = true;
+				t.object( [&]( Key key ) {
+					switch ( key )
+					{
+					case Key::InnerConeAngle: spot.inner_cone_angle = t.real(); break;
+					case Key::OuterConeAngle: spot.outer_cone_angle = t.real(); break;
+					default: t.skip(); break;
+					}
+				} );
+				break;
+			default: t.skip(); break;
+			}
+		} );
+
+		if ( type == "point" )
+		{
+			light.type = Light::Type::Point;
+		}
+		else if ( type == "directional" )
+		{
+			light.type = Light::Type::Directional;
+		}
+		else if ( type == "spot" )
+		{
+			light.type = Light::Type::Spot;
+			if ( has_spot )
+			{
+				light.spot = spot;
+			}
+		}
+		else if ( !type.empty() )
+		{
+			assert( false && "Invalid light type" );
+		}
+	}
+
+	void read_node( JsonTokenizer& t, Node& node, std::vector<size_t>& children )
+	{
+		node.model = &model;
+		auto& wanted = model.options.sections;
+
+		t.object( [&]( Key key ) {
+			switch ( key )
+			{
+			case Key::Name: node.name = text( t ); break;
+			case Key::Camera:
+			{
+				auto index = t.integer<unsigned>();
+				node.camera = wanted.cameras ? &model.cameras[index] : nullptr;
+				break;
+			}
+			case Key::Matrix: node.matrix = math::Mat4( t.reals<16>().data() ); break;
+			case Key::Mesh:
+			{
+				auto index = t.integer<size_t>();
+				if ( wanted.meshes )
+				{
+					node.mesh = Handle<Mesh>( model.meshes, index );
+				}
+				break;
+			}
+			case Key::Rotation:
+			{
+				auto q = t.reals<4>();
+				node.rotation = math::Quat{ q[3], q[0], q[1], q[2] };
+				break;
+			}
+			case Key::Scale:
+			{
+				auto s = t.reals<3>();
+				node.scale = math::Vec3{ s[0], s[1], s[2] };
+				break;
+			}
+			case Key::Translation:
+			{
+				auto v = t.reals<3>();
+				node.translation = math::Vec3{ v[0], v[1], v[2] };
+				break;
+			}
+			case Key::Children: t.integers( children ); break;
+			case Key::Extensions:
+				t.object( [&]( Key key ) {
+					if ( key != Key::KhrLightsPunctual )
+					{
+						return t.skip();
+					}
+					t.object( [&]( Key key ) {
+						if ( key == Key::Light && wanted.lights )
+						{
+							node.light_index = t.integer<int32_t>();
+						}
+						else
+						{
+							t.skip();
+						}
+					} );
+				} );
+				break;
+			case Key::Extras:
+				t.object( [&]( Key key ) {
+					switch ( key )
+					{
+					case Key::Bounds:
+						if ( !wanted.shapes )
+						{
+							return t.skip();
+						}
+						node.bounds = t.integer<int32_t>();
+						break;
+					case Key::Scripts:
+						if ( !wanted.scripts )
+						{
+							return t.skip();
+						}
+						t.integers( node.scripts_indices );
+						break;
+					default: t.skip(); break;
+					}
+				} );
+				break;
+			default: t.skip(); break;
+			}
+		} );
+	}
+
+	void read_nodes()
+	{
+		auto first = model.nodes->size();
+		std::vector<std::vector<size_t>> children;
+		read_list( Key::Nodes, [&]( JsonTokenizer& t ) { read_node( t, *model.nodes.push(), children.emplace_back() ); } );
+
+		// Children are resolved once all nodes exist
+		for ( size_t i = 0; i < children.size(); ++i )
+		{
+			auto& node = ( *model.nodes )[first + i];
+			for ( auto index : children[i] )
+			{
+				node.children.emplace_back( model.nodes, index );
+			}
+		}
+	}
+
+	void read_animation( JsonTokenizer& t, Animation& animation )
+	{
+		// Channels refer to samplers which may come later
+		struct Channel
+		{
+			size_t sampler = 0;
+			bool has_node = false;
+			size_t node = 0;
+			std::string path;
+		};
+		std::vector<Channel> channels;
+
+		t.object( [&]( Key key ) {
+			switch ( key )
+			{
+			case Key::Name: animation.name = text( t ); break;
+			case Key::Samplers:
+				t.array( [&] {
+					Animation::Sampler sampler;
+					t.object( [&]( Key key ) {
+						switch ( key )
+						{
+						case Key::Input: sampler.input = Handle<Accessor>( model.accessors, t.integer<size_t>() ); break;
+						case Key::Output: sampler.output = Handle<Accessor>( model.accessors, t.integer<size_t>() ); break;
+						case Key::Interpolation:
+							sampler.interpolation = from_string<Animation::Sampler::Interpolation>( text( t ) );
+							break;
+						default: t.skip(); break;
+						}
+					} );
+					animation.samplers->push_back( std::move( sampler ) );
+				} );
+				break;
+			case Key::Channels:
+				t.array( [&] {
+					auto& channel = channels.emplace_back();
+					t.object( [&]( Key key ) {
+						switch ( key )
+						{
+						case Key::Sampler: channel.sampler = t.integer<size_t>(); break;
+						case Key::Target:
+							t.object( [&]( Key key ) {
+								switch ( key )
+								{
+								case Key::Node:
+									channel.node = t.integer<size_t>();
+									channel.has_node = true;
+									break;
+								case Key::Path: channel.path = text( t ); break;
+								default: t.skip(); break;
+								}
+							} );
+							break;
+						default: t.skip(); break;
+						}
+					} );
+				} );
+				break;
+			default: t.skip(); break;
+			}
+		} );
+
+		for ( auto& c : channels )
+		{
+			Animation::Channel channel;
+			channel.sampler = Handle<Animation::Sampler>( animation.samplers, c.sampler );
+			if ( c.has_node )
+			{
+				channel.target.node = Handle<Node>( model.nodes, c.node );
+			}
+			channel.target.path = from_string<Animation::Target::Path>( c.path );
+			animation.channels->push_back( std::move( channel ) );
+		}
+	}
+
+	void read_shape( JsonTokenizer& t )
+	{
+		std::string type;
+		math::Vec3 a, b, o;
+		float r = 0.0f;
+
+		auto vec3 = [&t] {
+			auto v = t.reals<3>();
+			return math::Vec3{ v[0], v[1], v[2] };
+		};
+
+		t.object( [&]( Key key ) {
+			switch ( key )
+			{
+			case Key::Type: type = text( t ); break;
+			case Key::Box:
+				t.object( [&]( Key key ) {
+					switch ( key )
+					{
+					case Key::A: a = vec3(); break;
+					case Key::B: b = vec3(); break;
+					default: t.skip(); break;
+					}
+				} );
+				break;
+			case Key::Sphere:
+				t.object( [&]( Key key ) {
+					switch ( key )
+					{
+					case Key::O: o = vec3(); break;
+					case Key::R: r = t.real(); break;
+					default: t.skip(); break;
+					}
+				} );
+				break;
+			default: t.skip(); break;
+			}
+		} );
+
+		if ( type == "box" )
+		{
+			model.boxes.emplace_back( Box{ a, b } );
+		}
+		else if ( type == "sphere" )
+		{
+			model.spheres.emplace_back( Sphere{ o, r } );
+		}
+		else
+		{
+			throw std::runtime_error{ "Type not supported: " + type };
+		}
+	}
+
+	void read_script( JsonTokenizer& t, Script& script )
+	{
+		auto has_name = false;
+		t.object( [&]( Key key ) {
+			switch ( key )
+			{
+			case Key::Uri: script.uri = text( t ); break;
+			case Key::Name: script.name = text( t ); has_name = true; break;
+			default: t.skip(); break;
+			}
+		} );
+
+		if ( !has_name )
+		{
+			script.name = script.uri;
+		}
+	}
+
+	void read_scene( JsonTokenizer& t, Scene& scene )
+	{
+		scene.model = &model;
+
+		t.object( [&]( Key key ) {
+			switch ( key )
+			{
+			case Key::Name: scene.name = text( t ); break;
+			case Key::Nodes:
+				t.array( [&] { scene.nodes.emplace_back( model.nodes, t.integer<size_t>() ); } );
+				break;
+			default: t.skip(); break;
+			}
+		} );
+	}
+
+	Gltf& model;
+
+	const char* begin;
+	const char* end;
+
+	/// Binary chunk of a GLB
+	ByteSpan bin;
+
+	/// Where each section starts, null when missing
+	std::array<const char*, 256> sections = {};
+
+	/// Index of the default scene
+	size_t scene = 0;
+};
+
+
+Gltf Gltf::load_tokenized( const ByteSpan& text, const std::string& path, const LoadOptions& options, ByteSpan bin )
+{
+	Gltf model;
+	model.path = path.substr( 0, path.find_last_of( "/\\" ) );
+	model.options = options;
+	model.options.sections = options.sections.resolved();
+
+	GltfTokenizer( model, text, bin ).read();
+	return model;
+}
+
+
+} // namespace spot::gfx
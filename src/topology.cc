@@ -0,0 +1,169 @@
+#include "spot/gltf/topology.h"
+
+#include <type_traits>
+
+#include "spot/gltf/assembly.h"
+#include "spot/gltf/gltf.h"
+#include "spot/gltf/parallel.h"
+
+namespace spot::gfx
+{
+
+
+Primitive::Mode get_list_mode( const Primitive::Mode mode )
+{
+	switch ( mode )
+	{
+	case Primitive::Mode::LINE_LOOP:
+	case Primitive::Mode::LINE_STRIP: return Primitive::Mode::LINES;
+	case Primitive::Mode::TRIANGLE_STRIP:
+	case Primitive::Mode::TRIANGLE_FAN: return Primitive::Mode::TRIANGLES;
+	default: return mode;
+	}
+}
+
+
+/// Writes the triangles of a strip or a fan, always storing the triangle and moving on
+/// only when it is not degenerate, so the loop has no branch to mispredict on stitched strips
+/// @return The number of indices written, at most three for every index after the first two
+template <typename T>
+size_t unroll_triangles( const T* in, const size_t count, const bool fan, T* out )
+{
+	size_t written = 0;
+	for ( size_t i = 0; i + 2 < count; ++i )
+	{
+		// Odd triangles of a strip swap their last two vertices to keep the winding
+		auto odd = i & 1;
+		T a = fan ? in[i + 1] : in[i];
+		T b = fan ? in[i + 2] : in[i + 1 + odd];
+		T c = fan ? in[0] : in[i + 2 - odd];
+		out[written] = a;
+		out[written + 1] = b;
+		out[written + 2] = c;
+		written += ( a != b && b != c && c != a ) * 3;
+	}
+	return written;
+}
+
+
+/// Writes the segments of a line strip, closing it for a loop of more than two indices,
+/// as the closing segment of two would repeat the only one
+/// @return The number of indices written
+template <typename T>
+size_t unroll_lines( const T* in, const size_t count, const bool loop, T* out )
+{
+	if ( count < 2 )
+	{
+		return 0;
+	}
+
+	for ( size_t i = 0; i + 1 < count; ++i )
+	{
+		out[i * 2] = in[i];
+		out[i * 2 + 1] = in[i + 1];
+	}
+
+	auto written = ( count - 1 ) * 2;
+	if ( loop && count > 2 )
+	{
+		out[written] = in[count - 1];
+		out[written + 1] = in[0];
+		written += 2;
+	}
+	return written;
+}
+
+
+Indices convert_to_list( const Indices& indices, const Primitive::Mode mode )
+{
+	auto count = indices.size();
+	size_t list_count = 0;
+	switch ( mode )
+	{
+	case Primitive::Mode::LINE_STRIP: list_count = count > 1 ? ( count - 1 ) * 2 : 0; break;
+	case Primitive::Mode::LINE_LOOP: list_count = count > 2 ? count * 2 : count == 2 ? 2 : 0; break;
+	case Primitive::Mode::TRIANGLE_STRIP:
+	case Primitive::Mode::TRIANGLE_FAN: list_count = count > 2 ? ( count - 2 ) * 3 : 0; break;
+	default: return indices;
+	}
+
+	auto ret = Indices( indices.get_component_type(), list_count );
+	auto written = indices.visit( [&ret, mode]( auto in, const size_t count ) {
+		using T = std::remove_const_t<std::remove_pointer_t<decltype( in )>>;
+		auto out = reinterpret_cast<T*>( ret.data() );
+		switch ( mode )
+		{
+		case Primitive::Mode::LINE_STRIP: return unroll_lines( in, count, false, out );
+		case Primitive::Mode::LINE_LOOP: return unroll_lines( in, count, true, out );
+		case Primitive::Mode::TRIANGLE_STRIP: return unroll_triangles( in, count, false, out );
+		default: return unroll_triangles( in, count, true, out );
+		}
+	} );
+	ret.resize( written );
+	return ret;
+}
+
+
+bool convert_to_list( Primitive& primitive )
+{
+	auto mode = get_list_mode( primitive.mode );
+	if ( mode == primitive.mode )
+	{
+		return false;
+	}
+
+	auto& indices = primitive.indices;
+	if ( indices.empty() )
+	{
+		assemble_indices( primitive );
+	}
+	if ( indices.empty() && !primitive.indices_handle )
+	{
+		// Byte indices need support renderers may lack, so vertices in order get at least 16 bits
+		auto vertex_count = get_vertex_count( primitive );
+		auto component_type = Indices::get_component_type( vertex_count );
+		if ( component_type == Accessor::ComponentType::UNSIGNED_BYTE )
+		{
+			component_type = Accessor::ComponentType::UNSIGNED_SHORT;
+		}
+		indices = Indices( component_type, vertex_count );
+		indices.visit( []( auto data, const size_t count ) {
+			for ( size_t i = 0; i < count; ++i )
+			{
+				data[i] = i;
+			}
+		} );
+	}
+
+	indices = convert_to_list( indices, primitive.mode );
+	primitive.mode = mode;
+	return true;
+}
+
+
+size_t convert_to_lists( Gltf& model, const uint32_t threads )
+{
+	auto primitives = get_primitives( model );
+	std::vector<char> converted( primitives.size() );
+	parallel_for( primitives.size(), threads, [&primitives, &converted]( size_t i ) {
+		converted[i] = convert_to_list( *primitives[i] );
+	} );
+
+	// Accessors are added on this thread, as handles can not be pushed concurrently
+	size_t ret = 0;
+	for ( size_t i = 0; i < primitives.size(); ++i )
+	{
+		if ( converted[i] )
+		{
+			++ret;
+			if ( !primitives[i]->attributes.empty() )
+			{
+				store_indices( model, *primitives[i] );
+			}
+		}
+	}
+	return ret;
+}
+
+
+} // namespace spot::gfx
@@ -0,0 +1,1489 @@
+#include "spot/gltf/gltf.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+
+#include "spot/gltf/assembly.h"
+
+#include "glb.h"
+
+namespace spot::gfx
+{
+
+
+/// Buffers coalesced in the saved buffer start at multiples of this,
+/// which suits any component type and vector loads
+constexpr uint64_t save_alignment = 16;
+
+
+/// @return The value rounded up to a multiple of the alignment
+uint64_t align_save_offset( const uint64_t value, const uint64_t alignment )
+{
+	return ( value + alignment - 1 ) / alignment * alignment;
+}
+
+
+/// Where every byte of a saved model goes, all buffers coalesced in a single one.
+/// Only accessors and buffer views something saved refers to are kept, so those replaced
+/// by mesh passes are left out, along with their bytes
+struct SaveLayout
+{
+	/// Bytes made for the vertices or indices of a runtime primitive
+	struct View
+	{
+		std::vector<char> bytes;
+
+		/// Offset in the saved buffer
+		uint64_t offset = 0;
+
+		BufferView::Target target = BufferView::Target::None;
+	};
+
+	/// Accessor made for the vertices or indices of a runtime primitive
+	struct Generated
+	{
+		/// Index among the views made here
+		size_t view = 0;
+
+		Accessor::ComponentType component_type = Accessor::ComponentType::FLOAT;
+
+		Accessor::Type type = Accessor::Type::SCALAR;
+
+		size_t count = 0;
+
+		std::vector<float> min;
+
+		std::vector<float> max;
+	};
+
+	/// Accessors made for a primitive which only has vertices and indices in memory
+	struct Runtime
+	{
+		/// Indices among the accessors made here
+		std::vector<std::pair<Primitive::Semantic, size_t>> attributes;
+
+		/// Index among the accessors made here, if the primitive has indices
+		size_t indices = ~size_t( 0 );
+	};
+
+	/// Appends bytes to the saved buffer, along with an accessor looking at them
+	/// @return The index of the new accessor
+	template <typename T>
+	size_t add( const std::vector<T>& values, BufferView::Target target, Accessor::ComponentType component_type,
+		Accessor::Type type, size_t count );
+
+	/// Whether any byte goes in the saved buffer
+	bool has_bin() const { return !model_views.empty() || !views.empty(); }
+
+	/// New index of every accessor of the model, none when nothing saved refers to it
+	std::vector<size_t> accessor_indices;
+
+	/// Accessors of the model which are saved, in their new order
+	std::vector<size_t> model_accessors;
+
+	/// New index of every buffer view of the model, none when nothing saved refers to it
+	std::vector<size_t> view_indices;
+
+	/// Buffer views of the model which are saved, in their new order,
+	/// with their offset in the saved buffer
+	std::vector<std::pair<size_t, uint64_t>> model_views;
+
+	std::vector<View> views;
+
+	std::vector<Generated> accessors;
+
+	/// Runtime primitives by mesh and primitive index, where levels of detail
+	/// are meshes following the ones of the model, as they are written
+	std::map<std::pair<size_t, size_t>, Runtime> runtime;
+
+	/// Length of the saved buffer
+	uint64_t length = 0;
+};
+
+
+template <typename T>
+size_t SaveLayout::add( const std::vector<T>& values, const BufferView::Target target,
+	const Accessor::ComponentType component_type, const Accessor::Type type, const size_t count )
+{
+	auto& view = views.emplace_back();
+	view.bytes.resize( values.size() * sizeof( T ) );
+	std::memcpy( view.bytes.data(), values.data(), view.bytes.size() );
+	view.offset = align_save_offset( length, save_alignment );
+	view.target = target;
+	length = view.offset + view.bytes.size();
+
+	auto& accessor = accessors.emplace_back();
+	accessor.view = views.size() - 1;
+	accessor.component_type = component_type;
+	accessor.type = type;
+	accessor.count = count;
+	return accessors.size() - 1;
+}
+
+
+/// Keeps the accessors of the model which saved primitives and animations refer to,
+/// then their buffer views and those of images, laid out after the bytes made so far
+void plan_references( const Gltf& model, SaveLayout& layout )
+{
+	layout.accessor_indices.assign( model.accessors->size(), ~size_t( 0 ) );
+	layout.view_indices.assign( model.buffer_views->size(), ~size_t( 0 ) );
+	auto keep_accessor = [&layout]( const Handle<Accessor>& accessor ) {
+		if ( accessor )
+		{
+			layout.accessor_indices[accessor.get_index()] = 0;
+		}
+	};
+	auto keep_view = [&layout]( const Handle<BufferView>& view ) {
+		if ( view )
+		{
+			layout.view_indices[view.get_index()] = 0;
+		}
+	};
+
+	// Runtime primitives are written from the accessors made for them
+	auto keep_primitives = [&]( const std::vector<Primitive>& primitives, const size_t m ) {
+		for ( size_t p = 0; p < primitives.size(); ++p )
+		{
+			if ( layout.runtime.count( { m, p } ) )
+			{
+				continue;
+			}
+			for ( auto& [semantic, accessor] : primitives[p].attributes )
+			{
+				keep_accessor( accessor );
+			}
+			keep_accessor( primitives[p].indices_handle );
+		}
+	};
+	auto lod_mesh = model.meshes->size();
+	for ( size_t m = 0; m < model.meshes->size(); ++m )
+	{
+		keep_primitives( ( *model.meshes )[m].primitives, m );
+	}
+	for ( auto& mesh : *model.meshes )
+	{
+		for ( auto& lod : mesh.lods )
+		{
+			keep_primitives( lod.primitives, lod_mesh++ );
+		}
+	}
+	for ( auto& animation : model.animations )
+	{
+		for ( auto& sampler : *animation.samplers )
+		{
+			keep_accessor( sampler.input );
+			keep_accessor( sampler.output );
+		}
+	}
+
+	for ( size_t i = 0; i < layout.accessor_indices.size(); ++i )
+	{
+		if ( layout.accessor_indices[i] == ~size_t( 0 ) )
+		{
+			continue;
+		}
+		layout.accessor_indices[i] = layout.model_accessors.size();
+		layout.model_accessors.push_back( i );
+
+		auto& accessor = ( *model.accessors )[i];
+		keep_view( accessor.buffer_view );
+		if ( accessor.sparse )
+		{
+			keep_view( accessor.sparse->indices.buffer_view );
+			keep_view( accessor.sparse->values.buffer_view );
+		}
+	}
+	for ( auto& image : *model.images )
+	{
+		if ( image.uri.empty() && image.buffer_view < layout.view_indices.size() )
+		{
+			layout.view_indices[image.buffer_view] = 0;
+		}
+	}
+
+	// Only the bytes of the views are saved, not the whole buffers they look into
+	for ( size_t i = 0; i < layout.view_indices.size(); ++i )
+	{
+		if ( layout.view_indices[i] == ~size_t( 0 ) )
+		{
+			continue;
+		}
+		layout.view_indices[i] = layout.model_views.size();
+		layout.length = align_save_offset( layout.length, save_alignment );
+		layout.model_views.emplace_back( i, layout.length );
+		layout.length += ( *model.buffer_views )[i].byte_length;
+	}
+}
+
+
+/// Lays out the bytes of primitives which only have vertices and indices in memory,
+/// followed by the buffer views of the model which are saved.
+/// Their normals are written only when every vertex has a unit one, as glTF requires,
+/// so the placeholder of vertices which never got a normal is left out
+SaveLayout plan_save( const Gltf& model )
+{
+	SaveLayout layout;
+
+	for ( size_t m = 0; m < model.meshes->size(); ++m )
+	{
+		auto& primitives = ( *model.meshes )[m].primitives;
+		for ( size_t p = 0; p < primitives.size(); ++p )
+		{
+			auto& primitive = primitives[p];
+			if ( !primitive.attributes.empty() || primitive.vertices.empty() )
+			{
+				continue;
+			}
+
+			std::vector<float> positions;
+			std::vector<float> normals;
+			auto has_normals = has_unit_normals( primitive );
+			std::vector<float> colors;
+			std::vector<float> texcoords;
+			std::vector<float> min = { INFINITY, INFINITY, INFINITY };
+			std::vector<float> max = { -INFINITY, -INFINITY, -INFINITY };
+			for ( auto& vertex : primitive.vertices )
+			{
+				float position[3] = { vertex.p.x, vertex.p.y, vertex.p.z };
+				for ( size_t i = 0; i < 3; ++i )
+				{
+					min[i] = std::min( min[i], position[i] );
+					max[i] = std::max( max[i], position[i] );
+				}
+				positions.insert( positions.end(), position, position + 3 );
+				normals.insert( normals.end(), { vertex.n.x, vertex.n.y, vertex.n.z } );
+				colors.insert( colors.end(), { vertex.c.r, vertex.c.g, vertex.c.b, vertex.c.a } );
+				texcoords.insert( texcoords.end(), { vertex.t.x, vertex.t.y } );
+			}
+
+			auto count = primitive.vertices.size();
+			auto& runtime = layout.runtime[{ m, p }];
+			auto position = layout.add( positions, BufferView::Target::ArrayBuffer, Accessor::ComponentType::FLOAT,
+				Accessor::Type::VEC3, count );
+			layout.accessors[position].min = std::move( min );
+			layout.accessors[position].max = std::move( max );
+			runtime.attributes.emplace_back( Primitive::Semantic::POSITION, position );
+			if ( has_normals )
+			{
+				runtime.attributes.emplace_back( Primitive::Semantic::NORMAL,
+					layout.add( normals, BufferView::Target::ArrayBuffer, Accessor::ComponentType::FLOAT, Accessor::Type::VEC3, count ) );
+			}
+			runtime.attributes.emplace_back( Primitive::Semantic::COLOR_0,
+				layout.add( colors, BufferView::Target::ArrayBuffer, Accessor::ComponentType::FLOAT, Accessor::Type::VEC4, count ) );
+			runtime.attributes.emplace_back( Primitive::Semantic::TEXCOORD_0,
+				layout.add( texcoords, BufferView::Target::ArrayBuffer, Accessor::ComponentType::FLOAT, Accessor::Type::VEC2, count ) );
+
+			if ( !primitive.indices.empty() )
+			{
+				auto& indices = primitive.indices;
+				runtime.indices = layout.add( indices.get_bytes(), BufferView::Target::ElementArrayBuffer,
+					indices.get_component_type(), Accessor::Type::SCALAR, indices.size() );
+			}
+		}
+	}
+
+	// Levels of detail of runtime primitives share their vertices, with their own indices
+	auto lod_mesh = model.meshes->size();
+	for ( size_t m = 0; m < model.meshes->size(); ++m )
+	{
+		auto& mesh = ( *model.meshes )[m];
+		for ( auto& lod : mesh.lods )
+		{
+			for ( size_t p = 0; p < lod.primitives.size(); ++p )
+			{
+				auto base = layout.runtime.find( { m, p } );
+				auto& primitive = lod.primitives[p];
+				if ( base == layout.runtime.end() || !primitive.attributes.empty() )
+				{
+					continue;
+				}
+
+				auto& runtime = layout.runtime[{ lod_mesh, p }];
+				runtime.attributes = base->second.attributes;
+				runtime.indices = base->second.indices;
+				if ( !primitive.indices.empty() )
+				{
+					auto& indices = primitive.indices;
+					runtime.indices = layout.add( indices.get_bytes(), BufferView::Target::ElementArrayBuffer,
+						indices.get_component_type(), Accessor::Type::SCALAR, indices.size() );
+				}
+			}
+			++lod_mesh;
+		}
+	}
+
+	plan_references( model, layout );
+	return layout;
+}
+
+
+/// Writes json text straight to a stream, keeping track of the separators
+class JsonWriter
+{
+  public:
+	JsonWriter( std::ostream& o ) : out { o } {}
+
+	/// Starts an object, as a value or as the member with that key
+	void begin_object( const char* key = nullptr ) { begin( key, '{' ); }
+
+	void end_object() { end( '}' ); }
+
+	/// Starts an array, as a value or as the member with that key
+	void begin_array( const char* key = nullptr ) { begin( key, '[' ); }
+
+	void end_array() { end( ']' ); }
+
+	/// Writes the key of the next value
+	void key( const char* k )
+	{
+		separate();
+		string( k, std::strlen( k ) );
+		out.put( ':' );
+		keyed = true;
+	}
+
+	void value( const std::string& s )
+	{
+		separate();
+		string( s.data(), s.size() );
+	}
+
+	void value( float f )
+	{
+		if ( !std::isfinite( f ) )
+		{
+			throw std::runtime_error{ "Number not valid in json" };
+		}
+		// The shortest text reading back the same float, with a dot whatever the locale
+		char text[32];
+		auto result = std::to_chars( text, text + sizeof( text ), f );
+		separate();
+		out.write( text, result.ptr - text );
+	}
+
+	void value( bool b )
+	{
+		separate();
+		out << ( b ? "true" : "false" );
+	}
+
+	void value( uint64_t n )
+	{
+		char text[24];
+		auto len = std::snprintf( text, sizeof( text ), "%llu", static_cast<unsigned long long>( n ) );
+		separate();
+		out.write( text, len );
+	}
+
+	void value( uint32_t n ) { value( uint64_t( n ) ); }
+
+	void value( int32_t n )
+	{
+		char text[16];
+		auto len = std::snprintf( text, sizeof( text ), "%d", n );
+		separate();
+		out.write( text, len );
+	}
+
+	/// Writes a key followed by its value
+	template <typename T>
+	void member( const char* k, const T& v )
+	{
+		key( k );
+		value( v );
+	}
+
+	/// Writes a key followed by an array of floats
+	void floats( const char* k, const float* values, const size_t count )
+	{
+		begin_array( k );
+		for ( size_t i = 0; i < count; ++i )
+		{
+			value( values[i] );
+		}
+		end_array();
+	}
+
+  private:
+	void begin( const char* k, const char bracket )
+	{
+		if ( k )
+		{
+			key( k );
+		}
+		separate();
+		out.put( bracket );
+		first.push_back( true );
+	}
+
+	void end( const char bracket )
+	{
+		first.pop_back();
+		out.put( bracket );
+	}
+
+	/// Puts a comma before any value which is not the first of its parent, or follows a key
+	void separate()
+	{
+		if ( keyed )
+		{
+			keyed = false;
+			return;
+		}
+		if ( !first.empty() )
+		{
+			if ( !first.back() )
+			{
+				out.put( ',' );
+			}
+			first.back() = false;
+		}
+	}
+
+	void string( const char* s, const size_t size )
+	{
+		out.put( '"' );
+		for ( size_t i = 0; i < size; ++i )
+		{
+			auto c = s[i];
+			switch ( c )
+			{
+				case '"':
+					out.write( "\\\"", 2 );
+					break;
+				case '\\':
+					out.write( "\\\\", 2 );
+					break;
+				case '\n':
+					out.write( "\\n", 2 );
+					break;
+				case '\r':
+					out.write( "\\r", 2 );
+					break;
+				case '\t':
+					out.write( "\\t", 2 );
+					break;
+				default:
+					if ( uint8_t( c ) < 0x20 )
+					{
+						char escaped[8];
+						std::snprintf( escaped, sizeof( escaped ), "\\u%04x", unsigned( c ) );
+						out.write( escaped, 6 );
+					}
+					else
+					{
+						// UTF-8 sequences go through as they are
+						out.put( c );
+					}
+			}
+		}
+		out.put( '"' );
+	}
+
+	std::ostream& out;
+
+	/// Whether the open objects and arrays have no values yet
+	std::vector<bool> first;
+
+	/// Whether a key has just been written
+	bool keyed = false;
+};
+
+
+/// @return The name of a semantic in a glTF json
+const char* get_gltf_name( const Primitive::Semantic semantic )
+{
+	switch ( semantic )
+	{
+		case Primitive::Semantic::POSITION:
+			return "POSITION";
+		case Primitive::Semantic::NORMAL:
+			return "NORMAL";
+		case Primitive::Semantic::TANGENT:
+			return "TANGENT";
+		case Primitive::Semantic::TEXCOORD_0:
+			return "TEXCOORD_0";
+		case Primitive::Semantic::TEXCOORD_1:
+			return "TEXCOORD_1";
+		case Primitive::Semantic::COLOR_0:
+			return "COLOR_0";
+		case Primitive::Semantic::JOINTS_0:
+			return "JOINTS_0";
+		case Primitive::Semantic::WEIGHTS_0:
+			return "WEIGHTS_0";
+		default:
+			throw std::runtime_error{ "Semantic not valid" };
+	}
+}
+
+
+/// @return The name of an interpolation in a glTF json
+const char* get_gltf_name( const Animation::Sampler::Interpolation interpolation )
+{
+	switch ( interpolation )
+	{
+		case Animation::Sampler::Interpolation::Step:
+			return "STEP";
+		case Animation::Sampler::Interpolation::Cubicspline:
+			return "CUBICSPLINE";
+		default:
+			return "LINEAR";
+	}
+}
+
+
+/// @return The name of a target path in a glTF json
+const char* get_gltf_name( const Animation::Target::Path path )
+{
+	switch ( path )
+	{
+		case Animation::Target::Path::Translation:
+			return "translation";
+		case Animation::Target::Path::Rotation:
+			return "rotation";
+		case Animation::Target::Path::Scale:
+			return "scale";
+		case Animation::Target::Path::Weights:
+			return "weights";
+		default:
+			throw std::runtime_error{ "Animation path not valid" };
+	}
+}
+
+
+/// @return The name of a light type in a glTF json
+const char* get_gltf_name( const Light::Type type )
+{
+	switch ( type )
+	{
+		case Light::Type::Directional:
+			return "directional";
+		case Light::Type::Spot:
+			return "spot";
+		default:
+			return "point";
+	}
+}
+
+
+/// @return Whether vertex attributes which glTF defines as floats are stored as integers,
+/// which needs KHR_mesh_quantization
+bool has_quantized_attributes( const Gltf& model )
+{
+	for ( auto& mesh : *model.meshes )
+	{
+		for ( auto& primitive : mesh.primitives )
+		{
+			for ( auto& [semantic, accessor] : primitive.attributes )
+			{
+				auto needs_float = semantic == Primitive::Semantic::POSITION || semantic == Primitive::Semantic::NORMAL ||
+					semantic == Primitive::Semantic::TANGENT || semantic == Primitive::Semantic::TEXCOORD_0 ||
+					semantic == Primitive::Semantic::TEXCOORD_1;
+				if ( needs_float && accessor && accessor->component_type != Accessor::ComponentType::FLOAT )
+				{
+					return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+
+/// Splits a column-major transform without shear into the translation, rotation and scale
+/// of a node, as animated nodes can not have a matrix
+void decompose_transform( const float* m, float* translation, float* rotation, float* scale )
+{
+	translation[0] = m[12];
+	translation[1] = m[13];
+	translation[2] = m[14];
+
+	// Columns scaled back to unit length, a mirroring one flipping the sign of x
+	for ( size_t c = 0; c < 3; ++c )
+	{
+		scale[c] = std::sqrt( m[c * 4] * m[c * 4] + m[c * 4 + 1] * m[c * 4 + 1] + m[c * 4 + 2] * m[c * 4 + 2] );
+	}
+	auto det = m[0] * ( m[5] * m[10] - m[9] * m[6] ) - m[4] * ( m[1] * m[10] - m[9] * m[2] ) +
+		m[8] * ( m[1] * m[6] - m[5] * m[2] );
+	if ( det < 0.0f )
+	{
+		scale[0] = -scale[0];
+	}
+
+	// Element at row i and column j of the rotation
+	auto r = [m, scale]( const size_t i, const size_t j ) {
+		return scale[j] != 0.0f ? m[j * 4 + i] / scale[j] : float( i == j );
+	};
+	float x, y, z, w;
+	auto trace = r( 0, 0 ) + r( 1, 1 ) + r( 2, 2 );
+	if ( trace > 0.0f )
+	{
+		auto s = std::sqrt( trace + 1.0f ) * 2.0f;
+		w = 0.25f * s;
+		x = ( r( 2, 1 ) - r( 1, 2 ) ) / s;
+		y = ( r( 0, 2 ) - r( 2, 0 ) ) / s;
+		z = ( r( 1, 0 ) - r( 0, 1 ) ) / s;
+	}
+	else if ( r( 0, 0 ) > r( 1, 1 ) && r( 0, 0 ) > r( 2, 2 ) )
+	{
+		auto s = std::sqrt( 1.0f + r( 0, 0 ) - r( 1, 1 ) - r( 2, 2 ) ) * 2.0f;
+		w = ( r( 2, 1 ) - r( 1, 2 ) ) / s;
+		x = 0.25f * s;
+		y = ( r( 0, 1 ) + r( 1, 0 ) ) / s;
+		z = ( r( 0, 2 ) + r( 2, 0 ) ) / s;
+	}
+	else if ( r( 1, 1 ) > r( 2, 2 ) )
+	{
+		auto s = std::sqrt( 1.0f + r( 1, 1 ) - r( 0, 0 ) - r( 2, 2 ) ) * 2.0f;
+		w = ( r( 0, 2 ) - r( 2, 0 ) ) / s;
+		x = ( r( 0, 1 ) + r( 1, 0 ) ) / s;
+		y = 0.25f * s;
+		z = ( r( 1, 2 ) + r( 2, 1 ) ) / s;
+	}
+	else
+	{
+		auto s = std::sqrt( 1.0f + r( 2, 2 ) - r( 0, 0 ) - r( 1, 1 ) ) * 2.0f;
+		w = ( r( 1, 0 ) - r( 0, 1 ) ) / s;
+		x = ( r( 0, 2 ) + r( 2, 0 ) ) / s;
+		y = ( r( 1, 2 ) + r( 2, 1 ) ) / s;
+		z = 0.25f * s;
+	}
+	rotation[0] = x;
+	rotation[1] = y;
+	rotation[2] = z;
+	rotation[3] = w;
+}
+
+
+void Gltf::write_json( std::ostream& out, const SaveLayout& layout, const std::string& bin_uri ) const
+{
+	JsonWriter w( out );
+	w.begin_object();
+
+	w.begin_object( "asset" );
+	w.member( "version", asset.version.empty() ? std::string( "2.0" ) : asset.version );
+	if ( !asset.generator.empty() )
+	{
+		w.member( "generator", asset.generator );
+	}
+	if ( !asset.copyright.empty() )
+	{
+		w.member( "copyright", asset.copyright );
+	}
+	w.end_object();
+
+	if ( scene )
+	{
+		w.member( "scene", uint64_t( scene - scenes.data() ) );
+	}
+
+	if ( !scenes.empty() )
+	{
+		w.begin_array( "scenes" );
+		for ( auto& s : scenes )
+		{
+			w.begin_object();
+			w.member( "name", s.name );
+			if ( !s.nodes.empty() )
+			{
+				w.begin_array( "nodes" );
+				for ( auto& node : s.nodes )
+				{
+					w.value( uint64_t( node.get_index() ) );
+				}
+				w.end_array();
+			}
+			w.end_object();
+		}
+		w.end_array();
+	}
+
+	// Levels of detail are written as meshes following the ones of the model, and
+	// nodes using them follow the nodes of the model, referred by their MSFT_lod
+	std::vector<size_t> lod_meshes( meshes->size() );
+	auto lod_mesh_count = meshes->size();
+	for ( size_t m = 0; m < meshes->size(); ++m )
+	{
+		lod_meshes[m] = lod_mesh_count;
+		lod_mesh_count += ( *meshes )[m].lods.size();
+	}
+	std::vector<std::pair<const Node*, size_t>> lod_nodes;
+
+	// Targets of animations can only have a translation, rotation and scale
+	std::vector<char> animated( nodes->size() );
+	for ( auto& animation : animations )
+	{
+		for ( auto& channel : *animation.channels )
+		{
+			if ( channel.target.node )
+			{
+				animated[channel.target.node.get_index()] = 1;
+			}
+		}
+	}
+
+	// A node is written with either a matrix or its parts, never both, composing
+	// them into the matrix it was loaded with unless the node is animated
+	auto write_transform = [&w]( const Node& node, const bool animated ) {
+		float matrix[16];
+		static_assert( sizeof( matrix ) == sizeof( math::Mat4 ), "Matrix is written as 16 floats" );
+		auto& r = node.rotation;
+		auto& s = node.scale;
+		auto& t = node.translation;
+		float rotation[4] = { r.x, r.y, r.z, r.w };
+		float scale[3] = { s.x, s.y, s.z };
+		float translation[3] = { t.x, t.y, t.z };
+		if ( std::memcmp( &node.matrix, &math::Mat4::identity, sizeof( matrix ) ) != 0 )
+		{
+			auto transform = node.get_matrix();
+			std::memcpy( matrix, &transform, sizeof( matrix ) );
+			if ( !animated )
+			{
+				w.floats( "matrix", matrix, 16 );
+				return;
+			}
+			decompose_transform( matrix, translation, rotation, scale );
+		}
+		if ( rotation[0] != 0.0f || rotation[1] != 0.0f || rotation[2] != 0.0f || rotation[3] != 1.0f )
+		{
+			w.floats( "rotation", rotation, 4 );
+		}
+		if ( scale[0] != 1.0f || scale[1] != 1.0f || scale[2] != 1.0f )
+		{
+			w.floats( "scale", scale, 3 );
+		}
+		if ( translation[0] != 0.0f || translation[1] != 0.0f || translation[2] != 0.0f )
+		{
+			w.floats( "translation", translation, 3 );
+		}
+	};
+
+	if ( !nodes->empty() )
+	{
+		w.begin_array( "nodes" );
+		for ( auto& node : *nodes )
+		{
+			w.begin_object();
+			w.member( "name", node.name );
+			if ( node.camera )
+			{
+				w.member( "camera", uint64_t( node.camera - cameras.data() ) );
+			}
+			if ( !node.children.empty() )
+			{
+				w.begin_array( "children" );
+				for ( auto& child : node.children )
+				{
+					w.value( uint64_t( child.get_index() ) );
+				}
+				w.end_array();
+			}
+			if ( node.mesh )
+			{
+				w.member( "mesh", uint64_t( node.mesh.get_index() ) );
+			}
+			write_transform( node, animated[&node - nodes->data()] );
+			auto lod_count = node.mesh ? node.mesh->lods.size() : 0;
+			if ( node.light_index >= 0 || lod_count )
+			{
+				w.begin_object( "extensions" );
+				if ( node.light_index >= 0 )
+				{
+					w.begin_object( "KHR_lights_punctual" );
+					w.member( "light", node.light_index );
+					w.end_object();
+				}
+				if ( lod_count )
+				{
+					w.begin_object( "MSFT_lod" );
+					w.begin_array( "ids" );
+					for ( size_t l = 0; l < lod_count; ++l )
+					{
+						w.value( uint64_t( nodes->size() + lod_nodes.size() ) );
+						lod_nodes.emplace_back( &node, l );
+					}
+					w.end_array();
+					w.end_object();
+				}
+				w.end_object();
+			}
+			if ( node.bounds >= 0 || !node.scripts_indices.empty() )
+			{
+				w.begin_object( "extras" );
+				if ( node.bounds >= 0 )
+				{
+					w.member( "bounds", node.bounds );
+				}
+				if ( !node.scripts_indices.empty() )
+				{
+					w.begin_array( "scripts" );
+					for ( auto index : node.scripts_indices )
+					{
+						w.value( uint64_t( index ) );
+					}
+					w.end_array();
+				}
+				w.end_object();
+			}
+			w.end_object();
+		}
+
+		// Nodes of the levels of detail are not in any scene nor hierarchy, as MSFT_lod
+		// expects, so viewers ignoring the extension draw only the full level. Those
+		// supporting it put a level in place of its base node, hence the same transform
+		for ( auto& [node, l] : lod_nodes )
+		{
+			auto m = node->mesh.get_index();
+			w.begin_object();
+			w.member( "name", node->name + "_lod" + std::to_string( l + 1 ) );
+			w.member( "mesh", uint64_t( lod_meshes[m] + l ) );
+			write_transform( *node, false );
+			w.end_object();
+		}
+		w.end_array();
+	}
+
+	auto write_primitives = [&]( const std::vector<Primitive>& primitives, const size_t m ) {
+		w.begin_array( "primitives" );
+		for ( size_t p = 0; p < primitives.size(); ++p )
+		{
+			auto& primitive = primitives[p];
+			w.begin_object();
+			w.begin_object( "attributes" );
+			if ( auto it = layout.runtime.find( { m, p } ); it != layout.runtime.end() )
+			{
+				for ( auto& [semantic, index] : it->second.attributes )
+				{
+					w.member( get_gltf_name( semantic ), uint64_t( layout.model_accessors.size() + index ) );
+				}
+				w.end_object();
+				if ( it->second.indices != ~size_t( 0 ) )
+				{
+					w.member( "indices", uint64_t( layout.model_accessors.size() + it->second.indices ) );
+				}
+			}
+			else
+			{
+				// Semantics in a stable order
+				for ( auto semantic = uint32_t( Primitive::Semantic::POSITION );
+					semantic <= uint32_t( Primitive::Semantic::WEIGHTS_0 ); ++semantic )
+				{
+					auto found = primitive.attributes.find( Primitive::Semantic( semantic ) );
+					if ( found != primitive.attributes.end() )
+					{
+						w.member( get_gltf_name( found->first ), uint64_t( layout.accessor_indices[found->second.get_index()] ) );
+					}
+				}
+				w.end_object();
+				if ( primitive.indices_handle )
+				{
+					w.member( "indices", uint64_t( layout.accessor_indices[primitive.indices_handle.get_index()] ) );
+				}
+			}
+			if ( primitive.material )
+			{
+				w.member( "material", uint64_t( primitive.material.get_index() ) );
+			}
+			w.member( "mode", uint32_t( primitive.mode ) );
+			w.end_object();
+		}
+		w.end_array();
+	};
+
+	if ( !meshes->empty() )
+	{
+		w.begin_array( "meshes" );
+		for ( size_t m = 0; m < meshes->size(); ++m )
+		{
+			auto& mesh = ( *meshes )[m];
+			w.begin_object();
+			w.member( "name", mesh.name );
+			write_primitives( mesh.primitives, m );
+			if ( !mesh.weights.empty() )
+			{
+				w.floats( "weights", mesh.weights.data(), mesh.weights.size() );
+			}
+			w.end_object();
+		}
+		for ( size_t m = 0; m < meshes->size(); ++m )
+		{
+			auto& mesh = ( *meshes )[m];
+			for ( size_t l = 0; l < mesh.lods.size(); ++l )
+			{
+				w.begin_object();
+				w.member( "name", mesh.name + "_lod" + std::to_string( l + 1 ) );
+				write_primitives( mesh.lods[l].primitives, lod_meshes[m] + l );
+				if ( !mesh.weights.empty() )
+				{
+					w.floats( "weights", mesh.weights.data(), mesh.weights.size() );
+				}
+				w.begin_object( "extras" );
+				w.member( "error", mesh.lods[l].error );
+				w.end_object();
+				w.end_object();
+			}
+		}
+		w.end_array();
+	}
+
+	if ( !layout.model_accessors.empty() || !layout.accessors.empty() )
+	{
+		w.begin_array( "accessors" );
+		for ( auto index : layout.model_accessors )
+		{
+			auto& accessor = ( *accessors )[index];
+			w.begin_object();
+			if ( accessor.buffer_view )
+			{
+				w.member( "bufferView", uint64_t( layout.view_indices[accessor.buffer_view.get_index()] ) );
+			}
+			if ( accessor.byte_offset )
+			{
+				w.member( "byteOffset", uint64_t( accessor.byte_offset ) );
+			}
+			w.member( "componentType", uint32_t( accessor.component_type ) );
+			if ( accessor.normalized )
+			{
+				w.member( "normalized", true );
+			}
+			w.member( "count", uint64_t( accessor.count ) );
+			w.member( "type", to_string( accessor.type ) );
+			if ( !accessor.min.empty() )
+			{
+				w.floats( "min", accessor.min.data(), accessor.min.size() );
+			}
+			if ( !accessor.max.empty() )
+			{
+				w.floats( "max", accessor.max.data(), accessor.max.size() );
+			}
+			if ( accessor.sparse )
+			{
+				auto& sparse = *accessor.sparse;
+				w.begin_object( "sparse" );
+				w.member( "count", uint64_t( sparse.count ) );
+				w.begin_object( "indices" );
+				w.member( "bufferView", uint64_t( layout.view_indices[sparse.indices.buffer_view.get_index()] ) );
+				if ( sparse.indices.byte_offset )
+				{
+					w.member( "byteOffset", uint64_t( sparse.indices.byte_offset ) );
+				}
+				w.member( "componentType", uint32_t( sparse.indices.component_type ) );
+				w.end_object();
+				w.begin_object( "values" );
+				w.member( "bufferView", uint64_t( layout.view_indices[sparse.values.buffer_view.get_index()] ) );
+				if ( sparse.values.byte_offset )
+				{
+					w.member( "byteOffset", uint64_t( sparse.values.byte_offset ) );
+				}
+				w.end_object();
+				w.end_object();
+			}
+			w.end_object();
+		}
+		for ( auto& accessor : layout.accessors )
+		{
+			w.begin_object();
+			w.member( "bufferView", uint64_t( layout.model_views.size() + accessor.view ) );
+			w.member( "componentType", uint32_t( accessor.component_type ) );
+			w.member( "count", uint64_t( accessor.count ) );
+			w.member( "type", to_string( accessor.type ) );
+			if ( !accessor.min.empty() )
+			{
+				w.floats( "min", accessor.min.data(), accessor.min.size() );
+				w.floats( "max", accessor.max.data(), accessor.max.size() );
+			}
+			w.end_object();
+		}
+		w.end_array();
+	}
+
+	if ( layout.has_bin() )
+	{
+		w.begin_array( "bufferViews" );
+		for ( auto& [index, offset] : layout.model_views )
+		{
+			auto& view = ( *buffer_views )[index];
+			w.begin_object();
+			w.member( "buffer", uint32_t( 0 ) );
+			w.member( "byteOffset", offset );
+			w.member( "byteLength", uint64_t( view.byte_length ) );
+			if ( view.byte_stride )
+			{
+				w.member( "byteStride", uint64_t( view.byte_stride ) );
+			}
+			if ( view.target != BufferView::Target::None )
+			{
+				w.member( "target", uint32_t( view.target ) );
+			}
+			w.end_object();
+		}
+		for ( auto& view : layout.views )
+		{
+			w.begin_object();
+			w.member( "buffer", uint32_t( 0 ) );
+			w.member( "byteOffset", view.offset );
+			w.member( "byteLength", uint64_t( view.bytes.size() ) );
+			w.member( "target", uint32_t( view.target ) );
+			w.end_object();
+		}
+		w.end_array();
+	}
+
+	if ( layout.has_bin() )
+	{
+		w.begin_array( "buffers" );
+		w.begin_object();
+		w.member( "byteLength", layout.length );
+		if ( !bin_uri.empty() )
+		{
+			w.member( "uri", bin_uri );
+		}
+		w.end_object();
+		w.end_array();
+	}
+
+	if ( !cameras.empty() )
+	{
+		w.begin_array( "cameras" );
+		for ( auto& camera : cameras )
+		{
+			w.begin_object();
+			w.member( "name", camera.name );
+			if ( camera.type == GltfCamera::Type::Ortographic )
+			{
+				w.member( "type", std::string( "orthographic" ) );
+				w.begin_object( "orthographic" );
+				w.member( "xmag", camera.orthographic.xmag );
+				w.member( "ymag", camera.orthographic.ymag );
+				w.member( "zfar", camera.orthographic.zfar );
+				w.member( "znear", camera.orthographic.znear );
+				w.end_object();
+			}
+			else
+			{
+				w.member( "type", std::string( "perspective" ) );
+				w.begin_object( "perspective" );
+				if ( camera.perspective.aspect_ratio > 0.0f )
+				{
+					w.member( "aspectRatio", camera.perspective.aspect_ratio );
+				}
+				w.member( "yfov", camera.perspective.yfov );
+				w.member( "zfar", camera.perspective.zfar );
+				w.member( "znear", camera.perspective.znear );
+				w.end_object();
+			}
+			w.end_object();
+		}
+		w.end_array();
+	}
+
+	if ( !samplers->empty() )
+	{
+		w.begin_array( "samplers" );
+		for ( auto& sampler : *samplers )
+		{
+			w.begin_object();
+			w.member( "name", sampler.name );
+			if ( sampler.magFilter != GltfSampler::Filter::NONE )
+			{
+				w.member( "magFilter", uint32_t( sampler.magFilter ) );
+			}
+			if ( sampler.minFilter != GltfSampler::Filter::NONE )
+			{
+				w.member( "minFilter", uint32_t( sampler.minFilter ) );
+			}
+			w.member( "wrapS", uint32_t( sampler.wrapS ) );
+			w.member( "wrapT", uint32_t( sampler.wrapT ) );
+			w.end_object();
+		}
+		w.end_array();
+	}
+
+	if ( !images->empty() )
+	{
+		w.begin_array( "images" );
+		for ( auto& image : *images )
+		{
+			w.begin_object();
+			w.member( "name", image.name );
+			if ( !image.uri.empty() )
+			{
+				// Uris are stored relative to the directory of the model
+				auto prefix = path + "/";
+				auto relative = image.uri.compare( 0, prefix.size(), prefix ) == 0;
+				w.member( "uri", relative ? image.uri.substr( prefix.size() ) : image.uri );
+			}
+			else
+			{
+				w.member( "bufferView", uint64_t( layout.view_indices.at( image.buffer_view ) ) );
+			}
+			if ( !image.mime_type.empty() )
+			{
+				w.member( "mimeType", image.mime_type );
+			}
+			w.end_object();
+		}
+		w.end_array();
+	}
+
+	if ( !textures->empty() )
+	{
+		w.begin_array( "textures" );
+		for ( auto& texture : *textures )
+		{
+			w.begin_object();
+			w.member( "name", texture.name );
+			if ( texture.sampler )
+			{
+				w.member( "sampler", uint64_t( texture.sampler.get_index() ) );
+			}
+			if ( texture.source )
+			{
+				w.member( "source", uint64_t( texture.source.get_index() ) );
+			}
+			w.end_object();
+		}
+		w.end_array();
+	}
+
+	if ( !materials->empty() )
+	{
+		w.begin_array( "materials" );
+		for ( auto& material : *materials )
+		{
+			w.begin_object();
+			w.member( "name", material.name );
+			w.begin_object( "pbrMetallicRoughness" );
+			auto& c = material.pbr.color;
+			float color[4] = { c.r, c.g, c.b, c.a };
+			w.floats( "baseColorFactor", color, 4 );
+			if ( material.texture_handle )
+			{
+				w.begin_object( "baseColorTexture" );
+				w.member( "index", uint64_t( material.texture_handle.get_index() ) );
+				w.end_object();
+			}
+			w.member( "metallicFactor", material.pbr.metallic );
+			w.member( "roughnessFactor", material.pbr.roughness );
+			w.end_object();
+			w.end_object();
+		}
+		w.end_array();
+	}
+
+	if ( !animations.empty() )
+	{
+		w.begin_array( "animations" );
+		for ( auto& animation : animations )
+		{
+			w.begin_object();
+			w.member( "name", animation.name );
+			w.begin_array( "samplers" );
+			for ( auto& sampler : *animation.samplers )
+			{
+				w.begin_object();
+				w.member( "input", uint64_t( layout.accessor_indices[sampler.input.get_index()] ) );
+				w.member( "output", uint64_t( layout.accessor_indices[sampler.output.get_index()] ) );
+				w.member( "interpolation", std::string( get_gltf_name( sampler.interpolation ) ) );
+				w.end_object();
+			}
+			w.end_array();
+			w.begin_array( "channels" );
+			for ( auto& channel : *animation.channels )
+			{
+				w.begin_object();
+				w.member( "sampler", uint64_t( channel.sampler.get_index() ) );
+				w.begin_object( "target" );
+				if ( channel.target.node )
+				{
+					w.member( "node", uint64_t( channel.target.node.get_index() ) );
+				}
+				w.member( "path", std::string( get_gltf_name( channel.target.path ) ) );
+				w.end_object();
+				w.end_object();
+			}
+			w.end_array();
+			w.end_object();
+		}
+		w.end_array();
+	}
+
+	if ( !scripts.empty() || !boxes.empty() || !spheres.empty() )
+	{
+		w.begin_object( "extras" );
+		w.begin_array( "scripts" );
+		for ( auto& script : scripts )
+		{
+			w.begin_object();
+			w.member( "uri", script.uri );
+			w.member( "name", script.name );
+			w.end_object();
+		}
+		w.end_array();
+		w.begin_array( "shapes" );
+		for ( auto& box : boxes )
+		{
+			w.begin_object();
+			w.member( "type", std::string( "box" ) );
+			w.begin_object( "box" );
+			float a[3] = { box.a.x, box.a.y, box.a.z };
+			float b[3] = { box.b.x, box.b.y, box.b.z };
+			w.floats( "a", a, 3 );
+			w.floats( "b", b, 3 );
+			w.end_object();
+			w.end_object();
+		}
+		for ( auto& sphere : spheres )
+		{
+			w.begin_object();
+			w.member( "type", std::string( "sphere" ) );
+			w.begin_object( "sphere" );
+			float o[3] = { sphere.o.x, sphere.o.y, sphere.o.z };
+			w.floats( "o", o, 3 );
+			w.member( "r", sphere.r );
+			w.end_object();
+			w.end_object();
+		}
+		w.end_array();
+		w.end_object();
+	}
+
+	auto quantized = has_quantized_attributes( *this );
+	if ( !lights.empty() || quantized || !lod_nodes.empty() )
+	{
+		w.begin_array( "extensionsUsed" );
+		if ( !lights.empty() )
+		{
+			w.value( std::string( "KHR_lights_punctual" ) );
+		}
+		if ( quantized )
+		{
+			w.value( std::string( "KHR_mesh_quantization" ) );
+		}
+		if ( !lod_nodes.empty() )
+		{
+			w.value( std::string( "MSFT_lod" ) );
+		}
+		w.end_array();
+	}
+
+	if ( quantized )
+	{
+		w.begin_array( "extensionsRequired" );
+		w.value( std::string( "KHR_mesh_quantization" ) );
+		w.end_array();
+	}
+
+	if ( !lights.empty() )
+	{
+		w.begin_object( "extensions" );
+		w.begin_object( "KHR_lights_punctual" );
+		w.begin_array( "lights" );
+		for ( auto& light : lights )
+		{
+			w.begin_object();
+			w.member( "name", light.name );
+			w.member( "type", std::string( get_gltf_name( light.type ) ) );
+			float color[3] = { light.color.x, light.color.y, light.color.z };
+			w.floats( "color", color, 3 );
+			w.member( "intensity", light.intensity );
+			if ( light.range > 0.0f )
+			{
+				w.member( "range", light.range );
+			}
+			if ( light.type == Light::Type::Spot )
+			{
+				w.begin_object( "spot" );
+				w.member( "innerConeAngle", light.spot.inner_cone_angle );
+				w.member( "outerConeAngle", light.spot.outer_cone_angle );
+				w.end_object();
+			}
+			w.end_object();
+		}
+		w.end_array();
+		w.end_object();
+		w.end_object();
+	}
+
+	w.end_object();
+}
+
+
+/// Writes zeros, or another padding character
+void write_padding( std::ostream& out, uint64_t count, const char c = 0 )
+{
+	char padding[save_alignment];
+	std::memset( padding, c, sizeof( padding ) );
+	while ( count > 0 )
+	{
+		auto n = std::min<uint64_t>( count, sizeof( padding ) );
+		out.write( padding, n );
+		count -= n;
+	}
+}
+
+
+/// Streams the bytes of the saved buffer, without copying the buffers of the model
+void write_bin( std::ostream& out, Gltf& model, const SaveLayout& layout )
+{
+	uint64_t written = 0;
+	for ( auto& view : layout.views )
+	{
+		write_padding( out, view.offset - written );
+		out.write( view.bytes.data(), view.bytes.size() );
+		written = view.offset + view.bytes.size();
+	}
+	for ( auto& [index, offset] : layout.model_views )
+	{
+		auto& view = ( *model.buffer_views )[index];
+		auto& buffer = *view.buffer;
+		if ( view.byte_offset + view.byte_length > buffer.byte_length )
+		{
+			throw std::runtime_error{ "Buffer view out of its buffer: " + std::to_string( index ) };
+		}
+		write_padding( out, offset - written );
+		out.write( buffer.get_data() + view.byte_offset, view.byte_length );
+		written = offset + view.byte_length;
+	}
+}
+
+
+/// Writes a little endian 32 bit value
+void write_u32( std::ostream& out, const uint32_t value )
+{
+	char bytes[sizeof( value )];
+	std::memcpy( bytes, &value, sizeof( value ) );
+	out.write( bytes, sizeof( bytes ) );
+}
+
+
+/// Counts the characters written through it, discarding them
+class CountingBuffer : public std::streambuf
+{
+  public:
+	uint64_t count = 0;
+
+  protected:
+	int_type overflow( const int_type c ) override
+	{
+		if ( !traits_type::eq_int_type( c, traits_type::eof() ) )
+		{
+			++count;
+		}
+		return traits_type::not_eof( c );
+	}
+
+	std::streamsize xsputn( const char*, const std::streamsize n ) override
+	{
+		count += n;
+		return n;
+	}
+};
+
+
+void Gltf::save_glb( std::ostream& out )
+{
+	auto layout = plan_save( *this );
+
+	// The json is written twice, first to know its length
+	CountingBuffer counter;
+	std::ostream counting( &counter );
+	write_json( counting, layout, {} );
+
+	auto json_length = align_save_offset( counter.count, 4 );
+	auto has_bin = layout.has_bin();
+	auto bin_length = align_save_offset( layout.length, 4 );
+	auto length = glb_header_size + glb_chunk_header_size + json_length;
+	if ( has_bin )
+	{
+		length += glb_chunk_header_size + bin_length;
+	}
+	if ( length > glb_max_length )
+	{
+		throw std::runtime_error{ "Model too large for GLB: " + std::to_string( length ) + " bytes" };
+	}
+
+	write_u32( out, glb_magic );
+	write_u32( out, glb_version );
+	write_u32( out, uint32_t( length ) );
+
+	write_u32( out, uint32_t( json_length ) );
+	write_u32( out, glb_chunk_json );
+	write_json( out, layout, {} );
+	write_padding( out, json_length - counter.count, ' ' );
+
+	if ( has_bin )
+	{
+		write_u32( out, uint32_t( bin_length ) );
+		write_u32( out, glb_chunk_bin );
+		write_bin( out, *this, layout );
+		write_padding( out, bin_length - layout.length );
+	}
+
+	if ( !out )
+	{
+		throw std::runtime_error{ "Cannot write GLB" };
+	}
+}
+
+
+void Gltf::save_gltf( std::ostream& json, std::ostream& bin, const std::string& bin_uri )
+{
+	auto layout = plan_save( *this );
+
+	write_json( json, layout, bin_uri );
+	if ( layout.has_bin() )
+	{
+		write_bin( bin, *this, layout );
+	}
+
+	if ( !json || !bin )
+	{
+		throw std::runtime_error{ "Cannot write glTF" };
+	}
+}
+
+
+void Gltf::save( const std::string& file_path )
+{
+	auto name = file_path.find_last_of( "/\\" ) + 1;
+	auto dot = file_path.rfind( '.' );
+	auto extension = ( dot != std::string::npos && dot >= name ) ? file_path.substr( dot ) : std::string();
+
+	if ( extension == ".glb" )
+	{
+		std::ofstream out( file_path, std::ios::binary );
+		if ( !out.is_open() )
+		{
+			throw std::runtime_error{ "Cannot open file: " + file_path };
+		}
+		save_glb( out );
+		return;
+	}
+
+	auto bin_path = file_path.substr( 0, file_path.size() - extension.size() ) + ".bin";
+	std::ofstream json( file_path, std::ios::binary );
+	std::ofstream bin( bin_path, std::ios::binary );
+	if ( !json.is_open() || !bin.is_open() )
+	{
+		throw std::runtime_error{ "Cannot open file: " + file_path };
+	}
+	save_gltf( json, bin, bin_path.substr( name ) );
+
+	// No buffer, no bin file
+	if ( bin.tellp() == 0 )
+	{
+		bin.close();
+		std::remove( bin_path.c_str() );
+	}
+}
+
+
+} // namespace spot::gfx
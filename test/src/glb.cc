@@ -0,0 +1,102 @@
+#include "test.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <spot/gltf/gltf.h>
+
+namespace spot::gfx
+{
+
+
+/// @return A GLB container with the json and bin chunks
+std::vector<char> make_glb( std::string json, const std::vector<char>& bin )
+{
+	// Chunks are 4-byte aligned
+	json.resize( ( json.size() + 3 ) & ~size_t( 3 ), ' ' );
+	auto bin_length = ( bin.size() + 3 ) & ~size_t( 3 );
+
+	std::vector<char> glb;
+	auto push_u32 = [&glb]( uint32_t value ) {
+		auto bytes = reinterpret_cast<const char*>( &value );
+		glb.insert( std::end( glb ), bytes, bytes + sizeof( value ) );
+	};
+
+	push_u32( 0x46546C67 );
+	push_u32( 2 );
+	push_u32( uint32_t( 12 + 8 + json.size() + 8 + bin_length ) );
+
+	push_u32( uint32_t( json.size() ) );
+	push_u32( 0x4E4F534A );
+	glb.insert( std::end( glb ), std::begin( json ), std::end( json ) );
+
+	push_u32( uint32_t( bin_length ) );
+	push_u32( 0x004E4942 );
+	glb.insert( std::end( glb ), std::begin( bin ), std::end( bin ) );
+	glb.resize( glb.size() + bin_length - bin.size() );
+
+	return glb;
+}
+
+
+TEST_CASE( "load-glb" )
+{
+	const float positions[] = { 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f };
+	std::vector<char> bin( sizeof( positions ) );
+	std::memcpy( bin.data(), positions, sizeof( positions ) );
+
+	auto json = R"({
+		"asset": { "version": "2.0" },
+		"buffers": [ { "byteLength": 36 } ],
+		"bufferViews": [ { "buffer": 0, "byteLength": 36 } ],
+		"accessors": [ { "bufferView": 0, "componentType": 5126, "count": 3, "type": "VEC3" } ],
+		"meshes": [ { "primitives": [ { "attributes": { "POSITION": 0 } } ] } ]
+	})";
+
+	auto bytes = std::make_shared<std::vector<char>>( make_glb( json, bin ) );
+	auto model = Gltf::load_glb( { bytes->data(), bytes->size(), bytes } );
+
+	REQUIRE( model.buffers->size() == 1 );
+	auto& buffer = model.buffers->front();
+	REQUIRE( buffer.byte_length == 36 );
+
+	// The buffer looks into the BIN chunk without copying it
+	REQUIRE( buffer.data.empty() );
+	REQUIRE( buffer.get_data() >= bytes->data() );
+	REQUIRE( buffer.get_data() < bytes->data() + bytes->size() );
+
+	auto accessor = model.get_accessor( 0 );
+	REQUIRE( std::memcmp( accessor->get_data(), positions, sizeof( positions ) ) == 0 );
+
+	SECTION( "from-memory" )
+	{
+		// Caller owned bytes, recognised as GLB by their magic
+		auto glb = Gltf::load_from_memory( { bytes->data(), bytes->size() } );
+		REQUIRE( glb.buffers->front().get_data() >= bytes->data() );
+		REQUIRE( glb.buffers->front().get_data() < bytes->data() + bytes->size() );
+	}
+
+	SECTION( "truncated" )
+	{
+		// The header claims more bytes than there are
+		auto truncated = std::vector<char>( bytes->begin(), bytes->end() - 8 );
+		REQUIRE_THROWS_AS( Gltf::load_glb( { truncated.data(), truncated.size() } ), std::runtime_error );
+
+		auto path = std::string( "test-truncated.glb" );
+		std::ofstream( path, std::ios::binary ).write( truncated.data(), truncated.size() );
+		REQUIRE_THROWS_AS( Gltf::load( path ), std::runtime_error );
+		auto options = LoadOptions();
+		options.storage = ByteBuffer::Storage::Map;
+		REQUIRE_THROWS_AS( Gltf::load( path, options ), std::runtime_error );
+		std::remove( path.c_str() );
+	}
+
+	SECTION( "not-glb" )
+	{
+		std::vector<char> json_only( json, json + std::strlen( json ) );
+		REQUIRE_THROWS( Gltf::load_glb( { json_only.data(), json_only.size() } ) );
+	}
+}
+
+
+} // namespace spot::gfx
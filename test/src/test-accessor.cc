@@ -0,0 +1,567 @@
+#include "test.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+#include <random>
+#include <string>
+#include <spot/gltf/decode.h>
+#include <spot/gltf/gltf.h>
+
+namespace spot::gfx
+{
+
+
+/// Vertex interleaving a position and a 16 bit index, padded to 16 bytes
+struct Interleaved
+{
+	float position[3];
+	uint16_t index;
+	uint16_t padding;
+};
+
+
+/// Adds a buffer holding those bytes, with a view into it
+/// @return The view
+Handle<BufferView> add_view( Gltf& model, const void* bytes, size_t size, size_t stride = 0 )
+{
+	auto buffer = model.buffers.push();
+	buffer->byte_length = size;
+	buffer->data.resize( size );
+	std::memcpy( buffer->data.data(), bytes, size );
+
+	auto view = model.buffer_views.push();
+	view->buffer = buffer;
+	view->byte_length = size;
+	view->byte_stride = stride;
+	return view;
+}
+
+
+/// Adds a buffer holding those bytes, with a view and an accessor into it
+/// @return The accessor
+Handle<Accessor> add_accessor( Gltf& model, const void* bytes, size_t size, size_t stride, size_t offset,
+	Accessor::ComponentType component_type, Accessor::Type type, size_t count )
+{
+	auto view = add_view( model, bytes, size, stride );
+
+	auto accessor = model.accessors.push();
+	accessor->buffer_view = view;
+	accessor->byte_offset = offset;
+	accessor->component_type = component_type;
+	accessor->type = type;
+	accessor->count = count;
+	return accessor;
+}
+
+
+TEST_CASE( "accessor-view" )
+{
+	Gltf model;
+
+	std::vector<Interleaved> vertices( 4 );
+	for ( size_t i = 0; i < vertices.size(); ++i )
+	{
+		vertices[i] = { { float( i ), float( i ) * 2.0f, float( i ) * 3.0f }, uint16_t( 10 + i ), 0 };
+	}
+	auto size = vertices.size() * sizeof( Interleaved );
+
+	SECTION( "packed" )
+	{
+		float values[] = { 0.5f, 1.5f, 2.5f };
+		auto accessor = add_accessor(
+			model, values, sizeof( values ), 0, 0, Accessor::ComponentType::FLOAT, Accessor::Type::SCALAR, 3 );
+
+		auto view = AccessorView<float>( *accessor );
+		REQUIRE( view.size() == 3 );
+		REQUIRE( view.is_packed() );
+		REQUIRE( view[1] == 1.5f );
+		REQUIRE( view.back() == 2.5f );
+		REQUIRE( std::accumulate( view.begin(), view.end(), 0.0f ) == 4.5f );
+		REQUIRE( std::vector<float>( view.begin(), view.end() ) == std::vector<float>{ 0.5f, 1.5f, 2.5f } );
+	}
+
+	SECTION( "interleaved" )
+	{
+		auto positions = add_accessor( model, vertices.data(), size, sizeof( Interleaved ), 0,
+			Accessor::ComponentType::FLOAT, Accessor::Type::VEC3, vertices.size() );
+		auto indices = add_accessor( model, vertices.data(), size, sizeof( Interleaved ), offsetof( Interleaved, index ),
+			Accessor::ComponentType::UNSIGNED_SHORT, Accessor::Type::SCALAR, vertices.size() );
+
+		auto position_view = AccessorView<std::array<float, 3>>( *positions );
+		REQUIRE( position_view.stride() == sizeof( Interleaved ) );
+		REQUIRE( !position_view.is_packed() );
+		REQUIRE( position_view[3][2] == 9.0f );
+
+		auto index_view = AccessorView<uint16_t>( *indices );
+		auto it = index_view.begin();
+		REQUIRE( *it == 10 );
+		REQUIRE( it[3] == 13 );
+		REQUIRE( *( it + 2 ) == 12 );
+		REQUIRE( index_view.end() - it == 4 );
+		REQUIRE( *std::max_element( index_view.begin(), index_view.end() ) == 13 );
+	}
+
+	SECTION( "mismatch" )
+	{
+		auto indices = add_accessor( model, vertices.data(), size, sizeof( Interleaved ), offsetof( Interleaved, index ),
+			Accessor::ComponentType::UNSIGNED_SHORT, Accessor::Type::SCALAR, vertices.size() );
+		REQUIRE_THROWS( AccessorView<uint32_t>( *indices ) );
+		REQUIRE_THROWS( AccessorView<std::array<uint16_t, 2>>( *indices ) );
+
+		// One more element would go past the end of the view
+		indices->count += 1;
+		REQUIRE_THROWS( AccessorView<uint16_t>( *indices ) );
+
+		Accessor missing = {};
+		missing.component_type = Accessor::ComponentType::FLOAT;
+		missing.type = Accessor::Type::SCALAR;
+		missing.count = 1;
+		REQUIRE_THROWS( AccessorView<float>( missing ) );
+	}
+
+	SECTION( "animation" )
+	{
+		// Times interleaved with other data, which copying the whole accessor used to pick up
+		float times[] = { 0.0f, -1.0f, 0.5f, -1.0f, 2.0f, -1.0f };
+		auto input = add_accessor(
+			model, times, sizeof( times ), 2 * sizeof( float ), 0, Accessor::ComponentType::FLOAT, Accessor::Type::SCALAR, 3 );
+		math::Quat quats[] = { math::Quat::identity, math::Quat::identity, math::Quat::identity };
+		auto output = add_accessor(
+			model, quats, sizeof( quats ), 0, 0, Accessor::ComponentType::FLOAT, Accessor::Type::VEC4, 3 );
+
+		auto& animation = model.animations.emplace_back( model );
+		auto& sampler = animation.samplers->emplace_back();
+		sampler.input = input;
+		sampler.output = output;
+		auto& channel = animation.channels->emplace_back();
+		channel.sampler = Handle<Animation::Sampler>( animation.samplers, 0 );
+		channel.target.path = Animation::Target::Path::Rotation;
+
+		REQUIRE( animation.get_times( channel.sampler ) == std::vector<float>{ 0.0f, 0.5f, 2.0f } );
+		REQUIRE( animation.get_rotations( channel.sampler ).size() == 3 );
+		REQUIRE( animation.find_max_time() == 2.0f );
+	}
+}
+
+
+TEST_CASE( "accessor-view-benchmark", "[.benchmark]" )
+{
+	Gltf model;
+
+	std::vector<Interleaved> vertices( 1 << 20 );
+	for ( size_t i = 0; i < vertices.size(); ++i )
+	{
+		vertices[i] = { { float( i ), 1.0f, 2.0f }, uint16_t( i ), 0 };
+	}
+	auto positions = add_accessor( model, vertices.data(), vertices.size() * sizeof( Interleaved ), sizeof( Interleaved ),
+		0, Accessor::ComponentType::FLOAT, Accessor::Type::VEC3, vertices.size() );
+
+	BENCHMARK( "view" )
+	{
+		float sum = 0.0f;
+		for ( auto p : AccessorView<std::array<float, 3>>( *positions ) )
+		{
+			sum += p[0];
+		}
+		return sum;
+	};
+
+	BENCHMARK( "by hand" )
+	{
+		float sum = 0.0f;
+		auto data = positions->get_data();
+		for ( size_t i = 0; i < positions->count; ++i )
+		{
+			float p[3];
+			std::memcpy( p, data + i * positions->get_stride(), sizeof( p ) );
+			sum += p[0];
+		}
+		return sum;
+	};
+}
+
+
+/// Every component type with its name
+const std::pair<Accessor::ComponentType, const char*> component_types[] = {
+	{ Accessor::ComponentType::BYTE, "byte" },
+	{ Accessor::ComponentType::UNSIGNED_BYTE, "ubyte" },
+	{ Accessor::ComponentType::SHORT, "short" },
+	{ Accessor::ComponentType::UNSIGNED_SHORT, "ushort" },
+	{ Accessor::ComponentType::UNSIGNED_INT, "uint" },
+	{ Accessor::ComponentType::FLOAT, "float" },
+};
+
+
+/// @return Random bytes which are finite floats when read as such
+std::vector<uint8_t> random_components( const size_t size )
+{
+	std::mt19937 rng { uint32_t( size ) };
+	std::vector<uint8_t> bytes( size );
+	for ( auto& b : bytes )
+	{
+		// Keeps float exponents away from infinity and NaN
+		b = uint8_t( rng() ) & 0xbf;
+	}
+	return bytes;
+}
+
+
+TEST_CASE( "accessor-decode" )
+{
+	Gltf model;
+
+	SECTION( "normalized" )
+	{
+		int8_t bytes[] = { -128, -127, 0, 127 };
+		auto accessor = add_accessor(
+			model, bytes, sizeof( bytes ), 0, 0, Accessor::ComponentType::BYTE, Accessor::Type::VEC4, 1 );
+		REQUIRE( decode_floats( *accessor ) == std::vector<float>{ -128.0f, -127.0f, 0.0f, 127.0f } );
+		accessor->normalized = true;
+		REQUIRE( decode_floats( *accessor ) == std::vector<float>{ -1.0f, -1.0f, 0.0f, 1.0f } );
+
+		uint8_t ubytes[] = { 0, 255, 51 };
+		accessor = add_accessor(
+			model, ubytes, sizeof( ubytes ), 0, 0, Accessor::ComponentType::UNSIGNED_BYTE, Accessor::Type::SCALAR, 3 );
+		accessor->normalized = true;
+		REQUIRE( decode_floats( *accessor ) == std::vector<float>{ 0.0f, 1.0f, 0.2f } );
+
+		int16_t shorts[] = { -32768, 32767, 0, 0, 0, 0, 0 };
+		accessor = add_accessor(
+			model, shorts, sizeof( shorts ), 0, 0, Accessor::ComponentType::SHORT, Accessor::Type::SCALAR, 7 );
+		accessor->normalized = true;
+		REQUIRE( decode_floats( *accessor )[0] == -1.0f );
+		REQUIRE( decode_floats( *accessor )[1] == 1.0f );
+
+		uint16_t ushorts[] = { 65535, 0, 0, 0, 65535 };
+		accessor = add_accessor(
+			model, ushorts, sizeof( ushorts ), 0, 0, Accessor::ComponentType::UNSIGNED_SHORT, Accessor::Type::SCALAR, 5 );
+		accessor->normalized = true;
+		REQUIRE( decode_floats( *accessor ) == std::vector<float>{ 1.0f, 0.0f, 0.0f, 0.0f, 1.0f } );
+
+		uint32_t uints[] = { 4294967295u, 0, 65537, 16777217 };
+		accessor = add_accessor(
+			model, uints, sizeof( uints ), 0, 0, Accessor::ComponentType::UNSIGNED_INT, Accessor::Type::VEC4, 1 );
+		REQUIRE( decode_floats( *accessor ) == std::vector<float>{ 4294967296.0f, 0.0f, 65537.0f, 16777216.0f } );
+		accessor->normalized = true;
+		REQUIRE( decode_floats( *accessor )[0] == 1.0f );
+	}
+
+	SECTION( "matching scalar" )
+	{
+		// Every pair of component type and type, packed and interleaved, against the scalar decoder
+		auto bytes = random_components( 4096 );
+		for ( auto [component_type, name] : component_types )
+		{
+			for ( auto type : { Accessor::Type::SCALAR, Accessor::Type::VEC2, Accessor::Type::VEC3, Accessor::Type::VEC4,
+					  Accessor::Type::MAT2, Accessor::Type::MAT3, Accessor::Type::MAT4 } )
+			{
+				for ( size_t stride : { 0, 68 } )
+				{
+					for ( bool normalized : { false, true } )
+					{
+						auto accessor = add_accessor( model, bytes.data(), bytes.size(), stride, 4, component_type, type, 37 );
+						accessor->normalized = normalized;
+						std::vector<float> scalar( accessor->count * size_of( type ) );
+						decode_floats_scalar( *accessor, scalar.data() );
+						INFO( name << " " << to_string( type ) << " stride " << stride );
+						REQUIRE( decode_floats( *accessor ) == scalar );
+					}
+				}
+			}
+		}
+	}
+
+	SECTION( "interleaved" )
+	{
+		// Normalized 8 bit colors after a position
+		uint8_t vertices[] = { 0, 0, 0, 0, 255, 0, 51, 255, 0, 0, 0, 0, 0, 255, 0, 255 };
+		auto colors = add_accessor(
+			model, vertices, sizeof( vertices ), 8, 4, Accessor::ComponentType::UNSIGNED_BYTE, Accessor::Type::VEC3, 2 );
+		colors->normalized = true;
+		REQUIRE( decode_floats( *colors ) == std::vector<float>{ 1.0f, 0.0f, 0.2f, 0.0f, 1.0f, 0.0f } );
+	}
+
+	SECTION( "padded matrix" )
+	{
+		// Each column of three bytes is padded to four
+		int8_t matrix[] = { 1, 2, 3, 0, 4, 5, 6, 0, 7, 8, 9, 0 };
+		auto accessor = add_accessor(
+			model, matrix, sizeof( matrix ), 0, 0, Accessor::ComponentType::BYTE, Accessor::Type::MAT3, 1 );
+		REQUIRE( decode_floats( *accessor ) == std::vector<float>{ 1, 2, 3, 4, 5, 6, 7, 8, 9 } );
+
+		accessor->count = 2;
+		REQUIRE_THROWS( decode_floats( *accessor ) );
+	}
+
+	SECTION( "zeros" )
+	{
+		Accessor accessor = {};
+		accessor.component_type = Accessor::ComponentType::SHORT;
+		accessor.type = Accessor::Type::VEC2;
+		accessor.count = 3;
+		REQUIRE( decode_floats( accessor ) == std::vector<float>( 6, 0.0f ) );
+	}
+
+	SECTION( "halfs" )
+	{
+		REQUIRE( float_to_half( 1.0f ) == 0x3c00 );
+		REQUIRE( float_to_half( -2.0f ) == 0xc000 );
+		REQUIRE( float_to_half( 65504.0f ) == 0x7bff );
+		REQUIRE( float_to_half( 65519.0f ) == 0x7bff );
+		REQUIRE( float_to_half( 65520.0f ) == 0x7c00 );
+		REQUIRE( float_to_half( 1.0f / 16777216.0f ) == 0x0001 );
+		REQUIRE( float_to_half( 1.0f / 33554432.0f ) == 0x0000 );
+		REQUIRE( float_to_half( 1.0f + 1.0f / 2048.0f ) == 0x3c00 );
+		REQUIRE( float_to_half( 1.0f + 3.0f / 2048.0f ) == 0x3c02 );
+
+		// Every finite half survives a round trip
+		for ( uint32_t h = 0; h < 0x10000; ++h )
+		{
+			if ( ( h & 0x7c00 ) != 0x7c00 )
+			{
+				REQUIRE( float_to_half( half_to_float( uint16_t( h ) ) ) == h );
+			}
+		}
+
+		std::vector<float> floats( 1000 );
+		std::mt19937 rng { 7 };
+		std::uniform_real_distribution<float> distribution { -70000.0f, 70000.0f };
+		for ( auto& f : floats )
+		{
+			f = distribution( rng ) * ( rng() % 2 ? 1.0f : 1e-6f );
+		}
+		auto accessor = add_accessor( model, floats.data(), floats.size() * sizeof( float ), 0, 0,
+			Accessor::ComponentType::FLOAT, Accessor::Type::VEC4, floats.size() / 4 );
+		std::vector<uint16_t> halfs( floats.size() );
+		decode_halfs( *accessor, halfs.data() );
+		for ( size_t i = 0; i < floats.size(); ++i )
+		{
+			REQUIRE( halfs[i] == float_to_half( floats[i] ) );
+		}
+	}
+}
+
+
+TEST_CASE( "accessor-decode-benchmark", "[.benchmark]" )
+{
+	Gltf model;
+
+	constexpr size_t count = 1 << 20;
+	auto bytes = random_components( count * 16 );
+	std::vector<float> out( count * 4 );
+	std::vector<uint16_t> halfs( count * 4 );
+
+	for ( auto [component_type, name] : component_types )
+	{
+		auto packed = add_accessor(
+			model, bytes.data(), bytes.size(), 0, 0, component_type, Accessor::Type::VEC3, count );
+		packed->normalized = component_type != Accessor::ComponentType::FLOAT;
+		auto interleaved = add_accessor(
+			model, bytes.data(), bytes.size(), 16, 0, component_type, Accessor::Type::VEC3, count );
+		interleaved->normalized = packed->normalized;
+
+		BENCHMARK( std::string( name ) + " packed scalar" )
+		{
+			decode_floats_scalar( *packed, out.data() );
+			return out[0];
+		};
+
+		BENCHMARK( std::string( name ) + " packed" )
+		{
+			decode_floats( *packed, out.data() );
+			return out[0];
+		};
+
+		BENCHMARK( std::string( name ) + " interleaved scalar" )
+		{
+			decode_floats_scalar( *interleaved, out.data() );
+			return out[0];
+		};
+
+		BENCHMARK( std::string( name ) + " interleaved" )
+		{
+			decode_floats( *interleaved, out.data() );
+			return out[0];
+		};
+
+		BENCHMARK( std::string( name ) + " halfs" )
+		{
+			decode_halfs( *packed, halfs.data() );
+			return halfs[0];
+		};
+	}
+}
+
+
+/// Makes an accessor sparse, substituting values at those indices
+template <typename T>
+void add_sparse( Gltf& model, Accessor& accessor, const std::vector<uint32_t>& indices, const std::vector<T>& values )
+{
+	accessor.sparse = std::make_shared<Accessor::Sparse>();
+	accessor.sparse->count = indices.size();
+	accessor.sparse->indices.buffer_view = add_view( model, indices.data(), indices.size() * sizeof( uint32_t ) );
+	accessor.sparse->indices.component_type = Accessor::ComponentType::UNSIGNED_INT;
+	accessor.sparse->values.buffer_view = add_view( model, values.data(), values.size() * sizeof( T ) );
+}
+
+
+TEST_CASE( "accessor-sparse" )
+{
+	Gltf model;
+
+	std::vector<Interleaved> vertices( 5 );
+	for ( size_t i = 0; i < vertices.size(); ++i )
+	{
+		vertices[i] = { { float( i ), 0.0f, 0.0f }, uint16_t( i ), 0 };
+	}
+	auto positions = add_accessor( model, vertices.data(), vertices.size() * sizeof( Interleaved ),
+		sizeof( Interleaved ), 0, Accessor::ComponentType::FLOAT, Accessor::Type::VEC3, vertices.size() );
+	using P = std::array<float, 3>;
+	add_sparse( model, *positions, { 1, 4 }, std::vector<P>{ { 9, 9, 9 }, { 7, 7, 7 } } );
+
+	auto expected = std::vector<P>{ { 0, 0, 0 }, { 9, 9, 9 }, { 2, 0, 0 }, { 3, 0, 0 }, { 7, 7, 7 } };
+
+	SECTION( "overlay" )
+	{
+		auto view = SparseAccessorView<P>( *positions );
+		REQUIRE( view.size() == 5 );
+		REQUIRE( std::vector<P>( view.begin(), view.end() ) == expected );
+		REQUIRE( view[1] == P{ 9, 9, 9 } );
+		REQUIRE( view[3] == P{ 3, 0, 0 } );
+		REQUIRE( view.get_substitution_count() == 2 );
+		REQUIRE( view.get_substitution_index( 1 ) == 4 );
+		REQUIRE( view.get_base( 4 ) == P{ 4, 0, 0 } );
+
+		// Nothing has been made dense
+		REQUIRE( positions->sparse->dense.empty() );
+	}
+
+	SECTION( "dense" )
+	{
+		REQUIRE( positions->get_stride() == 0 );
+		auto view = AccessorView<P>( *positions );
+		REQUIRE( view.is_packed() );
+		REQUIRE( std::vector<P>( view.begin(), view.end() ) == expected );
+		REQUIRE( positions->sparse->dense.size() == 5 * sizeof( P ) );
+		REQUIRE( decode_floats( *positions )[3] == 9.0f );
+
+		// Copies share the dense elements
+		auto copy = *positions;
+		REQUIRE( copy.get_data() == positions->get_data() );
+	}
+
+	SECTION( "zeros" )
+	{
+		// Morph target deltas without a buffer view
+		Accessor deltas = {};
+		deltas.component_type = Accessor::ComponentType::FLOAT;
+		deltas.type = Accessor::Type::VEC3;
+		deltas.count = 4;
+		add_sparse( model, deltas, { 2 }, std::vector<P>{ { 1, 2, 3 } } );
+
+		auto zeros = std::vector<P>{ { 0, 0, 0 }, { 0, 0, 0 }, { 1, 2, 3 }, { 0, 0, 0 } };
+		auto view = SparseAccessorView<P>( deltas );
+		REQUIRE( std::vector<P>( view.begin(), view.end() ) == zeros );
+		auto dense = AccessorView<P>( deltas );
+		REQUIRE( std::vector<P>( dense.begin(), dense.end() ) == zeros );
+	}
+
+	SECTION( "narrow indices" )
+	{
+		uint8_t indices[] = { 0, 3 };
+		positions->sparse->indices.buffer_view = add_view( model, indices, sizeof( indices ) );
+		positions->sparse->indices.component_type = Accessor::ComponentType::UNSIGNED_BYTE;
+		auto view = AccessorView<P>( *positions );
+		REQUIRE( view[0] == P{ 9, 9, 9 } );
+		REQUIRE( view[3] == P{ 7, 7, 7 } );
+	}
+
+	SECTION( "invalid" )
+	{
+		add_sparse( model, *positions, { 1, 5 }, std::vector<P>{ { 9, 9, 9 }, { 7, 7, 7 } } );
+		REQUIRE_THROWS( positions->materialize() );
+		REQUIRE_THROWS( SparseAccessorView<P>( *positions ) );
+
+		add_sparse( model, *positions, { 1, 2 }, std::vector<P>{ { 9, 9, 9 } } );
+		REQUIRE_THROWS( positions->get_data() );
+	}
+
+	SECTION( "unordered" )
+	{
+		// Out of order or repeated indices would be missed by the lookups
+		add_sparse( model, *positions, { 4, 1 }, std::vector<P>{ { 7, 7, 7 }, { 9, 9, 9 } } );
+		REQUIRE_THROWS_AS( SparseAccessorView<P>( *positions ), std::runtime_error );
+		REQUIRE_THROWS_AS( positions->materialize(), std::runtime_error );
+
+		add_sparse( model, *positions, { 1, 1 }, std::vector<P>{ { 9, 9, 9 }, { 7, 7, 7 } } );
+		REQUIRE_THROWS_AS( positions->get_data(), std::runtime_error );
+	}
+}
+
+
+TEST_CASE( "accessor-sparse-benchmark", "[.benchmark]" )
+{
+	Gltf model;
+
+	// A morph target moving one vertex in a hundred
+	using P = std::array<float, 3>;
+	constexpr size_t count = 1 << 20;
+	Accessor deltas = {};
+	deltas.component_type = Accessor::ComponentType::FLOAT;
+	deltas.type = Accessor::Type::VEC3;
+	deltas.count = count;
+	std::vector<uint32_t> indices;
+	std::vector<P> values;
+	for ( uint32_t i = 0; i < count; i += 100 )
+	{
+		indices.push_back( i );
+		values.push_back( { 1.0f, 2.0f, 3.0f } );
+	}
+	add_sparse( model, deltas, indices, values );
+	auto sparse = deltas.sparse;
+
+	BENCHMARK( "materialize" )
+	{
+		deltas.sparse = std::make_shared<Accessor::Sparse>();
+		deltas.sparse->count = sparse->count;
+		deltas.sparse->indices = sparse->indices;
+		deltas.sparse->values = sparse->values;
+		return deltas.get_data()[4];
+	};
+
+	BENCHMARK( "overlay" )
+	{
+		float sum = 0.0f;
+		for ( auto p : SparseAccessorView<P>( deltas ) )
+		{
+			sum += p[0];
+		}
+		return sum;
+	};
+
+	BENCHMARK( "overlay substitutions" )
+	{
+		auto view = SparseAccessorView<P>( deltas );
+		float sum = 0.0f;
+		for ( size_t k = 0; k < view.get_substitution_count(); ++k )
+		{
+			sum += view.get_substitution( k )[0];
+		}
+		return sum;
+	};
+
+	BENCHMARK( "overlay lookups" )
+	{
+		auto view = SparseAccessorView<P>( deltas );
+		float sum = 0.0f;
+		for ( size_t i = 0; i < count; ++i )
+		{
+			sum += view[i][0];
+		}
+		return sum;
+	};
+}
+
+
+} // namespace spot::gfx
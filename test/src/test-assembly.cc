@@ -0,0 +1,271 @@
+#include "test.h"
+
+#include <array>
+#include <cstddef>
+#include <spot/gltf/assembly.h>
+#include <spot/gltf/gltf.h>
+
+namespace spot::gfx
+{
+
+
+/// Vertex of a quantized asset, as an exporter would interleave it
+struct Quantized
+{
+	float position[3];
+	uint8_t color[3];
+	uint8_t padding;
+	int16_t normal[3];
+	uint16_t texcoord[2];
+	uint16_t padding2;
+};
+
+
+/// @return A primitive of count quantized vertices
+Primitive& add_quantized( Gltf& model, const size_t count )
+{
+	std::vector<Quantized> vertices( count );
+	for ( size_t i = 0; i < count; ++i )
+	{
+		auto f = float( i );
+		vertices[i] = { { f, f * 2.0f, f * 3.0f }, { 255, 0, uint8_t( i ) }, 0, { 0, 32767, -32767 },
+			{ 65535, uint16_t( i ) }, 0 };
+	}
+
+	auto size = count * sizeof( Quantized );
+	auto stride = sizeof( Quantized );
+	auto& primitive = model.meshes.push( Mesh( model ) )->primitives.emplace_back();
+	primitive.attributes[Primitive::Semantic::POSITION] = add_accessor( model, vertices.data(), size, stride,
+		offsetof( Quantized, position ), Accessor::ComponentType::FLOAT, Accessor::Type::VEC3, count );
+
+	auto color = add_accessor( model, vertices.data(), size, stride, offsetof( Quantized, color ),
+		Accessor::ComponentType::UNSIGNED_BYTE, Accessor::Type::VEC3, count );
+	color->normalized = true;
+	primitive.attributes[Primitive::Semantic::COLOR_0] = color;
+
+	auto normal = add_accessor( model, vertices.data(), size, stride, offsetof( Quantized, normal ),
+		Accessor::ComponentType::SHORT, Accessor::Type::VEC3, count );
+	normal->normalized = true;
+	primitive.attributes[Primitive::Semantic::NORMAL] = normal;
+
+	auto texcoord = add_accessor( model, vertices.data(), size, stride, offsetof( Quantized, texcoord ),
+		Accessor::ComponentType::UNSIGNED_SHORT, Accessor::Type::VEC2, count );
+	primitive.attributes[Primitive::Semantic::TEXCOORD_0] = texcoord;
+
+	return primitive;
+}
+
+
+TEST_CASE( "assembly" )
+{
+	Gltf model;
+	auto& primitive = add_quantized( model, 5 );
+
+	SECTION( "vertex" )
+	{
+		assemble_vertices( primitive );
+		auto& vertices = primitive.vertices;
+		REQUIRE( vertices.size() == 5 );
+		REQUIRE( vertices[4].p.y == 8.0f );
+		REQUIRE( vertices[4].p.z == 12.0f );
+		REQUIRE( vertices[3].c.r == 1.0f );
+		REQUIRE( vertices[3].c.b == 3.0f / 255.0f );
+		REQUIRE( vertices[3].c.a == 1.0f );
+		REQUIRE( vertices[2].n.y == 1.0f );
+		REQUIRE( vertices[2].n.z == -1.0f );
+		REQUIRE( vertices[1].t.x == 65535.0f );
+		REQUIRE( vertices[4].t.y == 4.0f );
+	}
+
+	SECTION( "streams" )
+	{
+		// Positions apart, colors and texture coordinates interleaved between guards
+		std::vector<float> positions( 5 * 3 );
+		std::vector<float> interleaved( 5 * 8, -1.0f );
+		assemble_vertices( primitive,
+			{
+				{ Primitive::Semantic::POSITION, positions.data() },
+				{ Primitive::Semantic::COLOR_0, interleaved.data(), 8 * sizeof( float ) },
+				{ Primitive::Semantic::TEXCOORD_0, interleaved.data() + 5, 8 * sizeof( float ) },
+			} );
+
+		REQUIRE( positions[14] == 12.0f );
+		for ( size_t i = 0; i < 5; ++i )
+		{
+			auto vertex = interleaved.data() + i * 8;
+			REQUIRE( vertex[2] == float( i ) / 255.0f );
+			REQUIRE( vertex[3] == 1.0f );
+			REQUIRE( vertex[4] == -1.0f );
+			REQUIRE( vertex[6] == float( i ) );
+			REQUIRE( vertex[7] == -1.0f );
+		}
+	}
+
+	SECTION( "invalid" )
+	{
+		primitive.attributes[Primitive::Semantic::TEXCOORD_0]->type = Accessor::Type::VEC3;
+		REQUIRE_THROWS( assemble_vertices( primitive ) );
+
+		primitive.attributes[Primitive::Semantic::TEXCOORD_0]->type = Accessor::Type::VEC2;
+		primitive.attributes[Primitive::Semantic::NORMAL]->count = 4;
+		REQUIRE_THROWS( assemble_vertices( primitive ) );
+	}
+
+	SECTION( "model" )
+	{
+		for ( size_t i = 0; i < 7; ++i )
+		{
+			add_quantized( model, 10 + i );
+		}
+		auto& runtime = model.meshes.push( Mesh::create_triangle( { 0, 0, 0 }, { 1, 0, 0 }, { 0, 1, 0 } ) )->primitives[0];
+
+		assemble_vertices( model, 4 );
+		REQUIRE( runtime.vertices.size() == 3 );
+		for ( size_t i = 0; i < 7; ++i )
+		{
+			auto& vertices = ( *model.meshes )[i + 1].primitives[0].vertices;
+			REQUIRE( vertices.size() == 10 + i );
+			REQUIRE( vertices.back().p.x == float( 9 + i ) );
+		}
+	}
+}
+
+
+TEST_CASE( "indices" )
+{
+	SECTION( "widths" )
+	{
+		Indices indices = { 0, 1, 2 };
+		REQUIRE( indices.get_component_type() == Accessor::ComponentType::UNSIGNED_SHORT );
+		REQUIRE( indices.get_bytes().size() == 6 );
+
+		indices.push_back( 70000 );
+		REQUIRE( indices.get_component_type() == Accessor::ComponentType::UNSIGNED_INT );
+		REQUIRE( indices.size() == 4 );
+		REQUIRE( indices[2] == 2 );
+		REQUIRE( indices[3] == 70000 );
+		REQUIRE( indices.get_max() == 70000 );
+		REQUIRE_THROWS( indices.convert( Accessor::ComponentType::UNSIGNED_SHORT ) );
+		REQUIRE_THROWS( indices.convert( Accessor::ComponentType::FLOAT ) );
+
+		indices.set( 3, 3 );
+		indices.convert( Accessor::ComponentType::UNSIGNED_BYTE );
+		REQUIRE( indices.get_bytes() == std::vector<uint8_t>{ 0, 1, 2, 3 } );
+
+		// Restart values are never stored
+		indices.push_back( 255 );
+		REQUIRE( indices.get_component_type() == Accessor::ComponentType::UNSIGNED_SHORT );
+		indices.push_back( 65535 );
+		REQUIRE( indices.get_component_type() == Accessor::ComponentType::UNSIGNED_INT );
+		REQUIRE( indices[5] == 65535 );
+		REQUIRE( Indices{ 0, 65534 }.get_component_type() == Accessor::ComponentType::UNSIGNED_SHORT );
+		REQUIRE( Indices{ 0, 65535 }.get_component_type() == Accessor::ComponentType::UNSIGNED_INT );
+		REQUIRE_THROWS( Indices{ 0, 255 }.convert( Accessor::ComponentType::UNSIGNED_BYTE ) );
+		REQUIRE_THROWS( Indices{ 0, 65535 }.convert( Accessor::ComponentType::UNSIGNED_SHORT ) );
+		auto narrow = Indices{ 0, 254 };
+		narrow.convert( Accessor::ComponentType::UNSIGNED_BYTE );
+		REQUIRE( narrow[1] == 254 );
+	}
+
+	SECTION( "narrow" )
+	{
+		REQUIRE( Indices::get_component_type( 255 ) == Accessor::ComponentType::UNSIGNED_BYTE );
+		REQUIRE( Indices::get_component_type( 256 ) == Accessor::ComponentType::UNSIGNED_SHORT );
+		REQUIRE( Indices::get_component_type( 65536 ) == Accessor::ComponentType::UNSIGNED_INT );
+
+		auto indices = Indices( Accessor::ComponentType::UNSIGNED_INT, 3 );
+		indices.set( 2, 299 );
+		auto narrowed = indices;
+		narrowed.narrow( 300 );
+		REQUIRE( narrowed.get_component_type() == Accessor::ComponentType::UNSIGNED_SHORT );
+		REQUIRE( narrowed[2] == 299 );
+		REQUIRE_THROWS( indices.narrow( 299 ) );
+	}
+
+	SECTION( "assembly" )
+	{
+		// More vertices than 16 bits can index, interleaved with a guard
+		Gltf model;
+		auto& primitive = add_quantized( model, 70000 );
+		std::vector<uint32_t> bytes = { 0, ~0u, 1, ~0u, 69999, ~0u };
+		primitive.indices_handle = add_accessor( model, bytes.data(), bytes.size() * sizeof( uint32_t ),
+			2 * sizeof( uint32_t ), 0, Accessor::ComponentType::UNSIGNED_INT, Accessor::Type::SCALAR, 3 );
+
+		assemble_vertices( model );
+		auto& indices = primitive.indices;
+		REQUIRE( indices.get_component_type() == Accessor::ComponentType::UNSIGNED_INT );
+		REQUIRE( indices.size() == 3 );
+		REQUIRE( indices[2] == 69999 );
+		REQUIRE( primitive.vertices[indices[2]].p.x == 69999.0f );
+
+		narrow_indices( model );
+		REQUIRE( indices.get_component_type() == Accessor::ComponentType::UNSIGNED_INT );
+
+		primitive.attributes[Primitive::Semantic::POSITION]->count = 300;
+		bytes[4] = 299;
+		primitive.indices_handle = add_accessor( model, bytes.data(), bytes.size() * sizeof( uint32_t ),
+			2 * sizeof( uint32_t ), 0, Accessor::ComponentType::UNSIGNED_INT, Accessor::Type::SCALAR, 3 );
+		assemble_indices( primitive );
+		narrow_indices( primitive );
+		REQUIRE( indices.get_component_type() == Accessor::ComponentType::UNSIGNED_SHORT );
+		REQUIRE( indices.visit( []( auto data, size_t count ) { return Index( data[count - 1] ); } ) == 299 );
+
+		primitive.indices_handle->type = Accessor::Type::VEC2;
+		REQUIRE_THROWS( assemble_indices( primitive ) );
+	}
+}
+
+
+TEST_CASE( "assembly-benchmark", "[.benchmark]" )
+{
+	Gltf model;
+	for ( size_t i = 0; i < 16; ++i )
+	{
+		add_quantized( model, 1 << 16 );
+	}
+
+	BENCHMARK( "views" )
+	{
+		// The gather loop every renderer used to write
+		size_t ret = 0;
+		for ( auto& mesh : *model.meshes )
+		{
+			auto& primitive = mesh.primitives[0];
+			auto positions = AccessorView<std::array<float, 3>>( *primitive.attributes[Primitive::Semantic::POSITION] );
+			auto colors = AccessorView<std::array<uint8_t, 3>>( *primitive.attributes[Primitive::Semantic::COLOR_0] );
+			auto normals = AccessorView<std::array<int16_t, 3>>( *primitive.attributes[Primitive::Semantic::NORMAL] );
+			auto texcoords = AccessorView<std::array<uint16_t, 2>>( *primitive.attributes[Primitive::Semantic::TEXCOORD_0] );
+			primitive.vertices.resize( positions.size() );
+			for ( size_t v = 0; v < positions.size(); ++v )
+			{
+				auto& vertex = primitive.vertices[v];
+				auto p = positions[v];
+				vertex.p = { p[0], p[1], p[2] };
+				auto c = colors[v];
+				vertex.c = { c[0] / 255.0f, c[1] / 255.0f, c[2] / 255.0f, 1.0f };
+				auto n = normals[v];
+				vertex.n = { std::max( n[0] / 32767.0f, -1.0f ), std::max( n[1] / 32767.0f, -1.0f ),
+					std::max( n[2] / 32767.0f, -1.0f ) };
+				auto t = texcoords[v];
+				vertex.t = { float( t[0] ), float( t[1] ) };
+			}
+			ret += primitive.vertices.size();
+		}
+		return ret;
+	};
+
+	BENCHMARK( "assembly" )
+	{
+		assemble_vertices( model );
+		return ( *model.meshes )[0].primitives[0].vertices.size();
+	};
+
+	BENCHMARK( "assembly threads" )
+	{
+		assemble_vertices( model, 4 );
+		return ( *model.meshes )[0].primitives[0].vertices.size();
+	};
+}
+
+
+} // namespace spot::gfx
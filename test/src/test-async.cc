@@ -0,0 +1,131 @@
+#include "test.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <spot/gltf/gltf.h>
+
+namespace spot::gfx
+{
+
+
+const char* async_fixture = R"({
+	"asset": { "version": "2.0" },
+	"buffers": [
+		{ "byteLength": 4, "uri": "data:application/octet-stream;base64,AAECAw==" },
+		{ "byteLength": 4, "uri": "data:application/octet-stream;base64,BAUGBw==" },
+		{ "byteLength": 4, "uri": "external.bin" }
+	],
+	"bufferViews": [ { "buffer": 2, "byteLength": 4 } ],
+	"accessors": [ { "bufferView": 0, "componentType": 5121, "count": 4, "type": "SCALAR" } ],
+	"meshes": [ { "primitives": [ { "attributes": { "POSITION": 0 } } ] } ],
+	"nodes": [ { "mesh": 0 } ],
+	"scenes": [ { "nodes": [ 0 ] } ]
+})";
+
+
+/// Resolver which cancels the load asking for it
+struct CancellingResolver : public Resolver
+{
+	ByteSpan resolve( const std::string& ) override
+	{
+		progress->cancel();
+		return {};
+	}
+
+	std::shared_ptr<LoadProgress> progress;
+};
+
+
+TEST_CASE( "async-load" )
+{
+	auto text = ByteSpan{ async_fixture, std::strlen( async_fixture ) };
+
+	auto external = std::vector<char>{ 8, 9, 10, 11 };
+	auto resolver = std::make_shared<SpanResolver>();
+	resolver->add( "external.bin", ByteSpan{ external.data(), external.size() } );
+
+	for ( auto parser : { LoadOptions::Parser::Dom, LoadOptions::Parser::Sax, LoadOptions::Parser::Tokenizer } )
+	{
+		for ( uint32_t threads : { 0, 2 } )
+		{
+			LoadOptions options;
+			options.parser = parser;
+			options.load_threads = threads;
+			options.resolver = resolver;
+			options.progress = std::make_shared<LoadProgress>();
+
+			auto future = Gltf::load_from_memory_async( text, options );
+			auto model = future.get();
+
+			// Resolved buffers are not read, so they are not accounted
+			auto& progress = *options.progress;
+			REQUIRE( progress.stage == LoadProgress::Stage::Done );
+			REQUIRE( progress.bytes_total == 8 );
+			REQUIRE( progress.bytes_loaded == 8 );
+
+			for ( auto& buffer : *model.buffers )
+			{
+				REQUIRE( buffer.is_loaded() );
+			}
+			REQUIRE( model.get_accessor( 0 )->get_data()[1] == 9 );
+			REQUIRE( model.scene->nodes[0]->mesh->model == &model );
+		}
+	}
+}
+
+
+TEST_CASE( "async-cancel" )
+{
+	auto text = ByteSpan{ async_fixture, std::strlen( async_fixture ) };
+
+	LoadOptions options;
+	options.progress = std::make_shared<LoadProgress>();
+
+	SECTION( "before" )
+	{
+		options.progress->cancel();
+		auto future = Gltf::load_from_memory_async( text, options );
+		REQUIRE_THROWS_AS( future.get(), LoadCancelled );
+		REQUIRE( options.progress->stage == LoadProgress::Stage::Queued );
+	}
+
+	SECTION( "during" )
+	{
+		auto resolver = std::make_shared<CancellingResolver>();
+		resolver->progress = options.progress;
+		options.resolver = resolver;
+
+		for ( auto parser : { LoadOptions::Parser::Dom, LoadOptions::Parser::Sax, LoadOptions::Parser::Tokenizer } )
+		{
+			options.parser = parser;
+			options.progress->cancelled = false;
+
+			auto future = Gltf::load_from_memory_async( text, options );
+			REQUIRE_THROWS_AS( future.get(), LoadCancelled );
+			REQUIRE( options.progress->stage != LoadProgress::Stage::Done );
+		}
+	}
+}
+
+
+TEST_CASE( "async-file" )
+{
+	auto path = std::string( "test-async.gltf" );
+	std::ofstream( path ) << R"({ "asset": { "version": "2.0" }, "accessors": [], "nodes": [ { "name": "a" } ],
+		"scenes": [ { "nodes": [ 0 ] } ] })";
+
+	auto options = LoadOptions();
+	options.progress = std::make_shared<LoadProgress>();
+	auto future = Gltf::load_async( path, options );
+	auto model = future.get();
+
+	REQUIRE( options.progress->stage == LoadProgress::Stage::Done );
+	REQUIRE( model.nodes->at( 0 ).name == "a" );
+	REQUIRE( model.scene == &model.scenes[0] );
+
+	std::remove( path.c_str() );
+}
+
+
+} // namespace spot::gfx
@@ -0,0 +1,145 @@
+#include "test.h"
+
+#include <random>
+#include <string>
+#include <spot/gltf/base64.h>
+
+namespace spot::gfx
+{
+
+
+/// @return Base64 text of those bytes, with padding
+std::string base64_encode( const std::vector<char>& bytes )
+{
+	const char chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+	std::string ret;
+	for ( size_t i = 0; i < bytes.size(); i += 3 )
+	{
+		uint32_t bits = uint8_t( bytes[i] ) << 16;
+		if ( i + 1 < bytes.size() ) bits |= uint8_t( bytes[i + 1] ) << 8;
+		if ( i + 2 < bytes.size() ) bits |= uint8_t( bytes[i + 2] );
+
+		ret += chars[( bits >> 18 ) & 63];
+		ret += chars[( bits >> 12 ) & 63];
+		ret += i + 1 < bytes.size() ? chars[( bits >> 6 ) & 63] : '=';
+		ret += i + 2 < bytes.size() ? chars[bits & 63] : '=';
+	}
+	return ret;
+}
+
+
+/// @return Random bytes
+std::vector<char> random_bytes( const size_t size )
+{
+	std::mt19937 rng { uint32_t( size ) };
+	std::vector<char> bytes( size );
+	for ( auto& b : bytes )
+	{
+		b = char( rng() );
+	}
+	return bytes;
+}
+
+
+/// The decoder previously used by ByteBuffer, kept as a reference
+std::vector<char> legacy_base64_decode( const std::string& encoded_string )
+{
+	const std::string base64_chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	auto is_base64 = []( char c ) { return isalnum( c ) || c == '+' || c == '/'; };
+
+	auto in_len = encoded_string.size();
+	int i = 0;
+	int in_ = 0;
+	char char_array_4[4], char_array_3[3];
+	std::vector<char> ret;
+
+	auto decode = [&]() {
+		for ( int j = 0; j < 4; j++ )
+		{
+			char_array_4[j] = base64_chars.find( char_array_4[j] );
+		}
+		char_array_3[0] = ( char_array_4[0] << 2 ) + ( ( char_array_4[1] & 0x30 ) >> 4 );
+		char_array_3[1] = ( ( char_array_4[1] & 0xf ) << 4 ) + ( ( char_array_4[2] & 0x3c ) >> 2 );
+		char_array_3[2] = ( ( char_array_4[2] & 0x3 ) << 6 ) + char_array_4[3];
+	};
+
+	while ( in_len-- && ( encoded_string[in_] != '=' ) && is_base64( encoded_string[in_] ) )
+	{
+		char_array_4[i++] = encoded_string[in_++];
+		if ( i == 4 )
+		{
+			decode();
+			ret.insert( std::end( ret ), char_array_3, char_array_3 + 3 );
+			i = 0;
+		}
+	}
+
+	if ( i )
+	{
+		for ( int j = i; j < 4; j++ )
+		{
+			char_array_4[j] = 0;
+		}
+		decode();
+		ret.insert( std::end( ret ), char_array_3, char_array_3 + i - 1 );
+	}
+
+	return ret;
+}
+
+
+TEST_CASE( "base64-decode" )
+{
+	SECTION( "round-trip" )
+	{
+		for ( size_t size : { 0, 1, 2, 3, 11, 12, 13, 24, 47, 48, 100, 1000, 4099 } )
+		{
+			auto bytes = random_bytes( size );
+			auto encoded = base64_encode( bytes );
+			REQUIRE( base64_decode( encoded ) == bytes );
+			REQUIRE( base64_decode_scalar( encoded ) == bytes );
+		}
+	}
+
+	SECTION( "stops-at-invalid" )
+	{
+		// Every character in every position of a block wide enough for AVX2
+		auto encoded = base64_encode( random_bytes( 96 ) );
+		for ( size_t pos : { 0, 5, 17, 31, 33, 64, 127 } )
+		{
+			for ( int c = 0; c < 256; ++c )
+			{
+				auto text = encoded;
+				text[pos] = char( c );
+				auto expected = legacy_base64_decode( text );
+				REQUIRE( base64_decode( text ) == expected );
+				REQUIRE( base64_decode_scalar( text ) == expected );
+			}
+		}
+	}
+}
+
+
+TEST_CASE( "base64-benchmark", "[.benchmark]" )
+{
+	auto encoded = base64_encode( random_bytes( 16 * 1024 * 1024 ) );
+
+	BENCHMARK( "legacy" )
+	{
+		return legacy_base64_decode( encoded );
+	};
+
+	BENCHMARK( "scalar" )
+	{
+		return base64_decode_scalar( encoded );
+	};
+
+	BENCHMARK( "simd" )
+	{
+		return base64_decode( encoded );
+	};
+}
+
+
+} // namespace spot::gfx
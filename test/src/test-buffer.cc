@@ -0,0 +1,178 @@
+#include "test.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <spot/gltf/gltf.h>
+
+namespace spot::gfx
+{
+
+
+/// @return Path of a temporary file with those bytes
+std::string write_temp_file( const std::string& name, const std::vector<char>& bytes )
+{
+	auto path = "test-" + name + ".bin";
+	std::ofstream out( path, std::ios::binary );
+	out.write( bytes.data(), bytes.size() );
+	return path;
+}
+
+
+TEST_CASE( "map-buffer" )
+{
+	std::vector<char> bytes( 4096 + 17 );
+	for ( size_t i = 0; i < bytes.size(); ++i )
+	{
+		bytes[i] = char( i * 7 );
+	}
+	auto path = write_temp_file( "map-buffer", bytes );
+
+	{
+		auto buffer = ByteBuffer( path, bytes.size() - 1, ByteBuffer::Storage::Map );
+		REQUIRE( std::memcmp( buffer.get_data(), bytes.data(), bytes.size() - 1 ) == 0 );
+		if ( can_map_files )
+		{
+			REQUIRE( buffer.data.empty() );
+			REQUIRE( buffer.span.size == bytes.size() - 1 );
+		}
+	}
+
+	REQUIRE_THROWS( ByteBuffer( path, bytes.size() + 1, ByteBuffer::Storage::Map ) );
+
+	std::remove( path.c_str() );
+}
+
+
+TEST_CASE( "lazy-buffer" )
+{
+	std::vector<char> bytes = { 1, 2, 3, 4 };
+	auto path = write_temp_file( "lazy-buffer", bytes );
+
+	auto buffer = ByteBuffer( path, bytes.size(), ByteBuffer::Storage::Read, true );
+	REQUIRE( !buffer.is_loaded() );
+	REQUIRE( buffer.data.empty() );
+
+	REQUIRE( std::memcmp( buffer.get_data(), bytes.data(), bytes.size() ) == 0 );
+	REQUIRE( buffer.is_loaded() );
+
+	std::remove( path.c_str() );
+}
+
+
+TEST_CASE( "prefetch-buffers" )
+{
+	auto json = nlohmann::json::parse( R"({
+		"asset": { "version": "2.0" },
+		"buffers": [
+			{ "byteLength": 4, "uri": "data:application/octet-stream;base64,AAECAw==" },
+			{ "byteLength": 4, "uri": "data:application/octet-stream;base64,BAUGBw==" }
+		],
+		"bufferViews": [ { "buffer": 1, "byteLength": 4 } ],
+		"accessors": [ { "bufferView": 0, "componentType": 5121, "count": 4, "type": "SCALAR" } ]
+	})" );
+
+	LoadOptions options;
+	options.lazy_buffers = true;
+	auto model = Gltf( json, ".", options );
+
+	auto& buffers = *model.buffers;
+	REQUIRE( !buffers[0].is_loaded() );
+	REQUIRE( !buffers[1].is_loaded() );
+
+	SECTION( "on-access" )
+	{
+		REQUIRE( model.get_accessor( 0 )->get_data()[0] == 4 );
+		REQUIRE( !buffers[0].is_loaded() );
+		REQUIRE( buffers[1].is_loaded() );
+	}
+
+	SECTION( "prefetch" )
+	{
+		model.prefetch( { model.buffers.get_handle( 0 ) } );
+		REQUIRE( buffers[0].is_loaded() );
+		REQUIRE( !buffers[1].is_loaded() );
+		REQUIRE( buffers[0].data == std::vector<char>{ 0, 1, 2, 3 } );
+	}
+}
+
+
+TEST_CASE( "parallel-buffers" )
+{
+	auto json = nlohmann::json::parse( R"({
+		"asset": { "version": "2.0" },
+		"buffers": [
+			{ "byteLength": 4, "uri": "data:application/octet-stream;base64,AAECAw==" },
+			{ "byteLength": 4, "uri": "data:application/octet-stream;base64,BAUGBw==" },
+			{ "byteLength": 4, "uri": "data:application/octet-stream;base64,CAkKCw==" }
+		],
+		"accessors": []
+	})" );
+
+	LoadOptions options;
+	options.load_threads = 2;
+	auto model = Gltf( json, ".", options );
+
+	for ( size_t i = 0; i < model.buffers->size(); ++i )
+	{
+		auto& buffer = ( *model.buffers )[i];
+		REQUIRE( buffer.is_loaded() );
+		REQUIRE( buffer.data.size() == 4 );
+		REQUIRE( buffer.data[0] == char( i * 4 ) );
+	}
+
+	SECTION( "error" )
+	{
+		json["buffers"][1]["uri"] = "data:application/octet-stream;base64";
+		REQUIRE_THROWS( Gltf( json, ".", options ) );
+	}
+}
+
+
+TEST_CASE( "memory-resolver" )
+{
+	std::string json = R"({
+		"asset": { "version": "2.0" },
+		"buffers": [
+			{ "byteLength": 4, "uri": "meshes/mesh.bin" },
+			{ "byteLength": 4, "uri": "data:application/octet-stream;base64,AAECAw==" }
+		],
+		"images": [ { "uri": "checker.png" }, { "uri": "missing.png" } ],
+		"accessors": []
+	})";
+
+	std::vector<char> mesh = { 9, 8, 7, 6, 5 };
+	std::vector<char> image = { 'P', 'N', 'G' };
+
+	auto resolver = std::make_shared<SpanResolver>();
+	resolver->add( "meshes/mesh.bin", ByteSpan{ mesh.data(), mesh.size() } );
+	resolver->add( "checker.png", ByteSpan{ image.data(), image.size() } );
+
+	LoadOptions options;
+	options.resolver = resolver;
+
+	for ( auto parser : { LoadOptions::Parser::Dom, LoadOptions::Parser::Sax, LoadOptions::Parser::Tokenizer } )
+	{
+		options.parser = parser;
+		auto model = Gltf::load_from_memory( ByteSpan{ json.data(), json.size() }, options );
+
+		// Resolved resources are used in place
+		auto& buffers = *model.buffers;
+		REQUIRE( buffers[0].get_data() == mesh.data() );
+		REQUIRE( buffers[0].data.empty() );
+		REQUIRE( buffers[1].get_data()[3] == 3 );
+
+		auto& images = *model.images;
+		REQUIRE( images[0].data.data == image.data() );
+		REQUIRE( images[0].data.size == image.size() );
+		REQUIRE( images[1].data.data == nullptr );
+	}
+
+	SECTION( "too-short" )
+	{
+		resolver->add( "meshes/mesh.bin", ByteSpan{ mesh.data(), 2 } );
+		REQUIRE_THROWS( Gltf::load_from_memory( ByteSpan{ json.data(), json.size() }, options ) );
+	}
+}
+
+} // namespace spot::gfx
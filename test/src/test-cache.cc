@@ -0,0 +1,146 @@
+#include "test.h"
+
+#include <cstdio>
+#include <fstream>
+#include <spot/gltf/gltf.h>
+
+namespace spot::gfx
+{
+
+
+/// Writes a file of that size whose bytes count from the first one
+void write_counting_file( const std::string& path, const size_t size, const char first = 0 )
+{
+	std::ofstream out( path, std::ios::binary );
+	for ( size_t i = 0; i < size; ++i )
+	{
+		out.put( char( first + i ) );
+	}
+}
+
+
+TEST_CASE( "buffer-cache" )
+{
+	auto path = std::string( "test-cache.bin" );
+	write_counting_file( path, 8 );
+
+	auto json = nlohmann::json::parse( R"({
+		"asset": { "version": "2.0" },
+		"buffers": [
+			{ "byteLength": 8, "uri": "test-cache.bin" },
+			{ "byteLength": 4, "uri": "test-cache.bin" }
+		],
+		"accessors": []
+	})" );
+
+	auto cache = std::make_shared<BufferCache>();
+	LoadOptions options;
+	options.cache = cache;
+
+	SECTION( "shared" )
+	{
+		for ( auto storage : { ByteBuffer::Storage::Read, ByteBuffer::Storage::Map } )
+		{
+			cache->clear();
+			options.storage = storage;
+
+			auto a = Gltf( json, "./a.gltf", options );
+			auto b = Gltf( json, "./b.gltf", options );
+
+			auto data = ( *a.buffers )[0].get_data();
+			REQUIRE( data[7] == 7 );
+			REQUIRE( ( *a.buffers )[1].get_data() == data );
+			REQUIRE( ( *b.buffers )[0].get_data() == data );
+			REQUIRE( ( *b.buffers )[1].span.size == 4 );
+
+			auto stats = cache->get_stats();
+			REQUIRE( stats.misses == 1 );
+			REQUIRE( stats.hits == 3 );
+			REQUIRE( stats.entries == 1 );
+			REQUIRE( stats.bytes == 8 );
+		}
+	}
+
+	SECTION( "evicted-in-use" )
+	{
+		cache->set_capacity( 0 );
+		{
+			auto a = Gltf( json, "./a.gltf", options );
+			REQUIRE( cache->get_stats().evictions == 1 );
+			REQUIRE( cache->get_stats().bytes == 0 );
+
+			// Bytes used by a model are found again
+			auto b = Gltf( json, "./b.gltf", options );
+			REQUIRE( ( *b.buffers )[0].get_data() == ( *a.buffers )[0].get_data() );
+			REQUIRE( cache->get_stats().misses == 1 );
+		}
+
+		auto c = Gltf( json, "./c.gltf", options );
+		REQUIRE( cache->get_stats().misses == 2 );
+	}
+
+	SECTION( "least-recently-used" )
+	{
+		auto other = std::string( "test-cache-other.bin" );
+		write_counting_file( other, 8, 8 );
+
+		cache->set_capacity( 16 );
+		cache->load( path, 8 );
+		cache->load( other, 8 );
+		cache->load( path, 8 );
+		REQUIRE( cache->get_stats().evictions == 0 );
+
+		// The other file is the least recently used
+		cache->set_capacity( 8 );
+		REQUIRE( cache->get_stats().evictions == 1 );
+		REQUIRE( cache->load( path, 8 ).data[0] == 0 );
+		REQUIRE( cache->load( other, 8 ).data[0] == 8 );
+
+		auto stats = cache->get_stats();
+		REQUIRE( stats.hits == 2 );
+		REQUIRE( stats.misses == 3 );
+		REQUIRE( stats.entries == 1 );
+
+		std::remove( other.c_str() );
+	}
+
+	SECTION( "changed" )
+	{
+		auto before = cache->load( path, 8 );
+		write_counting_file( path, 12, 1 );
+
+		auto after = cache->load( path, 8 );
+		REQUIRE( cache->get_stats().misses == 2 );
+		REQUIRE( before.data[0] == 0 );
+		REQUIRE( after.data[0] == 1 );
+	}
+
+	SECTION( "errors" )
+	{
+		REQUIRE_THROWS( cache->load( "test-cache-missing.bin", 4 ) );
+		REQUIRE_THROWS( cache->load( path, 16 ) );
+		REQUIRE( cache->get_stats().entries == 0 );
+	}
+
+	SECTION( "threads" )
+	{
+		for ( size_t i = 0; i < 14; ++i )
+		{
+			json["buffers"].push_back( json["buffers"][i % 2] );
+		}
+		options.load_threads = 4;
+
+		auto model = Gltf( json, "./a.gltf", options );
+		for ( auto& buffer : *model.buffers )
+		{
+			REQUIRE( buffer.get_data() == ( *model.buffers )[0].get_data() );
+		}
+		REQUIRE( cache->get_stats().misses == 1 );
+		REQUIRE( cache->get_stats().hits == 15 );
+	}
+
+	std::remove( path.c_str() );
+}
+
+
+} // namespace spot::gfx
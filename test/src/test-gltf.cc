@@ -36,13 +36,14 @@ void printBuffer( Gltf& model )
 {
 	cout << endl << "# Buffer" << endl;
 	auto buffer = model.buffers.get_handle( 0 );
-	for ( size_t i{ 0 }; i < buffer->data.size(); ++i )
+	auto data = buffer->get_data();
+	for ( size_t i{ 0 }; i < buffer->byte_length; ++i )
 	{
 		if ( i != 0 && ( i % 32 ) == 0 )
 		{
 			cout << endl;
 		}
-		auto& b = buffer->data[i];
+		auto& b = data[i];
 		printf( "%02X ", b & 0xff );
 	}
 	cout << endl;
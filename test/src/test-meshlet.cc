@@ -0,0 +1,176 @@
+#include "test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <spot/gltf/gltf.h>
+#include <spot/gltf/meshlet.h>
+#include <spot/gltf/optimize.h>
+
+namespace spot::gfx
+{
+
+
+/// @return Positions of a grid of side by side vertices, waving along x
+std::vector<float> get_grid_positions( const uint32_t side )
+{
+	std::vector<float> ret;
+	for ( uint32_t v = 0; v < side * side; ++v )
+	{
+		auto x = float( v % side );
+		ret.insert( ret.end(), { x, float( v / side ), 0.1f * std::sin( x * 0.5f ) } );
+	}
+	return ret;
+}
+
+
+/// @return The triangles of meshlets, back to indices of the primitive
+Indices get_meshlet_indices( const Meshlets& meshlets )
+{
+	auto ret = Indices( Accessor::ComponentType::UNSIGNED_INT );
+	for ( auto& meshlet : meshlets.meshlets )
+	{
+		for ( size_t i = 0; i < meshlet.triangle_count * 3; ++i )
+		{
+			auto local = meshlets.triangles[meshlet.triangle_offset + i];
+			REQUIRE( local < meshlet.vertex_count );
+			ret.push_back( meshlets.vertices[meshlet.vertex_offset + local] );
+		}
+	}
+	return ret;
+}
+
+
+TEST_CASE( "meshlet" )
+{
+	const uint32_t side = 64;
+	auto grid = make_indices( get_shuffled_grid( side ) );
+	optimize_vertex_cache( grid, side * side );
+	auto positions = get_grid_positions( side );
+
+	SECTION( "limits" )
+	{
+		auto meshlets = build_meshlets( grid, positions.data(), side * side );
+		REQUIRE( meshlets.bounds.size() == meshlets.meshlets.size() );
+		for ( auto& meshlet : meshlets.meshlets )
+		{
+			REQUIRE( meshlet.vertex_count <= meshlet_max_vertices );
+			REQUIRE( meshlet.triangle_count <= meshlet_max_triangles );
+		}
+
+		// Every triangle once, with its winding
+		REQUIRE( get_sorted_triangles( get_meshlet_indices( meshlets ) ) == get_sorted_triangles( grid ) );
+
+		// Compact meshlets share most of their vertices among their triangles
+		auto triangles = grid.size() / 3;
+		REQUIRE( meshlets.meshlets.size() < triangles / 80 );
+		REQUIRE( meshlets.vertices.size() < triangles * 3 / 4 );
+	}
+
+	SECTION( "small" )
+	{
+		auto meshlets = build_meshlets( grid, positions.data(), side * side, 0, 16, 8 );
+		for ( auto& meshlet : meshlets.meshlets )
+		{
+			REQUIRE( meshlet.vertex_count <= 16 );
+			REQUIRE( meshlet.triangle_count <= 8 );
+		}
+		REQUIRE( get_sorted_triangles( get_meshlet_indices( meshlets ) ) == get_sorted_triangles( grid ) );
+
+		REQUIRE_THROWS( build_meshlets( grid, positions.data(), side * side, 0, 2, 8 ) );
+		REQUIRE_THROWS( build_meshlets( grid, positions.data(), side * side, 0, 257, 8 ) );
+		REQUIRE_THROWS( build_meshlets( grid, positions.data(), side * side, 0, 64, 0 ) );
+		REQUIRE_THROWS( build_meshlets( grid, positions.data(), side * side - 1 ) );
+	}
+
+	SECTION( "bounds" )
+	{
+		auto meshlets = build_meshlets( grid, positions.data(), side * side );
+		for ( size_t i = 0; i < meshlets.meshlets.size(); ++i )
+		{
+			auto& meshlet = meshlets.meshlets[i];
+			auto& bounds = meshlets.bounds[i];
+			for ( size_t v = 0; v < meshlet.vertex_count; ++v )
+			{
+				auto p = &positions[meshlets.vertices[meshlet.vertex_offset + v] * 3];
+				auto dx = p[0] - bounds.center.x;
+				auto dy = p[1] - bounds.center.y;
+				auto dz = p[2] - bounds.center.z;
+				REQUIRE( std::sqrt( dx * dx + dy * dy + dz * dz ) <= bounds.radius * 1.0001f );
+			}
+
+			// A gently waving grid faces up
+			REQUIRE( bounds.cone_axis.z > 0.9f );
+			REQUIRE( bounds.cone_cutoff < 0.5f );
+			REQUIRE( bounds.cone_apex.z <= bounds.center.z );
+		}
+
+		// Triangles facing every way can not be culled
+		std::vector<float> box = { 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1 };
+		uint32_t vertices[] = { 0, 1, 2, 3 };
+		uint8_t triangles[] = { 0, 2, 1, 0, 1, 3, 0, 3, 2, 1, 2, 3 };
+		auto closed = compute_meshlet_bounds( vertices, triangles, 4, box.data() );
+		REQUIRE( closed.cone_cutoff == 1.0f );
+		REQUIRE( closed.radius > 0.5f );
+	}
+
+	SECTION( "threads" )
+	{
+		// Ranges split by workers join into the same triangles
+		const uint32_t large = 400;
+		auto indices = make_indices( get_shuffled_grid( large ) );
+		auto large_positions = get_grid_positions( large );
+		auto meshlets = build_meshlets( indices, large_positions.data(), large * large, 0, 64, 124, 2 );
+		REQUIRE( get_sorted_triangles( get_meshlet_indices( meshlets ) ) == get_sorted_triangles( indices ) );
+		for ( size_t i = 0; i < meshlets.meshlets.size(); ++i )
+		{
+			REQUIRE( meshlets.bounds[i].radius > 0.0f );
+		}
+	}
+
+	SECTION( "model" )
+	{
+		Gltf model;
+		auto& primitive = model.meshes.push( Mesh( model ) )->primitives.emplace_back();
+		primitive.attributes[Primitive::Semantic::POSITION] = add_accessor( model, positions.data(),
+			positions.size() * sizeof( float ), 0, 0, Accessor::ComponentType::FLOAT, Accessor::Type::VEC3, side * side );
+		auto bytes = grid.get_bytes();
+		primitive.indices_handle = add_accessor( model, bytes.data(), bytes.size(), 0, 0,
+			grid.get_component_type(), Accessor::Type::SCALAR, grid.size() );
+
+		auto& lines = model.meshes.push( Mesh( model ) )->primitives.emplace_back();
+		lines.mode = Primitive::Mode::LINES;
+
+		auto meshlets = build_meshlets( model, 2 );
+		REQUIRE( meshlets.size() == 2 );
+		REQUIRE( get_sorted_triangles( get_meshlet_indices( meshlets[0] ) ) == get_sorted_triangles( grid ) );
+		REQUIRE( meshlets[1].meshlets.empty() );
+	}
+}
+
+
+TEST_CASE( "meshlet-benchmark", "[.benchmark]" )
+{
+	const uint32_t side = 1024;
+	auto grid = make_indices( get_shuffled_grid( side ) );
+	optimize_vertex_cache( grid, side * side );
+	auto positions = get_grid_positions( side );
+
+	auto meshlets = build_meshlets( grid, positions.data(), side * side );
+	WARN( grid.size() / 3 << " triangles in " << meshlets.meshlets.size() << " meshlets, "
+		<< double( meshlets.vertices.size() ) / meshlets.meshlets.size() << " vertices and "
+		<< double( grid.size() / 3 ) / meshlets.meshlets.size() << " triangles each" );
+
+	BENCHMARK( "build" )
+	{
+		return build_meshlets( grid, positions.data(), side * side ).meshlets.size();
+	};
+
+	BENCHMARK( "build 4 threads" )
+	{
+		return build_meshlets( grid, positions.data(), side * side, 0, meshlet_max_vertices, meshlet_max_triangles, 4 )
+			.meshlets.size();
+	};
+}
+
+
+} // namespace spot::gfx
@@ -0,0 +1,274 @@
+#include "test.h"
+
+#include <cmath>
+#include <spot/gltf/assembly.h>
+#include <spot/gltf/decode.h>
+#include <spot/gltf/gltf.h>
+#include <spot/gltf/normals.h>
+
+namespace spot::gfx
+{
+
+
+/// @return Three floats for every vertex of a primitive
+std::vector<float> get_surface_positions( const Primitive& primitive )
+{
+	std::vector<float> ret;
+	for ( auto& vertex : primitive.vertices )
+	{
+		ret.insert( ret.end(), { vertex.p.x, vertex.p.y, vertex.p.z } );
+	}
+	return ret;
+}
+
+
+/// @return Two floats for every vertex of a primitive
+std::vector<float> get_surface_texcoords( const Primitive& primitive )
+{
+	std::vector<float> ret;
+	for ( auto& vertex : primitive.vertices )
+	{
+		ret.insert( ret.end(), { vertex.t.x, vertex.t.y } );
+	}
+	return ret;
+}
+
+
+TEST_CASE( "normals" )
+{
+	SECTION( "plane" )
+	{
+		auto plane = make_surface( 9, false );
+		auto positions = get_surface_positions( plane );
+		std::vector<float> normals( positions.size() );
+		generate_normals( plane.indices, positions.data(), plane.vertices.size(), normals.data() );
+		for ( size_t v = 0; v < plane.vertices.size(); ++v )
+		{
+			REQUIRE( normals[v * 3] == Approx( 0.0f ).margin( 1e-6f ) );
+			REQUIRE( normals[v * 3 + 1] == Approx( 0.0f ).margin( 1e-6f ) );
+			REQUIRE( normals[v * 3 + 2] == Approx( 1.0f ) );
+		}
+
+		REQUIRE_THROWS( generate_normals( Indices{ 0, 1 }, positions.data(), 9, normals.data() ) );
+		REQUIRE_THROWS( generate_normals( Indices{ 0, 1, 81 }, positions.data(), 81, normals.data() ) );
+	}
+
+	SECTION( "sphere" )
+	{
+		// Smooth normals of a sphere point away from its center
+		auto sphere = make_surface( 33, true );
+		auto normals = generate_normals( sphere );
+		REQUIRE( normals.size() == sphere.vertices.size() * 3 );
+		for ( auto& vertex : sphere.vertices )
+		{
+			REQUIRE( std::abs( vertex.n.x * vertex.p.x + vertex.n.y * vertex.p.y + vertex.n.z * vertex.p.z ) > 0.99f );
+		}
+	}
+
+	SECTION( "weights" )
+	{
+		// A corner of a cube, with one face split in a fan of thin triangles along an arc
+		std::vector<float> positions = { 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1 };
+		for ( size_t i = 1; i < 8; ++i )
+		{
+			auto angle = float( i ) / 8 * 1.5707964f;
+			positions.insert( positions.end(), { 0, std::cos( angle ), std::sin( angle ) } );
+		}
+		auto count = positions.size() / 3;
+		auto corner = Indices{ 0, 2, 1, 0, 1, 3, 0, 3, 2 };
+		auto split = Indices{ 0, 2, 1, 0, 1, 3 };
+		std::vector<Index> arc = { 2, 4, 5, 6, 7, 8, 9, 10, 3 };
+		for ( size_t i = 0; i + 1 < arc.size(); ++i )
+		{
+			for ( auto index : { Index( 0 ), arc[i + 1], arc[i] } )
+			{
+				split.push_back( index );
+			}
+		}
+
+		// Weighted by angle faces count the same however they are split, so the normal is the diagonal
+		std::vector<float> normals( positions.size() );
+		generate_normals( corner, positions.data(), count, normals.data() );
+		std::vector<float> split_normals( positions.size() );
+		generate_normals( split, positions.data(), count, split_normals.data() );
+		for ( size_t c = 0; c < 3; ++c )
+		{
+			REQUIRE( normals[c] == Approx( -0.57735f ) );
+			REQUIRE( split_normals[c] == Approx( normals[c] ).margin( 1e-4f ) );
+		}
+
+		// Weighted by area the fan covers more than the other faces
+		generate_normals( split, positions.data(), count, split_normals.data(), NormalWeight::Area );
+		REQUIRE( split_normals[0] < split_normals[1] - 0.1f );
+		REQUIRE( split_normals[1] == Approx( split_normals[2] ) );
+
+		// Vertices without triangles face +z
+		REQUIRE( normals[4 * 3 + 2] == 1.0f );
+	}
+}
+
+
+TEST_CASE( "tangents" )
+{
+	SECTION( "plane" )
+	{
+		auto plane = make_surface( 5, false );
+		auto positions = get_surface_positions( plane );
+		auto texcoords = get_surface_texcoords( plane );
+		std::vector<float> normals( positions.size() );
+		generate_normals( plane.indices, positions.data(), plane.vertices.size(), normals.data() );
+
+		// Texture coordinates grow along +y, while glTF textures grow down
+		std::vector<float> tangents( plane.vertices.size() * 4 );
+		generate_tangents( plane.indices, positions.data(), normals.data(), texcoords.data(), plane.vertices.size(),
+			tangents.data() );
+		for ( size_t v = 0; v < plane.vertices.size(); ++v )
+		{
+			REQUIRE( tangents[v * 4] == Approx( 1.0f ) );
+			REQUIRE( tangents[v * 4 + 1] == Approx( 0.0f ).margin( 1e-6f ) );
+			REQUIRE( tangents[v * 4 + 2] == Approx( 0.0f ).margin( 1e-6f ) );
+			REQUIRE( tangents[v * 4 + 3] == -1.0f );
+		}
+
+		for ( size_t v = 0; v < plane.vertices.size(); ++v )
+		{
+			texcoords[v * 2 + 1] = 1.0f - texcoords[v * 2 + 1];
+		}
+		generate_tangents( plane.indices, positions.data(), normals.data(), texcoords.data(), plane.vertices.size(),
+			tangents.data() );
+		REQUIRE( tangents[0] == Approx( 1.0f ) );
+		REQUIRE( tangents[3] == 1.0f );
+
+		// Without texture space tangents still lie on the plane
+		std::fill( texcoords.begin(), texcoords.end(), 0.0f );
+		generate_tangents( plane.indices, positions.data(), normals.data(), texcoords.data(), plane.vertices.size(),
+			tangents.data() );
+		REQUIRE( tangents[2] == 0.0f );
+		REQUIRE( tangents[0] * tangents[0] + tangents[1] * tangents[1] == Approx( 1.0f ) );
+	}
+
+	SECTION( "sphere" )
+	{
+		auto sphere = make_surface( 33, true );
+		auto normals = generate_normals( sphere );
+		auto tangents = generate_tangents( sphere, normals );
+		REQUIRE( tangents.size() == sphere.vertices.size() * 4 );
+		for ( size_t v = 0; v < sphere.vertices.size(); ++v )
+		{
+			auto t = &tangents[v * 4];
+			auto n = &normals[v * 3];
+			REQUIRE( t[0] * t[0] + t[1] * t[1] + t[2] * t[2] == Approx( 1.0f ) );
+			REQUIRE( t[0] * n[0] + t[1] * n[1] + t[2] * n[2] == Approx( 0.0f ).margin( 1e-5f ) );
+			REQUIRE( std::abs( t[3] ) == 1.0f );
+		}
+	}
+
+	SECTION( "model" )
+	{
+		auto plane = make_surface( 9, false );
+		auto positions = get_surface_positions( plane );
+		auto texcoords = get_surface_texcoords( plane );
+		auto count = plane.vertices.size();
+
+		Gltf model;
+		for ( size_t i = 0; i < 2; ++i )
+		{
+			auto primitive = &model.meshes.push( Mesh( model ) )->primitives.emplace_back();
+			primitive->attributes[Primitive::Semantic::POSITION] = add_accessor( model, positions.data(),
+				positions.size() * sizeof( float ), 0, 0, Accessor::ComponentType::FLOAT, Accessor::Type::VEC3, count );
+			primitive->attributes[Primitive::Semantic::TEXCOORD_0] = add_accessor( model, texcoords.data(),
+				texcoords.size() * sizeof( float ), 0, 0, Accessor::ComponentType::FLOAT, Accessor::Type::VEC2, count );
+			primitive->indices = plane.indices;
+		}
+
+		// Normals of the second one are kept, even if quantized and tilted
+		std::vector<int8_t> tilted( count * 4 );
+		for ( size_t v = 0; v < count; ++v )
+		{
+			tilted[v * 4 + 1] = 127;
+		}
+		auto normal = add_accessor( model, tilted.data(), tilted.size(), 4, 0, Accessor::ComponentType::BYTE,
+			Accessor::Type::VEC3, count );
+		normal->normalized = true;
+
+		// Runtime primitives get normals in their vertices, without accessors
+		model.meshes.push( Mesh( { make_surface( 3, false ) } ) );
+		auto primitives = get_primitives( model );
+		primitives[1]->attributes[Primitive::Semantic::NORMAL] = normal;
+
+		auto generated = generate_normals( model, 2 );
+		REQUIRE( generated.normals == 2 );
+		REQUIRE( generated.tangents == 2 );
+
+		auto& normals = primitives[0]->attributes[Primitive::Semantic::NORMAL];
+		REQUIRE( normals->type == Accessor::Type::VEC3 );
+		REQUIRE( decode_floats( *normals )[2] == Approx( 1.0f ) );
+		auto tangents = decode_floats( *primitives[0]->attributes[Primitive::Semantic::TANGENT] );
+		REQUIRE( tangents.size() == count * 4 );
+		REQUIRE( tangents[0] == Approx( 1.0f ) );
+
+		// Tangents lie on the plane of the normals they are given
+		auto tilted_tangents = decode_floats( *primitives[1]->attributes[Primitive::Semantic::TANGENT] );
+		for ( size_t v = 0; v < count; ++v )
+		{
+			REQUIRE( tilted_tangents[v * 4 + 1] == Approx( 0.0f ).margin( 1e-6f ) );
+		}
+		REQUIRE( primitives[2]->attributes.empty() );
+		REQUIRE( primitives[2]->vertices[0].n.z == Approx( 1.0f ) );
+
+		// Assembled vertices read the new attributes
+		assemble_vertices( *primitives[0] );
+		REQUIRE( primitives[0]->vertices[0].n.z == Approx( 1.0f ) );
+
+		generated = generate_normals( model, 2 );
+		REQUIRE( generated.normals == 0 );
+		REQUIRE( generated.tangents == 0 );
+	}
+}
+
+
+TEST_CASE( "normals-benchmark", "[.benchmark]" )
+{
+	auto sphere = make_surface( 512, true );
+	auto positions = get_surface_positions( sphere );
+	auto texcoords = get_surface_texcoords( sphere );
+	auto count = sphere.vertices.size();
+	std::vector<float> normals( count * 3 );
+	std::vector<float> tangents( count * 4 );
+
+	BENCHMARK( "normals" )
+	{
+		generate_normals( sphere.indices, positions.data(), count, normals.data() );
+		return normals[0];
+	};
+
+	BENCHMARK( "tangents" )
+	{
+		generate_tangents( sphere.indices, positions.data(), normals.data(), texcoords.data(), count, tangents.data() );
+		return tangents[0];
+	};
+
+	Gltf model;
+	for ( size_t i = 0; i < 4; ++i )
+	{
+		auto& primitive = model.meshes.push( Mesh( model ) )->primitives.emplace_back();
+		primitive.attributes[Primitive::Semantic::POSITION] = add_accessor( model, positions.data(),
+			positions.size() * sizeof( float ), 0, 0, Accessor::ComponentType::FLOAT, Accessor::Type::VEC3, count );
+		primitive.attributes[Primitive::Semantic::TEXCOORD_0] = add_accessor( model, texcoords.data(),
+			texcoords.size() * sizeof( float ), 0, 0, Accessor::ComponentType::FLOAT, Accessor::Type::VEC2, count );
+		primitive.indices = sphere.indices;
+	}
+
+	BENCHMARK( "model 4 threads" )
+	{
+		for ( auto primitive : get_primitives( model ) )
+		{
+			primitive->attributes.erase( Primitive::Semantic::NORMAL );
+			primitive->attributes.erase( Primitive::Semantic::TANGENT );
+		}
+		return generate_normals( model, 4 ).tangents;
+	};
+}
+
+
+} // namespace spot::gfx
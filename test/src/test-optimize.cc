@@ -0,0 +1,456 @@
+#include "test.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <spot/gltf/assembly.h>
+#include <spot/gltf/gltf.h>
+#include <spot/gltf/optimize.h>
+
+namespace spot::gfx
+{
+
+
+/// @return The triangles of a grid of side by side vertices, in a random order
+std::vector<uint32_t> get_shuffled_grid( const uint32_t side )
+{
+	std::vector<std::array<uint32_t, 3>> triangles;
+	for ( uint32_t y = 0; y + 1 < side; ++y )
+	{
+		for ( uint32_t x = 0; x + 1 < side; ++x )
+		{
+			auto v = y * side + x;
+			triangles.push_back( { v, v + 1, v + side } );
+			triangles.push_back( { v + 1, v + side + 1, v + side } );
+		}
+	}
+	std::shuffle( triangles.begin(), triangles.end(), std::mt19937( 42 ) );
+
+	std::vector<uint32_t> ret;
+	for ( auto& triangle : triangles )
+	{
+		ret.insert( ret.end(), triangle.begin(), triangle.end() );
+	}
+	return ret;
+}
+
+
+/// @return The triangles of indices rotated to start from their smallest index, sorted
+std::vector<std::array<Index, 3>> get_sorted_triangles( const Indices& indices )
+{
+	std::vector<std::array<Index, 3>> ret;
+	for ( size_t i = 0; i < indices.size(); i += 3 )
+	{
+		std::array<Index, 3> triangle = { indices[i], indices[i + 1], indices[i + 2] };
+		std::rotate( triangle.begin(), std::min_element( triangle.begin(), triangle.end() ), triangle.end() );
+		ret.push_back( triangle );
+	}
+	std::sort( ret.begin(), ret.end() );
+	return ret;
+}
+
+
+/// @return Indices of 32 bits with those values
+Indices make_indices( const std::vector<uint32_t>& values )
+{
+	auto ret = Indices( Accessor::ComponentType::UNSIGNED_INT, values.size() );
+	for ( size_t i = 0; i < values.size(); ++i )
+	{
+		ret.set( i, values[i] );
+	}
+	return ret;
+}
+
+
+TEST_CASE( "optimize-vertex-cache" )
+{
+	SECTION( "analyze" )
+	{
+		Indices indices = { 0, 1, 2, 2, 1, 3 };
+		auto stats = analyze_vertex_cache( indices, 4, 32 );
+		REQUIRE( stats.triangles == 2 );
+		REQUIRE( stats.vertices == 4 );
+		REQUIRE( stats.transformed == 4 );
+		REQUIRE( stats.acmr == 2.0f );
+		REQUIRE( stats.atvr == 1.0f );
+
+		// Vertex 1 is evicted by vertex 2 in a cache of one entry
+		stats = analyze_vertex_cache( indices, 4, 1 );
+		REQUIRE( stats.transformed == 5 );
+
+		REQUIRE_THROWS( analyze_vertex_cache( indices, 3 ) );
+		indices.push_back( 0 );
+		REQUIRE_THROWS( analyze_vertex_cache( indices, 4 ) );
+	}
+
+	SECTION( "tipsify" )
+	{
+		const uint32_t side = 64;
+		auto indices = make_indices( get_shuffled_grid( side ) );
+		auto triangles = get_sorted_triangles( indices );
+		auto before = analyze_vertex_cache( indices, side * side, 16 );
+
+		optimize_vertex_cache( indices, side * side, 16 );
+		auto after = analyze_vertex_cache( indices, side * side, 16 );
+		REQUIRE( after.transformed < before.transformed );
+		REQUIRE( after.acmr < 1.0f );
+		REQUIRE( after.vertices == before.vertices );
+
+		// Same triangles, with the same winding
+		REQUIRE( get_sorted_triangles( indices ) == triangles );
+	}
+
+	SECTION( "dead-end" )
+	{
+		// A 3x3 grid in order, where after the first triangle neither 1 nor 3 would stay
+		// in a cache of three entries, so fanning restarts from 3, the last one emitted
+		auto indices = make_indices( { 0, 1, 3, 1, 4, 3, 1, 2, 4, 2, 5, 4, 3, 4, 6, 4, 7, 6, 4, 5, 7, 5, 8, 7 } );
+		optimize_vertex_cache( indices, 9, 3 );
+		auto expected = make_indices( { 0, 1, 3, 1, 4, 3, 3, 4, 6, 4, 7, 6, 4, 5, 7, 5, 8, 7, 2, 5, 4, 1, 2, 4 } );
+		REQUIRE( indices.get_bytes() == expected.get_bytes() );
+	}
+
+	SECTION( "model" )
+	{
+		const uint32_t side = 32;
+		Gltf model;
+		auto grid = get_shuffled_grid( side );
+		auto& primitive = add_quantized( model, side * side );
+		primitive.indices_handle = add_accessor( model, grid.data(), grid.size() * sizeof( uint32_t ), 0, 0,
+			Accessor::ComponentType::UNSIGNED_INT, Accessor::Type::SCALAR, grid.size() );
+		auto loaded = primitive.indices_handle;
+
+		auto& lines = add_quantized( model, 3 );
+		lines.mode = Primitive::Mode::LINES;
+		lines.indices = { 0, 1, 1, 2 };
+
+		auto reports = optimize_vertex_cache( model, 4 );
+		REQUIRE( reports.size() == 2 );
+		REQUIRE( reports[0].before.triangles == grid.size() / 3 );
+		REQUIRE( reports[0].after.acmr < reports[0].before.acmr );
+		REQUIRE( reports[1].after.triangles == 0 );
+		REQUIRE( lines.indices[3] == 2 );
+
+		// Stored in a new accessor, leaving the loaded one as it was
+		REQUIRE( primitive.indices_handle != loaded );
+		auto& accessor = *primitive.indices_handle;
+		REQUIRE( accessor.count == grid.size() );
+		REQUIRE( std::equal( primitive.indices.get_bytes().begin(), primitive.indices.get_bytes().end(),
+			accessor.get_data() ) );
+		REQUIRE( reinterpret_cast<const uint32_t*>( loaded->get_data() )[0] == grid[0] );
+	}
+}
+
+
+/// @return Whether every index is at most one more than the largest before it
+bool is_first_use_order( const Indices& indices )
+{
+	Index next = 0;
+	for ( size_t i = 0; i < indices.size(); ++i )
+	{
+		if ( indices[i] > next )
+		{
+			return false;
+		}
+		next = std::max( next, indices[i] + 1 );
+	}
+	return true;
+}
+
+
+TEST_CASE( "optimize-vertex-fetch" )
+{
+	SECTION( "remap" )
+	{
+		// Vertex 3 duplicates vertex 0, vertex 1 is not used
+		std::vector<float> positions = { 0, 1, 2, 0 };
+		std::vector<uint8_t> colors = { 5, 6, 7, 5 };
+		std::vector<AttributeStream> streams = {
+			{ reinterpret_cast<const uint8_t*>( positions.data() ), sizeof( float ), sizeof( float ) },
+			{ colors.data(), 1, 1 },
+			{ nullptr, 4, 4 },
+		};
+		Indices indices = { 2, 0, 2, 3 };
+
+		std::vector<uint32_t> remap;
+		REQUIRE( generate_vertex_remap( streams, 4, &indices, true, remap ) == 2 );
+		REQUIRE( remap == std::vector<uint32_t>{ 1, remap_unused, 0, 1 } );
+		auto moved = remap_elements( streams[1], remap, 2 );
+		REQUIRE( moved == std::vector<char>{ 7, 5 } );
+		REQUIRE( remap_elements( streams[2], remap, 2 ) == std::vector<char>( 8, 0 ) );
+
+		// A different color keeps the vertices apart
+		colors[3] = 8;
+		REQUIRE( generate_vertex_remap( streams, 4, &indices, true, remap ) == 3 );
+		REQUIRE( generate_vertex_remap( streams, 4, nullptr, false, remap ) == 4 );
+		REQUIRE( remap == std::vector<uint32_t>{ 0, 1, 2, 3 } );
+
+		remap_indices( indices, { 1, remap_unused, 0, 2 } );
+		REQUIRE( indices[0] == 0 );
+		REQUIRE( indices[3] == 2 );
+		REQUIRE_THROWS( generate_vertex_remap( streams, 2, &indices, true, remap ) );
+	}
+
+	SECTION( "accessors" )
+	{
+		// Every triangle with its own vertices, as exporters write flat shaded meshes
+		const uint32_t side = 16;
+		auto grid = get_shuffled_grid( side );
+		std::vector<float> positions;
+		for ( auto index : grid )
+		{
+			positions.insert( positions.end(), { float( index % side ), float( index / side ), 0.0f } );
+		}
+
+		Gltf model;
+		auto& primitive = model.meshes.push( Mesh( model ) )->primitives.emplace_back();
+		auto position = add_accessor( model, positions.data(), positions.size() * sizeof( float ), 0, 0,
+			Accessor::ComponentType::FLOAT, Accessor::Type::VEC3, grid.size() );
+		position->min = { 0, 0, 0 };
+		position->max = { 100, 100, 0 };
+		primitive.attributes[Primitive::Semantic::POSITION] = position;
+
+		std::stringstream original;
+		model.save_glb( original );
+
+		auto stats = optimize_vertex_fetch( model, 2 )[0];
+		REQUIRE( stats.vertices_before == grid.size() );
+		REQUIRE( stats.vertices_after == side * side );
+		REQUIRE( stats.bytes_before == grid.size() * 12 );
+		REQUIRE( stats.bytes_after == side * side * 12 + grid.size() * 2 );
+		REQUIRE( stats.get_bytes_saved() > 0 );
+
+		auto& welded = *primitive.attributes.at( Primitive::Semantic::POSITION );
+		REQUIRE( welded.count == side * side );
+		REQUIRE( welded.max == std::vector<float>{ side - 1, side - 1, 0 } );
+		REQUIRE( primitive.indices_handle->count == grid.size() );
+		REQUIRE( is_first_use_order( primitive.indices ) );
+
+		// Same triangles, now through indices
+		auto view = AccessorView<std::array<float, 3>>( welded );
+		for ( size_t i = 0; i < grid.size(); ++i )
+		{
+			REQUIRE( view[primitive.indices[i]][0] == positions[i * 3] );
+			REQUIRE( view[primitive.indices[i]][1] == positions[i * 3 + 1] );
+		}
+
+		// The replaced accessor and its bytes are not saved
+		std::stringstream saved;
+		model.save_glb( saved );
+		auto glb = saved.str();
+		REQUIRE( glb.size() < original.str().size() );
+		auto bytes = std::make_shared<std::vector<char>>( glb.begin(), glb.end() );
+		auto loaded = Gltf::load_glb( { bytes->data(), bytes->size(), bytes } );
+		REQUIRE( loaded.accessors->size() == 2 );
+		REQUIRE( loaded.buffer_views->size() == 2 );
+		auto& reloaded = ( *loaded.meshes )[0].primitives[0];
+		REQUIRE( reloaded.attributes.at( Primitive::Semantic::POSITION )->count == side * side );
+		REQUIRE( reloaded.indices_handle->count == grid.size() );
+
+		// Bounds of quantized positions are recomputed too, in the values of their component type
+		std::vector<int16_t> shorts = { 0, 0, 0, 0, 100, 0, 0, 0, 0, 200, 0, 0, -30000, 30000, 5, 0 };
+		auto& triangle = model.meshes.push( Mesh( model ) )->primitives.emplace_back();
+		auto quantized = add_accessor( model, shorts.data(), shorts.size() * sizeof( int16_t ), 8, 0,
+			Accessor::ComponentType::SHORT, Accessor::Type::VEC3, 4 );
+		quantized->normalized = true;
+		quantized->min = { -30000, 0, 0 };
+		quantized->max = { 100, 30000, 5 };
+		triangle.attributes[Primitive::Semantic::POSITION] = quantized;
+		triangle.indices = { 0, 1, 2 };
+
+		optimize_vertex_fetch( model, triangle );
+		auto& bounded = *triangle.attributes.at( Primitive::Semantic::POSITION );
+		REQUIRE( bounded.count == 3 );
+		REQUIRE( bounded.normalized );
+		REQUIRE( bounded.min == std::vector<float>{ 0, 0, 0 } );
+		REQUIRE( bounded.max == std::vector<float>{ 100, 200, 0 } );
+	}
+
+	SECTION( "runtime" )
+	{
+		Gltf model;
+		auto mesh = model.meshes.push( Mesh::create_rect( math::Vec3( 0, 0, 0 ), math::Vec3( 1, 1, 0 ), Color::white ) );
+		auto& primitive = mesh->primitives[0];
+		primitive.vertices.push_back( primitive.vertices[0] );
+		primitive.indices.set( 7, 4 );
+
+		auto stats = optimize_vertex_fetch( model, primitive, false );
+		REQUIRE( stats.vertices_after == 5 );
+		REQUIRE( stats.get_bytes_saved() == 0 );
+
+		stats = optimize_vertex_fetch( model, primitive );
+		REQUIRE( stats.vertices_after == 4 );
+		REQUIRE( stats.get_bytes_saved() == sizeof( Vertex ) );
+		REQUIRE( primitive.vertices.size() == 4 );
+		REQUIRE( primitive.indices[7] == 0 );
+		REQUIRE( !primitive.indices_handle );
+	}
+}
+
+
+/// @return A primitive of layers of quads facing up, from the bottom one to the top one
+Primitive make_layers( const size_t layers )
+{
+	Primitive ret;
+	for ( size_t i = 0; i < layers; ++i )
+	{
+		auto z = float( i ) / layers;
+		auto first = Index( ret.vertices.size() );
+		ret.vertices.emplace_back( math::Vec3( 0.0f, 0.0f, z ) );
+		ret.vertices.emplace_back( math::Vec3( 1.0f, 0.0f, z ) );
+		ret.vertices.emplace_back( math::Vec3( 1.0f, 1.0f, z ) );
+		ret.vertices.emplace_back( math::Vec3( 0.0f, 1.0f, z ) );
+		for ( auto index : { 0, 1, 2, 0, 2, 3 } )
+		{
+			ret.indices.push_back( first + index );
+		}
+	}
+	return ret;
+}
+
+
+TEST_CASE( "optimize-overdraw" )
+{
+	SECTION( "analyze" )
+	{
+		auto layers = make_layers( 4 );
+		auto positions = &layers.vertices[0].p.x;
+		auto stats = analyze_overdraw( layers.indices, positions, layers.vertices.size(), sizeof( Vertex ), 16 );
+		// Seen only from above, where every layer is drawn over the one below
+		REQUIRE( stats.covered == 16 * 16 );
+		REQUIRE( stats.shaded == stats.covered * 4 );
+		REQUIRE( stats.overdraw == 4.0f );
+
+		// From the top one down
+		std::swap( layers.vertices[0].p, layers.vertices[12].p );
+		std::swap( layers.vertices[1].p, layers.vertices[13].p );
+		std::swap( layers.vertices[2].p, layers.vertices[14].p );
+		std::swap( layers.vertices[3].p, layers.vertices[15].p );
+		stats = analyze_overdraw( layers.indices, positions, layers.vertices.size(), sizeof( Vertex ), 16 );
+		REQUIRE( stats.overdraw < 4.0f );
+	}
+
+	SECTION( "clusters" )
+	{
+		auto layers = make_layers( 8 );
+		auto report = optimize_overdraw( layers );
+		REQUIRE( report.before.overdraw == 8.0f );
+		REQUIRE( report.after.overdraw == 1.0f );
+		REQUIRE( report.cache_after.transformed <= report.cache_before.transformed );
+
+		// Layers are kept whole, with their winding
+		REQUIRE( layers.indices[0] == 28 );
+		REQUIRE( layers.indices[5] == 31 );
+
+		// Unordered triangles go through Tipsify first, so clusters are not single triangles
+		const uint32_t side = 32;
+		Primitive grid;
+		grid.indices = make_indices( get_shuffled_grid( side ) );
+		for ( uint32_t v = 0; v < side * side; ++v )
+		{
+			grid.vertices.emplace_back( math::Vec3( float( v % side ), float( v / side ), 0.0f ) );
+		}
+		auto shuffled = optimize_overdraw( grid, 1.05f, 16 );
+		REQUIRE( shuffled.cache_after.acmr < shuffled.cache_before.acmr * 0.75f );
+	}
+
+	SECTION( "model" )
+	{
+		// Bottom layer last, to be drawn first
+		auto layers = make_layers( 3 );
+		std::vector<float> positions;
+		for ( auto& vertex : layers.vertices )
+		{
+			positions.insert( positions.end(), { vertex.p.x, vertex.p.y, vertex.p.z } );
+		}
+		std::vector<uint16_t> indices;
+		for ( size_t i = 0; i < layers.indices.size(); ++i )
+		{
+			indices.push_back( uint16_t( layers.indices[i] ) );
+		}
+
+		Gltf model;
+		auto& primitive = model.meshes.push( Mesh( model ) )->primitives.emplace_back();
+		primitive.attributes[Primitive::Semantic::POSITION] = add_accessor( model, positions.data(),
+			positions.size() * sizeof( float ), 0, 0, Accessor::ComponentType::FLOAT, Accessor::Type::VEC3, 12 );
+		primitive.indices_handle = add_accessor( model, indices.data(), indices.size() * sizeof( uint16_t ), 0, 0,
+			Accessor::ComponentType::UNSIGNED_SHORT, Accessor::Type::SCALAR, indices.size() );
+
+		auto reports = optimize_overdraw( model, 2, 1.5f );
+		REQUIRE( reports[0].after.overdraw < reports[0].before.overdraw );
+		auto& optimized = *primitive.indices_handle;
+		REQUIRE( optimized.component_type == Accessor::ComponentType::UNSIGNED_SHORT );
+		REQUIRE( reinterpret_cast<const uint16_t*>( optimized.get_data() )[0] == 8 );
+	}
+}
+
+
+TEST_CASE( "optimize-vertex-cache-benchmark", "[.benchmark]" )
+{
+	const uint32_t side = 512;
+	auto grid = make_indices( get_shuffled_grid( side ) );
+	auto optimized = grid;
+	optimize_vertex_cache( optimized, side * side );
+
+	auto before = analyze_vertex_cache( grid, side * side, 16 );
+	auto after = analyze_vertex_cache( optimized, side * side, 16 );
+	WARN( "ACMR " << before.acmr << " -> " << after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr );
+
+	BENCHMARK( "analyze" )
+	{
+		return analyze_vertex_cache( grid, side * side, 16 ).transformed;
+	};
+
+	BENCHMARK( "tipsify" )
+	{
+		auto indices = grid;
+		optimize_vertex_cache( indices, side * side );
+		return indices[0];
+	};
+
+	// Every triangle with its own vertices, to be welded back into the grid
+	std::vector<float> positions;
+	for ( size_t i = 0; i < grid.size(); ++i )
+	{
+		positions.insert( positions.end(), { float( grid[i] % side ), float( grid[i] / side ), 0.0f } );
+	}
+	auto stream = AttributeStream{ reinterpret_cast<const uint8_t*>( positions.data() ), 12, 12 };
+
+	// A wavy grid, with folds hiding parts of it
+	std::vector<float> grid_positions;
+	for ( uint32_t v = 0; v < side * side; ++v )
+	{
+		auto x = float( v % side ) / side;
+		auto y = float( v / side ) / side;
+		grid_positions.insert( grid_positions.end(), { x, y, 0.1f * std::sin( x * 40.0f ) } );
+	}
+	auto overdraw_before = analyze_overdraw( optimized, grid_positions.data(), side * side );
+	auto overdraw_sorted = optimized;
+	optimize_overdraw( overdraw_sorted, grid_positions.data(), side * side );
+	auto overdraw_after = analyze_overdraw( overdraw_sorted, grid_positions.data(), side * side );
+	WARN( "Overdraw " << overdraw_before.overdraw << " -> " << overdraw_after.overdraw << ", ACMR "
+		<< after.acmr << " -> " << analyze_vertex_cache( overdraw_sorted, side * side, 16 ).acmr );
+
+	BENCHMARK( "analyze overdraw" )
+	{
+		return analyze_overdraw( optimized, grid_positions.data(), side * side ).shaded;
+	};
+
+	BENCHMARK( "overdraw" )
+	{
+		auto indices = optimized;
+		optimize_overdraw( indices, grid_positions.data(), side * side );
+		return indices[0];
+	};
+
+	BENCHMARK( "weld" )
+	{
+		std::vector<uint32_t> remap;
+		return generate_vertex_remap( { stream }, grid.size(), nullptr, true, remap );
+	};
+}
+
+
+} // namespace spot::gfx
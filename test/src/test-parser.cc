@@ -0,0 +1,842 @@
+#include "test.h"
+
+#include <clocale>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <spot/gltf/gltf.h>
+
+namespace spot::gfx
+{
+
+
+/// A model touching every part of the loader. Sections come in an unusual order
+/// so that elements refer to others which have not been seen yet
+const char* parser_fixture = R"({
+	"scene": 1,
+	"extras": {
+		"scripts": [ { "uri": "a.lua" }, { "uri": "b.lua", "name": "bee" } ],
+		"shapes": [
+			{ "type": "box", "box": { "a": [ 0, 0, 0 ], "b": [ 1, 2, 3 ] } },
+			{ "type": "sphere", "sphere": { "o": [ 1, 1, 1 ], "r": 0.5 } }
+		],
+		"ignored": { "deep": [ [ 1, 2 ], { "x": null } ] }
+	},
+	"nodes": [
+		{
+			"name": "root",
+			"children": [ 1, 2 ],
+			"translation": [ 1, 2, 3 ],
+			"extras": { "scripts": [ 1 ], "bounds": 0 }
+		},
+		{ "name": "body", "mesh": 0, "rotation": [ 0, 0.7071068, 0, 0.7071068 ], "scale": [ 2, 2, 2 ] },
+		{ "camera": 1, "extensions": { "KHR_lights_punctual": { "light": 1 } } }
+	],
+	"meshes": [
+		{
+			"name": "tri",
+			"primitives": [
+				{ "attributes": { "POSITION": 0, "NORMAL": 1 }, "indices": 2, "material": 0, "mode": 4 },
+				{ "attributes": { "POSITION": 0, "TEXCOORD_0": 5 }, "mode": 1 },
+				{ "attributes": { "POSITION": 6 }, "mode": 0 }
+			],
+			"weights": [ 0.25, 0.75 ]
+		}
+	],
+	"animations": [
+		{
+			"name": "spin",
+			"channels": [ { "sampler": 0, "target": { "node": 1, "path": "rotation" } } ],
+			"samplers": [ { "input": 3, "output": 4, "interpolation": "STEP" } ]
+		}
+	],
+	"materials": [
+		{
+			"name": "r\u00e9d \"1\"\n\ud83d\ude00",
+			"pbrMetallicRoughness": {
+				"baseColorFactor": [ 1, 0, 0, 1 ],
+				"baseColorTexture": { "index": 0 },
+				"metallicFactor": 5e-1,
+				"roughnessFactor": 0.0025E2
+			}
+		}
+	],
+	"textures": [ { "sampler": 0, "source": 0, "name": "checker" } ],
+	"images": [ { "uri": "checker.png", "mimeType": "image/png" } ],
+	"samplers": [ { "magFilter": 9729, "minFilter": 9987, "wrapS": 33071, "wrapT": 33648 } ],
+	"accessors": [
+		{ "bufferView": 0, "componentType": 5126, "count": 3, "type": "VEC3", "min": [ -0.0, 1e-30, 0.1 ], "max": [ 1.0000001, 12345678901234567890, 3.4e38 ] },
+		{ "bufferView": 0, "byteOffset": 0, "componentType": 5126, "count": 3, "type": "VEC3" },
+		{ "bufferView": 1, "componentType": 5123, "count": 3, "type": "SCALAR" },
+		{ "bufferView": 2, "componentType": 5126, "count": 2, "type": "SCALAR" },
+		{ "bufferView": 2, "byteOffset": 8, "componentType": 5126, "count": 2, "type": "VEC4" },
+		{ "bufferView": 1, "componentType": 5123, "normalized": true, "count": 1, "type": "VEC2" },
+		{ "bufferView": 0, "componentType": 5126, "count": 3, "type": "VEC3", "sparse": {
+			"count": 2,
+			"indices": { "bufferView": 1, "componentType": 5123 },
+			"values": { "bufferView": 2, "byteOffset": 4 }
+		} }
+	],
+	"bufferViews": [
+		{ "buffer": 0, "byteLength": 36, "byteStride": 12 },
+		{ "buffer": 0, "byteOffset": 36, "byteLength": 6 },
+		{ "buffer": 1, "byteLength": 40 }
+	],
+	"buffers": [
+		{ "byteLength": 42, "uri": "data:application/octet-stream;base64,AAAAAAAAAAAAAAAAAACAPwAAAAAAAAAAAAAAAAAAgD8AAAAAAAABAAIA" },
+		{ "byteLength": 40, "uri": "data:application/octet-stream;base64,AAAAAAAAgD8AAAAAAAAAAAAAAAAAAIA/AAAAAPQENT8AAAAA9AQ1Pw==" }
+	],
+	"cameras": [
+		{ "type": "orthographic", "orthographic": { "xmag": 1, "ymag": 2, "zfar": 10, "znear": 0.5 } },
+		{ "type": "perspective", "name": "eye", "perspective": { "aspectRatio": 1.5, "yfov": 0.8, "zfar": 100, "znear": 0.1 } }
+	],
+	"extensionsUsed": [ "KHR_lights_punctual" ],
+	"extensions": {
+		"KHR_lights_punctual": {
+			"lights": [
+				{ "type": "directional", "color": [ 1, 1, 0.5 ], "intensity": 2 },
+				{ "spot": { "outerConeAngle": 0.5, "innerConeAngle": 0.1 }, "name": "torch", "range": 5, "type": "spot" }
+			]
+		}
+	},
+	"scenes": [ { "name": "first", "nodes": [ 2 ] }, { "name": "second", "nodes": [ 0 ] } ],
+	"asset": { "version": "2.0", "generator": "hand", "copyright": "none\/\t" }
+})";
+
+
+/// @return Whether two handles of different models point to the same index
+template <typename T>
+bool same( const Handle<T>& a, const Handle<T>& b )
+{
+	return bool( a ) == bool( b ) && ( !a || a.get_index() == b.get_index() );
+}
+
+
+/// Checks that two models loaded from the same json are equal
+/// @param same_buffers Whether buffers should be equal, otherwise only the bytes seen by accessors
+void require_equal( const Gltf& a, const Gltf& b, const bool same_buffers = true )
+{
+	REQUIRE( a.asset.version == b.asset.version );
+	REQUIRE( a.asset.generator == b.asset.generator );
+	REQUIRE( a.asset.copyright == b.asset.copyright );
+
+	if ( same_buffers )
+	{
+		REQUIRE( a.buffers->size() == b.buffers->size() );
+		for ( size_t i = 0; i < a.buffers->size(); ++i )
+		{
+			auto& x = ( *a.buffers )[i];
+			auto& y = ( *b.buffers )[i];
+			REQUIRE( x.uri == y.uri );
+			REQUIRE( x.byte_length == y.byte_length );
+			REQUIRE( std::equal( x.get_data(), x.get_data() + x.byte_length, y.get_data() ) );
+		}
+	}
+
+	REQUIRE( a.buffer_views->size() == b.buffer_views->size() );
+	for ( size_t i = 0; i < a.buffer_views->size(); ++i )
+	{
+		auto& x = ( *a.buffer_views )[i];
+		auto& y = ( *b.buffer_views )[i];
+		if ( same_buffers )
+		{
+			REQUIRE( same( x.buffer, y.buffer ) );
+			REQUIRE( x.byte_offset == y.byte_offset );
+		}
+		REQUIRE( x.byte_length == y.byte_length );
+		REQUIRE( x.byte_stride == y.byte_stride );
+	}
+
+	REQUIRE( a.accessors->size() == b.accessors->size() );
+	for ( size_t i = 0; i < a.accessors->size(); ++i )
+	{
+		auto& x = ( *a.accessors )[i];
+		auto& y = ( *b.accessors )[i];
+		REQUIRE( same( x.handle, y.handle ) );
+		REQUIRE( same( x.buffer_view, y.buffer_view ) );
+		REQUIRE( x.byte_offset == y.byte_offset );
+		REQUIRE( x.component_type == y.component_type );
+		REQUIRE( x.normalized == y.normalized );
+		REQUIRE( x.count == y.count );
+		REQUIRE( x.type == y.type );
+		REQUIRE( x.min == y.min );
+		REQUIRE( x.max == y.max );
+		REQUIRE( bool( x.sparse ) == bool( y.sparse ) );
+		if ( x.sparse )
+		{
+			REQUIRE( x.sparse->count == y.sparse->count );
+			REQUIRE( same( x.sparse->indices.buffer_view, y.sparse->indices.buffer_view ) );
+			REQUIRE( x.sparse->indices.byte_offset == y.sparse->indices.byte_offset );
+			REQUIRE( x.sparse->indices.component_type == y.sparse->indices.component_type );
+			REQUIRE( same( x.sparse->values.buffer_view, y.sparse->values.buffer_view ) );
+			REQUIRE( x.sparse->values.byte_offset == y.sparse->values.byte_offset );
+			REQUIRE( std::equal( x.get_data(), x.get_data() + x.get_size(), y.get_data() ) );
+		}
+		if ( !same_buffers && x.buffer_view )
+		{
+			REQUIRE( std::equal( x.get_data(), x.get_data() + x.get_size(), y.get_data() ) );
+		}
+	}
+
+	REQUIRE( a.cameras.size() == b.cameras.size() );
+	for ( size_t i = 0; i < a.cameras.size(); ++i )
+	{
+		auto& x = a.cameras[i];
+		auto& y = b.cameras[i];
+		REQUIRE( x.name == y.name );
+		REQUIRE( x.type == y.type );
+		REQUIRE( x.orthographic.xmag == y.orthographic.xmag );
+		REQUIRE( x.orthographic.znear == y.orthographic.znear );
+		REQUIRE( x.perspective.aspect_ratio == y.perspective.aspect_ratio );
+		REQUIRE( x.perspective.yfov == y.perspective.yfov );
+	}
+
+	REQUIRE( a.samplers->size() == b.samplers->size() );
+	for ( size_t i = 0; i < a.samplers->size(); ++i )
+	{
+		auto& x = ( *a.samplers )[i];
+		auto& y = ( *b.samplers )[i];
+		REQUIRE( x.magFilter == y.magFilter );
+		REQUIRE( x.minFilter == y.minFilter );
+		REQUIRE( x.wrapS == y.wrapS );
+		REQUIRE( x.wrapT == y.wrapT );
+	}
+
+	REQUIRE( a.images->size() == b.images->size() );
+	for ( size_t i = 0; i < a.images->size(); ++i )
+	{
+		auto& x = ( *a.images )[i];
+		auto& y = ( *b.images )[i];
+		REQUIRE( x.uri == y.uri );
+		REQUIRE( x.mime_type == y.mime_type );
+	}
+
+	REQUIRE( a.textures->size() == b.textures->size() );
+	for ( size_t i = 0; i < a.textures->size(); ++i )
+	{
+		auto& x = ( *a.textures )[i];
+		auto& y = ( *b.textures )[i];
+		REQUIRE( x.name == y.name );
+		REQUIRE( same( x.sampler, y.sampler ) );
+		REQUIRE( same( x.source, y.source ) );
+	}
+
+	REQUIRE( a.materials->size() == b.materials->size() );
+	for ( size_t i = 0; i < a.materials->size(); ++i )
+	{
+		auto& x = ( *a.materials )[i];
+		auto& y = ( *b.materials )[i];
+		REQUIRE( x.name == y.name );
+		REQUIRE( x.pbr.color.r == y.pbr.color.r );
+		REQUIRE( x.pbr.metallic == y.pbr.metallic );
+		REQUIRE( x.pbr.roughness == y.pbr.roughness );
+		REQUIRE( same( x.texture_handle, y.texture_handle ) );
+	}
+
+	REQUIRE( a.meshes->size() == b.meshes->size() );
+	for ( size_t i = 0; i < a.meshes->size(); ++i )
+	{
+		auto& x = ( *a.meshes )[i];
+		auto& y = ( *b.meshes )[i];
+		REQUIRE( x.name == y.name );
+		REQUIRE( x.weights == y.weights );
+		REQUIRE( x.primitives.size() == y.primitives.size() );
+		for ( size_t p = 0; p < x.primitives.size(); ++p )
+		{
+			auto& px = x.primitives[p];
+			auto& py = y.primitives[p];
+			REQUIRE( px.mode == py.mode );
+			REQUIRE( same( px.material, py.material ) );
+			REQUIRE( same( px.indices_handle, py.indices_handle ) );
+			REQUIRE( px.attributes.size() == py.attributes.size() );
+			for ( auto& [semantic, accessor] : px.attributes )
+			{
+				REQUIRE( same( accessor, py.attributes.at( semantic ) ) );
+			}
+		}
+	}
+
+	REQUIRE( a.lights.size() == b.lights.size() );
+	for ( size_t i = 0; i < a.lights.size(); ++i )
+	{
+		auto& x = a.lights[i];
+		auto& y = b.lights[i];
+		REQUIRE( x.name == y.name );
+		REQUIRE( x.type == y.type );
+		REQUIRE( x.intensity == y.intensity );
+		REQUIRE( x.range == y.range );
+		REQUIRE( x.spot.inner_cone_angle == y.spot.inner_cone_angle );
+		REQUIRE( x.spot.outer_cone_angle == y.spot.outer_cone_angle );
+	}
+
+	REQUIRE( a.nodes->size() == b.nodes->size() );
+	for ( size_t i = 0; i < a.nodes->size(); ++i )
+	{
+		auto& x = ( *a.nodes )[i];
+		auto& y = ( *b.nodes )[i];
+		REQUIRE( x.name == y.name );
+		REQUIRE( same( x.mesh, y.mesh ) );
+		REQUIRE( same( x.get_parent(), y.get_parent() ) );
+		auto& cx = x.get_children();
+		auto& cy = y.get_children();
+		REQUIRE( cx.size() == cy.size() );
+		for ( size_t c = 0; c < cx.size(); ++c )
+		{
+			REQUIRE( same( cx[c], cy[c] ) );
+		}
+		REQUIRE( x.translation.x == y.translation.x );
+		REQUIRE( x.translation.z == y.translation.z );
+		REQUIRE( x.rotation.y == y.rotation.y );
+		REQUIRE( x.rotation.w == y.rotation.w );
+		REQUIRE( x.scale.x == y.scale.x );
+	}
+
+	REQUIRE( a.animations.size() == b.animations.size() );
+	for ( size_t i = 0; i < a.animations.size(); ++i )
+	{
+		auto& x = a.animations[i];
+		auto& y = b.animations[i];
+		REQUIRE( x.name == y.name );
+		REQUIRE( x.samplers->size() == y.samplers->size() );
+		for ( size_t s = 0; s < x.samplers->size(); ++s )
+		{
+			auto& sx = ( *x.samplers )[s];
+			auto& sy = ( *y.samplers )[s];
+			REQUIRE( same( sx.input, sy.input ) );
+			REQUIRE( same( sx.output, sy.output ) );
+			REQUIRE( sx.interpolation == sy.interpolation );
+		}
+		REQUIRE( x.channels->size() == y.channels->size() );
+		for ( size_t c = 0; c < x.channels->size(); ++c )
+		{
+			auto& cx = ( *x.channels )[c];
+			auto& cy = ( *y.channels )[c];
+			REQUIRE( same( cx.sampler, cy.sampler ) );
+			REQUIRE( same( cx.target.node, cy.target.node ) );
+			REQUIRE( cx.target.path == cy.target.path );
+		}
+	}
+
+	REQUIRE( a.boxes.size() == b.boxes.size() );
+	REQUIRE( a.spheres.size() == b.spheres.size() );
+
+	REQUIRE( a.scripts.size() == b.scripts.size() );
+	for ( size_t i = 0; i < a.scripts.size(); ++i )
+	{
+		REQUIRE( a.scripts[i].uri == b.scripts[i].uri );
+		REQUIRE( a.scripts[i].name == b.scripts[i].name );
+	}
+
+	REQUIRE( a.scenes.size() == b.scenes.size() );
+	for ( size_t i = 0; i < a.scenes.size(); ++i )
+	{
+		auto& x = a.scenes[i];
+		auto& y = b.scenes[i];
+		REQUIRE( x.name == y.name );
+		REQUIRE( x.nodes.size() == y.nodes.size() );
+		for ( size_t n = 0; n < x.nodes.size(); ++n )
+		{
+			REQUIRE( same( x.nodes[n], y.nodes[n] ) );
+		}
+	}
+
+	REQUIRE( ( a.scene == nullptr ) == ( b.scene == nullptr ) );
+	if ( a.scene )
+	{
+		REQUIRE( a.scene - a.scenes.data() == b.scene - b.scenes.data() );
+	}
+}
+
+
+TEST_CASE( "parser-sax" )
+{
+	auto dom = Gltf( nlohmann::json::parse( parser_fixture ), "." );
+	REQUIRE( dom.scene == &dom.scenes[1] );
+	REQUIRE( dom.nodes->at( 1 ).get_parent().get_index() == 0 );
+	REQUIRE( AccessorView<math::Vec3>( dom.accessors->at( 6 ) )[1].y == 1.0f );
+
+	LoadOptions options;
+	options.parser = LoadOptions::Parser::Sax;
+
+	SECTION( "memory" )
+	{
+		auto text = ByteSpan{ parser_fixture, std::strlen( parser_fixture ) };
+		auto sax  = Gltf::load_streaming( text, ".", options );
+		require_equal( dom, sax );
+	}
+
+	SECTION( "stream" )
+	{
+		std::istringstream in( parser_fixture );
+		auto sax = Gltf::load_streaming( in, ".", options );
+		require_equal( dom, sax );
+
+		// Models stay consistent when moved around
+		auto moved = std::move( sax );
+		require_equal( dom, moved );
+	}
+
+	SECTION( "invalid" )
+	{
+		auto text = std::string( parser_fixture );
+		text.resize( text.size() / 2 );
+		REQUIRE_THROWS_AS( Gltf::load_streaming( ByteSpan{ text.data(), text.size() }, ".", options ),
+		                   std::runtime_error );
+	}
+}
+
+
+TEST_CASE( "parser-tokenizer" )
+{
+	auto dom = Gltf( nlohmann::json::parse( parser_fixture ), "." );
+	REQUIRE( dom.materials->at( 0 ).name == "r\xc3\xa9" "d \"1\"\n\xf0\x9f\x98\x80" );
+
+	LoadOptions options;
+	options.parser = LoadOptions::Parser::Tokenizer;
+	auto text = ByteSpan{ parser_fixture, std::strlen( parser_fixture ) };
+
+	SECTION( "conformance" )
+	{
+		auto tokenized = Gltf::parse( text, ".", options );
+		require_equal( dom, tokenized );
+		REQUIRE( tokenized.lights[1].spot.outer_cone_angle == 0.5f );
+	}
+
+	SECTION( "numbers" )
+	{
+		auto numbers = R"({ "asset": { "version": "2.0" }, "accessors": [ { "count": 1, "componentType": 5126, "type": "SCALAR",
+			"min": [ 0, -1, 0.5, 1e3, 1E-3, 123.456e-2, 0.1, 0.3, 2.2250738585072014e-308, 1e39, 99999999999999999999999.5 ] } ] })";
+		auto a = Gltf( nlohmann::json::parse( numbers ), "." );
+		auto b = Gltf::parse( ByteSpan{ numbers, std::strlen( numbers ) }, ".", options );
+		REQUIRE( a.accessors->at( 0 ).min == b.accessors->at( 0 ).min );
+	}
+
+	SECTION( "invalid" )
+	{
+		for ( auto invalid : { R"({ "asset": { "version": "2.0" } )", R"({ "asset": { "version": 2.0. } })",
+		                       R"({ "asset": { "version": "2.0" } } x)", R"({ "asset": [ 1 2 ] })",
+		                       R"({ "asset": "\x" })", R"({ "nodes": [ { "rotation": [ 0, 0, 1 ] } ] })" } )
+		{
+			REQUIRE_THROWS_AS( Gltf::parse( ByteSpan{ invalid, std::strlen( invalid ) }, ".", options ),
+			                   std::runtime_error );
+		}
+	}
+}
+
+
+TEST_CASE( "parser-blob" )
+{
+	auto dom = Gltf( nlohmann::json::parse( parser_fixture ), "." );
+
+	std::ostringstream out;
+	auto source = BlobSource::from_bytes( ByteSpan{ parser_fixture, std::strlen( parser_fixture ) } );
+	dom.save_blob( out, source );
+	auto bytes = std::make_shared<std::string>( out.str() );
+	auto blob = ByteSpan{ bytes->data(), bytes->size(), bytes };
+
+	SECTION( "round-trip" )
+	{
+		REQUIRE( is_blob_current( blob, source ) );
+		auto loaded = Gltf::load_blob( blob, "." );
+		require_equal( dom, loaded );
+
+		// Buffers point into the blob
+		auto& buffer = loaded.buffers->at( 0 );
+		REQUIRE( buffer.data.empty() );
+		REQUIRE( buffer.get_data() >= bytes->data() );
+		REQUIRE( buffer.get_data() < bytes->data() + bytes->size() );
+
+		auto moved = std::move( loaded );
+		require_equal( dom, moved );
+	}
+
+	SECTION( "stale" )
+	{
+		auto other = source;
+		other.hash += 1;
+		REQUIRE( !is_blob_current( blob, other ) );
+
+		// Models loaded with other sections, scenes or topology are not the same
+		LoadOptions options;
+		options.parser = LoadOptions::Parser::Tokenizer;
+		options.load_threads = 2;
+		REQUIRE( is_blob_current( blob, source, options ) );
+		options.list_topology = true;
+		REQUIRE( !is_blob_current( blob, source, options ) );
+		options = {};
+		options.sections.cameras = false;
+		REQUIRE( !is_blob_current( blob, source, options ) );
+		options = {};
+		options.scenes = { 1 };
+		REQUIRE( !is_blob_current( blob, source, options ) );
+	}
+
+	SECTION( "invalid" )
+	{
+		auto truncated = blob;
+		truncated.size /= 2;
+		REQUIRE( !is_blob_current( truncated, source ) );
+		REQUIRE_THROWS_AS( Gltf::load_blob( truncated ), std::runtime_error );
+
+		auto version = *bytes;
+		version[4] += 1;
+		REQUIRE_THROWS_AS( Gltf::load_blob( ByteSpan{ version.data(), version.size() } ), std::runtime_error );
+	}
+
+	SECTION( "cached" )
+	{
+		auto path = std::string( "./test-blob.gltf" );
+		std::ofstream( path ) << parser_fixture;
+
+		auto first = Gltf::load_cached( path );
+		require_equal( dom, first );
+		REQUIRE( !first.buffers->at( 0 ).data.empty() );
+
+		// The second load reads the blob
+		auto second = Gltf::load_cached( path );
+		require_equal( dom, second );
+		REQUIRE( second.buffers->at( 0 ).data.empty() );
+
+		// A changed model is loaded again
+		std::ofstream( path ) << R"({ "asset": { "version": "2.0" }, "accessors": [] })";
+		auto third = Gltf::load_cached( path );
+		REQUIRE( third.nodes->empty() );
+		REQUIRE( Gltf::load_cached( path ).nodes->empty() );
+
+		// A blob which can not be written does not fail the load
+		std::ofstream( path ) << parser_fixture;
+		auto unwritten = Gltf::load_cached( path, {}, "./test-blob-missing/test-blob.gltf.blob" );
+		require_equal( dom, unwritten );
+		REQUIRE( !std::ifstream( "./test-blob-missing/test-blob.gltf.blob.tmp" ).is_open() );
+
+		std::remove( path.c_str() );
+		std::remove( ( path + ".blob" ).c_str() );
+	}
+
+	SECTION( "cached partial" )
+	{
+		auto path = std::string( "./test-blob-partial.gltf" );
+		std::ofstream( path ) << parser_fixture;
+
+		LoadOptions options;
+		options.sections.meshes = false;
+		REQUIRE( Gltf::load_cached( path, options ).meshes->empty() );
+		REQUIRE( Gltf::load_cached( path, options ).meshes->empty() );
+
+		// A full load does not get the blob of the partial one
+		auto full = Gltf::load_cached( path );
+		require_equal( dom, full );
+		REQUIRE( full.meshes->size() == 1 );
+
+		std::remove( path.c_str() );
+		std::remove( ( path + ".blob" ).c_str() );
+	}
+
+	SECTION( "cached buffer file" )
+	{
+		auto path = std::string( "./test-blob-buffer.gltf" );
+		std::ofstream( path ) << R"({ "asset": { "version": "2.0" },
+			"buffers": [ { "byteLength": 4, "uri": "test-blob-buffer.bin" } ] })";
+		auto write_bin = []( const std::vector<float>& values ) {
+			std::ofstream( "./test-blob-buffer.bin", std::ios::binary )
+				.write( reinterpret_cast<const char*>( values.data() ), values.size() * sizeof( float ) );
+		};
+		auto get_x = []( Gltf& model ) {
+			float x;
+			std::memcpy( &x, model.buffers->at( 0 ).get_data(), sizeof( x ) );
+			return x;
+		};
+
+		write_bin( { 1.0f } );
+		auto first = Gltf::load_cached( path );
+		REQUIRE( get_x( first ) == 1.0f );
+		auto second = Gltf::load_cached( path );
+		REQUIRE( second.buffers->at( 0 ).data.empty() );
+		REQUIRE( get_x( second ) == 1.0f );
+
+		// Only the buffer file is edited, growing so the change shows within the same second
+		write_bin( { 2.0f, 0.0f } );
+		auto edited = Gltf::load_cached( path );
+		REQUIRE( get_x( edited ) == 2.0f );
+
+		std::remove( path.c_str() );
+		std::remove( "./test-blob-buffer.bin" );
+		std::remove( ( path + ".blob" ).c_str() );
+	}
+}
+
+
+TEST_CASE( "parser-save" )
+{
+	auto dom = Gltf( nlohmann::json::parse( parser_fixture ), "." );
+
+	SECTION( "glb" )
+	{
+		auto path = std::string( "./test-save.glb" );
+		dom.save( path );
+
+		auto saved = Gltf::load( path );
+		require_equal( dom, saved, false );
+		REQUIRE( saved.buffers->size() == 1 );
+		REQUIRE( ( *saved.buffers )[0].uri.empty() );
+
+		std::remove( path.c_str() );
+	}
+
+	SECTION( "gltf" )
+	{
+		auto path = std::string( "./test-save.gltf" );
+		dom.save( path );
+
+		for ( auto parser : { LoadOptions::Parser::Dom, LoadOptions::Parser::Sax, LoadOptions::Parser::Tokenizer } )
+		{
+			LoadOptions options;
+			options.parser = parser;
+			auto saved = Gltf::load( path, options );
+			require_equal( dom, saved, false );
+		}
+
+		std::remove( path.c_str() );
+		std::remove( "./test-save.bin" );
+	}
+
+	SECTION( "coalesced" )
+	{
+		std::ostringstream json;
+		std::ostringstream bin;
+		dom.save_gltf( json, bin, "all.bin" );
+
+		auto j = nlohmann::json::parse( json.str() );
+		REQUIRE( j["buffers"].size() == 1 );
+		REQUIRE( j["buffers"][0]["uri"] == "all.bin" );
+		REQUIRE( j["buffers"][0]["byteLength"] == bin.str().size() );
+
+		// Only the bytes of the views are saved, each one starting at the next aligned offset
+		REQUIRE( bin.str().size() == 64 + 40 );
+		REQUIRE( j["bufferViews"][1]["byteOffset"] == 48 );
+		REQUIRE( j["bufferViews"][2]["byteOffset"] == 64 );
+
+		// Integer texture coordinates need the quantization extension
+		REQUIRE( j["accessors"][5]["normalized"] == true );
+		REQUIRE( j["extensionsRequired"] == nlohmann::json::array( { "KHR_mesh_quantization" } ) );
+		REQUIRE( j["extensionsUsed"].size() == 2 );
+	}
+
+	SECTION( "transform" )
+	{
+		// Scaled by 2, turned a quarter around z and moved
+		auto model = Gltf( nlohmann::json::parse( R"({
+			"asset": { "version": "2.0" },
+			"nodes": [
+				{ "name": "still", "matrix": [ 0, 2, 0, 0, -2, 0, 0, 0, 0, 0, 2, 0, 1, 2, 3, 1 ] },
+				{ "name": "turning", "matrix": [ 0, 2, 0, 0, -2, 0, 0, 0, 0, 0, 2, 0, 1, 2, 3, 1 ] }
+			]
+		})" ), "." );
+		model.nodes->at( 0 ).translation = math::Vec3( 0.0f, 0.0f, 1.0f );
+		auto turning = model.nodes.get_handle( 1 );
+
+		auto& animation = model.animations.emplace_back( model );
+		animation.add_rotation( turning, { 0.0f, 1.0f }, { math::Quat::identity, math::Quat::identity } );
+
+		std::ostringstream json;
+		std::ostringstream bin;
+		model.save_gltf( json, bin, "transform.bin" );
+		auto j = nlohmann::json::parse( json.str() );
+
+		// Either a matrix or its parts, and only the parts for animated nodes
+		auto& a = j["nodes"][0];
+		REQUIRE( a.count( "matrix" ) );
+		REQUIRE( !a.count( "rotation" ) );
+		REQUIRE( !a.count( "translation" ) );
+		auto& b = j["nodes"][1];
+		REQUIRE( !b.count( "matrix" ) );
+		REQUIRE( b["translation"] == nlohmann::json::array( { 1.0f, 2.0f, 3.0f } ) );
+		REQUIRE( b["scale"][0].get<float>() == Approx( 2.0f ) );
+		REQUIRE( b["rotation"][2].get<float>() == Approx( std::sqrt( 0.5f ) ) );
+		REQUIRE( b["rotation"][3].get<float>() == Approx( std::sqrt( 0.5f ) ) );
+	}
+
+	SECTION( "runtime" )
+	{
+		Gltf model;
+		auto& scene = model.scenes.emplace_back();
+		scene.model = &model;
+		model.scene = &scene;
+
+		auto node = scene.create_node( "triangle" );
+		node->mesh = model.create_mesh( Mesh::create_triangle( { 0, 0, 0 }, { 1, 0, 0 }, { 0, 2, 0 } ) );
+
+		auto& animation = model.animations.emplace_back( model );
+		animation.add_rotation( node, { 0.0f, 1.0f }, { math::Quat::identity, math::Quat::identity } );
+
+		std::stringstream glb;
+		model.save_glb( glb );
+		auto bytes = glb.str();
+		REQUIRE( bytes.size() % 4 == 0 );
+
+		auto saved = Gltf::load_glb( ByteSpan{ bytes.data(), bytes.size() } );
+		REQUIRE( saved.scene == &saved.scenes[0] );
+		auto& primitive = ( *saved.meshes )[0].primitives[0];
+		REQUIRE( primitive.attributes.size() == 3 );
+
+		auto& position = *primitive.attributes.at( Primitive::Semantic::POSITION );
+		REQUIRE( position.count == 3 );
+		REQUIRE( position.min == std::vector<float>{ 0, 0, 0 } );
+		REQUIRE( position.max == std::vector<float>{ 1, 2, 0 } );
+		REQUIRE( reinterpret_cast<const float*>( position.get_data() )[7] == 2.0f );
+
+		auto& indices = *primitive.indices_handle;
+		REQUIRE( indices.count == 6 );
+		REQUIRE( indices.component_type == Accessor::ComponentType::UNSIGNED_SHORT );
+		REQUIRE( reinterpret_cast<const uint16_t*>( indices.get_data() )[5] == 0 );
+
+		REQUIRE( saved.animations[0].get_times( Handle<Animation::Sampler>( saved.animations[0].samplers, 0 ) ) ==
+			std::vector<float>{ 0.0f, 1.0f } );
+
+		// Without a normal for every vertex there is no NORMAL, with them it goes along
+		REQUIRE( !primitive.attributes.count( Primitive::Semantic::NORMAL ) );
+		for ( auto& vertex : node->mesh->primitives[0].vertices )
+		{
+			vertex.n = { 0.0f, 0.0f, -1.0f };
+		}
+		std::stringstream normal_glb;
+		model.save_glb( normal_glb );
+		bytes = normal_glb.str();
+		auto normal_saved = Gltf::load_glb( ByteSpan{ bytes.data(), bytes.size() } );
+		auto& normal = *( *normal_saved.meshes )[0].primitives[0].attributes.at( Primitive::Semantic::NORMAL );
+		REQUIRE( normal.count == 3 );
+		REQUIRE( normal.type == Accessor::Type::VEC3 );
+		REQUIRE( reinterpret_cast<const float*>( normal.get_data() )[8] == -1.0f );
+	}
+
+	SECTION( "locale" )
+	{
+		// Hosts with a decimal comma still get json numbers
+		if ( std::setlocale( LC_NUMERIC, "de_DE.UTF-8" ) )
+		{
+			std::ostringstream json;
+			std::ostringstream bin;
+			dom.save_gltf( json, bin, "all.bin" );
+			std::setlocale( LC_NUMERIC, "C" );
+			auto j = nlohmann::json::parse( json.str() );
+			REQUIRE( j["materials"][0]["pbrMetallicRoughness"]["metallicFactor"] == 0.5f );
+		}
+	}
+
+	SECTION( "empty" )
+	{
+		Gltf model;
+		model.save( "./test-save-empty.gltf" );
+		REQUIRE( !std::ifstream( "./test-save-empty.bin" ).is_open() );
+		REQUIRE( Gltf::load( "./test-save-empty.gltf" ).buffers->empty() );
+		std::remove( "./test-save-empty.gltf" );
+	}
+}
+
+
+/// Streams a mapped buffer of 1 GiB out, run it with few samples like --benchmark-samples 5
+TEST_CASE( "parser-save-benchmark", "[.benchmark]" )
+{
+	constexpr size_t size = size_t( 1 ) << 30;
+	{
+		std::ofstream out( "test-save-large.bin", std::ios::binary );
+		std::vector<char> chunk( size_t( 1 ) << 20, 1 );
+		for ( size_t i = 0; i < size; i += chunk.size() )
+		{
+			out.write( chunk.data(), chunk.size() );
+		}
+	}
+
+	auto json = nlohmann::json::parse( R"({
+		"asset": { "version": "2.0" },
+		"buffers": [ { "byteLength": 1073741824, "uri": "test-save-large.bin" } ],
+		"bufferViews": [ { "buffer": 0, "byteLength": 1073741824 } ]
+	})" );
+	LoadOptions options;
+	options.storage = ByteBuffer::Storage::Map;
+	auto model = Gltf( json, ".", options );
+
+	BENCHMARK( "gltf" )
+	{
+		model.save( "./test-save-out.gltf" );
+		return size;
+	};
+
+	BENCHMARK( "glb" )
+	{
+		model.save( "./test-save-out.glb" );
+		return size;
+	};
+
+	std::remove( "test-save-large.bin" );
+	std::remove( "test-save-out.gltf" );
+	std::remove( "test-save-out.bin" );
+	std::remove( "test-save-out.glb" );
+}
+
+
+/// @return A glTF json with many nodes, meshes and accessors
+std::string make_large_gltf( const size_t count )
+{
+	std::string text = R"({ "asset": { "version": "2.0" },)"
+	                   R"( "buffers": [ { "byteLength": 4, "uri": "data:application/octet-stream;base64,AAECAw==" } ],)"
+	                   R"( "bufferViews": [ { "buffer": 0, "byteLength": 4 } ], "accessors": [)";
+	for ( size_t i = 0; i < count; ++i )
+	{
+		text += i ? "," : "";
+		text += R"({ "bufferView": 0, "componentType": 5121, "count": 4, "type": "SCALAR", "min": [ 0 ], "max": [ 3 ] })";
+	}
+	text += R"(], "meshes": [)";
+	for ( size_t i = 0; i < count; ++i )
+	{
+		auto a = std::to_string( i );
+		text += i ? "," : "";
+		text += R"({ "name": "mesh)" + a + R"(", "primitives": [ { "attributes": { "POSITION": )" + a + " } } ] }";
+	}
+	text += R"(], "nodes": [)";
+	for ( size_t i = 0; i < count; ++i )
+	{
+		auto a = std::to_string( i );
+		text += i ? "," : "";
+		text += R"({ "name": "node)" + a + R"(", "mesh": )" + a + R"(, "translation": [ 1.5, 2.5, 3.5 ] })";
+	}
+	text += R"(], "scenes": [ { "nodes": [ 0 ] } ] })";
+	return text;
+}
+
+
+TEST_CASE( "parser-benchmark", "[.benchmark]" )
+{
+	auto text = make_large_gltf( 20000 );
+
+	BENCHMARK( "dom" )
+	{
+		return Gltf( nlohmann::json::parse( text ), "." ).nodes->size();
+	};
+
+	LoadOptions options;
+	options.parser = LoadOptions::Parser::Sax;
+	BENCHMARK( "sax" )
+	{
+		return Gltf::load_streaming( ByteSpan{ text.data(), text.size() }, ".", options ).nodes->size();
+	};
+
+	options.parser = LoadOptions::Parser::Tokenizer;
+	BENCHMARK( "tokenizer" )
+	{
+		return Gltf::load_tokenized( ByteSpan{ text.data(), text.size() }, ".", options ).nodes->size();
+	};
+
+	std::ostringstream out;
+	Gltf::load_tokenized( ByteSpan{ text.data(), text.size() }, ".", options ).save_blob( out );
+	auto blob = out.str();
+	BENCHMARK( "blob" )
+	{
+		return Gltf::load_blob( ByteSpan{ blob.data(), blob.size() } ).nodes->size();
+	};
+}
+
+
+} // namespace spot::gfx
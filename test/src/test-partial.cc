@@ -0,0 +1,216 @@
+#include "test.h"
+
+#include <cstring>
+#include <spot/gltf/gltf.h>
+
+namespace spot::gfx
+{
+
+
+/// Two scenes with a mesh each, an animation and an image, every one in its own buffer
+const char* partial_fixture = R"({
+	"asset": { "version": "2.0" },
+	"scene": 1,
+	"buffers": [
+		{ "byteLength": 4, "uri": "data:application/octet-stream;base64,AAECAw==" },
+		{ "byteLength": 4, "uri": "data:application/octet-stream;base64,BAUGBw==" },
+		{ "byteLength": 8, "uri": "data:application/octet-stream;base64,AAAAAAAAgD8=" },
+		{ "byteLength": 4, "uri": "data:application/octet-stream;base64,CAkKCw==" }
+	],
+	"bufferViews": [
+		{ "buffer": 0, "byteLength": 4 },
+		{ "buffer": 1, "byteLength": 4 },
+		{ "buffer": 2, "byteLength": 8 },
+		{ "buffer": 3, "byteLength": 4 }
+	],
+	"accessors": [
+		{ "bufferView": 0, "componentType": 5121, "count": 4, "type": "SCALAR" },
+		{ "bufferView": 1, "componentType": 5121, "count": 4, "type": "SCALAR" },
+		{ "bufferView": 2, "componentType": 5126, "count": 1, "type": "SCALAR" },
+		{ "bufferView": 2, "byteOffset": 4, "componentType": 5126, "count": 1, "type": "SCALAR" }
+	],
+	"cameras": [ { "type": "perspective", "perspective": { "yfov": 1.0, "zfar": 100.0, "znear": 0.1 } } ],
+	"images": [ { "bufferView": 3, "mimeType": "image/png" } ],
+	"materials": [ { "name": "material" } ],
+	"meshes": [
+		{ "primitives": [ { "attributes": { "POSITION": 0 }, "material": 0 } ] },
+		{ "primitives": [ { "attributes": { "POSITION": 1 } } ] }
+	],
+	"nodes": [
+		{ "name": "root", "mesh": 0, "camera": 0, "children": [ 1 ] },
+		{ "name": "child" },
+		{ "name": "other", "mesh": 1 }
+	],
+	"animations": [ {
+		"samplers": [ { "input": 2, "output": 3 } ],
+		"channels": [ { "sampler": 0, "target": { "node": 1, "path": "scale" } } ]
+	} ],
+	"scenes": [ { "name": "first", "nodes": [ 0 ] }, { "name": "second", "nodes": [ 2 ] } ]
+})";
+
+
+/// @return Whether each buffer of the model has been loaded
+std::vector<bool> loaded_buffers( Gltf& model )
+{
+	std::vector<bool> ret;
+	for ( auto& buffer : *model.buffers )
+	{
+		ret.push_back( buffer.is_loaded() );
+	}
+	return ret;
+}
+
+
+TEST_CASE( "partial-load" )
+{
+	auto text = ByteSpan{ partial_fixture, std::strlen( partial_fixture ) };
+	const LoadOptions::Parser parsers[] = { LoadOptions::Parser::Dom, LoadOptions::Parser::Sax, LoadOptions::Parser::Tokenizer };
+
+	SECTION( "whole" )
+	{
+		for ( auto parser : parsers )
+		{
+			LoadOptions options;
+			options.parser = parser;
+
+			REQUIRE( !options.is_partial() );
+			auto model = Gltf::parse( text, ".", options );
+			REQUIRE( model.scenes.size() == 2 );
+			REQUIRE( model.scene == &model.scenes[1] );
+			REQUIRE( loaded_buffers( model ) == std::vector<bool>{ true, true, true, true } );
+		}
+	}
+
+	SECTION( "scene" )
+	{
+		for ( auto parser : parsers )
+		{
+			LoadOptions options;
+			options.parser = parser;
+			options.scenes = { 0 };
+			options.progress = std::make_shared<LoadProgress>();
+			REQUIRE( options.is_partial() );
+
+			auto model = Gltf::parse( text, ".", options );
+
+			// The default scene is not kept, so the first kept one is current
+			REQUIRE( model.scenes.size() == 1 );
+			REQUIRE( model.scene == &model.scenes[0] );
+			REQUIRE( model.scene->name == "first" );
+			REQUIRE( model.nodes->size() == 3 );
+
+			// The mesh of the other scene is never read
+			REQUIRE( loaded_buffers( model ) == std::vector<bool>{ true, false, true, true } );
+			REQUIRE( options.progress->bytes_total == 16 );
+			REQUIRE( options.progress->bytes_loaded == 16 );
+			REQUIRE( options.progress->stage == LoadProgress::Stage::Done );
+			REQUIRE( model.get_accessor( 0 )->get_data()[3] == 3 );
+		}
+	}
+
+	SECTION( "scenes" )
+	{
+		for ( auto parser : parsers )
+		{
+			LoadOptions options;
+			options.parser = parser;
+			options.scenes = { 1, 0 };
+			auto model = Gltf::parse( text, ".", options );
+
+			REQUIRE( model.scenes.size() == 2 );
+			REQUIRE( model.scene == &model.scenes[0] );
+			REQUIRE( model.scene->name == "second" );
+			REQUIRE( model.scene->nodes[0]->name == "other" );
+			REQUIRE( loaded_buffers( model ) == std::vector<bool>{ true, true, true, true } );
+		}
+	}
+
+	SECTION( "invalid-scene" )
+	{
+		for ( auto parser : parsers )
+		{
+			LoadOptions options;
+			options.parser = parser;
+			options.scenes = { 2 };
+			REQUIRE_THROWS_AS( Gltf::parse( text, ".", options ), std::runtime_error );
+		}
+	}
+
+	SECTION( "geometry" )
+	{
+		for ( auto parser : parsers )
+		{
+			LoadOptions options;
+			options.parser              = parser;
+			options.sections.materials  = false;
+			options.sections.animations = false;
+			options.sections.cameras    = false;
+
+			auto model = Gltf::parse( text, ".", options );
+
+			REQUIRE( model.materials->empty() );
+			REQUIRE( model.images->empty() );
+			REQUIRE( model.animations.empty() );
+			REQUIRE( model.cameras.empty() );
+			REQUIRE( model.meshes->size() == 2 );
+			REQUIRE( !model.meshes->at( 0 ).primitives[0].material );
+			REQUIRE( loaded_buffers( model ) == std::vector<bool>{ true, true, false, false } );
+		}
+	}
+
+	SECTION( "meshes" )
+	{
+		for ( auto parser : parsers )
+		{
+			LoadOptions options;
+			options.parser = parser;
+			options.sections.nodes = false;
+
+			auto model = Gltf::parse( text, ".", options );
+
+			// Scenes and animations need nodes
+			REQUIRE( model.nodes->empty() );
+			REQUIRE( model.animations.empty() );
+			REQUIRE( model.scenes.empty() );
+			REQUIRE( model.scene == nullptr );
+			REQUIRE( model.meshes->size() == 2 );
+			REQUIRE( loaded_buffers( model ) == std::vector<bool>{ true, true, false, true } );
+		}
+	}
+
+	SECTION( "nothing" )
+	{
+		for ( auto parser : parsers )
+		{
+			LoadOptions options;
+			options.parser              = parser;
+			options.sections.meshes     = false;
+			options.sections.animations = false;
+			options.sections.materials  = false;
+
+			auto model = Gltf::parse( text, ".", options );
+
+			REQUIRE( model.meshes->empty() );
+			REQUIRE( !model.nodes->at( 0 ).mesh );
+			REQUIRE( model.scene->name == "second" );
+			REQUIRE( loaded_buffers( model ) == std::vector<bool>{ false, false, false, false } );
+		}
+	}
+
+	SECTION( "lazy" )
+	{
+		for ( auto parser : parsers )
+		{
+			LoadOptions options;
+			options.parser       = parser;
+			options.scenes       = { 0 };
+			options.lazy_buffers = true;
+
+			auto model = Gltf::parse( text, ".", options );
+			REQUIRE( loaded_buffers( model ) == std::vector<bool>{ false, false, false, false } );
+		}
+	}
+}
+
+
+} // namespace spot::gfx
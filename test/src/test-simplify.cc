@@ -0,0 +1,252 @@
+#include "test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <spot/gltf/gltf.h>
+#include <spot/gltf/simplify.h>
+
+namespace spot::gfx
+{
+
+
+/// @return A primitive of side by side vertices on a plane, or bent on a sphere
+Primitive make_surface( const uint32_t side, const bool sphere )
+{
+	Primitive ret;
+	for ( uint32_t y = 0; y < side; ++y )
+	{
+		for ( uint32_t x = 0; x < side; ++x )
+		{
+			auto u = float( x ) / ( side - 1 );
+			auto v = float( y ) / ( side - 1 );
+			auto p = math::Vec3( u, v, 0.0f );
+			if ( sphere )
+			{
+				// A cap, as a whole sphere would join its own borders
+				auto theta = u * 3.0f;
+				auto phi = 0.2f + v * 2.7f;
+				p = math::Vec3( std::sin( phi ) * std::cos( theta ), std::sin( phi ) * std::sin( theta ), std::cos( phi ) );
+			}
+			auto& vertex = ret.vertices.emplace_back( p );
+			vertex.t = math::Vec2( u, v );
+		}
+	}
+	for ( uint32_t y = 0; y + 1 < side; ++y )
+	{
+		for ( uint32_t x = 0; x + 1 < side; ++x )
+		{
+			auto v = y * side + x;
+			for ( auto index : { v, v + 1, v + side + 1, v, v + side + 1, v + side } )
+			{
+				ret.indices.push_back( index );
+			}
+		}
+	}
+	return ret;
+}
+
+
+/// @return Whether a vertex is indexed
+bool is_indexed( const Indices& indices, const Index vertex )
+{
+	for ( size_t i = 0; i < indices.size(); ++i )
+	{
+		if ( indices[i] == vertex )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+
+TEST_CASE( "simplify" )
+{
+	SECTION( "plane" )
+	{
+		auto plane = make_surface( 17, false );
+		auto positions = &plane.vertices[0].p.x;
+		auto indices = plane.indices;
+		auto error = simplify( indices, positions, plane.vertices.size(), sizeof( Vertex ), 0, 1e-3f );
+		REQUIRE( indices.size() % 3 == 0 );
+		REQUIRE( indices.size() < plane.indices.size() / 10 );
+		REQUIRE( error <= 1e-3f );
+		REQUIRE( indices.get_component_type() == plane.indices.get_component_type() );
+
+		// Corners do not move
+		for ( Index corner : { 0, 16, 16 * 17, 17 * 17 - 1 } )
+		{
+			REQUIRE( is_indexed( indices, corner ) );
+		}
+	}
+
+	SECTION( "sphere" )
+	{
+		auto sphere = make_surface( 33, true );
+		auto positions = &sphere.vertices[0].p.x;
+		auto count = sphere.vertices.size();
+
+		auto half = sphere.indices;
+		auto half_error = simplify( half, positions, count, sizeof( Vertex ), half.size() / 2, 1.0f );
+		REQUIRE( half.size() <= sphere.indices.size() / 2 );
+		REQUIRE( half_error > 0.0f );
+
+		auto tenth = sphere.indices;
+		auto tenth_error = simplify( tenth, positions, count, sizeof( Vertex ), tenth.size() / 10 / 3 * 3, 1.0f );
+		REQUIRE( tenth.size() <= sphere.indices.size() / 10 );
+		REQUIRE( tenth_error > half_error );
+		REQUIRE( tenth_error < 0.05f );
+
+		// Curved surfaces do not go down without error
+		auto exact = sphere.indices;
+		REQUIRE( simplify( exact, positions, count, sizeof( Vertex ), 0, 1e-6f ) <= 1e-6f );
+		REQUIRE( exact.size() > half.size() );
+	}
+
+	SECTION( "seam" )
+	{
+		// The middle column is split in two vertices, as texture seams are
+		auto plane = make_surface( 9, false );
+		for ( Index row = 0; row < 9; ++row )
+		{
+			plane.vertices.emplace_back( plane.vertices[row * 9 + 4].p );
+		}
+		for ( size_t i = 0; i < plane.indices.size(); i += 3 )
+		{
+			if ( plane.indices[i] % 9 >= 4 && plane.indices[i + 1] % 9 >= 4 && plane.indices[i + 2] % 9 >= 4 )
+			{
+				for ( size_t k = 0; k < 3; ++k )
+				{
+					auto index = plane.indices[i + k];
+					if ( index % 9 == 4 )
+					{
+						plane.indices.set( i + k, 81 + index / 9 );
+					}
+				}
+			}
+		}
+
+		auto indices = plane.indices;
+		simplify( indices, &plane.vertices[0].p.x, plane.vertices.size(), sizeof( Vertex ), 0, 0.01f );
+		REQUIRE( indices.size() < plane.indices.size() );
+		for ( Index row = 0; row < 9; ++row )
+		{
+			REQUIRE( is_indexed( indices, row * 9 + 4 ) );
+			REQUIRE( is_indexed( indices, 81 + row ) );
+		}
+	}
+
+	SECTION( "invalid" )
+	{
+		auto plane = make_surface( 3, false );
+		auto indices = Indices{ 0, 1, 2, 3 };
+		REQUIRE_THROWS( simplify( indices, &plane.vertices[0].p.x, 9, sizeof( Vertex ), 0, 1.0f ) );
+		indices = Indices{ 0, 1, 9 };
+		REQUIRE_THROWS( simplify( indices, &plane.vertices[0].p.x, 9, sizeof( Vertex ), 0, 1.0f ) );
+	}
+}
+
+
+TEST_CASE( "simplify-lods" )
+{
+	Gltf model;
+	auto& scene = model.scenes.emplace_back();
+	scene.model = &model;
+	model.scene = &scene;
+
+	auto sphere = make_surface( 33, true );
+	for ( auto& vertex : sphere.vertices )
+	{
+		vertex.p = vertex.p * 2.0f;
+	}
+	auto triangles = sphere.indices.size();
+	auto node = scene.create_node( "sphere" );
+	node->translation = math::Vec3( 1.0f, 2.0f, 3.0f );
+	node->mesh = model.create_mesh( Mesh( { std::move( sphere ) } ) );
+	auto& mesh = *node->mesh;
+	mesh.name = "sphere";
+
+	LodOptions options;
+	options.max_levels = 3;
+	generate_lods( model, 2, options );
+	REQUIRE( mesh.lods.size() == 3 );
+
+	// Errors are in model units, growing with the levels as triangles go down
+	auto previous = triangles;
+	auto error = 0.0f;
+	for ( auto& lod : mesh.lods )
+	{
+		REQUIRE( lod.primitives.size() == 1 );
+		REQUIRE( lod.primitives[0].vertices.empty() );
+		REQUIRE( lod.primitives[0].indices.size() < previous * 3 / 4 );
+		REQUIRE( lod.error >= error );
+		REQUIRE( lod.error < options.max_error * 4.0f );
+		previous = lod.primitives[0].indices.size();
+		error = lod.error;
+	}
+
+	std::ostringstream json;
+	std::ostringstream bin;
+	model.save_gltf( json, bin, "lods.bin" );
+	auto j = nlohmann::json::parse( json.str() );
+	REQUIRE( j["extensionsUsed"] == nlohmann::json::array( { "MSFT_lod" } ) );
+	REQUIRE( j["nodes"].size() == 4 );
+	REQUIRE( j["nodes"][0]["extensions"]["MSFT_lod"]["ids"] == nlohmann::json::array( { 1, 2, 3 } ) );
+	REQUIRE( j["nodes"][3]["mesh"] == 3 );
+
+	// Level nodes stand in place of their base node, outside every scene and hierarchy
+	REQUIRE( j["scenes"][0]["nodes"] == nlohmann::json::array( { 0 } ) );
+	for ( size_t n = 1; n < 4; ++n )
+	{
+		REQUIRE( !j["nodes"][n].count( "children" ) );
+		REQUIRE( j["nodes"][n]["translation"] == j["nodes"][0]["translation"] );
+	}
+	REQUIRE( !j["nodes"][0].count( "children" ) );
+	REQUIRE( j["meshes"].size() == 4 );
+	REQUIRE( j["meshes"][1]["name"] == "sphere_lod1" );
+	REQUIRE( j["meshes"][2]["extras"]["error"] == Approx( mesh.lods[1].error ) );
+
+	// Levels share the vertices of the mesh
+	auto& primitive = j["meshes"][0]["primitives"][0];
+	auto& lod_primitive = j["meshes"][3]["primitives"][0];
+	REQUIRE( lod_primitive["attributes"] == primitive["attributes"] );
+	REQUIRE( lod_primitive["indices"] != primitive["indices"] );
+	REQUIRE( j["accessors"][lod_primitive["indices"].get<size_t>()]["count"] == mesh.lods[2].primitives[0].indices.size() );
+}
+
+
+TEST_CASE( "simplify-benchmark", "[.benchmark]" )
+{
+	auto sphere = make_surface( 256, true );
+	auto positions = &sphere.vertices[0].p.x;
+	auto count = sphere.vertices.size();
+
+	BENCHMARK( "simplify" )
+	{
+		auto indices = sphere.indices;
+		return simplify( indices, positions, count, sizeof( Vertex ), indices.size() / 2, 0.05f );
+	};
+
+	// Meshes are simplified in parallel
+	Gltf model;
+	for ( size_t i = 0; i < 4; ++i )
+	{
+		model.meshes.push( Mesh( { make_surface( 128, true ) } ) );
+	}
+
+	BENCHMARK( "lods" )
+	{
+		generate_lods( model );
+		return ( *model.meshes )[0].lods.size();
+	};
+
+	BENCHMARK( "lods 4 threads" )
+	{
+		generate_lods( model, 4 );
+		return ( *model.meshes )[0].lods.size();
+	};
+}
+
+
+} // namespace spot::gfx
@@ -0,0 +1,170 @@
+#include "test.h"
+
+#include <cstring>
+#include <spot/gltf/gltf.h>
+#include <spot/gltf/topology.h>
+
+namespace spot::gfx
+{
+
+
+/// A quad drawn as an indexed strip, a fan, a line loop and an indexed list
+const char* topology_fixture = R"({
+	"asset": { "version": "2.0" },
+	"buffers": [ { "byteLength": 56,
+		"uri": "data:application/octet-stream;base64,AAAAAAAAAAAAAAAAAACAPwAAAAAAAAAAAAAAAAAAgD8AAAAAAACAPwAAgD8AAAAAAAABAAIAAwA=" } ],
+	"bufferViews": [ { "buffer": 0, "byteLength": 48 }, { "buffer": 0, "byteOffset": 48, "byteLength": 8 } ],
+	"accessors": [
+		{ "bufferView": 0, "componentType": 5126, "count": 4, "type": "VEC3" },
+		{ "bufferView": 1, "componentType": 5123, "count": 4, "type": "SCALAR" }
+	],
+	"meshes": [ { "primitives": [
+		{ "attributes": { "POSITION": 0 }, "indices": 1, "mode": 5 },
+		{ "attributes": { "POSITION": 0 }, "mode": 6 },
+		{ "attributes": { "POSITION": 0 }, "mode": 2 },
+		{ "attributes": { "POSITION": 0 }, "indices": 1 }
+	] } ]
+})";
+
+
+/// @return The values of indices
+std::vector<Index> get_values( const Indices& indices )
+{
+	std::vector<Index> ret;
+	for ( size_t i = 0; i < indices.size(); ++i )
+	{
+		ret.push_back( indices[i] );
+	}
+	return ret;
+}
+
+
+TEST_CASE( "topology" )
+{
+	SECTION( "modes" )
+	{
+		REQUIRE( get_list_mode( Primitive::Mode::TRIANGLE_STRIP ) == Primitive::Mode::TRIANGLES );
+		REQUIRE( get_list_mode( Primitive::Mode::TRIANGLE_FAN ) == Primitive::Mode::TRIANGLES );
+		REQUIRE( get_list_mode( Primitive::Mode::LINE_STRIP ) == Primitive::Mode::LINES );
+		REQUIRE( get_list_mode( Primitive::Mode::LINE_LOOP ) == Primitive::Mode::LINES );
+		REQUIRE( get_list_mode( Primitive::Mode::POINTS ) == Primitive::Mode::POINTS );
+
+		// Odd triangles of a strip keep the winding of the even ones
+		auto strip = Indices{ 0, 1, 2, 3, 4 };
+		REQUIRE( get_values( convert_to_list( strip, Primitive::Mode::TRIANGLE_STRIP ) ) ==
+			std::vector<Index>{ 0, 1, 2, 1, 3, 2, 2, 3, 4 } );
+		REQUIRE( get_values( convert_to_list( strip, Primitive::Mode::TRIANGLE_FAN ) ) ==
+			std::vector<Index>{ 1, 2, 0, 2, 3, 0, 3, 4, 0 } );
+		REQUIRE( get_values( convert_to_list( strip, Primitive::Mode::LINE_STRIP ) ) ==
+			std::vector<Index>{ 0, 1, 1, 2, 2, 3, 3, 4 } );
+		REQUIRE( get_values( convert_to_list( strip, Primitive::Mode::LINE_LOOP ) ) ==
+			std::vector<Index>{ 0, 1, 1, 2, 2, 3, 3, 4, 4, 0 } );
+		REQUIRE( get_values( convert_to_list( strip, Primitive::Mode::POINTS ) ) == get_values( strip ) );
+
+		// Strips stitched by repeating vertices lose the degenerate triangles
+		auto stitched = Indices{ 0, 1, 2, 3, 3, 4, 4, 5, 6, 7 };
+		REQUIRE( get_values( convert_to_list( stitched, Primitive::Mode::TRIANGLE_STRIP ) ) ==
+			std::vector<Index>{ 0, 1, 2, 1, 3, 2, 4, 5, 6, 5, 7, 6 } );
+
+		// Too short to draw anything
+		auto pair = Indices{ 0, 1 };
+		REQUIRE( convert_to_list( pair, Primitive::Mode::TRIANGLE_STRIP ).empty() );
+		REQUIRE( convert_to_list( Indices{ 0 }, Primitive::Mode::LINE_LOOP ).empty() );
+
+		// A loop of two indices is a single segment, not the same one twice
+		REQUIRE( get_values( convert_to_list( pair, Primitive::Mode::LINE_LOOP ) ) == std::vector<Index>{ 0, 1 } );
+	}
+
+	SECTION( "widths" )
+	{
+		auto bytes = Indices( Accessor::ComponentType::UNSIGNED_BYTE, 4 );
+		bytes.set( 1, 1 );
+		bytes.set( 2, 2 );
+		bytes.set( 3, 200 );
+		auto list = convert_to_list( bytes, Primitive::Mode::TRIANGLE_FAN );
+		REQUIRE( list.get_component_type() == Accessor::ComponentType::UNSIGNED_BYTE );
+		REQUIRE( list.get_max() == 200 );
+
+		// Vertices in order are indexed with at least 16 bits
+		Gltf model;
+		std::vector<float> positions( 70000 * 3 );
+		auto& primitive = model.meshes.push( Mesh( model ) )->primitives.emplace_back();
+		primitive.mode = Primitive::Mode::LINE_STRIP;
+		primitive.attributes[Primitive::Semantic::POSITION] = add_accessor( model, positions.data(),
+			positions.size() * sizeof( float ), 0, 0, Accessor::ComponentType::FLOAT, Accessor::Type::VEC3, 3 );
+		REQUIRE( convert_to_list( primitive ) );
+		REQUIRE( primitive.mode == Primitive::Mode::LINES );
+		REQUIRE( primitive.indices.get_component_type() == Accessor::ComponentType::UNSIGNED_SHORT );
+		REQUIRE( get_values( primitive.indices ) == std::vector<Index>{ 0, 1, 1, 2 } );
+		REQUIRE( !convert_to_list( primitive ) );
+
+		primitive.indices.clear();
+		primitive.mode = Primitive::Mode::TRIANGLE_STRIP;
+		primitive.attributes[Primitive::Semantic::POSITION]->count = 70000;
+		REQUIRE( convert_to_list( primitive ) );
+		REQUIRE( primitive.indices.get_component_type() == Accessor::ComponentType::UNSIGNED_INT );
+		REQUIRE( primitive.indices.size() == 69998 * 3 );
+		REQUIRE( primitive.indices.get_max() == 69999 );
+	}
+
+	SECTION( "load" )
+	{
+		auto text = ByteSpan{ topology_fixture, std::strlen( topology_fixture ) };
+		const LoadOptions::Parser parsers[] = { LoadOptions::Parser::Dom, LoadOptions::Parser::Sax, LoadOptions::Parser::Tokenizer };
+		for ( auto parser : parsers )
+		{
+			LoadOptions options;
+			options.parser = parser;
+			auto kept = Gltf::parse( text, ".", options );
+			REQUIRE( ( *kept.meshes )[0].primitives[0].mode == Primitive::Mode::TRIANGLE_STRIP );
+
+			options.list_topology = true;
+			options.load_threads = 2;
+			auto model = Gltf::parse( text, ".", options );
+			auto& primitives = ( *model.meshes )[0].primitives;
+			REQUIRE( primitives[0].mode == Primitive::Mode::TRIANGLES );
+			REQUIRE( primitives[1].mode == Primitive::Mode::TRIANGLES );
+			REQUIRE( primitives[2].mode == Primitive::Mode::LINES );
+			REQUIRE( primitives[3].mode == Primitive::Mode::TRIANGLES );
+
+			// New indices are in accessors, as loaded primitives are drawn from those
+			REQUIRE( primitives[0].indices_handle->count == 6 );
+			REQUIRE( primitives[1].indices_handle->count == 6 );
+			REQUIRE( primitives[2].indices_handle->count == 8 );
+			REQUIRE( primitives[3].indices_handle->count == 4 );
+			REQUIRE( primitives[3].indices.empty() );
+			REQUIRE( get_values( primitives[1].indices ) == std::vector<Index>{ 1, 2, 0, 2, 3, 0 } );
+		}
+	}
+}
+
+
+TEST_CASE( "topology-benchmark", "[.benchmark]" )
+{
+	// A long strip of a grid, stitched at the end of each row
+	const uint32_t side = 1024;
+	auto strip = Indices( Accessor::ComponentType::UNSIGNED_INT );
+	for ( uint32_t y = 0; y + 1 < side; ++y )
+	{
+		for ( uint32_t x = 0; x < side; ++x )
+		{
+			strip.push_back( y * side + x );
+			strip.push_back( ( y + 1 ) * side + x );
+		}
+		strip.push_back( ( y + 2 ) * side - 1 );
+		strip.push_back( ( y + 1 ) * side );
+	}
+
+	BENCHMARK( "strip" )
+	{
+		return convert_to_list( strip, Primitive::Mode::TRIANGLE_STRIP ).size();
+	};
+
+	BENCHMARK( "fan" )
+	{
+		return convert_to_list( strip, Primitive::Mode::TRIANGLE_FAN ).size();
+	};
+}
+
+
+} // namespace spot::gfx
@@ -1 +1,32 @@
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
 #include <catch2/catch.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <spot/gltf/gltf.h>
+
+namespace spot::gfx
+{
+
+
+/// Fixtures shared by the test sources, documented where they are defined
+
+/// Defined along the accessor tests
+Handle<Accessor> add_accessor( Gltf& model, const void* bytes, size_t size, size_t stride, size_t offset,
+	Accessor::ComponentType component_type, Accessor::Type type, size_t count );
+
+/// Defined along the assembly tests
+Primitive& add_quantized( Gltf& model, size_t count );
+
+/// Defined along the optimize tests
+std::vector<uint32_t> get_shuffled_grid( uint32_t side );
+Indices make_indices( const std::vector<uint32_t>& values );
+std::vector<std::array<Index, 3>> get_sorted_triangles( const Indices& indices );
+
+/// Defined along the simplify tests
+Primitive make_surface( uint32_t side, bool sphere );
+
+
+} // namespace spot::gfx